@@ -0,0 +1,113 @@
+#ifndef AUDIO_PLAYER_H
+#define AUDIO_PLAYER_H
+
+#include <stdbool.h>
+
+/* ========================================================================= */
+/*                            Defines                                        */
+/* ========================================================================= */
+#define AUDIO_REFILL_INTERVAL_MS 10 // Sleep of the audio thread between refills, far below a stream buffer
+#define AUDIO_SAMPLE_RING 8192      // Mono samples buffered from the mixer to the analysis, a power of two
+#define AUDIO_FFT_SIZE 1024         // Samples per spectrum, a power of two
+#define AUDIO_BAND_COUNT 9          // Octave bands of the spectrum: bins [2^b, 2^(b+1)) for band b
+#define AUDIO_BASS_BANDS 3          // Lowest bands averaged into the bass level, up to ~375 Hz at 48 kHz
+#define AUDIO_PEAK_DECAY 0.998f     // Per spectrum, how fast the loudest level of a band is forgotten
+
+/**
+ * @brief Music decoded and analysed on its own thread.
+ *
+ * The audio thread runs at a lowered priority and refills raylib's stream buffers every
+ * AUDIO_REFILL_INTERVAL_MS, so MP3 decoding never runs on the thread that simulates and draws.
+ * raylib's device thread hands the mixed samples to it through a lock-free single-producer,
+ * single-consumer ring, where they are turned into AUDIO_BAND_COUNT octave band levels. The
+ * levels are published with atomic stores and can be read from any thread without locking.
+ */
+typedef struct AudioPlayer AudioPlayer;
+
+/**
+ * @brief Opaque handle to the raylib music stream of a player.
+ */
+typedef struct AudioMusic AudioMusic;
+
+/* ========================================================================= */
+/*                           Function Prototypes                             */
+/* ========================================================================= */
+
+/**
+ * @brief Loads a music file, starts playing it and starts the audio thread.
+ *
+ * The audio device must already be initialized with InitAudioDevice().
+ *
+ * @param path The music file, in any format raylib streams.
+ *
+ * @return The player, or NULL if the file cannot be loaded (which is logged) or the thread
+ *         cannot be started.
+ */
+AudioPlayer *StartAudioPlayer(const char *path);
+
+/**
+ * @brief Reads the latest band levels.
+ *
+ * Each level is the band's amplitude relative to the loudest it has recently been, in [0, 1],
+ * so the levels follow the shape of the music whatever its volume. Levels taken while a new
+ * spectrum is being published can come from two consecutive spectra.
+ *
+ * @param player The player, or NULL for silence.
+ * @param levels Receives AUDIO_BAND_COUNT levels, from the lowest band up.
+ */
+void GetAudioBandLevels(const AudioPlayer *player, float *levels);
+
+/**
+ * @brief Returns the average level of the AUDIO_BASS_BANDS lowest bands, in [0, 1].
+ *
+ * @param player The player, or NULL for silence.
+ */
+float GetAudioBassLevel(const AudioPlayer *player);
+
+/**
+ * @brief Stops the audio thread, then stops and unloads the music. Accepts NULL.
+ *
+ * @param player The player to stop and free.
+ */
+void StopAudioPlayer(AudioPlayer *player);
+
+/**
+ * @brief Appends mixed audio to the ring of a player. Called on raylib's device thread.
+ *
+ * Never blocks: samples that do not fit are dropped.
+ *
+ * @param player The player.
+ * @param frames Interleaved float frames.
+ * @param frameCount The number of frames.
+ * @param channels The number of channels per frame; they are averaged into one.
+ */
+void PushAudioSamples(AudioPlayer *player, const float *frames, unsigned int frameCount, int channels);
+
+/**
+ * @brief Loads a music stream, routes its mixed samples to a player and starts playing it.
+ *
+ * Lives apart from the audio thread in audio_player_music.c, which can include raylib.h, as
+ * do the other AudioMusic functions. Only one music stream can feed a player at a time.
+ *
+ * @param path The music file.
+ * @param player The player that receives the samples.
+ *
+ * @return The stream, or NULL if the file cannot be loaded.
+ */
+AudioMusic *OpenAudioMusic(const char *path, AudioPlayer *player);
+
+/**
+ * @brief Decodes into every stream buffer the device has finished playing.
+ *
+ * @param music The stream, only ever updated from one thread.
+ */
+void UpdateAudioMusic(AudioMusic *music);
+
+/**
+ * @brief Stops, detaches and unloads a music stream.
+ *
+ * @param music The stream to close.
+ */
+void CloseAudioMusic(AudioMusic *music);
+
+#endif // AUDIO_PLAYER_H
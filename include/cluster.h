@@ -0,0 +1,231 @@
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+#include "cluster_net.h"
+#include "config.h"
+#include "force_field.h"
+#include "occupancy.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* ========================================================================= */
+/*                            Defines                                        */
+/* ========================================================================= */
+#define CLUSTER_MAGIC 0x53554C43u // "CLUS" as little-endian bytes
+#define CLUSTER_VERSION 1
+#define CLUSTER_TILE_WORDS 8                        // Bitmap words per tile row, 256 pixels
+#define CLUSTER_TILE_ROWS (1 << DIRTY_BAND_SHIFT)   // Rows per tile, one dirty band
+#define CLUSTER_TILE_SIZE (CLUSTER_TILE_WORDS * CLUSTER_TILE_ROWS) // Words per tile, one mask bit each
+
+/**
+ * @brief Sent by the compositor to each node once it connected.
+ *
+ * Every message is the raw struct in host byte order and layout, so all machines of a cluster
+ * must share one architecture. A node of the other byte order sends the CLUSTER_MAGIC of its
+ * hello byte-swapped, and the compositor rejects it.
+ *
+ * Node i of n simulates the particles [count * i / n, count * (i + 1) / n) of the scene, with
+ * their initial scanline placement on the full grid. Every message after it is a tick.
+ */
+typedef struct ClusterSetup
+{
+    uint32_t magic;         // CLUSTER_MAGIC
+    uint32_t version;       // CLUSTER_VERSION of the compositor
+    int32_t gridWidth;      // Simulation grid of the whole scene, in pixels
+    int32_t gridHeight;
+    int32_t particleCount;  // Particles of the whole scene
+    int32_t shardStart;     // First particle of the node's shard
+    int32_t shardEnd;       // One past its last particle
+    float friction;         // Force constants of the scene
+    int32_t fastMath;       // Non-zero for the fast integration kernels
+} ClusterSetup;
+
+/**
+ * @brief Header of a tick, followed by attractorCount ClusterAttractor records.
+ *
+ * A tick asks every node for one step under these attractors. A node answers it with a
+ * ClusterFrame before the compositor sends the next one, so the scene advances in lockstep.
+ */
+typedef struct ClusterTick
+{
+    int32_t step;           // Index of the step
+    int32_t attractorCount; // At most MAX_ATTRACTORS
+} ClusterTick;
+
+typedef struct ClusterAttractor
+{
+    float x;               // Position in grid pixels
+    float y;
+    float strength;        // As in Attractor
+    float falloffRadiusSq;
+} ClusterAttractor;
+
+/**
+ * @brief Header of a node's answer to a tick, followed by byteCount bytes of tiles.
+ *
+ * The occupancy bitmap of the shard is cut into tiles of CLUSTER_TILE_ROWS rows by
+ * CLUSTER_TILE_WORDS words, numbered in row-major order. Only tiles that changed since the
+ * node's previous frame are sent, each as its index, a CLUSTER_TILE_SIZE-bit mask of its
+ * non-zero words and then those words. A tile that became empty is sent with an empty mask.
+ */
+typedef struct ClusterFrame
+{
+    int32_t step;       // Index of the step the bitmap shows
+    int32_t tileCount;  // Tiles that follow
+    int32_t byteCount;  // Bytes of tiles that follow
+    float stepMs;       // Time the node took to integrate and splat the step
+} ClusterFrame;
+
+/**
+ * @brief A node's connection to the compositor and its copy of what the compositor has.
+ */
+typedef struct ClusterNodeLink
+{
+    ClusterSocket socket;
+    ClusterSetup setup;       // As received from the compositor
+    OccupancyBitmap sent;     // The bitmap as of the last frame sent, which the compositor mirrors
+    uint8_t *sentBands;       // Non-zero for every band of sent holding occupied pixels
+    uint8_t *payload;         // Encoded tiles of the frame being sent
+    int tilesPerRow;          // Tiles across the bitmap
+} ClusterNodeLink;
+
+/**
+ * @brief Totals of the traffic received by the compositor.
+ */
+typedef struct ClusterStats
+{
+    long long frames;      // Frames gathered, one per node per step
+    long long tiles;       // Changed tiles received
+    long long bytes;       // Bytes received, headers included
+    long long totalTiles;  // Tiles a full bitmap per frame would have been
+    double nodeStepMs;     // Sum of the step times reported by the nodes
+} ClusterStats;
+
+/**
+ * @brief The compositor's connections and its mirror of every node's bitmap.
+ */
+typedef struct ClusterCompositor
+{
+    ClusterSocket listener;
+    ClusterSocket sockets[MAX_THREADS];
+    OccupancyBitmap mirrors[MAX_THREADS]; // The last bitmap received from each node
+    uint8_t *payload;                     // Receive buffer for the tiles of one frame
+    int payloadCapacity;                  // Size of payload in bytes
+    uint8_t *bandChanged;                 // Non-zero for every band some node changed since it was last staged
+    int nodeCount;
+    int tilesPerRow;
+    int tileCount;                        // Tiles per bitmap
+    ClusterStats stats;
+} ClusterCompositor;
+
+/* ========================================================================= */
+/*                           Function Prototypes                             */
+/* ========================================================================= */
+
+/**
+ * @brief Connects to the compositor and receives the shard of this node.
+ *
+ * @param link A pointer to the link to initialize.
+ * @param host The host of the compositor.
+ * @param port Its TCP port.
+ *
+ * @return true once the setup was received and the buffers allocated; failures are logged.
+ */
+bool ConnectClusterNode(ClusterNodeLink *link, const char *host, int port);
+
+/**
+ * @brief Waits for the next tick and loads its attractors into a force field.
+ *
+ * @param link The link of the node.
+ * @param field Receives the attractors of the step.
+ * @param step Receives the index of the step.
+ *
+ * @return false once the compositor hung up or sent an invalid tick.
+ */
+bool ReceiveClusterTick(ClusterNodeLink *link, ForceField *field, int *step);
+
+/**
+ * @brief Sends the tiles of the shard that changed since the previous frame.
+ *
+ * Merges the per-worker bitmaps the step splatted into, then clears them like the combine
+ * phase does, so the next step starts from clear bitmaps.
+ *
+ * @param link The link of the node.
+ * @param buffers The per-worker bitmaps of the fused update phase.
+ * @param bufferCount The number of bitmaps in buffers.
+ * @param step The index of the step they hold.
+ * @param stepMs The time taken by the step, reported to the compositor.
+ *
+ * @return false if the compositor hung up.
+ */
+bool SendClusterFrame(ClusterNodeLink *link, OccupancyBitmap *buffers, int bufferCount, int step, float stepMs);
+
+/**
+ * @brief Closes the connection and frees the buffers of a link.
+ *
+ * @param link The link to close.
+ */
+void CloseClusterNode(ClusterNodeLink *link);
+
+/**
+ * @brief Waits until every node connected and sends each its shard.
+ *
+ * @param compositor A pointer to the compositor to initialize.
+ * @param config The scene: its grid, particle count, force constants, node count and port.
+ *
+ * @return true once every node received its setup; failures are logged and clean up.
+ */
+bool StartClusterCompositor(ClusterCompositor *compositor, const SimulationConfig *config);
+
+/**
+ * @brief Sends the attractors of a step to every node, which start integrating it at once.
+ *
+ * @param compositor The compositor.
+ * @param field The attractors of the step.
+ * @param step The index of the step.
+ *
+ * @return false if a node hung up.
+ */
+bool BroadcastClusterTick(ClusterCompositor *compositor, const ForceField *field, int step);
+
+/**
+ * @brief Receives every node's frame of a step and applies its tiles to the mirrors.
+ *
+ * @param compositor The compositor.
+ * @param step The index of the step that was broadcast.
+ *
+ * @return false if a node hung up or sent an invalid frame.
+ */
+bool GatherClusterFrames(ClusterCompositor *compositor, int step);
+
+/**
+ * @brief Copies every band a node changed from the mirrors into the combine bitmaps.
+ *
+ * Band b of bitmaps[n] receives band b of node n's mirror, and its bandTouched flag is set if
+ * the band holds occupied pixels, which is how the combine phase expects to find it. The
+ * mirrors themselves are never cleared.
+ *
+ * @param compositor The compositor.
+ * @param bitmaps One bitmap per node, clear outside the bands being staged.
+ * @param bands Receives the staged bands in ascending order, room for one per band.
+ *
+ * @return The number of bands staged, all of which have to be repainted.
+ */
+int StageClusterBands(ClusterCompositor *compositor, OccupancyBitmap *bitmaps, int *bands);
+
+/**
+ * @brief Logs the traffic of the run.
+ *
+ * @param compositor The compositor.
+ */
+void LogClusterSummary(const ClusterCompositor *compositor);
+
+/**
+ * @brief Disconnects every node, which ends them, and frees the mirrors.
+ *
+ * @param compositor The compositor to stop.
+ */
+void StopClusterCompositor(ClusterCompositor *compositor);
+
+#endif // CLUSTER_H
@@ -0,0 +1,84 @@
+#ifndef CLUSTER_NET_H
+#define CLUSTER_NET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Blocking TCP streams between the cluster compositor and its nodes. The socket headers stay
+// in cluster_net.c: winsock2.h declares names that clash with raylib.h, like windows.h does.
+
+/* ========================================================================= */
+/*                            Defines                                        */
+/* ========================================================================= */
+#define CLUSTER_INVALID_SOCKET ((ClusterSocket)-1)
+
+/**
+ * @brief A connected or listening socket, SOCKET on Windows and a file descriptor elsewhere.
+ */
+typedef intptr_t ClusterSocket;
+
+/* ========================================================================= */
+/*                           Function Prototypes                             */
+/* ========================================================================= */
+
+/**
+ * @brief Initializes the socket library. Call once before any other function of this file.
+ *
+ * @return true on success.
+ */
+bool ClusterNetStartup(void);
+
+/**
+ * @brief Releases the socket library after the last socket was closed.
+ */
+void ClusterNetCleanup(void);
+
+/**
+ * @brief Listens for nodes on every interface.
+ *
+ * @param port The TCP port.
+ *
+ * @return The listening socket, or CLUSTER_INVALID_SOCKET if the port cannot be bound.
+ */
+ClusterSocket ClusterListen(int port);
+
+/**
+ * @brief Waits for the next node to connect.
+ *
+ * @param listener A socket returned by ClusterListen().
+ *
+ * @return The connection, with Nagle's algorithm off, or CLUSTER_INVALID_SOCKET on failure.
+ */
+ClusterSocket ClusterAccept(ClusterSocket listener);
+
+/**
+ * @brief Connects to a compositor.
+ *
+ * @param host The host name or address of the compositor.
+ * @param port Its TCP port.
+ *
+ * @return The connection, with Nagle's algorithm off, or CLUSTER_INVALID_SOCKET on failure.
+ */
+ClusterSocket ClusterConnect(const char *host, int port);
+
+/**
+ * @brief Writes a whole buffer to a connection, resuming calls interrupted by a signal.
+ *
+ * @return false if the connection failed or was closed by the peer.
+ */
+bool ClusterSend(ClusterSocket socket, const void *data, size_t size);
+
+/**
+ * @brief Reads exactly size bytes from a connection, resuming calls interrupted by a signal.
+ *
+ * @return false if the connection failed or was closed before size bytes arrived.
+ */
+bool ClusterReceive(ClusterSocket socket, void *data, size_t size);
+
+/**
+ * @brief Closes a socket. Accepts CLUSTER_INVALID_SOCKET.
+ */
+void ClusterCloseSocket(ClusterSocket socket);
+
+#endif // CLUSTER_NET_H
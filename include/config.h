@@ -0,0 +1,217 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "threadpool.h"
+
+#include <stdbool.h>
+
+/* ========================================================================= */
+/*                            Defaults                                       */
+/* ========================================================================= */
+#define DEFAULT_PARTICLE_COUNT 8000 // 360000 // 720000 // 1440000 // 2880000 // 5760000 // 4953600
+#define DEFAULT_THREAD_COUNT 12
+#define DEFAULT_ATTRACTION_STRENGTH 0.2000f // 0.2000f
+#define DEFAULT_FRICTION 0.999f // 0.999f
+#define DEFAULT_SCREEN_WIDTH 3440 // Display of hidden benchmark and export windows
+#define DEFAULT_SCREEN_HEIGHT 1440
+#define DEFAULT_SIM_SCALE 1       // Display pixels per simulation pixel along each axis
+#define MAX_SIM_SCALE 8
+#define DEFAULT_BENCHMARK_FRAMES 0 // 0 runs interactively
+#define DEFAULT_SHOW_PROFILER 0
+#define DEFAULT_FUSED_UPDATE 1 // Splat particles from the integration kernel instead of a separate pass
+#define DEFAULT_PIPELINED 0    // Integrate the next frame while the current one is presented
+#define DEFAULT_FAST_MATH 0    // Use the reciprocal square root integration kernels
+#define DEFAULT_REPULSION 0.0f        // Particle-particle repulsion strength, 0 turns the neighbour grid off
+#define DEFAULT_REPULSION_RADIUS 4.0f // Distance in pixels below which particles push each other apart
+#define DEFAULT_EXPORT_FRAMES 600     // Frames written by an export run
+#define DEFAULT_EMITTER_CAPACITY 1000000 // Slots reserved for emitted particles on top of the initial ones
+#define DEFAULT_STEP_RATE 0           // Simulation steps per second, 0 runs one step per rendered frame
+#define DEFAULT_MAX_STEPS 4           // Steps one frame catches up at most when the step rate is fixed
+#define DEFAULT_GOVERNOR 0            // Vary the particle count to hold the frame time under budget
+#define DEFAULT_GOVERNOR_FLOOR 0.25f  // Share of the particles the governor always keeps
+#define DEFAULT_AUDIO_DRIVE 0.0f      // Extra pointer attraction at full bass level, 0 leaves the music out of it
+#define DEFAULT_CLUSTER_NODES 2       // Nodes the cluster compositor waits for
+#define DEFAULT_CLUSTER_PORT 47000    // TCP port the cluster compositor listens on
+
+#define MAX_THREADS 64 // Upper bound for the thread count, sizes the per-job context arrays
+#define MAX_ATTRACTORS 16 // Upper bound for the attractor count, the pointer attractor included
+#define MAX_EMITTERS 16   // Upper bound for the emitter count
+#define CONFIG_PATH_LENGTH 260 // Capacity of the path settings, MAX_PATH on Windows
+#define DEFAULT_SNAPSHOT_PATH "particles.rtsnap" // Written when SNAPSHOT_SAVE_KEY is pressed
+
+typedef enum SimulationBackend
+{
+    BACKEND_CPU,    // AVX2 integrator, CPU rasterization and texture upload
+    BACKEND_GPU,    // OpenGL 4.3 compute shader, particles drawn straight from GPU buffers
+    BACKEND_CLUSTER // Compositor of shards simulated by cluster nodes on other machines
+} SimulationBackend;
+
+typedef enum RenderMode
+{
+    RENDER_OCCUPANCY, // One bit per pixel, drawn as OCCUPIED_COLOR or EMPTY_COLOR
+    RENDER_DENSITY    // Saturating 8-bit particle counts per pixel, tone-mapped through a palette
+} RenderMode;
+
+typedef enum ParticleStorage
+{
+    STORAGE_FULL,   // Four float arrays, 16 bytes per particle
+    STORAGE_COMPACT // 16-bit fixed-point positions and half-precision velocities, 8 bytes per particle
+} ParticleStorage;
+
+typedef enum PixelUpload
+{
+    UPLOAD_COPY, // Pixels combined into system memory and copied to the texture by the driver
+    UPLOAD_PBO   // Pixels combined straight into a ring of mapped pixel buffers the GPU copies from
+} PixelUpload;
+
+typedef enum SimdLevel
+{
+    SIMD_AUTO,   // Widest instruction set the machine supports
+    SIMD_SCALAR, // Plain C, runs on any x86-64
+    SIMD_SSE41,
+    SIMD_AVX2,
+    SIMD_AVX512  // AVX-512F
+} SimdLevel;
+
+/**
+ * @brief Placement of one extra attractor or repulsor, as given by an "attractor" setting.
+ */
+typedef struct AttractorConfig
+{
+    float x;           // Position, or centre of the orbit, in pixels
+    float y;
+    float strength;    // Acceleration per frame, negative to repel
+    float falloff;     // Distance at which the pull is halved, 0 for a constant pull
+    float orbitRadius; // Radius of a circular path around (x, y), 0 to stay put
+    float orbitPeriod; // Frames per revolution of the orbit
+} AttractorConfig;
+
+typedef struct AttractorList
+{
+    AttractorConfig items[MAX_ATTRACTORS - 1]; // The pointer attractor takes the remaining slot
+    int count;
+} AttractorList;
+
+/**
+ * @brief A source of particles, as given by an "emitter" setting.
+ */
+typedef struct EmitterConfig
+{
+    float x;        // Position in pixels
+    float y;
+    float rate;     // Particles spawned per frame, fractions carry over to later frames
+    float lifetime; // Frames an emitted particle lives
+    float speed;    // Initial speed in pixels per frame
+    float angle;    // Direction of the initial velocity in degrees, 0 along +x
+    float spread;   // Width of the cone of directions in degrees, 360 for every direction
+} EmitterConfig;
+
+typedef struct EmitterList
+{
+    EmitterConfig items[MAX_EMITTERS];
+    int count;
+} EmitterList;
+
+/**
+ * @brief Simulation parameters chosen at startup.
+ *
+ * Every value starts from its DEFAULT_* define and can be overridden from a config file
+ * and then from the command line, so one binary can be swept across particle counts,
+ * thread counts and resolutions.
+ */
+typedef struct SimulationConfig
+{
+    int particleCount;        // Number of simulated particles
+    int threadCount;          // Number of worker threads, at most MAX_THREADS
+    int screenWidth;          // Width of the simulation buffers in pixels, 0 to derive it from the display
+    int screenHeight;         // Height of the simulation buffers in pixels, 0 to derive it from the display
+    int simScale;             // Divisor of the display resolution a derived simulation grid runs at
+    float attractionStrength; // Acceleration towards the attractor per frame
+    float friction;           // Velocity multiplier applied every frame
+    SimulationBackend backend; // Where particles are integrated and drawn
+    RenderMode renderMode;     // How the particles landing on a pixel are shown
+    ParticleStorage storage;   // Precision the particle state is kept in between steps
+    PixelUpload pixelUpload;   // How the CPU backend's pixels reach the texture
+    int benchmarkFrames;       // Frames to time in benchmark mode, 0 for an interactive run
+    int showProfiler;          // Non-zero to show the frame profiler overlay at startup
+    int fusedUpdate;           // Non-zero to rasterize inside the integration phase
+    int pipelined;             // Non-zero to overlap integration of frame N+1 with presenting frame N
+    SimdLevel simdLevel;       // Instruction set of the CPU kernels, SIMD_AUTO to detect it
+    int fastMath;              // Non-zero to integrate with the estimate-based kernels instead of exact division
+    int verifyKernels;         // Non-zero to check the kernels against the scalar reference and exit
+    SimpleThreadPoolPinning pinning; // How worker threads are bound to logical processors
+    AttractorList attractors;  // Attractors and repulsors in addition to the pointer
+    float repulsion;           // Velocity pushed between particles at zero distance, 0 to skip the neighbour grid
+    float repulsionRadius;     // Interaction radius of the repulsion in pixels
+    char snapshotPath[CONFIG_PATH_LENGTH]; // File the particle state is saved to, empty to disable saving
+    char restorePath[CONFIG_PATH_LENGTH];  // Snapshot to start from instead of the scanline placement, or empty
+    char exportPath[CONFIG_PATH_LENGTH];   // Frame file pattern or "|command" to export to, empty for a normal run
+    int exportFrames;                      // Frames to export before exiting
+    EmitterList emitters;     // Sources of short-lived particles on top of the initial ones
+    int emitterCapacity;      // Emitted particles alive at once at most
+    int sortInterval;         // Frames between Morton re-sorts of the particle arrays, 0 = off
+    int governor;             // Non-zero to drop particles while the frame time is over budget
+    float governorFloor;      // Share of particleCount the governor never goes below
+    int stepRate;             // Fixed simulation steps per second, 0 to step once per rendered frame
+    int maxSteps;             // Steps one rendered frame may run at most with a fixed step rate
+    char recordPath[CONFIG_PATH_LENGTH]; // File the attractor input of every step is written to, or empty
+    char replayPath[CONFIG_PATH_LENGTH]; // Recording the attractor input is read from instead, or empty
+    float audioDrive;         // Pointer attraction is scaled by 1 + audioDrive * the bass level of the music
+    int clusterNodes;         // Nodes the cluster backend shards the particles over, at most MAX_THREADS
+    int clusterPort;          // TCP port of the cluster compositor
+    char clusterHost[CONFIG_PATH_LENGTH]; // Compositor to serve as a headless cluster node, or empty
+} SimulationConfig;
+
+/**
+ * @brief Fills a config with the compile-time defaults.
+ *
+ * @param config A pointer to the config to initialize.
+ */
+void DefaultSimulationConfig(SimulationConfig *config);
+
+/**
+ * @brief Applies the settings of a config file.
+ *
+ * The file holds one "key = value" pair per line, using the same keys as the command-line
+ * flags without the leading dashes. Blank lines and lines starting with '#' are ignored.
+ *
+ * @param config A pointer to the config to update.
+ * @param path The path of the file to read.
+ *
+ * @return true on success, false if the file cannot be read or holds an invalid setting.
+ */
+bool LoadSimulationConfigFile(SimulationConfig *config, const char *path);
+
+/**
+ * @brief Applies the command-line flags.
+ *
+ * Flags are given as "--key value" or "--key=value". "--config <path>" loads a config file
+ * at that point, so later flags override its values. "--help" prints the available flags.
+ *
+ * @param config A pointer to the config to update.
+ * @param argc The argument count passed to main().
+ * @param argv The argument vector passed to main().
+ *
+ * @return true if the program should continue, false on error or after printing the help.
+ */
+bool ParseSimulationArgs(SimulationConfig *config, int argc, char **argv);
+
+/**
+ * @brief Checks that the settings are usable.
+ *
+ * @param config A pointer to the config to check.
+ *
+ * @return true if the config is valid, false (after logging the reason) otherwise.
+ */
+bool ValidateSimulationConfig(const SimulationConfig *config);
+
+/**
+ * @brief Returns the name of a backend, as accepted by "--backend".
+ *
+ * @param backend The backend.
+ *
+ * @return A static string.
+ */
+const char *GetBackendName(SimulationBackend backend);
+
+#endif // CONFIG_H
@@ -0,0 +1,49 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include "raylib.h"
+#include "config.h"
+
+/**
+ * @brief The simulation grid and where it is shown on the display.
+ *
+ * The grid is the one resolution every simulation buffer is sized from: the occupancy bitmaps,
+ * the pixel buffer, the texture, the exported frames and the particle placement. It is either
+ * requested explicitly or derived from the display divided by the simulation scale, and is
+ * drawn scaled up by the GPU to fit the display, centred with its aspect ratio kept.
+ */
+typedef struct DisplayLayout
+{
+    int simWidth;       // Pixels of the simulation grid
+    int simHeight;
+    int displayWidth;   // Pixels of the window the grid is shown in
+    int displayHeight;
+    Camera2D camera;    // Maps grid pixels to display pixels: zoom is the scale, offset centres the grid
+} DisplayLayout;
+
+/**
+ * @brief Sizes the simulation grid for a display and fits it on the display.
+ *
+ * A grid dimension of 0 in the config is the display's divided by its simulation scale. A
+ * display size of 0 stands for a hidden window, which gets the requested grid scaled up, or
+ * DEFAULT_SCREEN_WIDTH x DEFAULT_SCREEN_HEIGHT where none was requested.
+ *
+ * @param config The simulation config providing the requested grid and the simulation scale.
+ * @param displayWidth The width of the window in pixels, or 0 for a hidden window.
+ * @param displayHeight The height of the window in pixels, or 0 for a hidden window.
+ *
+ * @return The resolved layout, with a grid of at least one pixel per side.
+ */
+DisplayLayout ResolveDisplayLayout(const SimulationConfig *config, int displayWidth, int displayHeight);
+
+/**
+ * @brief Converts a position on the display, such as the mouse, to grid pixels.
+ *
+ * @param layout The layout of the running session.
+ * @param position The position in display pixels.
+ *
+ * @return The position in grid pixels, outside the grid for positions in the letterbox.
+ */
+Vector2 DisplayToSimulation(const DisplayLayout *layout, Vector2 position);
+
+#endif // DISPLAY_H
@@ -0,0 +1,68 @@
+#ifndef EMITTERS_H
+#define EMITTERS_H
+
+#include "config.h"
+#include "particles.h"
+
+#include <limits.h>
+#include <stdbool.h>
+
+/* ========================================================================= */
+/*                            Defines                                        */
+/* ========================================================================= */
+#define EMITTER_COMPACT_INTERVAL 8 // Frames between two compactions of the live particles
+#define EMITTER_IMMORTAL INT_MAX   // Expiry frame of the initial particles, which never die
+
+/**
+ * @brief Spawns and retires short-lived particles inside preallocated particle arrays.
+ *
+ * The live particles are always the dense prefix [0, count) of the arrays, so the integration
+ * and rasterization kernels run over them unchanged. The initial particles come first and
+ * never expire; emitted particles follow, and the slots [count, capacity) are the free pool new
+ * ones are taken from. Every EMITTER_COMPACT_INTERVAL frames, expired particles are replaced by
+ * live ones moved down from the end of the range, so a dead particle stays in the range for at
+ * most EMITTER_COMPACT_INTERVAL - 1 frames and nothing is allocated while running.
+ */
+typedef struct ParticleEmitters
+{
+    EmitterConfig configs[MAX_EMITTERS];
+    float pending[MAX_EMITTERS]; // Fraction of a particle every emitter still owes
+    int count;                   // Number of emitters
+    int *expiry;                 // First frame every slot is dead in, EMITTER_IMMORTAL for the initial particles
+    int immortalCount;           // Initial particles at the start of the arrays
+    int capacity;                // Slots of the particle arrays
+    unsigned int seed;           // State of the generator placing new particles
+} ParticleEmitters;
+
+/**
+ * @brief Sets up the emitters of a config.
+ *
+ * @param emitters A pointer to the ParticleEmitters to initialize.
+ * @param config The simulation config providing the emitters and the initial particle count.
+ * @param capacity The number of slots of the particle arrays, at least the initial particle count.
+ *
+ * @return true on success, false if allocation fails.
+ */
+bool InitParticleEmitters(ParticleEmitters *emitters, const SimulationConfig *config, int capacity);
+
+/**
+ * @brief Retires expired particles and spawns the new ones of a frame.
+ *
+ * Runs on the calling thread between two steps, while no phase reads or writes the particles.
+ * Compaction reorders particles, so it only happens every EMITTER_COMPACT_INTERVAL frames.
+ * Spawning stops while every slot is in use.
+ *
+ * @param emitters A pointer to the emitters.
+ * @param particles The state the next step starts from; its count is updated.
+ * @param frame The index of the frame the next step computes.
+ */
+void UpdateParticleEmitters(ParticleEmitters *emitters, Particles *particles, int frame);
+
+/**
+ * @brief Frees the memory allocated by InitParticleEmitters().
+ *
+ * @param emitters A pointer to the emitters to free.
+ */
+void FreeParticleEmitters(ParticleEmitters *emitters);
+
+#endif // EMITTERS_H
@@ -0,0 +1,70 @@
+#ifndef FORCE_FIELD_H
+#define FORCE_FIELD_H
+
+#include "raylib.h"
+#include "config.h"
+
+/**
+ * @brief One point force as seen by the integration kernels.
+ *
+ * A particle at distance d is accelerated towards the position by strength per step, scaled by
+ * falloffRadiusSq / (d^2 + falloffRadiusSq) when a falloff is set. A negative strength repels.
+ */
+typedef struct Attractor
+{
+    Vector2 position;      // Position in pixels
+    float strength;        // Acceleration per step at the attractor, negative to repel
+    float falloffRadiusSq; // Square of the distance at which the pull is halved, 0 for a constant pull
+} Attractor;
+
+/**
+ * @brief Every attractor acting on the particles this step.
+ *
+ * attractors[0] follows the pointer (mouse or benchmark path) with the configured attraction
+ * strength and no falloff, which is the original single-attractor behaviour. The others come
+ * from the "attractor" settings and either stay put or orbit their configured position.
+ */
+typedef struct ForceField
+{
+    Attractor attractors[MAX_ATTRACTORS];
+    AttractorConfig paths[MAX_ATTRACTORS]; // Placement of attractors[1..count), paths[0] is unused
+    int count;                             // Number of active attractors, at least 1
+    float pointerStrength;                 // Configured strength of attractors[0], before any scaling
+} ForceField;
+
+/**
+ * @brief Builds the force field described by a config.
+ *
+ * @param field A pointer to the ForceField to initialize.
+ * @param config The simulation config providing the attraction strength and extra attractors.
+ */
+void InitForceField(ForceField *field, const SimulationConfig *config);
+
+/**
+ * @brief Moves the attractors to their positions for a frame.
+ *
+ * @param field A pointer to the ForceField to update.
+ * @param pointer The position of the pointer-driven attractor.
+ * @param frame The index of the frame, drives the scripted orbits.
+ */
+void UpdateForceField(ForceField *field, Vector2 pointer, int frame);
+
+/**
+ * @brief Sets the strength of the pointer attractor to a multiple of its configured strength.
+ *
+ * @param field A pointer to the ForceField to update.
+ * @param scale The multiple, 1 for the configured strength.
+ */
+void ScalePointerAttractor(ForceField *field, float scale);
+
+/**
+ * @brief Marks every attractor on screen. Must be called between BeginDrawing() and EndDrawing().
+ *
+ * The pointer attractor is drawn as before, attractors in orange and repulsors in blue, with
+ * a ring at the falloff radius.
+ *
+ * @param field A pointer to the ForceField to draw.
+ */
+void DrawForceField(const ForceField *field);
+
+#endif // FORCE_FIELD_H
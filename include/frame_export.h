@@ -0,0 +1,88 @@
+#ifndef FRAME_EXPORT_H
+#define FRAME_EXPORT_H
+
+#include "threadpool.h"
+
+#include <stdbool.h>
+
+/* ========================================================================= */
+/*                            Defines                                        */
+/* ========================================================================= */
+#define EXPORT_RING_FRAMES 4     // Frames buffered between the simulation and the encoder thread
+#define EXPORT_COPY_CHUNK_ROWS 16 // Rows per work-stealing chunk of the copy into the ring
+
+typedef enum FrameExportFormat
+{
+    FRAME_EXPORT_RAW,  // One file of width * height RGBA bytes per frame, named by a pattern
+    FRAME_EXPORT_PNG,  // One PNG file per frame, named by a pattern
+    FRAME_EXPORT_PIPE  // Raw RGBA frames written back to back to the standard input of a command
+} FrameExportFormat;
+
+typedef struct FrameExportStats
+{
+    int framesSubmitted; // Frames handed to the ring
+    int framesWritten;   // Frames the encoder thread wrote successfully
+    int stalls;          // Submissions that had to wait for the encoder to free a slot
+} FrameExportStats;
+
+typedef struct FrameExporter FrameExporter;
+
+/**
+ * @brief Allocates the frame ring and starts the encoder thread.
+ *
+ * A target starting with '|' is a shell command that receives the frames as raw RGBA on its
+ * standard input, for example "|ffmpeg -f rawvideo -pix_fmt rgba -s 1920x1080 -i - out.mp4".
+ * Any other target is a file name pattern with one integer conversion such as "%05d" for the
+ * frame number, starting from 0; the extension selects the format: ".png", or ".rgba" and
+ * ".raw" for raw frames.
+ *
+ * @param target The file name pattern or the command.
+ * @param width The width of the frames in pixels.
+ * @param height The height of the frames in pixels.
+ * @param error Receives a static description of the problem when NULL is returned.
+ *
+ * @return The exporter, or NULL if the target is invalid, the command cannot be started or
+ *         allocation fails.
+ */
+FrameExporter *CreateFrameExporter(const char *target, int width, int height, const char **error);
+
+/**
+ * @brief Queues one frame for the encoder thread.
+ *
+ * The pixels are copied into the next free ring slot by a range phase on the pool, so the
+ * caller may overwrite them as soon as the function returns. Only when every slot still holds
+ * a frame the encoder has not finished does the call wait, which is counted as a stall.
+ *
+ * @param exporter The exporter created by CreateFrameExporter().
+ * @param pool The thread pool running the copy; no other phase may be in flight.
+ * @param pixels The frame, width * height RGBA pixels, rows top to bottom.
+ *
+ * @return false once the encoder has failed to write a frame; later frames are not queued.
+ */
+bool SubmitExportFrame(FrameExporter *exporter, SimpleThreadPool *pool, const void *pixels);
+
+/**
+ * @brief Waits for the encoder to write every queued frame, then stops it and frees the exporter.
+ *
+ * @param exporter The exporter to finish. Accepts NULL.
+ * @param stats Receives the totals of the export. Can be NULL.
+ *
+ * @return true if every frame was written and, for a pipe, the command exited successfully.
+ */
+bool FinishFrameExport(FrameExporter *exporter, FrameExportStats *stats);
+
+/**
+ * @brief Encodes one frame as a PNG file.
+ *
+ * Lives apart from the encoder thread in frame_export_png.c, which can include raylib.h.
+ *
+ * @param path The file to write.
+ * @param pixels The frame, width * height RGBA pixels.
+ * @param width The width of the frame in pixels.
+ * @param height The height of the frame in pixels.
+ *
+ * @return true if the file was written completely.
+ */
+bool WriteFramePng(const char *path, const void *pixels, int width, int height);
+
+#endif // FRAME_EXPORT_H
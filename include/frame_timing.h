@@ -0,0 +1,180 @@
+#ifndef FRAME_TIMING_H
+#define FRAME_TIMING_H
+
+#include "raylib.h"
+#include "config.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/* ========================================================================= */
+/*                            Defines                                        */
+/* ========================================================================= */
+#define BENCHMARK_WARMUP_FRAMES 30 // Frames run before recording starts, lets caches and clocks settle
+
+typedef enum FramePhase
+{
+    FRAME_PHASE_INTEGRATE, // Particle update
+    FRAME_PHASE_RASTERIZE, // Splat into the per-thread bitmaps
+    FRAME_PHASE_COMBINE,   // Dirty band collection, merge and pixel conversion
+    FRAME_PHASE_UPLOAD,    // Texture update of the dirty bands
+    FRAME_PHASE_PRESENT,   // BeginDrawing() to EndDrawing(), including the buffer swap
+    FRAME_PHASE_COUNT
+} FramePhase;
+
+extern const char *const FramePhaseNames[FRAME_PHASE_COUNT];
+
+/**
+ * @brief Wall-clock duration of every phase of one frame.
+ *
+ * Each EndFramePhase() call stores the time elapsed since the previous one, so a frame costs
+ * one timestamp per phase and nothing is logged while it runs.
+ */
+typedef struct FrameTimer
+{
+    double phaseStart;                   // Timestamp at which the current phase started
+    double seconds[FRAME_PHASE_COUNT];   // Duration of each phase, 0 for phases a backend skips
+} FrameTimer;
+
+/**
+ * @brief Fixed-timestep accumulator deciding how many simulation steps a frame runs.
+ *
+ * Real time is accumulated and consumed in steps of a fixed length, so the simulation runs at
+ * the same speed whatever the frame rate: a fast frame may run no step at all, a slow one
+ * catches up with several. At most maxSteps run per frame; the debt beyond that is dropped,
+ * slowing the simulation down instead of letting every frame fall further behind.
+ */
+typedef struct StepClock
+{
+    double stepSeconds;     // Simulated time per step
+    double accumulator;     // Real time not simulated yet
+    double lastTime;        // Timestamp of the previous frame, negative before the first one
+    int maxSteps;           // Steps one frame runs at most
+    long long steps;        // Steps handed out so far
+    long long droppedSteps; // Steps skipped because a frame was owed more than maxSteps
+} StepClock;
+
+/**
+ * @brief Per-frame phase durations of a benchmark run, kept in memory until the run ends.
+ */
+typedef struct BenchmarkRecorder
+{
+    double *samples;   // frameCapacity rows of FRAME_PHASE_COUNT durations in seconds
+    int frameCapacity; // Number of frames to record
+    int frameCount;    // Number of frames recorded so far
+    int warmupLeft;    // Frames still to be skipped before recording starts
+} BenchmarkRecorder;
+
+/* ========================================================================= */
+/*                           Function Prototypes                             */
+/* ========================================================================= */
+
+/**
+ * @brief Starts timing a new frame.
+ *
+ * @param timer A pointer to the timer to reset.
+ */
+static inline void BeginFrameTimer(FrameTimer *timer)
+{
+    for (int i = 0; i < FRAME_PHASE_COUNT; i++)
+    {
+        timer->seconds[i] = 0.0;
+    }
+    timer->phaseStart = GetTime();
+}
+
+/**
+ * @brief Ends the current phase and starts the next one.
+ *
+ * @param timer A pointer to the running timer.
+ * @param phase The phase that just finished.
+ */
+static inline void EndFramePhase(FrameTimer *timer, FramePhase phase)
+{
+    double now = GetTime();
+    timer->seconds[phase] = now - timer->phaseStart;
+    timer->phaseStart = now;
+}
+
+/**
+ * @brief Starts a step clock.
+ *
+ * @param clock A pointer to the clock to initialize.
+ * @param stepRate The number of simulation steps per second of real time.
+ * @param maxSteps The number of steps one frame may catch up at most.
+ */
+void InitStepClock(StepClock *clock, int stepRate, int maxSteps);
+
+/**
+ * @brief Returns the number of steps to run for a frame starting at the given time.
+ *
+ * The first frame always runs one step, so there is something to draw.
+ *
+ * @param clock A pointer to the clock.
+ * @param now The current time in seconds, as returned by GetTime().
+ *
+ * @return Between 0 and maxSteps.
+ */
+int AdvanceStepClock(StepClock *clock, double now);
+
+/**
+ * @brief Allocates a recorder for a fixed number of frames.
+ *
+ * @param recorder A pointer to the recorder to initialize.
+ * @param frames The number of frames to record after the warm-up.
+ *
+ * @return true on success, false if the sample storage could not be allocated.
+ */
+bool InitBenchmarkRecorder(BenchmarkRecorder *recorder, int frames);
+
+/**
+ * @brief Stores the phase durations of a frame, or drops them during the warm-up.
+ *
+ * @param recorder A pointer to the recorder.
+ * @param timer The timer of the frame that just finished.
+ */
+void RecordBenchmarkFrame(BenchmarkRecorder *recorder, const FrameTimer *timer);
+
+/**
+ * @brief Checks whether every frame of the run has been recorded.
+ *
+ * @param recorder A pointer to the recorder.
+ *
+ * @return true once frameCapacity frames have been recorded.
+ */
+bool BenchmarkFinished(const BenchmarkRecorder *recorder);
+
+/**
+ * @brief Writes min, median and p99 of every phase, plus the whole frame, as CSV.
+ *
+ * One row per phase, prefixed with the settings of the run so that results from several
+ * builds or machines can be concatenated into one table. Percentiles use the nearest rank.
+ *
+ * @param recorder A pointer to the recorder of a finished run.
+ * @param config The config the run used.
+ * @param file The stream to write to.
+ */
+void WriteBenchmarkCsv(const BenchmarkRecorder *recorder, const SimulationConfig *config, FILE *file);
+
+/**
+ * @brief Frees the sample storage of a recorder.
+ *
+ * @param recorder A pointer to the recorder to free.
+ */
+void FreeBenchmarkRecorder(BenchmarkRecorder *recorder);
+
+/**
+ * @brief Returns the scripted attractor position of a benchmark frame.
+ *
+ * The attractor follows a Lissajous curve over most of the screen, so every run sweeps the
+ * particles through the same positions regardless of frame rate.
+ *
+ * @param frame The index of the frame, counted from the start of the run.
+ * @param width The width of the simulation in pixels.
+ * @param height The height of the simulation in pixels.
+ *
+ * @return The attractor position in pixels.
+ */
+Vector2 GetBenchmarkAttractor(int frame, int width, int height);
+
+#endif // FRAME_TIMING_H
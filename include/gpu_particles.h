@@ -0,0 +1,79 @@
+#ifndef GPU_PARTICLES_H
+#define GPU_PARTICLES_H
+
+#include "raylib.h"
+#include "particles.h"
+#include "force_field.h"
+
+#include <stdbool.h>
+
+/**
+ * @brief Particle state living entirely in GPU storage buffers.
+ *
+ * posX/posY/velX/velY are kept in four shader storage buffers with the same SoA layout as
+ * Particles. A compute shader integrates them in place and a point draw call reads the
+ * positions straight from the buffers, so nothing is read back or uploaded per frame.
+ */
+typedef struct GpuParticles
+{
+    unsigned int posXBuffer; // SSBO ids, bound to binding points 0..3
+    unsigned int posYBuffer;
+    unsigned int velXBuffer;
+    unsigned int velYBuffer;
+    unsigned int computeProgram; // Integration kernel
+    unsigned int drawProgram;    // Point rendering from the position buffers
+    unsigned int vertexArray;    // Empty VAO required by core profile draw calls
+    int count;
+
+    int attractorsLoc; // Uniform locations of computeProgram
+    int attractorCountLoc;
+    int frictionLoc;
+    int countLoc;
+    int mvpLoc;        // Uniform locations of drawProgram
+    int pointSizeLoc;
+    int colorLoc;
+} GpuParticles;
+
+/**
+ * @brief Uploads the initial particle state and builds the compute and draw programs.
+ *
+ * Requires a build with GRAPHICS_API_OPENGL_43 and a context that provides OpenGL 4.3 at
+ * runtime. After this call the CPU copy of the particles is no longer needed.
+ *
+ * @param gpu A pointer to the GpuParticles to initialize.
+ * @param particles The initial particle state.
+ *
+ * @return true on success, false if compute shaders are unavailable or a program fails to build.
+ */
+bool InitGpuParticles(GpuParticles *gpu, const Particles *particles);
+
+/**
+ * @brief Advances the particles by one step on the GPU.
+ *
+ * @param gpu A pointer to the initialized GpuParticles.
+ * @param field The attractors of this step, in screen pixels.
+ * @param friction The velocity multiplier per step.
+ */
+void UpdateGpuParticles(GpuParticles *gpu, const ForceField *field, float friction);
+
+/**
+ * @brief Draws every particle as a point covering its grid pixel. Must be called between
+ * BeginMode2D() and EndMode2D(), with the camera that maps the simulation grid to the window.
+ *
+ * The points are transformed by the modelview and projection rlgl has set up, so they land
+ * where the CPU path's texture would, letterboxing included.
+ *
+ * @param gpu A pointer to the initialized GpuParticles.
+ * @param color The color of the points.
+ * @param pointSize The size of one grid pixel on screen, the zoom of the camera.
+ */
+void DrawGpuParticles(const GpuParticles *gpu, Color color, float pointSize);
+
+/**
+ * @brief Releases the GPU buffers and programs.
+ *
+ * @param gpu A pointer to the GpuParticles to release.
+ */
+void UnloadGpuParticles(GpuParticles *gpu);
+
+#endif // GPU_PARTICLES_H
@@ -0,0 +1,121 @@
+#ifndef INPUT_REPLAY_H
+#define INPUT_REPLAY_H
+
+#include "raylib.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* ========================================================================= */
+/*                            Defines                                        */
+/* ========================================================================= */
+#define INPUT_RECORDING_MAGIC 0x4E495452u // "RTIN" as little-endian bytes
+#define INPUT_RECORDING_VERSION 1
+
+/**
+ * @brief Fixed-size header at the start of an input recording, all fields little-endian.
+ *
+ * One pair of floats follows per simulation step: the pointer attractor of that step in grid
+ * pixels. The step count is taken from the file size, so a recording cut short by a crash
+ * still replays up to its last complete step.
+ */
+typedef struct InputRecordingHeader
+{
+    uint32_t magic;      // INPUT_RECORDING_MAGIC
+    uint32_t version;    // INPUT_RECORDING_VERSION of the writer
+    uint32_t headerSize; // sizeof(InputRecordingHeader) of the writer
+    int32_t firstStep;   // Index of the step of the first entry
+    int32_t gridWidth;   // Simulation grid the positions are in
+    int32_t gridHeight;
+    int32_t stepRate;    // Steps per second of the recorded run, 0 for one step per frame
+    uint32_t reserved;   // Zero
+} InputRecordingHeader;
+
+/**
+ * @brief An input recording being written, one entry per step.
+ */
+typedef struct InputRecorder
+{
+    FILE *file;
+    int stepCount; // Entries written so far
+    bool failed;   // A write failed, later entries are not written
+} InputRecorder;
+
+/**
+ * @brief An input recording loaded into memory for replay.
+ */
+typedef struct InputReplay
+{
+    InputRecordingHeader header; // Copy of the validated header
+    Vector2 *positions;          // stepCount attractor positions, from header.firstStep on
+    int stepCount;
+} InputReplay;
+
+/* ========================================================================= */
+/*                           Function Prototypes                             */
+/* ========================================================================= */
+
+/**
+ * @brief Creates an input recording and writes its header.
+ *
+ * @param recorder A pointer to the recorder to initialize.
+ * @param path The path of the file to write, replaced if it exists.
+ * @param firstStep The index of the first step that will be recorded.
+ * @param gridWidth The width of the simulation grid in pixels.
+ * @param gridHeight The height of the simulation grid in pixels.
+ * @param stepRate The steps per second of the run, 0 for one step per frame.
+ *
+ * @return true on success, false (after logging the reason) if the file cannot be written.
+ */
+bool OpenInputRecorder(InputRecorder *recorder, const char *path, int firstStep, int gridWidth, int gridHeight,
+                       int stepRate);
+
+/**
+ * @brief Appends the attractor position of the next step.
+ *
+ * @param recorder A pointer to the open recorder.
+ * @param position The position in grid pixels.
+ */
+void RecordInputStep(InputRecorder *recorder, Vector2 position);
+
+/**
+ * @brief Closes a recording and logs how many steps it holds.
+ *
+ * @param recorder A pointer to the recorder, closed or never opened recorders are ignored.
+ *
+ * @return false if any step could not be written.
+ */
+bool CloseInputRecorder(InputRecorder *recorder);
+
+/**
+ * @brief Reads a whole input recording into memory.
+ *
+ * @param replay A pointer to the replay to initialize.
+ * @param path The path of the recording.
+ *
+ * @return true on success, false (after logging the reason) if the file is missing or malformed.
+ */
+bool LoadInputReplay(InputReplay *replay, const char *path);
+
+/**
+ * @brief Returns the recorded attractor position of a step.
+ *
+ * Steps before the first entry take the first one and steps past the end keep the last one,
+ * so a replay can run longer than its recording.
+ *
+ * @param replay A pointer to the loaded replay.
+ * @param step The index of the step.
+ *
+ * @return The position in grid pixels.
+ */
+Vector2 GetReplayInput(const InputReplay *replay, int step);
+
+/**
+ * @brief Frees the positions of a replay.
+ *
+ * @param replay A pointer to the replay to free.
+ */
+void FreeInputReplay(InputReplay *replay);
+
+#endif // INPUT_REPLAY_H
@@ -0,0 +1,151 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include "raylib.h"
+#include "config.h"
+#include "particles.h"
+#include "occupancy.h"
+#include "force_field.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/* ========================================================================= */
+/*                            Defines                                        */
+/* ========================================================================= */
+#define FAST_MATH_SOFTENING_SQ 1e-6f // Squared distance added by the fast kernels, (0.001 px)^2, keeps rsqrt finite
+#define KERNEL_VERIFY_TOLERANCE 1e-4f // Largest velocity error of a fast kernel, relative to the total attractor strength
+#define KERNEL_COMPACT_TOLERANCE 3e-3f // Largest velocity error of a compact kernel, mostly the rounding to half precision
+#define KERNEL_DRIFT_STEPS 60          // Steps the compact and full-precision states are run side by side
+#define KERNEL_DRIFT_TOLERANCE 0.5f    // Largest RMS distance in pixels between them after those steps
+
+/**
+ * @brief Forces applied by one integration step.
+ */
+typedef struct IntegrateParams
+{
+    const Attractor *attractors; // Point forces summed for every particle
+    int attractorCount;          // Number of entries in attractors
+    float friction;              // Velocity multiplier per step
+} IntegrateParams;
+
+/**
+ * @brief Integrates the particles in [start, end) by one step.
+ *
+ * Reads the state from source and writes the new state to target, which may be the same
+ * particles to update them in place. Every batch of particles stays in registers while the
+ * forces of all attractors are accumulated, so memory is streamed once whatever the count.
+ * When splat is not NULL, the new positions are also marked in that bitmap with
+ * MarkOccupiedPixel(), truncated to whole pixels, with positions outside the bitmap skipped. Any range is accepted: the vector kernels
+ * handle the unaligned head and the tail of the range themselves.
+ *
+ * A particle sitting exactly on an attractor has no direction to be pulled in and receives no
+ * force from it, so its state never turns into NaN.
+ */
+typedef void (*IntegrateKernel)(const Particles *source, Particles *target, int start, int end, const IntegrateParams *params,
+                                OccupancyBitmap *splat);
+
+/**
+ * @brief Integrates the compact particles in [start, end) by one step.
+ *
+ * Behaves like an IntegrateKernel on particles expanded from the compact format, with the new
+ * state rounded back into it; the splat uses the new positions before they are rounded.
+ * Source and target must share the same position format.
+ */
+typedef void (*CompactIntegrateKernel)(const CompactParticles *source, CompactParticles *target, int start, int end,
+                                       const IntegrateParams *params, OccupancyBitmap *splat);
+
+/**
+ * @brief Merges rows [rowStart, rowEnd) of the bitmaps into pixels.
+ *
+ * The bitmaps are ORed into the first one, every bit is written as OCCUPIED_COLOR or EMPTY_COLOR,
+ * and all bitmaps are left clear over those rows. Disjoint row ranges can run concurrently.
+ */
+typedef void (*CombineKernel)(OccupancyBitmap *const *buffers, int bufferCount, Color *pixels, int rowStart, int rowEnd);
+
+/**
+ * @brief Merges rows [rowStart, rowEnd) of density bitmaps into pixels.
+ *
+ * The counters are added into the first bitmap with saturation, every counter is written as
+ * its palette entry, and all bitmaps are left clear over those rows. Disjoint row ranges can
+ * run concurrently.
+ */
+typedef void (*DensityCombineKernel)(OccupancyBitmap *const *buffers, int bufferCount, Color *pixels, int rowStart,
+                                     int rowEnd, const uint32_t *palette);
+
+/**
+ * @brief Sets count pixels to one color.
+ */
+typedef void (*FillKernel)(Color *pixels, int count, Color color);
+
+/**
+ * @brief One implementation of every hot loop, built for a single instruction set.
+ *
+ * The stream variants of the pixel kernels produce the same pixels with non-temporal stores
+ * wherever a vector is aligned, for mapped GPU memory the CPU never reads back, and end with
+ * a store fence, since the locks of the thread pool do not order streaming stores.
+ */
+typedef struct ParticleKernels
+{
+    const char *name;
+    SimdLevel level;
+    IntegrateKernel integrate;     // IEEE square root and divisions
+    IntegrateKernel integrateFast; // Refined reciprocal square root and reciprocal estimates on the softened
+                                   // distance sqrt(distSq + FAST_MATH_SOFTENING_SQ), within KERNEL_VERIFY_TOLERANCE
+    CompactIntegrateKernel integrateCompact;     // The exact variant on compact storage
+    CompactIntegrateKernel integrateCompactFast; // The fast variant on compact storage
+    CombineKernel combine;
+    CombineKernel combineStream;
+    DensityCombineKernel combineDensity; // Tone-maps the counters of the density mode through a palette
+    DensityCombineKernel combineDensityStream;
+    FillKernel fill;
+    FillKernel fillStream;
+} ParticleKernels;
+
+// Each table lives in its own translation unit compiled for its instruction set
+extern const ParticleKernels ScalarKernels;
+extern const ParticleKernels Sse41Kernels;
+extern const ParticleKernels Avx2Kernels;
+extern const ParticleKernels Avx512Kernels;
+
+/**
+ * @brief Returns the widest instruction set the CPU and the OS both support.
+ *
+ * @return SIMD_SCALAR, SIMD_SSE41, SIMD_AVX2 or SIMD_AVX512.
+ */
+SimdLevel DetectSimdLevel(void);
+
+/**
+ * @brief Picks the kernels to run for the whole session.
+ *
+ * @param requested SIMD_AUTO for the best supported kernels, or a specific level. A level the
+ *                  machine cannot run falls back to the best supported one, with a warning.
+ *
+ * @return A pointer to a static kernel table.
+ */
+const ParticleKernels *SelectParticleKernels(SimdLevel requested);
+
+/**
+ * @brief Checks every kernel the CPU supports against the exact scalar kernel.
+ *
+ * Integrates one step of a fixed random particle set, with particles placed exactly on and
+ * next to the attractors, and compares the velocities. Exact kernels must match the scalar
+ * one to rounding, fast kernels to within KERNEL_VERIFY_TOLERANCE; within one pixel of an
+ * attractor, where the softening dominates, only finiteness is checked. The compact kernels
+ * start from the same set rounded to the compact format and must match the scalar kernel run
+ * on the expanded state to within KERNEL_COMPACT_TOLERANCE. One CSV row per kernel is written
+ * to out, followed by a quality row comparing KERNEL_DRIFT_STEPS steps of the widest exact
+ * compact kernel with the full-precision one, whose error is the RMS distance in pixels.
+ *
+ * The combine, density combine and fill kernels, stream variants included, must then match
+ * the scalar ones pixel for pixel and leave the merged rows of their bitmaps clear. Their rows
+ * are not a whole number of words wide, the fill covers an odd count from an unaligned start,
+ * and most density sums saturate; the error of their CSV rows is the count of differing pixels.
+ *
+ * @param out The stream to write the results to.
+ *
+ * @return true if every kernel passed.
+ */
+bool VerifyParticleKernels(FILE *out);
+
+#endif // KERNELS_H
@@ -0,0 +1,117 @@
+#ifndef OCCUPANCY_H
+#define OCCUPANCY_H
+
+#include "raylib.h"
+#include "particles.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* ========================================================================= */
+/*                            Defines                                        */
+/* ========================================================================= */
+#define OCCUPIED_COLOR (Color){0, 0, 0, 255}  // Black
+#define EMPTY_COLOR (Color){130, 130, 130, 255} // Gray
+#define DIRTY_BAND_SHIFT 4 // Dirty regions are bands of 1 << DIRTY_BAND_SHIFT full-width rows
+#define DENSITY_LEVELS 256 // Values of a density counter, which saturates at DENSITY_LEVELS - 1
+#define DENSITY_MAX_BITMAPS 3 // Count arrays of the density mode, whatever the thread count
+
+/**
+ * @brief Per-job record of the pixels particles landed on.
+ *
+ * Holds either one bit per pixel, or in density mode one saturating 8-bit particle counter per
+ * pixel; the other array is NULL. A bitmap is 1/32 of a 4-byte BOOL per pixel, so even one per
+ * thread stays far below it. Counters are 1/4 of it each, so the density mode keeps at most
+ * DENSITY_MAX_BITMAPS of them, 3 bytes per pixel in total, plus row padding to 64 bytes.
+ */
+typedef struct OccupancyBitmap
+{
+    uint32_t *words; // One bit per pixel, 32 pixels per word, each row padded to whole words
+    int width;       // Width of the bitmap in pixels
+    int height;      // Height of the bitmap in pixels
+    int stride;      // Number of words per row
+    int wordCount;   // Total number of words, padded to a multiple of 16 (one AVX-512 vector)
+    uint8_t *counts; // Density mode: particles per pixel, saturating at DENSITY_LEVELS - 1
+    int countStride; // Bytes per row of counts, padded to a multiple of 64
+    uint8_t *bandTouched; // Non-zero for every dirty band that received a particle since it was last combined
+    int bandCount;        // Number of dirty bands covering the bitmap
+} OccupancyBitmap;
+
+/**
+ * @brief Packs a color into the 32-bit layout of a pixel in memory.
+ *
+ * @param color The color to pack.
+ *
+ * @return The RGBA bytes as one little-endian word.
+ */
+static inline uint32_t PackColor(Color color)
+{
+    return color.r | (color.g << 8) | (color.b << 16) | ((uint32_t)color.a << 24);
+}
+
+/**
+ * @brief Records a particle on a pixel inside the bitmap.
+ *
+ * Sets the pixel's bit, or increments its counter in density mode, and marks its dirty band.
+ *
+ * @param bitmap The bitmap to update.
+ * @param x The column of the pixel, 0 <= x < width.
+ * @param y The row of the pixel, 0 <= y < height.
+ */
+static inline void MarkOccupiedPixel(OccupancyBitmap *bitmap, int x, int y)
+{
+    if (bitmap->counts)
+    {
+        uint8_t *count = &bitmap->counts[y * bitmap->countStride + x];
+        *count += *count != DENSITY_LEVELS - 1;
+    }
+    else
+    {
+        bitmap->words[y * bitmap->stride + (x >> 5)] |= 1u << (x & 31);
+    }
+    bitmap->bandTouched[y >> DIRTY_BAND_SHIFT] = 1;
+}
+
+/**
+ * Allocates an occupancy bitmap with alignment suitable for SIMD operations.
+ *
+ * @param width The width of the bitmap in pixels.
+ * @param height The height of the bitmap in pixels.
+ * @param density true for 8-bit per-pixel counters, false for 1 bit per pixel.
+ * @return The allocated bitmap; its words or counts pointer is NULL if allocation fails.
+ */
+OccupancyBitmap AllocateOccupancyBitmap(int width, int height, bool density);
+
+/**
+ * @brief Builds the tone-mapping palette of the density mode.
+ *
+ * Entry 0 is EMPTY_COLOR and entry 1 OCCUPIED_COLOR, as in the occupancy mode; higher counts
+ * ramp on a logarithmic scale through red and yellow up to white at saturation.
+ *
+ * @param palette Receives DENSITY_LEVELS packed colors, indexed by counter value.
+ */
+void BuildDensityPalette(uint32_t *palette);
+
+/**
+ * @brief Updates an occupancy bitmap with the positions of particles.
+ *
+ * This function updates an occupancy bitmap with the positions of particles. It sets the bit
+ * (or bumps the density counter) of every pixel covered by a particle and marks the dirty band containing it. The bitmap is
+ * expected to be clear on entry; the combine phase clears every band it reads. The function
+ * processes the particles in a specified range and updates the bitmap based on their positions.
+ *
+ * @param buffer A pointer to the occupancy bitmap to update.
+ * @param particles A pointer to the Particles structure containing the particle positions.
+ * @param start The starting index of the particles to update.
+ * @param end The ending index of the particles to update.
+ */
+void UpdateBufferWithParticles(OccupancyBitmap *buffer, const Particles *particles, int start, int end);
+
+/**
+ * Frees the memory allocated by AllocateOccupancyBitmap().
+ *
+ * @param bitmap A pointer to the bitmap to free.
+ */
+void FreeOccupancyBitmap(OccupancyBitmap *bitmap);
+
+#endif // OCCUPANCY_H
@@ -0,0 +1,97 @@
+#ifndef PARTICLE_SORT_H
+#define PARTICLE_SORT_H
+
+#include "threadpool.h"
+#include "config.h"
+#include "particles.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* ========================================================================= */
+/*                            Defines                                        */
+/* ========================================================================= */
+#define SORT_KEY_BITS 12          // Bits of each coordinate in a Morton key, 4096 cells per axis
+#define SORT_RADIX_BITS 8         // Key bits per radix pass
+#define SORT_RADIX (1 << SORT_RADIX_BITS)
+#define SORT_PASSES ((2 * SORT_KEY_BITS + SORT_RADIX_BITS - 1) / SORT_RADIX_BITS)
+#define SORT_STAGES (SORT_PASSES + 2) // Frames one re-sort is spread over: keys, every pass, reorder
+#define SORT_CHUNK_SIZE 4096      // Particles per work-stealing chunk of the reorder phases
+
+typedef struct ParticleSorter ParticleSorter;
+
+typedef struct SortJobContext
+{
+    ParticleSorter *sorter;
+    int start;                    // First entry of the job's slice
+    int end;                      // One past the last entry
+    uint32_t histogram[SORT_RADIX]; // Entries of the slice per digit, then the slot of the next one
+} SortJobContext;
+
+/**
+ * @brief Reorders the particle arrays along a Morton (Z-order) curve, a few phases per frame.
+ *
+ * Particles that are close on screen end up close in the arrays, so the splat of consecutive
+ * particles writes nearby bitmap words instead of scattering stores over the whole frame.
+ * A re-sort computes a key per particle from its position, radix-sorts the keys over the next
+ * frames and finally gathers the arrays into the new order. The particles keep moving while the
+ * keys are sorted, so the order is a few frames old when it is applied, which only matters for
+ * locality: every particle keeps its exact state.
+ */
+struct ParticleSorter
+{
+    int count;           // Particles sorted, the prefix [0, count) of the arrays
+    int interval;        // Frames between the starts of two re-sorts
+    int stage;           // Next stage to run, 0 while idle
+    float scale;         // Pixels to key cells, so the longer side spans at most 1 << SORT_KEY_BITS cells
+    uint32_t *keys[2];   // Morton keys, sorted back and forth between the two arrays
+    int *order[2];       // Particle index belonging to every key
+    int current;         // Which of the two arrays holds the keys of the last stage
+    Particles staging;   // The arrays in the new order, copied back by the last stage
+
+    Particles *particles; // Particles of the running stage
+    SortJobContext jobs[MAX_THREADS]; // One slice of the keys per job
+    SimpleThreadPoolPhase keyPhase;
+    SimpleThreadPoolPhase histogramPhase;
+    SimpleThreadPoolPhase scatterPhase;
+    SimpleThreadPoolRangePhase gatherPhase;
+    SimpleThreadPoolRangePhase copyPhase;
+};
+
+/**
+ * @brief Allocates the keys and the staging arrays of a sorter.
+ *
+ * @param sorter A pointer to the sorter to initialize.
+ * @param particleCount The number of particles to sort, a prefix of the particle arrays.
+ * @param width The width of the simulation in pixels.
+ * @param height The height of the simulation in pixels.
+ * @param interval The number of frames between the starts of two re-sorts, at least SORT_STAGES.
+ * @param jobCount The number of jobs per sort phase, usually the pool's thread count, at most MAX_THREADS.
+ *
+ * @return true on success, false (after logging the reason) if allocation fails.
+ */
+bool InitParticleSorter(ParticleSorter *sorter, int particleCount, int width, int height, int interval, int jobCount);
+
+/**
+ * @brief Runs the stage of the re-sort that falls on a frame.
+ *
+ * A re-sort starts on every frame that is a multiple of the interval and runs one stage per
+ * frame, each as one or two phases on the pool. Must be called every frame.
+ *
+ * @param sorter A pointer to the sorter.
+ * @param pool The thread pool running the phases; no other phase may be in flight.
+ * @param particles The state the next step starts from.
+ * @param frame The index of the current frame.
+ *
+ * @return true if the particles were reordered.
+ */
+bool StepParticleSorter(ParticleSorter *sorter, SimpleThreadPool *pool, Particles *particles, int frame);
+
+/**
+ * @brief Frees the memory allocated by InitParticleSorter().
+ *
+ * @param sorter A pointer to the sorter to free.
+ */
+void FreeParticleSorter(ParticleSorter *sorter);
+
+#endif // PARTICLE_SORT_H
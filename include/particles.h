@@ -0,0 +1,253 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <stdint.h>
+#include <string.h>
+
+typedef struct Particles
+{
+    float *posX;
+    float *posY;
+    float *velX;
+    float *velY;
+    int count;
+} Particles;
+
+/**
+ * @brief Particles stored in 8 bytes each instead of 16, for the compact storage mode.
+ *
+ * Positions are 16-bit fixed point around the screen centre, with the finest power-of-two step
+ * whose range reaches one long side of the screen to either side of the centre, so at least half
+ * a screen length past the long edges (1/16 pixel at 1920x1080). Velocities
+ * are IEEE half precision, 11 significant bits. The kernels convert both in registers, so all
+ * arithmetic is still single precision; only what is stored between steps is rounded.
+ */
+typedef struct CompactParticles
+{
+    int16_t *posX;  // Position = origin + stored value * step, saturating at the ends of the range
+    int16_t *posY;
+    uint16_t *velX; // Half-precision floats, pixels per step
+    uint16_t *velY;
+    int count;
+    float originX;  // Position of the stored value 0, the centre of the screen
+    float originY;
+    float step;     // Pixels per unit of a stored position
+    float inverseStep;
+} CompactParticles;
+
+/**
+ * @brief Creates a new set of particles with the specified count and screen dimensions.
+ *
+ * @param count The number of particles to create.
+ * @param screenWidth The width of the screen to place the particles on.
+ * @param screenHeight The height of the screen to place the particles on.
+ *
+ * @return A Particles structure containing the particle positions and velocities.
+ */
+Particles CreateParticles(int count, int screenWidth, int screenHeight);
+
+/**
+ * @brief Allocates the particle arrays without writing to them.
+ *
+ * The OS backs each page when it is first written, on the NUMA node of the writing thread.
+ * Initializing every slice with InitializeParticleRange() from the thread that will update it
+ * therefore keeps the slice in that thread's local memory.
+ *
+ * @param count The number of particles to allocate.
+ *
+ * @return A Particles structure with uninitialized positions and velocities.
+ */
+Particles AllocateParticles(int count);
+
+/**
+ * @brief Sets the initial state of the particles in [start, end).
+ *
+ * Particles are placed in scanline order from the top-left pixel, with zero velocity.
+ *
+ * @param particles A pointer to the particles to initialize.
+ * @param start The first particle to initialize.
+ * @param end One past the last particle to initialize.
+ * @param screenWidth The width of the screen to place the particles on.
+ * @param screenHeight The height of the screen to place the particles on.
+ */
+void InitializeParticleRange(Particles *particles, int start, int end, int screenWidth, int screenHeight);
+
+/**
+ * @brief Sets the initial state of the particles in [start, end) of one shard of a larger scene.
+ *
+ * Particle i is placed where InitializeParticleRange() places particle shardStart + i of the
+ * whole scene, so the shards of a cluster together start out exactly like a single run.
+ *
+ * @param particles A pointer to the particles of the shard.
+ * @param start The first particle to initialize.
+ * @param end One past the last particle to initialize.
+ * @param shardStart The index of the shard's first particle in the whole scene.
+ * @param screenWidth The width of the screen to place the particles on.
+ * @param screenHeight The height of the screen to place the particles on.
+ */
+void InitializeParticleShard(Particles *particles, int start, int end, int shardStart, int screenWidth, int screenHeight);
+
+/**
+ * @brief Allocates compact particle arrays without writing to them.
+ *
+ * Pages are backed on first write just like with AllocateParticles().
+ *
+ * @param count The number of particles to allocate.
+ * @param screenWidth The width of the screen the positions are stored relative to.
+ * @param screenHeight The height of the screen the positions are stored relative to.
+ *
+ * @return A CompactParticles structure with uninitialized positions and velocities.
+ */
+CompactParticles AllocateCompactParticles(int count, int screenWidth, int screenHeight);
+
+/**
+ * @brief Sets the initial state of the compact particles in [start, end), like InitializeParticleRange().
+ */
+void InitializeCompactParticleRange(CompactParticles *particles, int start, int end, int screenWidth, int screenHeight);
+
+/**
+ * @brief Converts the particles in [start, end) to the compact format, rounding to nearest.
+ *
+ * @param source The full-precision particles.
+ * @param target The compact particles, which keep their own position format.
+ * @param start The first particle to convert.
+ * @param end One past the last particle to convert.
+ */
+void PackCompactParticles(const Particles *source, CompactParticles *target, int start, int end);
+
+/**
+ * @brief Expands the compact particles in [start, end) to full precision, exactly.
+ *
+ * @param source The compact particles.
+ * @param target The full-precision particles.
+ * @param start The first particle to convert.
+ * @param end One past the last particle to convert.
+ */
+void UnpackCompactParticles(const CompactParticles *source, Particles *target, int start, int end);
+
+/**
+ * @brief Frees the memory allocated for compact particles.
+ *
+ * @param particles A pointer to the CompactParticles structure to free.
+ */
+void FreeCompactParticles(CompactParticles *particles);
+
+/* ========================================================================= */
+/*                            Compact conversions                            */
+/* ========================================================================= */
+// The scalar versions of what the vector kernels do with F16C and saturating packs, bit for bit
+// under the default round-to-nearest-even mode.
+
+/**
+ * @brief Rounds a float to the nearest half-precision value, ties to even.
+ */
+static inline uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    uint32_t magnitude = bits & 0x7FFFFFFFu;
+
+    if (magnitude >= 0x7F800000u)
+    {
+        return (uint16_t)(sign | 0x7C00u | (magnitude > 0x7F800000u ? 0x0200u : 0u)); // Infinity, quiet NaN
+    }
+    if (magnitude >= 0x477FF000u)
+    {
+        return (uint16_t)(sign | 0x7C00u); // Rounds past 65504
+    }
+    if (magnitude < 0x38800000u)
+    {
+        // Below 2^-14 the result is subnormal, in units of 2^-24
+        if (magnitude < 0x33000000u)
+        {
+            return (uint16_t)sign;
+        }
+        uint32_t mantissa = (magnitude & 0x007FFFFFu) | 0x00800000u;
+        int shift = 126 - (int)(magnitude >> 23);
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1u);
+        uint32_t halfway = 1u << (shift - 1);
+        half += rest > halfway || (rest == halfway && (half & 1u));
+        return (uint16_t)(sign | half);
+    }
+
+    // Rebias the exponent and round away the 13 extra mantissa bits; a carry moves into the exponent
+    uint32_t half = (magnitude - 0x38000000u) >> 13;
+    uint32_t rest = magnitude & 0x1FFFu;
+    half += rest > 0x1000u || (rest == 0x1000u && (half & 1u));
+    return (uint16_t)(sign | half);
+}
+
+/**
+ * @brief Expands a half-precision value to a float, exactly.
+ */
+static inline float HalfToFloat(uint16_t half)
+{
+    uint32_t sign = (uint32_t)(half & 0x8000u) << 16;
+    uint32_t exponent = (half >> 10) & 0x1Fu;
+    uint32_t mantissa = half & 0x03FFu;
+    uint32_t bits;
+
+    if (exponent == 0x1Fu)
+    {
+        bits = sign | 0x7F800000u | (mantissa << 13);
+    }
+    else if (exponent != 0)
+    {
+        bits = sign | ((exponent + 112u) << 23) | (mantissa << 13);
+    }
+    else if (mantissa == 0)
+    {
+        bits = sign;
+    }
+    else
+    {
+        // Subnormal: shift the leading bit up to the implicit position
+        uint32_t biased = 113u;
+        while (!(mantissa & 0x0400u))
+        {
+            mantissa <<= 1;
+            biased--;
+        }
+        bits = sign | (biased << 23) | ((mantissa & 0x03FFu) << 13);
+    }
+
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief Converts a position to the fixed-point format, rounding to nearest and saturating.
+ */
+static inline int16_t QuantizePosition(float position, float origin, float inverseStep)
+{
+    float scaled = (position - origin) * inverseStep;
+    if (!(scaled > -32768.0f))
+    {
+        return INT16_MIN; // NaN included, like the vector conversion
+    }
+    if (scaled > 32767.0f)
+    {
+        return INT16_MAX;
+    }
+    return (int16_t)__builtin_lrintf(scaled);
+}
+
+/**
+ * @brief Expands a fixed-point position.
+ */
+static inline float DequantizePosition(int16_t value, float origin, float step)
+{
+    return origin + (float)value * step;
+}
+
+/**
+ * @brief Frees the memory allocated for the particles.
+ *
+ * @param particles A pointer to the Particles structure to free.
+ */
+void FreeParticles(Particles *particles);
+
+#endif // PARTICLES_H
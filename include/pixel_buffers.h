@@ -0,0 +1,97 @@
+#ifndef PIXEL_BUFFERS_H
+#define PIXEL_BUFFERS_H
+
+#include "raylib.h"
+
+#include <stdbool.h>
+
+/* ========================================================================= */
+/*                            Defines                                        */
+/* ========================================================================= */
+#define PIXEL_RING_BUFFERS 3 // One buffer being written, up to two still being read by the GPU
+
+/**
+ * @brief A ring of frame-sized pixel unpack buffers the combine phase writes into directly.
+ *
+ * Every buffer is mapped persistently and coherently (OpenGL 4.4 buffer storage), so the
+ * combine kernels stream the pixels straight into driver-visible memory and the texture
+ * update becomes a copy the GPU performs on its own, instead of a second pass over the frame
+ * on the main thread. A fence placed after each upload tells when the GPU has finished reading
+ * a buffer. A frame whose next buffer is still being read is combined into the regular pixel
+ * buffer and copied as before, so the main thread never waits for the GPU. Without buffer
+ * storage, the buffers are mapped unsynchronized every frame instead, after their fence.
+ */
+typedef struct PixelBufferRing
+{
+    unsigned int buffers[PIXEL_RING_BUFFERS]; // Pixel unpack buffer ids
+    Color *mapped[PIXEL_RING_BUFFERS];        // Persistent mappings, or the mapping of the acquired buffer
+    void *fences[PIXEL_RING_BUFFERS];         // GL sync objects of the last upload from each buffer, NULL when idle
+    bool persistent;                          // Buffers stay mapped for their whole lifetime
+    int width;
+    int height;
+    int next;        // Buffer the next frame tries to acquire
+    int acquired;    // Buffer holding the current frame, -1 if none was free
+    int frames;      // Frames that tried to acquire a buffer
+    int busyFrames;  // Frames that found the next buffer still in use
+} PixelBufferRing;
+
+/**
+ * @brief Creates and maps the pixel buffers of a ring.
+ *
+ * Requires an OpenGL 3.3 or 4.3 build of raylib and a current context.
+ *
+ * @param ring A pointer to the ring to initialize.
+ * @param width The width of the frames in pixels.
+ * @param height The height of the frames in pixels.
+ *
+ * @return true on success, false (after logging the reason) if the buffers are unavailable.
+ */
+bool InitPixelBufferRing(PixelBufferRing *ring, int width, int height);
+
+/**
+ * @brief Takes the next buffer of the ring for the current frame, if the GPU is done with it.
+ *
+ * Never waits: a buffer whose fence has not signalled yet is left alone.
+ *
+ * @param ring A pointer to the initialized ring.
+ *
+ * @return The mapped pixels of the buffer, width * height, or NULL if it is still in use.
+ */
+Color *AcquirePixelBuffer(PixelBufferRing *ring);
+
+/**
+ * @brief Readies the acquired buffer to be the source of texture uploads.
+ *
+ * Must follow a successful AcquirePixelBuffer(), once every pixel of the frame is written.
+ *
+ * @param ring A pointer to the ring.
+ */
+void BeginPixelBufferUpload(PixelBufferRing *ring);
+
+/**
+ * @brief Queues the upload of full rows [rowStart, rowEnd) of the acquired buffer to a texture.
+ *
+ * The copy is performed by the GPU; the call returns without touching the pixels.
+ *
+ * @param ring A pointer to the ring, between BeginPixelBufferUpload() and EndPixelBufferUpload().
+ * @param texture The texture to update, of the ring's size and RGBA8 format.
+ * @param rowStart The first row to upload.
+ * @param rowEnd One past the last row to upload.
+ */
+void UploadPixelBufferRows(PixelBufferRing *ring, Texture2D texture, int rowStart, int rowEnd);
+
+/**
+ * @brief Fences the uploads of the acquired buffer and moves on to the next one.
+ *
+ * @param ring A pointer to the ring.
+ */
+void EndPixelBufferUpload(PixelBufferRing *ring);
+
+/**
+ * @brief Releases the buffers and fences of a ring.
+ *
+ * @param ring A pointer to the ring to release.
+ */
+void UnloadPixelBufferRing(PixelBufferRing *ring);
+
+#endif // PIXEL_BUFFERS_H
@@ -0,0 +1,43 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+/**
+ * @brief Allocates memory aligned to a power-of-two boundary.
+ *
+ * @param size The number of bytes to allocate.
+ * @param alignment The alignment in bytes, a power of two and a multiple of sizeof(void *).
+ *
+ * @return The allocated block, to be released with FreeAligned(), or NULL on failure.
+ */
+static inline void *AllocateAligned(size_t size, size_t alignment)
+{
+#if defined(_WIN32)
+    return _aligned_malloc(size, alignment);
+#else
+    void *block = NULL;
+    return posix_memalign(&block, alignment, size) == 0 ? block : NULL;
+#endif
+}
+
+/**
+ * @brief Frees memory allocated by AllocateAligned(). Accepts NULL.
+ *
+ * @param block The block to free.
+ */
+static inline void FreeAligned(void *block)
+{
+#if defined(_WIN32)
+    _aligned_free(block);
+#else
+    free(block);
+#endif
+}
+
+#endif // PLATFORM_H
@@ -0,0 +1,167 @@
+#ifndef PLATFORM_THREADS_H
+#define PLATFORM_THREADS_H
+
+#include <stdbool.h>
+
+// Threads, a mutex and a condition variable for the modules that run their own background
+// thread. Never include this next to raylib.h: windows.h declares names that clash with it.
+#if defined(_WIN32)
+#include <windows.h>
+
+typedef HANDLE PlatformThread;
+typedef DWORD PlatformThreadResult;
+typedef SRWLOCK PlatformMutex;
+typedef CONDITION_VARIABLE PlatformCondition;
+#define PLATFORM_THREAD_CALL WINAPI
+#else
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#if defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+typedef pthread_t PlatformThread;
+typedef void *PlatformThreadResult;
+typedef pthread_mutex_t PlatformMutex;
+typedef pthread_cond_t PlatformCondition;
+#define PLATFORM_THREAD_CALL
+#endif
+
+/**
+ * @brief Starts a thread running entry(arg).
+ *
+ * @return true on success.
+ */
+static inline bool PlatformThreadStart(PlatformThread *thread, PlatformThreadResult(PLATFORM_THREAD_CALL *entry)(void *),
+                                       void *arg)
+{
+#if defined(_WIN32)
+    *thread = CreateThread(NULL, 0, entry, arg, 0, NULL);
+    return *thread != NULL;
+#else
+    return pthread_create(thread, NULL, entry, arg) == 0;
+#endif
+}
+
+/**
+ * @brief Waits for a thread started by PlatformThreadStart() to exit and releases it.
+ */
+static inline void PlatformThreadJoin(PlatformThread thread)
+{
+#if defined(_WIN32)
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, NULL);
+#endif
+}
+
+/**
+ * @brief Lets the scheduler prefer every normal thread over the calling one.
+ *
+ * Used by background threads that only have to keep up on average, so they never take a core
+ * from the simulation. Outside Windows and Linux, where POSIX threads share the priority of
+ * their process, this does nothing.
+ */
+static inline void PlatformThreadLowerPriority(void)
+{
+#if defined(_WIN32)
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#elif defined(__linux__)
+    // Every Linux thread has its own nice value
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), getpriority(PRIO_PROCESS, 0) + 5);
+#endif
+}
+
+/**
+ * @brief Suspends the calling thread for at least the given time.
+ */
+static inline void PlatformSleep(int milliseconds)
+{
+#if defined(_WIN32)
+    Sleep((DWORD)milliseconds);
+#else
+    struct timespec duration = {milliseconds / 1000, (long)(milliseconds % 1000) * 1000000L};
+    while (nanosleep(&duration, &duration) == -1 && errno == EINTR)
+    {
+        // Interrupted by a signal, sleep for the rest
+    }
+#endif
+}
+
+static inline void PlatformMutexInit(PlatformMutex *mutex)
+{
+#if defined(_WIN32)
+    InitializeSRWLock(mutex);
+#else
+    pthread_mutex_init(mutex, NULL);
+#endif
+}
+
+static inline void PlatformMutexDestroy(PlatformMutex *mutex)
+{
+#if defined(_WIN32)
+    (void)mutex;
+#else
+    pthread_mutex_destroy(mutex);
+#endif
+}
+
+static inline void PlatformMutexLock(PlatformMutex *mutex)
+{
+#if defined(_WIN32)
+    AcquireSRWLockExclusive(mutex);
+#else
+    pthread_mutex_lock(mutex);
+#endif
+}
+
+static inline void PlatformMutexUnlock(PlatformMutex *mutex)
+{
+#if defined(_WIN32)
+    ReleaseSRWLockExclusive(mutex);
+#else
+    pthread_mutex_unlock(mutex);
+#endif
+}
+
+static inline void PlatformConditionInit(PlatformCondition *condition)
+{
+#if defined(_WIN32)
+    InitializeConditionVariable(condition);
+#else
+    pthread_cond_init(condition, NULL);
+#endif
+}
+
+static inline void PlatformConditionDestroy(PlatformCondition *condition)
+{
+#if defined(_WIN32)
+    (void)condition;
+#else
+    pthread_cond_destroy(condition);
+#endif
+}
+
+static inline void PlatformConditionWait(PlatformCondition *condition, PlatformMutex *mutex)
+{
+#if defined(_WIN32)
+    SleepConditionVariableSRW(condition, mutex, INFINITE, 0);
+#else
+    pthread_cond_wait(condition, mutex);
+#endif
+}
+
+static inline void PlatformConditionWakeAll(PlatformCondition *condition)
+{
+#if defined(_WIN32)
+    WakeAllConditionVariable(condition);
+#else
+    pthread_cond_broadcast(condition);
+#endif
+}
+
+#endif // PLATFORM_THREADS_H
@@ -0,0 +1,69 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "raylib.h"
+#include "frame_timing.h"
+
+#include <stdbool.h>
+
+/* ========================================================================= */
+/*                            Defines                                        */
+/* ========================================================================= */
+#define PROFILER_HISTORY 240    // Frames kept for the rolling graph and averages
+#define PROFILER_TOGGLE_KEY KEY_F3
+
+/**
+ * @brief Rolling history of phase times and worker busy times, drawn as an overlay.
+ *
+ * Only the main thread touches this structure. Worker busy times are collected from the
+ * thread pool's per-worker rings once per frame and stored next to the phase times.
+ */
+typedef struct FrameProfiler
+{
+    float phaseMs[PROFILER_HISTORY][FRAME_PHASE_COUNT]; // Ring of phase times in milliseconds
+    float *workerBusyMs; // Ring of PROFILER_HISTORY rows of workerCount busy times
+    int workerCount;     // Number of pool workers tracked
+    int head;            // Row of the next frame
+    int frameCount;      // Number of valid rows, at most PROFILER_HISTORY
+    bool visible;        // Whether DrawFrameProfiler() draws anything
+} FrameProfiler;
+
+/**
+ * @brief Allocates the history of a profiler.
+ *
+ * @param profiler A pointer to the profiler to initialize.
+ * @param workerCount The number of pool workers whose busy time is recorded.
+ * @param visible Whether the overlay starts out visible.
+ *
+ * @return true on success, false if the history could not be allocated.
+ */
+bool InitFrameProfiler(FrameProfiler *profiler, int workerCount, bool visible);
+
+/**
+ * @brief Appends one frame to the history, overwriting the oldest one when full.
+ *
+ * @param profiler A pointer to the profiler.
+ * @param timer The phase times of the frame.
+ * @param workerBusySeconds workerCount busy times of the frame, in seconds.
+ */
+void RecordProfilerFrame(FrameProfiler *profiler, const FrameTimer *timer, const double *workerBusySeconds);
+
+/**
+ * @brief Draws a stacked per-phase frame time graph, per-phase averages and per-worker load.
+ * Must be called between BeginDrawing() and EndDrawing(). Does nothing while hidden.
+ *
+ * @param profiler A pointer to the profiler.
+ * @param x The left edge of the overlay in pixels.
+ * @param y The top edge of the overlay in pixels.
+ * @param budgetMs The frame time budget, drawn as a reference line.
+ */
+void DrawFrameProfiler(const FrameProfiler *profiler, int x, int y, float budgetMs);
+
+/**
+ * @brief Frees the history of a profiler.
+ *
+ * @param profiler A pointer to the profiler to free.
+ */
+void FreeFrameProfiler(FrameProfiler *profiler);
+
+#endif // PROFILER_H
@@ -0,0 +1,72 @@
+#ifndef QUALITY_GOVERNOR_H
+#define QUALITY_GOVERNOR_H
+
+#include "frame_timing.h"
+
+#include <stdbool.h>
+
+/* ========================================================================= */
+/*                            Defines                                        */
+/* ========================================================================= */
+#define GOVERNOR_WINDOW 100      // Frames per decision, so a single hitch is not its p99
+#define GOVERNOR_HEADROOM 0.75f  // Share of the frame budget the simulation phases may take at p99
+#define GOVERNOR_RECOVERY 0.6f   // Share of the budget below which the particle count grows back
+#define GOVERNOR_GROWTH 0.05f    // Share of the full particle count restored per quiet window
+#define GOVERNOR_MAX_CUT 0.5f    // Largest share of the active particles dropped by one decision
+
+/**
+ * @brief Feedback controller trading particles for frame time.
+ *
+ * Every GOVERNOR_WINDOW frames the p99 of the simulation phases (everything but present, which
+ * includes the wait for the frame cap and the swap) is compared with GOVERNOR_HEADROOM of the
+ * frame budget. Over it, the active particle count is cut by the share the integrate and
+ * rasterize phases of the p99 frame would have to shrink by, since only they scale with the
+ * count. Well under it, the count grows back in steps as long as the same estimate predicts it
+ * fits. Every change is logged with the phase times that caused it.
+ */
+typedef struct QualityGovernor
+{
+    float windowMs[GOVERNOR_WINDOW][FRAME_PHASE_COUNT]; // Phase times of the current window
+    int windowFrames; // Frames recorded in the current window
+    int fullCount;    // Particles at full quality
+    int minCount;     // Fewest particles the governor cuts down to
+    int activeCount;  // Particles integrated and drawn from the next step on
+    float targetMs;   // p99 the simulation phases are held under
+    float recoveryMs; // p99 below which the count may grow
+    bool saturated;   // Over target with nothing left to cut, logged once until it recovers
+    long long activeSum; // Sum of activeCount over every frame, for the delivered average
+    int frames;       // Frames recorded since the start
+    int lowestCount;  // Fewest particles any frame ran with
+    int cuts;         // Decisions that lowered the count
+    int raises;       // Decisions that raised it
+} QualityGovernor;
+
+/**
+ * @brief Starts a governor at full quality.
+ *
+ * @param governor A pointer to the governor to initialize.
+ * @param particleCount The number of particles at full quality.
+ * @param floorShare The share of particleCount the governor never goes below, in (0, 1].
+ * @param budgetMs The frame time budget in milliseconds.
+ */
+void InitQualityGovernor(QualityGovernor *governor, int particleCount, float floorShare, float budgetMs);
+
+/**
+ * @brief Records the phase times of a frame and, at the end of a window, adjusts the particle count.
+ *
+ * @param governor A pointer to the governor.
+ * @param timer The timer of the frame that just finished.
+ * @param frame The index of the frame, for the log.
+ *
+ * @return true if activeCount changed and the next step should run with it.
+ */
+bool UpdateQualityGovernor(QualityGovernor *governor, const FrameTimer *timer, int frame);
+
+/**
+ * @brief Logs the quality delivered over the run: the average and lowest particle count and the decisions taken.
+ *
+ * @param governor A pointer to the governor.
+ */
+void LogQualityGovernorSummary(const QualityGovernor *governor);
+
+#endif // QUALITY_GOVERNOR_H
@@ -0,0 +1,142 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "threadpool.h"
+#include "config.h"
+#include "particles.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* ========================================================================= */
+/*                            Defines                                        */
+/* ========================================================================= */
+#define SNAPSHOT_MAGIC 0x4E535452u // "RTSN" as little-endian bytes
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_ALIGNMENT 4096    // File offset alignment of every array, one page
+#define SNAPSHOT_COPY_CHUNK_SIZE 65536 // Particles per chunk of the staging copy
+
+/**
+ * @brief Fixed-size header at the start of a snapshot file, all fields little-endian.
+ *
+ * The four particle arrays follow, each at a page-aligned offset, so a mapped file can be
+ * used as the particle arrays directly. Later versions may append fields; headerSize tells a
+ * reader where the fields it knows end.
+ */
+typedef struct SnapshotHeader
+{
+    uint32_t magic;          // SNAPSHOT_MAGIC
+    uint32_t version;        // SNAPSHOT_VERSION of the writer
+    uint32_t headerSize;     // sizeof(SnapshotHeader) of the writer
+    int32_t particleCount;   // Number of entries in every array
+    int32_t screenWidth;     // Simulation dimensions the state was captured at
+    int32_t screenHeight;
+    int32_t frame;           // Index of the next frame to simulate
+    float attractionStrength; // Force constants of the captured run
+    float friction;
+    float repulsion;
+    float repulsionRadius;
+    uint32_t reserved;        // Zero
+    uint64_t arrayOffset[4];  // File offsets of posX, posY, velX and velY
+} SnapshotHeader;
+
+typedef enum SnapshotStatus
+{
+    SNAPSHOT_OK,
+    SNAPSHOT_IO_ERROR,      // The file could not be opened, mapped, written or renamed
+    SNAPSHOT_BAD_FORMAT,    // Not a snapshot, or truncated
+    SNAPSHOT_BAD_VERSION,   // Written by an incompatible version
+    SNAPSHOT_BUSY           // The previous save is still being written
+} SnapshotStatus;
+
+/**
+ * @brief A snapshot file mapped copy-on-write into memory.
+ *
+ * particles points straight into the mapping: pages are read from the file when they are
+ * first touched, and written pages become private copies, so the simulation can run on the
+ * arrays without modifying the file.
+ */
+typedef struct ParticleSnapshot
+{
+    SnapshotHeader header; // Copy of the validated header
+    Particles particles;   // Arrays inside the mapping
+    void *view;            // Base address of the mapping
+    size_t viewSize;       // Length of the mapping in bytes
+} ParticleSnapshot;
+
+typedef struct SnapshotWriter SnapshotWriter;
+
+/**
+ * @brief Maps a snapshot file and validates its header.
+ *
+ * @param snapshot A pointer to the snapshot to initialize.
+ * @param path The path of the file to map.
+ *
+ * @return SNAPSHOT_OK on success; any other status leaves nothing mapped.
+ */
+SnapshotStatus MapParticleSnapshot(ParticleSnapshot *snapshot, const char *path);
+
+/**
+ * @brief Releases a mapping created by MapParticleSnapshot(), invalidating its particles.
+ *
+ * @param snapshot A pointer to the mapped snapshot.
+ */
+void UnmapParticleSnapshot(ParticleSnapshot *snapshot);
+
+/**
+ * @brief Allocates a writer and its staging copy of the particle arrays.
+ *
+ * @param particleCount The number of particles every save will hold.
+ *
+ * @return The writer, or NULL if allocation fails.
+ */
+SnapshotWriter *CreateSnapshotWriter(int particleCount);
+
+/**
+ * @brief Starts saving a particle state in the background.
+ *
+ * The arrays are copied into the writer's staging buffers by a range phase on the pool, which
+ * is the only part the caller waits for. A background thread then writes the file under a
+ * temporary name and renames it over path once complete, so a reader never sees a partial
+ * snapshot.
+ *
+ * @param writer The writer created by CreateSnapshotWriter().
+ * @param pool The thread pool running the copy; no other phase may be in flight.
+ * @param particles The state to save, with the writer's particle count.
+ * @param config The parameters stored in the header.
+ * @param frame The index of the next frame to simulate.
+ * @param path The path of the file to write.
+ *
+ * @return SNAPSHOT_OK once the save is started, SNAPSHOT_BUSY if the last one is still running.
+ */
+SnapshotStatus BeginSnapshotSave(SnapshotWriter *writer, SimpleThreadPool *pool, const Particles *particles,
+                                 const SimulationConfig *config, int frame, const char *path);
+
+/**
+ * @brief Reports the result of the last save, once.
+ *
+ * @param writer The writer.
+ * @param status Receives the result of the save that finished.
+ *
+ * @return true if a save finished since the last call, false otherwise.
+ */
+bool PollSnapshotWriter(SnapshotWriter *writer, SnapshotStatus *status);
+
+/**
+ * @brief Waits for a save in progress and frees the writer. Accepts NULL.
+ *
+ * @param writer The writer to destroy.
+ */
+void DestroySnapshotWriter(SnapshotWriter *writer);
+
+/**
+ * @brief Returns a description of a status for log messages.
+ *
+ * @param status The status.
+ *
+ * @return A static string.
+ */
+const char *GetSnapshotStatusText(SnapshotStatus status);
+
+#endif // SNAPSHOT_H
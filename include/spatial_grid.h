@@ -0,0 +1,131 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include "threadpool.h"
+#include "config.h"
+#include "particles.h"
+
+#include <stdbool.h>
+
+/* ========================================================================= */
+/*                            Defines                                        */
+/* ========================================================================= */
+#define GRID_PARTICLE_CHUNK_SIZE 4096 // Particles per work-stealing chunk of the position gather
+#define GRID_CELL_CHUNK_SIZE 512      // Cells per work-stealing chunk of the repulsion phase
+#define GRID_MAX_NEIGHBOURS 64        // Candidates examined per particle, bounds the cost of crowded cells
+
+typedef struct SpatialGrid SpatialGrid;
+
+typedef struct GridScanContext
+{
+    SpatialGrid *grid; // Grid whose counts are scanned
+    int begin;         // First cell of the block
+    int end;           // One past the last cell of the block
+    int sum;           // Particles in the block, written by the first scan pass
+    int offset;        // Particles in the blocks before this one, read by the second pass
+} GridScanContext;
+
+typedef struct GridSliceContext
+{
+    SpatialGrid *grid; // Grid being rebuilt
+    int start;         // First particle of the job's slice
+    int end;           // One past the last particle of the slice
+    int *histogram;    // cellCount entries: particles of the slice per cell, then the slot of the next one
+} GridSliceContext;
+
+/**
+ * @brief Uniform grid of particle indices, rebuilt every step with a parallel counting sort.
+ *
+ * Cells are squares with the interaction radius as their side, so every neighbour of a
+ * particle lies in the 3x3 cells around its own. Cells are numbered row by row, so the three
+ * cells of each neighbouring row form one contiguous run of the sorted arrays. Particles
+ * outside the grid are clamped into the border cells.
+ *
+ * Every job counts a contiguous slice of the particles into its own cell histogram, so the
+ * cells the particles crowd into near an attractor are never contended between threads. An
+ * exclusive scan over cells first and jobs second gives every job a private run of slots per
+ * cell, filled in slice order, so indices within a cell come out ascending and the result of a
+ * step does not depend on how the pool scheduled it. The histograms take jobCount * cellCount
+ * ints.
+ */
+struct SpatialGrid
+{
+    int columns;       // Cells per row
+    int rows;          // Rows of cells
+    int cellCount;     // columns * rows
+    float cellSize;    // Side of a cell in pixels, the interaction radius
+    float inverseCellSize;
+    float strength;    // Velocity added per step by a neighbour at zero distance
+    int *cellStart;    // cellCount + 1 entries, the particles of cell c are sorted[cellStart[c] .. cellStart[c + 1])
+    int *histograms;   // One cellCount histogram per slice job, back to back
+    int *particleCell; // Cell of every particle
+    int *sorted;       // Particle indices ordered by cell
+    float *sortedX;    // Positions in the order of sorted, gathered once so neighbour searches stream them
+    float *sortedY;
+    int capacity;      // Number of particles the index arrays hold
+    int jobCount;      // Slice and scan jobs per phase
+
+    const Particles *particles; // Particles of the current rebuild
+    Particles *target;          // Particles whose velocities receive the repulsion
+    GridSliceContext slices[MAX_THREADS]; // One slice of the particles per count and scatter job
+    GridScanContext scan[MAX_THREADS];    // One block of cells per scan job
+    SimpleThreadPoolPhase countPhase;
+    SimpleThreadPoolPhase sumPhase;
+    SimpleThreadPoolPhase offsetPhase;
+    SimpleThreadPoolPhase scatterPhase;
+    SimpleThreadPoolRangePhase gatherPhase;
+    SimpleThreadPoolRangePhase repelPhase;
+};
+
+/**
+ * @brief Allocates a grid covering the simulation area.
+ *
+ * @param grid A pointer to the grid to initialize.
+ * @param particleCount The number of particles the grid will hold.
+ * @param width The width of the simulation in pixels.
+ * @param height The height of the simulation in pixels.
+ * @param radius The interaction radius in pixels, also the side of a cell.
+ * @param strength The repulsion strength applied by ApplyParticleRepulsion().
+ * @param jobCount The number of slice and scan jobs, usually the pool's thread count, at most MAX_THREADS.
+ *
+ * @return true on success, false (after logging the reason) if allocation fails.
+ */
+bool InitSpatialGrid(SpatialGrid *grid, int particleCount, int width, int height, float radius, float strength,
+                     int jobCount);
+
+/**
+ * @brief Sorts the particle indices by cell on the pool.
+ *
+ * Counts the particles of every cell per slice, scans the counts into slot offsets, scatters
+ * the indices and finally gathers the positions in sorted order, each step as one pool phase.
+ * Returns once the grid is complete.
+ *
+ * @param grid A pointer to the initialized grid.
+ * @param pool The thread pool running the phases; no other phase may be in flight.
+ * @param particles The particles to sort, at most the count the grid was created for.
+ */
+void RebuildSpatialGrid(SpatialGrid *grid, SimpleThreadPool *pool, const Particles *particles);
+
+/**
+ * @brief Pushes apart particles closer than the interaction radius.
+ *
+ * Rebuilds the grid, then adds a repulsion velocity to every particle that falls off linearly
+ * from grid->strength at zero distance to nothing at the radius. At most GRID_MAX_NEIGHBOURS
+ * candidates from the particle's own and surrounding cells are examined, own row first, so
+ * crowded regions stay bounded in cost at the price of an approximate push. Positions are not
+ * modified.
+ *
+ * @param grid A pointer to the initialized grid.
+ * @param pool The thread pool running the phases; no other phase may be in flight.
+ * @param particles The particles to update, before they are integrated.
+ */
+void ApplyParticleRepulsion(SpatialGrid *grid, SimpleThreadPool *pool, Particles *particles);
+
+/**
+ * @brief Frees the memory allocated by InitSpatialGrid().
+ *
+ * @param grid A pointer to the grid to free.
+ */
+void FreeSpatialGrid(SpatialGrid *grid);
+
+#endif // SPATIAL_GRID_H
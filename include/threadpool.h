@@ -1,15 +1,184 @@
 #ifndef THREADPOOL_H
 #define THREADPOOL_H
 
-#include <windows.h>
+#include <stdbool.h>
+#include <stddef.h>
 
-typedef struct SimpleThreadPool {
-    PTP_POOL pool;
-    TP_CALLBACK_ENVIRON callBackEnviron;
-} SimpleThreadPool;
+/**
+ * @brief Function run by a worker thread for a single job of a phase.
+ *
+ * @param context Pointer to the context of the job (one element of the phase's context array).
+ * @param workerIndex Index of the worker thread running the job, in the range [0, threadCount).
+ */
+typedef void (*SimpleThreadPoolJob)(void *context, int workerIndex);
 
-SimpleThreadPool* SimpleThreadPool_Init();
-BOOL SimpleThreadPool_Submit(SimpleThreadPool* tp, PTP_WORK_CALLBACK workCallback, PVOID context);
-void SimpleThreadPool_Destroy(SimpleThreadPool* tp);
+/**
+ * @brief Reusable description of one frame phase.
+ *
+ * A phase is a batch of jobCount independent jobs sharing the same function. Job i receives
+ * the i-th element of the contexts array. The descriptor is meant to be filled in once and
+ * submitted every frame; only the data the contexts point to changes between frames.
+ *
+ * Jobs normally go to whichever worker asks first. A pinned phase instead runs job i on
+ * worker i % threadCount every time it is submitted, so data a job touches stays in the
+ * caches and on the NUMA node of the same core from frame to frame.
+ */
+typedef struct SimpleThreadPoolPhase
+{
+    SimpleThreadPoolJob job; // Function run once per job
+    void *contexts;          // Array of jobCount contexts, contextSize bytes apart
+    size_t contextSize;      // Size in bytes of one context
+    int jobCount;            // Number of jobs in the phase
+    bool pinnedJobs;         // true to always run job i on worker i % threadCount
+} SimpleThreadPoolPhase;
+
+/**
+ * @brief Function run by a worker thread for one chunk of a range phase.
+ *
+ * @param context The context of the range phase, shared by every chunk.
+ * @param start The first item of the chunk.
+ * @param end One past the last item of the chunk.
+ * @param workerIndex Index of the worker thread running the chunk, in the range [0, threadCount).
+ */
+typedef void (*SimpleThreadPoolRangeJob)(void *context, int start, int end, int workerIndex);
+
+/**
+ * @brief Reusable description of a phase over the items [0, itemCount).
+ *
+ * The range is cut into chunks of chunkSize items and every worker gets a contiguous home run
+ * of them, the same run every time the phase is submitted. A worker works through its own run
+ * front to back and then steals chunks from the back of the other workers' runs, so a worker
+ * that is preempted or slow only delays the chunks it is actually running, and the phase ends
+ * when the average worker is done rather than the slowest one.
+ */
+typedef struct SimpleThreadPoolRangePhase
+{
+    SimpleThreadPoolRangeJob job; // Function run once per chunk
+    void *context;                // Passed to every chunk
+    int itemCount;                // Number of items to process
+    int chunkSize;                // Items per chunk; only the last chunk can be shorter
+} SimpleThreadPoolRangePhase;
+
+/**
+ * @brief How worker threads are bound to logical processors.
+ */
+typedef enum SimpleThreadPoolPinning
+{
+    SIMPLE_THREADPOOL_PIN_NONE,  // Leave placement to the OS scheduler
+    SIMPLE_THREADPOOL_PIN_CPUS,  // One logical processor each, SMT siblings only once every core has a worker
+    SIMPLE_THREADPOOL_PIN_CORES  // One physical core each, SMT siblings stay unused
+} SimpleThreadPoolPinning;
+
+/**
+ * @brief Persistent worker threads. The layout is private to threadpool.c, which builds on
+ * Win32 threads on Windows and on pthreads everywhere else.
+ */
+typedef struct SimpleThreadPool SimpleThreadPool;
+
+/**
+ * @brief Creates the pool and starts its worker threads.
+ *
+ * The threads live until SimpleThreadPool_Destroy() and sleep between phases, so no kernel
+ * objects are created or destroyed per frame. When pinned, worker i is bound to the i-th
+ * processor of the chosen list before it can run a job, wrapping around if there are more
+ * workers than processors.
+ *
+ * @param threadCount The number of worker threads to start.
+ * @param pinning How to bind the workers to logical processors.
+ *
+ * @return The new pool, or NULL if it could not be created.
+ */
+SimpleThreadPool *SimpleThreadPool_Init(int threadCount, SimpleThreadPoolPinning pinning);
+
+/**
+ * @brief Returns the number of worker threads that actually started.
+ *
+ * @param tp The pool.
+ *
+ * @return A value between 1 and the count passed to SimpleThreadPool_Init().
+ */
+int SimpleThreadPool_ThreadCount(const SimpleThreadPool *tp);
+
+/**
+ * @brief Returns the number of worker threads bound to a logical processor.
+ *
+ * @param tp The pool.
+ *
+ * @return 0 when pinning is off or unsupported, otherwise at most SimpleThreadPool_ThreadCount().
+ */
+int SimpleThreadPool_PinnedCount(const SimpleThreadPool *tp);
+
+/**
+ * @brief Hands all jobs of a phase to the workers and returns immediately.
+ *
+ * The phase descriptor and its contexts must stay valid until SimpleThreadPool_Wait() returns.
+ * Only one phase can be in flight at a time.
+ */
+void SimpleThreadPool_Submit(SimpleThreadPool *tp, const SimpleThreadPoolPhase *phase);
+
+/**
+ * @brief Blocks until every job of the submitted phase has finished.
+ *
+ * This is the single barrier of a phase.
+ */
+void SimpleThreadPool_Wait(SimpleThreadPool *tp);
+
+/**
+ * @brief Submits a phase and waits for it to complete.
+ */
+void SimpleThreadPool_Run(SimpleThreadPool *tp, const SimpleThreadPoolPhase *phase);
+
+/**
+ * @brief Hands the chunks of a range phase to the workers and returns immediately.
+ *
+ * Completes with SimpleThreadPool_Wait() like any other phase, under the same rules.
+ */
+void SimpleThreadPool_SubmitRange(SimpleThreadPool *tp, const SimpleThreadPoolRangePhase *phase);
+
+/**
+ * @brief Submits a range phase and waits for it to complete.
+ */
+void SimpleThreadPool_RunRange(SimpleThreadPool *tp, const SimpleThreadPoolRangePhase *phase);
+
+/**
+ * @brief Returns the items a worker processes itself before it starts stealing.
+ *
+ * The split only depends on the phase and the thread count, so it can be used to prepare the
+ * data of each home run from its worker, e.g. to first-touch it on the right NUMA node.
+ *
+ * @param tp The pool.
+ * @param phase The range phase.
+ * @param workerIndex The worker, in the range [0, threadCount).
+ * @param start Receives the first item of the home run.
+ * @param end Receives one past the last item of the home run; equal to start if it is empty.
+ */
+void SimpleThreadPool_GetHomeRange(const SimpleThreadPool *tp, const SimpleThreadPoolRangePhase *phase, int workerIndex,
+                                   int *start, int *end);
+
+/**
+ * @brief Returns the time a worker spent running jobs since the previous call.
+ *
+ * Drains the worker's timing ring without blocking it. Must only be called from one thread.
+ *
+ * @param tp The pool.
+ * @param workerIndex The worker to query, in the range [0, threadCount).
+ *
+ * @return The busy time in seconds.
+ */
+double SimpleThreadPool_ConsumeBusyTime(SimpleThreadPool *tp, int workerIndex);
+
+/**
+ * @brief Reads the monotonic clock the pool times its workers with.
+ *
+ * Needs neither a pool nor a window, unlike raylib's GetTime().
+ *
+ * @return The time in seconds since an arbitrary fixed point.
+ */
+double SimpleThreadPool_GetTime(void);
+
+/**
+ * @brief Stops and joins the worker threads and frees the pool.
+ */
+void SimpleThreadPool_Destroy(SimpleThreadPool *tp);
 
 #endif // THREADPOOL_H
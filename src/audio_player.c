@@ -0,0 +1,254 @@
+#include "audio_player.h"
+#include "platform_threads.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define AUDIO_PI 3.14159265358979f
+
+/* ========================================================================= */
+/*                            Player                                         */
+/* ========================================================================= */
+struct AudioPlayer
+{
+    AudioMusic *music;
+    PlatformThread thread;
+    int stopping; // Set by StopAudioPlayer(), read by the audio thread
+
+    // Single-producer, single-consumer ring: the device thread only advances head, the audio
+    // thread only advances tail, and each publishes its index with a release store.
+    float ring[AUDIO_SAMPLE_RING];
+    unsigned int head; // Samples ever written, wraps around
+    unsigned int tail; // Samples ever read
+
+    // Owned by the audio thread
+    float history[AUDIO_FFT_SIZE]; // The newest AUDIO_FFT_SIZE samples, oldest at historyCursor
+    int historyCursor;
+    float window[AUDIO_FFT_SIZE];  // Hann window
+    float cosines[AUDIO_FFT_SIZE / 2]; // Twiddle factors
+    float sines[AUDIO_FFT_SIZE / 2];
+    float real[AUDIO_FFT_SIZE];
+    float imaginary[AUDIO_FFT_SIZE];
+    float peaks[AUDIO_BAND_COUNT]; // Loudest recent amplitude of every band
+
+    uint32_t levels[AUDIO_BAND_COUNT]; // Published levels as float bits, atomically stored
+};
+
+/* ========================================================================= */
+/*                            Private functions                              */
+/* ========================================================================= */
+static void InitSpectrumTables(AudioPlayer *player)
+{
+    for (int i = 0; i < AUDIO_FFT_SIZE; i++)
+    {
+        player->window[i] = 0.5f - 0.5f * cosf(2.0f * AUDIO_PI * (float)i / (float)(AUDIO_FFT_SIZE - 1));
+    }
+    for (int i = 0; i < AUDIO_FFT_SIZE / 2; i++)
+    {
+        player->cosines[i] = cosf(2.0f * AUDIO_PI * (float)i / (float)AUDIO_FFT_SIZE);
+        player->sines[i] = -sinf(2.0f * AUDIO_PI * (float)i / (float)AUDIO_FFT_SIZE);
+    }
+}
+
+// In-place iterative radix-2 transform of real[] and imaginary[]
+static void TransformSpectrum(AudioPlayer *player)
+{
+    float *re = player->real;
+    float *im = player->imaginary;
+
+    for (int i = 1, j = 0; i < AUDIO_FFT_SIZE; i++)
+    {
+        int bit = AUDIO_FFT_SIZE >> 1;
+        for (; j & bit; bit >>= 1)
+        {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j)
+        {
+            float t = re[i];
+            re[i] = re[j];
+            re[j] = t;
+            t = im[i];
+            im[i] = im[j];
+            im[j] = t;
+        }
+    }
+
+    for (int length = 2; length <= AUDIO_FFT_SIZE; length <<= 1)
+    {
+        const int half = length >> 1;
+        const int stride = AUDIO_FFT_SIZE / length;
+        for (int start = 0; start < AUDIO_FFT_SIZE; start += length)
+        {
+            for (int k = 0; k < half; k++)
+            {
+                float wr = player->cosines[k * stride];
+                float wi = player->sines[k * stride];
+                int a = start + k;
+                int b = a + half;
+                float tr = re[b] * wr - im[b] * wi;
+                float ti = re[b] * wi + im[b] * wr;
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+}
+
+// Moves the samples the device thread published into the history; returns how many arrived
+static int DrainSampleRing(AudioPlayer *player)
+{
+    unsigned int head = __atomic_load_n(&player->head, __ATOMIC_ACQUIRE);
+    unsigned int tail = player->tail;
+    if (head - tail > AUDIO_FFT_SIZE)
+    {
+        tail = head - AUDIO_FFT_SIZE; // Only the newest spectrum matters
+    }
+
+    int count = (int)(head - tail);
+    for (; tail != head; tail++)
+    {
+        player->history[player->historyCursor] = player->ring[tail & (AUDIO_SAMPLE_RING - 1)];
+        player->historyCursor = (player->historyCursor + 1) & (AUDIO_FFT_SIZE - 1);
+    }
+    __atomic_store_n(&player->tail, tail, __ATOMIC_RELEASE); // Hands the slots back to the device thread
+    return count;
+}
+
+static void AnalyzeSpectrum(AudioPlayer *player)
+{
+    for (int i = 0; i < AUDIO_FFT_SIZE; i++)
+    {
+        player->real[i] = player->history[(player->historyCursor + i) & (AUDIO_FFT_SIZE - 1)] * player->window[i];
+        player->imaginary[i] = 0.0f;
+    }
+    TransformSpectrum(player);
+
+    for (int band = 0; band < AUDIO_BAND_COUNT; band++)
+    {
+        const int first = 1 << band;
+        const int last = first << 1;
+        float power = 0.0f;
+        for (int bin = first; bin < last; bin++)
+        {
+            power += player->real[bin] * player->real[bin] + player->imaginary[bin] * player->imaginary[bin];
+        }
+        float amplitude = sqrtf(power / (float)(last - first));
+
+        // Relative to a slowly decaying peak, with a floor so that silence stays at zero
+        float peak = player->peaks[band] * AUDIO_PEAK_DECAY;
+        peak = amplitude > peak ? amplitude : peak;
+        peak = peak > 1e-3f ? peak : 1e-3f;
+        player->peaks[band] = peak;
+
+        float level = amplitude / peak;
+        uint32_t bits;
+        memcpy(&bits, &level, sizeof(bits));
+        __atomic_store_n(&player->levels[band], bits, __ATOMIC_RELAXED);
+    }
+}
+
+static PlatformThreadResult PLATFORM_THREAD_CALL AudioThreadMain(void *param)
+{
+    AudioPlayer *player = (AudioPlayer *)param;
+
+    // Decoding only has to stay a stream buffer ahead of the device, never ahead of a frame
+    PlatformThreadLowerPriority();
+    while (!__atomic_load_n(&player->stopping, __ATOMIC_ACQUIRE))
+    {
+        UpdateAudioMusic(player->music);
+        if (DrainSampleRing(player) > 0)
+        {
+            AnalyzeSpectrum(player);
+        }
+        PlatformSleep(AUDIO_REFILL_INTERVAL_MS);
+    }
+    return 0;
+}
+
+/* ========================================================================= */
+/*                            Public functions                               */
+/* ========================================================================= */
+AudioPlayer *StartAudioPlayer(const char *path)
+{
+    AudioPlayer *player = (AudioPlayer *)calloc(1, sizeof(AudioPlayer));
+    if (!player)
+    {
+        return NULL;
+    }
+    InitSpectrumTables(player);
+
+    // Playing starts here, before the thread exists, so raylib is never called from two threads
+    player->music = OpenAudioMusic(path, player);
+    if (!player->music)
+    {
+        free(player);
+        return NULL;
+    }
+    if (!PlatformThreadStart(&player->thread, AudioThreadMain, player))
+    {
+        CloseAudioMusic(player->music);
+        free(player);
+        return NULL;
+    }
+    return player;
+}
+
+void GetAudioBandLevels(const AudioPlayer *player, float *levels)
+{
+    for (int band = 0; band < AUDIO_BAND_COUNT; band++)
+    {
+        uint32_t bits = player ? __atomic_load_n(&player->levels[band], __ATOMIC_RELAXED) : 0;
+        memcpy(&levels[band], &bits, sizeof(bits));
+    }
+}
+
+float GetAudioBassLevel(const AudioPlayer *player)
+{
+    float levels[AUDIO_BAND_COUNT];
+    GetAudioBandLevels(player, levels);
+
+    float sum = 0.0f;
+    for (int band = 0; band < AUDIO_BASS_BANDS; band++)
+    {
+        sum += levels[band];
+    }
+    return sum / (float)AUDIO_BASS_BANDS;
+}
+
+void StopAudioPlayer(AudioPlayer *player)
+{
+    if (!player)
+    {
+        return;
+    }
+    __atomic_store_n(&player->stopping, 1, __ATOMIC_RELEASE);
+    PlatformThreadJoin(player->thread);
+    CloseAudioMusic(player->music); // Detaches the device thread from the ring before it is freed
+    free(player);
+}
+
+void PushAudioSamples(AudioPlayer *player, const float *frames, unsigned int frameCount, int channels)
+{
+    unsigned int head = player->head;
+    unsigned int tail = __atomic_load_n(&player->tail, __ATOMIC_ACQUIRE);
+    unsigned int space = AUDIO_SAMPLE_RING - (head - tail);
+    unsigned int count = frameCount < space ? frameCount : space;
+
+    const float scale = 1.0f / (float)channels;
+    for (unsigned int f = 0; f < count; f++)
+    {
+        float sum = 0.0f;
+        for (int c = 0; c < channels; c++)
+        {
+            sum += frames[f * channels + c];
+        }
+        player->ring[(head + f) & (AUDIO_SAMPLE_RING - 1)] = sum * scale;
+    }
+    __atomic_store_n(&player->head, head + count, __ATOMIC_RELEASE); // Publishes the samples
+}
@@ -0,0 +1,65 @@
+#include "audio_player.h"
+#include "raylib.h"
+
+#include <stdlib.h>
+
+#define AUDIO_MIXER_CHANNELS 2 // raylib hands stream processors float frames in its mixing format, stereo
+
+/* ========================================================================= */
+/*                            Music stream                                   */
+/* ========================================================================= */
+struct AudioMusic
+{
+    Music music;
+};
+
+// raylib's processors take no user pointer, so the one player being fed is kept here. It is
+// only written while the processor is detached.
+static AudioPlayer *ProcessedPlayer = NULL;
+
+/* ========================================================================= */
+/*                            Private functions                              */
+/* ========================================================================= */
+static void ProcessMixedSamples(void *bufferData, unsigned int frames)
+{
+    PushAudioSamples(ProcessedPlayer, (const float *)bufferData, frames, AUDIO_MIXER_CHANNELS);
+}
+
+/* ========================================================================= */
+/*                            Public functions                               */
+/* ========================================================================= */
+AudioMusic *OpenAudioMusic(const char *path, AudioPlayer *player)
+{
+    Music music = LoadMusicStream(path);
+    if (!music.ctxData)
+    {
+        TraceLog(LOG_WARNING, "AUDIO: Failed to load '%s'", path);
+        return NULL;
+    }
+    AudioMusic *stream = (AudioMusic *)malloc(sizeof(AudioMusic));
+    if (!stream)
+    {
+        UnloadMusicStream(music);
+        return NULL;
+    }
+    stream->music = music;
+
+    ProcessedPlayer = player;
+    AttachAudioStreamProcessor(music.stream, ProcessMixedSamples);
+    PlayMusicStream(music);
+    return stream;
+}
+
+void UpdateAudioMusic(AudioMusic *music)
+{
+    UpdateMusicStream(music->music);
+}
+
+void CloseAudioMusic(AudioMusic *music)
+{
+    StopMusicStream(music->music);
+    DetachAudioStreamProcessor(music->music.stream, ProcessMixedSamples);
+    ProcessedPlayer = NULL;
+    UnloadMusicStream(music->music);
+    free(music);
+}
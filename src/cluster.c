@@ -0,0 +1,505 @@
+#include "cluster.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Wire header of one tile, followed by one word per bit set in mask.
+ *
+ * Bit r * CLUSTER_TILE_WORDS + c of the mask stands for word c of row r of the tile. Tiles on
+ * the right and bottom edges are clipped to the bitmap and never set bits outside it.
+ */
+typedef struct ClusterTileHeader
+{
+    uint32_t index;                        // Tile number, row-major over the bitmap
+    uint32_t mask[CLUSTER_TILE_SIZE / 32]; // Non-zero words of the tile
+} ClusterTileHeader;
+
+/* ========================================================================= */
+/*                            Private functions                              */
+/* ========================================================================= */
+static int GetTileRows(const OccupancyBitmap *bitmap, int band)
+{
+    int rows = bitmap->height - band * CLUSTER_TILE_ROWS;
+    return rows < CLUSTER_TILE_ROWS ? rows : CLUSTER_TILE_ROWS;
+}
+
+static int GetTileWords(const OccupancyBitmap *bitmap, int tileX)
+{
+    int words = bitmap->stride - tileX * CLUSTER_TILE_WORDS;
+    return words < CLUSTER_TILE_WORDS ? words : CLUSTER_TILE_WORDS;
+}
+
+// Largest frame a node can send: every tile, every word non-zero
+static size_t GetMaxPayloadSize(int tileCount)
+{
+    return (size_t)tileCount * (sizeof(ClusterTileHeader) + CLUSTER_TILE_SIZE * sizeof(uint32_t));
+}
+
+static void CloseCompositorSockets(ClusterCompositor *compositor)
+{
+    for (int n = 0; n < compositor->nodeCount; n++)
+    {
+        ClusterCloseSocket(compositor->sockets[n]);
+        compositor->sockets[n] = CLUSTER_INVALID_SOCKET;
+    }
+    ClusterCloseSocket(compositor->listener);
+    compositor->listener = CLUSTER_INVALID_SOCKET;
+}
+
+// Writes the tile into the mirror: words whose bit is set come from the payload, the others are cleared
+static bool ApplyClusterTile(ClusterCompositor *compositor, OccupancyBitmap *mirror, const uint8_t **cursor,
+                             const uint8_t *end)
+{
+    ClusterTileHeader header;
+    if ((size_t)(end - *cursor) < sizeof(header))
+    {
+        return false;
+    }
+    memcpy(&header, *cursor, sizeof(header));
+    *cursor += sizeof(header);
+    if (header.index >= (uint32_t)compositor->tileCount)
+    {
+        return false;
+    }
+
+    const int band = (int)header.index / compositor->tilesPerRow;
+    const int tileX = (int)header.index % compositor->tilesPerRow;
+    const int rows = GetTileRows(mirror, band);
+    const int words = GetTileWords(mirror, tileX);
+    uint32_t *origin = &mirror->words[band * CLUSTER_TILE_ROWS * mirror->stride + tileX * CLUSTER_TILE_WORDS];
+
+    int wordCount = 0;
+    for (int i = 0; i < CLUSTER_TILE_SIZE / 32; i++)
+    {
+        wordCount += __builtin_popcount(header.mask[i]);
+    }
+    if ((size_t)(end - *cursor) < (size_t)wordCount * sizeof(uint32_t))
+    {
+        return false;
+    }
+
+    int used = 0;
+    for (int r = 0; r < CLUSTER_TILE_ROWS; r++)
+    {
+        for (int c = 0; c < CLUSTER_TILE_WORDS; c++)
+        {
+            int bit = r * CLUSTER_TILE_WORDS + c;
+            bool set = (header.mask[bit >> 5] >> (bit & 31)) & 1u;
+            if (r >= rows || c >= words)
+            {
+                if (set)
+                {
+                    return false; // Outside the bitmap
+                }
+                continue;
+            }
+            uint32_t word = 0;
+            if (set)
+            {
+                memcpy(&word, *cursor + used * sizeof(uint32_t), sizeof(word));
+                used++;
+            }
+            origin[r * mirror->stride + c] = word;
+        }
+    }
+    *cursor += (size_t)used * sizeof(uint32_t);
+    compositor->bandChanged[band] = 1;
+    return true;
+}
+
+/* ========================================================================= */
+/*                            Node                                           */
+/* ========================================================================= */
+bool ConnectClusterNode(ClusterNodeLink *link, const char *host, int port)
+{
+    memset(link, 0, sizeof(*link));
+    link->socket = ClusterConnect(host, port);
+    if (link->socket == CLUSTER_INVALID_SOCKET)
+    {
+        TraceLog(LOG_ERROR, "CLUSTER: Cannot connect to the compositor at %s:%d", host, port);
+        return false;
+    }
+
+    const uint32_t hello[2] = {CLUSTER_MAGIC, CLUSTER_VERSION};
+    ClusterSetup *setup = &link->setup;
+    if (!ClusterSend(link->socket, hello, sizeof(hello)) || !ClusterReceive(link->socket, setup, sizeof(*setup)))
+    {
+        TraceLog(LOG_ERROR, "CLUSTER: The compositor at %s:%d hung up before sending a shard", host, port);
+        CloseClusterNode(link);
+        return false;
+    }
+    if (setup->magic != CLUSTER_MAGIC || setup->version != CLUSTER_VERSION || setup->gridWidth <= 0 ||
+        setup->gridHeight <= 0 || setup->shardStart < 0 || setup->shardEnd <= setup->shardStart ||
+        setup->shardEnd > setup->particleCount)
+    {
+        TraceLog(LOG_ERROR, "CLUSTER: The compositor at %s:%d sent an invalid setup (version %u, expected %u)", host, port,
+                 setup->version, CLUSTER_VERSION);
+        CloseClusterNode(link);
+        return false;
+    }
+
+    link->sent = AllocateOccupancyBitmap(setup->gridWidth, setup->gridHeight, false);
+    link->tilesPerRow = (link->sent.stride + CLUSTER_TILE_WORDS - 1) / CLUSTER_TILE_WORDS;
+    link->sentBands = (uint8_t *)calloc(link->sent.bandCount, sizeof(uint8_t));
+    link->payload = (uint8_t *)malloc(GetMaxPayloadSize(link->tilesPerRow * link->sent.bandCount));
+    if (!link->sent.words || !link->sent.bandTouched || !link->sentBands || !link->payload)
+    {
+        TraceLog(LOG_ERROR, "CLUSTER: Failed to allocate the tile buffers");
+        CloseClusterNode(link);
+        return false;
+    }
+
+    TraceLog(LOG_INFO, "CLUSTER: Simulating particles [%d, %d) of %d on a %dx%d grid for %s:%d", setup->shardStart,
+             setup->shardEnd, setup->particleCount, setup->gridWidth, setup->gridHeight, host, port);
+    return true;
+}
+
+bool ReceiveClusterTick(ClusterNodeLink *link, ForceField *field, int *step)
+{
+    ClusterTick tick;
+    if (!ClusterReceive(link->socket, &tick, sizeof(tick)))
+    {
+        return false;
+    }
+    if (tick.attractorCount < 1 || tick.attractorCount > MAX_ATTRACTORS)
+    {
+        TraceLog(LOG_ERROR, "CLUSTER: Received a tick with %d attractors", tick.attractorCount);
+        return false;
+    }
+
+    ClusterAttractor attractors[MAX_ATTRACTORS];
+    if (!ClusterReceive(link->socket, attractors, (size_t)tick.attractorCount * sizeof(ClusterAttractor)))
+    {
+        return false;
+    }
+    for (int i = 0; i < tick.attractorCount; i++)
+    {
+        field->attractors[i] = (Attractor){
+            .position = {attractors[i].x, attractors[i].y},
+            .strength = attractors[i].strength,
+            .falloffRadiusSq = attractors[i].falloffRadiusSq
+        };
+    }
+    field->count = tick.attractorCount;
+    *step = tick.step;
+    return true;
+}
+
+bool SendClusterFrame(ClusterNodeLink *link, OccupancyBitmap *buffers, int bufferCount, int step, float stepMs)
+{
+    OccupancyBitmap *sent = &link->sent;
+    const int stride = sent->stride;
+    uint8_t *cursor = link->payload;
+    int tileCount = 0;
+
+    for (int band = 0; band < sent->bandCount; band++)
+    {
+        OccupancyBitmap *touched[MAX_THREADS];
+        int touchedCount = 0;
+        for (int b = 0; b < bufferCount; b++)
+        {
+            if (buffers[b].bandTouched[band])
+            {
+                touched[touchedCount++] = &buffers[b];
+            }
+        }
+
+        // Empty now and empty in the frame the compositor has, nothing can have changed
+        if (touchedCount == 0 && !link->sentBands[band])
+        {
+            continue;
+        }
+
+        const int rowStart = band * CLUSTER_TILE_ROWS;
+        const int rows = GetTileRows(sent, band);
+        bool occupied = false;
+        for (int tileX = 0; tileX < link->tilesPerRow; tileX++)
+        {
+            const int words = GetTileWords(sent, tileX);
+            ClusterTileHeader header = {.index = (uint32_t)(band * link->tilesPerRow + tileX)};
+            uint32_t tile[CLUSTER_TILE_SIZE];
+            int tileWords = 0;
+            bool changed = false;
+
+            for (int r = 0; r < rows; r++)
+            {
+                const int rowOffset = (rowStart + r) * stride + tileX * CLUSTER_TILE_WORDS;
+                for (int c = 0; c < words; c++)
+                {
+                    uint32_t word = 0;
+                    for (int t = 0; t < touchedCount; t++)
+                    {
+                        word |= touched[t]->words[rowOffset + c];
+                    }
+
+                    changed |= word != sent->words[rowOffset + c];
+                    sent->words[rowOffset + c] = word;
+                    if (word)
+                    {
+                        int bit = r * CLUSTER_TILE_WORDS + c;
+                        header.mask[bit >> 5] |= 1u << (bit & 31);
+                        tile[tileWords++] = word;
+                    }
+                }
+            }
+
+            occupied |= tileWords > 0;
+            if (changed)
+            {
+                memcpy(cursor, &header, sizeof(header));
+                cursor += sizeof(header);
+                memcpy(cursor, tile, (size_t)tileWords * sizeof(uint32_t));
+                cursor += (size_t)tileWords * sizeof(uint32_t);
+                tileCount++;
+            }
+        }
+        link->sentBands[band] = occupied;
+
+        // Leave the bitmaps clear for the next step, as the combine phase would have
+        for (int t = 0; t < touchedCount; t++)
+        {
+            memset(&touched[t]->words[rowStart * stride], 0, (size_t)rows * stride * sizeof(uint32_t));
+            touched[t]->bandTouched[band] = 0;
+        }
+    }
+
+    ClusterFrame frame = {
+        .step = step,
+        .tileCount = tileCount,
+        .byteCount = (int32_t)(cursor - link->payload),
+        .stepMs = stepMs
+    };
+    return ClusterSend(link->socket, &frame, sizeof(frame)) &&
+           ClusterSend(link->socket, link->payload, (size_t)frame.byteCount);
+}
+
+void CloseClusterNode(ClusterNodeLink *link)
+{
+    ClusterCloseSocket(link->socket);
+    link->socket = CLUSTER_INVALID_SOCKET;
+    FreeOccupancyBitmap(&link->sent);
+    free(link->sentBands);
+    free(link->payload);
+    link->sentBands = NULL;
+    link->payload = NULL;
+}
+
+/* ========================================================================= */
+/*                            Compositor                                     */
+/* ========================================================================= */
+bool StartClusterCompositor(ClusterCompositor *compositor, const SimulationConfig *config)
+{
+    memset(compositor, 0, sizeof(*compositor));
+    compositor->listener = CLUSTER_INVALID_SOCKET;
+    const int nodeCount = config->clusterNodes;
+    if (config->particleCount < nodeCount)
+    {
+        TraceLog(LOG_ERROR, "CLUSTER: %d particles cannot be sharded over %d nodes", config->particleCount, nodeCount);
+        return false;
+    }
+
+    compositor->nodeCount = nodeCount;
+    bool allocated = true;
+    for (int n = 0; n < nodeCount; n++)
+    {
+        compositor->sockets[n] = CLUSTER_INVALID_SOCKET;
+        compositor->mirrors[n] = AllocateOccupancyBitmap(config->screenWidth, config->screenHeight, false);
+        allocated = allocated && compositor->mirrors[n].words && compositor->mirrors[n].bandTouched;
+    }
+    const OccupancyBitmap *layout = &compositor->mirrors[0];
+    compositor->tilesPerRow = (layout->stride + CLUSTER_TILE_WORDS - 1) / CLUSTER_TILE_WORDS;
+    compositor->tileCount = compositor->tilesPerRow * layout->bandCount;
+    compositor->payloadCapacity = (int)GetMaxPayloadSize(compositor->tileCount);
+    compositor->payload = (uint8_t *)malloc((size_t)compositor->payloadCapacity);
+    compositor->bandChanged = (uint8_t *)calloc(layout->bandCount, sizeof(uint8_t));
+    if (!allocated || !compositor->payload || !compositor->bandChanged)
+    {
+        TraceLog(LOG_ERROR, "CLUSTER: Failed to allocate the node mirrors");
+        StopClusterCompositor(compositor);
+        return false;
+    }
+
+    compositor->listener = ClusterListen(config->clusterPort);
+    if (compositor->listener == CLUSTER_INVALID_SOCKET)
+    {
+        TraceLog(LOG_ERROR, "CLUSTER: Cannot listen on port %d", config->clusterPort);
+        StopClusterCompositor(compositor);
+        return false;
+    }
+    TraceLog(LOG_INFO, "CLUSTER: Waiting for %d nodes on port %d", nodeCount, config->clusterPort);
+
+    for (int n = 0; n < nodeCount; n++)
+    {
+        ClusterSocket socket = ClusterAccept(compositor->listener);
+        uint32_t hello[2] = {0};
+        if (socket == CLUSTER_INVALID_SOCKET || !ClusterReceive(socket, hello, sizeof(hello)) ||
+            hello[0] != CLUSTER_MAGIC || hello[1] != CLUSTER_VERSION)
+        {
+            // Something other than a node of this version, keep waiting for a real one
+            TraceLog(LOG_WARNING, "CLUSTER: Rejected a connection that is not a version %u node", CLUSTER_VERSION);
+            ClusterCloseSocket(socket);
+            n--;
+            continue;
+        }
+
+        const long long count = config->particleCount;
+        ClusterSetup setup = {
+            .magic = CLUSTER_MAGIC,
+            .version = CLUSTER_VERSION,
+            .gridWidth = config->screenWidth,
+            .gridHeight = config->screenHeight,
+            .particleCount = config->particleCount,
+            .shardStart = (int32_t)(count * n / nodeCount),
+            .shardEnd = (int32_t)(count * (n + 1) / nodeCount),
+            .friction = config->friction,
+            .fastMath = config->fastMath
+        };
+        if (!ClusterSend(socket, &setup, sizeof(setup)))
+        {
+            TraceLog(LOG_WARNING, "CLUSTER: Node %d hung up before receiving its shard", n);
+            ClusterCloseSocket(socket);
+            n--;
+            continue;
+        }
+        compositor->sockets[n] = socket;
+        TraceLog(LOG_INFO, "CLUSTER: Node %d of %d simulates particles [%d, %d)", n + 1, nodeCount, setup.shardStart,
+                 setup.shardEnd);
+    }
+
+    // Every node is in, nobody else is let in
+    ClusterCloseSocket(compositor->listener);
+    compositor->listener = CLUSTER_INVALID_SOCKET;
+    return true;
+}
+
+bool BroadcastClusterTick(ClusterCompositor *compositor, const ForceField *field, int step)
+{
+    // One message per node, so each starts the step as soon as its own tick arrived
+    uint8_t message[sizeof(ClusterTick) + MAX_ATTRACTORS * sizeof(ClusterAttractor)];
+    ClusterTick tick = {.step = step, .attractorCount = field->count};
+    memcpy(message, &tick, sizeof(tick));
+    for (int i = 0; i < field->count; i++)
+    {
+        const Attractor *attractor = &field->attractors[i];
+        ClusterAttractor wire = {
+            .x = attractor->position.x,
+            .y = attractor->position.y,
+            .strength = attractor->strength,
+            .falloffRadiusSq = attractor->falloffRadiusSq
+        };
+        memcpy(&message[sizeof(tick) + i * sizeof(wire)], &wire, sizeof(wire));
+    }
+
+    const size_t size = sizeof(tick) + (size_t)field->count * sizeof(ClusterAttractor);
+    for (int n = 0; n < compositor->nodeCount; n++)
+    {
+        if (!ClusterSend(compositor->sockets[n], message, size))
+        {
+            TraceLog(LOG_ERROR, "CLUSTER: Node %d hung up", n + 1);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool GatherClusterFrames(ClusterCompositor *compositor, int step)
+{
+    for (int n = 0; n < compositor->nodeCount; n++)
+    {
+        ClusterFrame frame;
+        if (!ClusterReceive(compositor->sockets[n], &frame, sizeof(frame)))
+        {
+            TraceLog(LOG_ERROR, "CLUSTER: Node %d hung up", n + 1);
+            return false;
+        }
+        if (frame.step != step || frame.tileCount < 0 || frame.tileCount > compositor->tileCount ||
+            frame.byteCount < 0 || frame.byteCount > compositor->payloadCapacity)
+        {
+            TraceLog(LOG_ERROR, "CLUSTER: Node %d sent an invalid frame for step %d", n + 1, step);
+            return false;
+        }
+        if (!ClusterReceive(compositor->sockets[n], compositor->payload, (size_t)frame.byteCount))
+        {
+            TraceLog(LOG_ERROR, "CLUSTER: Node %d hung up", n + 1);
+            return false;
+        }
+
+        const uint8_t *cursor = compositor->payload;
+        const uint8_t *end = cursor + frame.byteCount;
+        for (int t = 0; t < frame.tileCount; t++)
+        {
+            if (!ApplyClusterTile(compositor, &compositor->mirrors[n], &cursor, end))
+            {
+                TraceLog(LOG_ERROR, "CLUSTER: Node %d sent an invalid tile for step %d", n + 1, step);
+                return false;
+            }
+        }
+
+        compositor->stats.frames++;
+        compositor->stats.tiles += frame.tileCount;
+        compositor->stats.bytes += (long long)sizeof(frame) + frame.byteCount;
+        compositor->stats.totalTiles += compositor->tileCount;
+        compositor->stats.nodeStepMs += frame.stepMs;
+    }
+    return true;
+}
+
+int StageClusterBands(ClusterCompositor *compositor, OccupancyBitmap *bitmaps, int *bands)
+{
+    const OccupancyBitmap *layout = &compositor->mirrors[0];
+    int bandCount = 0;
+    for (int band = 0; band < layout->bandCount; band++)
+    {
+        if (!compositor->bandChanged[band])
+        {
+            continue;
+        }
+        compositor->bandChanged[band] = 0;
+
+        const size_t offset = (size_t)band * CLUSTER_TILE_ROWS * layout->stride;
+        const size_t wordCount = (size_t)GetTileRows(layout, band) * layout->stride;
+        for (int n = 0; n < compositor->nodeCount; n++)
+        {
+            const uint32_t *source = &compositor->mirrors[n].words[offset];
+            uint32_t occupied = 0;
+            for (size_t i = 0; i < wordCount; i++)
+            {
+                occupied |= source[i];
+            }
+            if (occupied)
+            {
+                memcpy(&bitmaps[n].words[offset], source, wordCount * sizeof(uint32_t));
+                bitmaps[n].bandTouched[band] = 1;
+            }
+        }
+        bands[bandCount++] = band;
+    }
+    return bandCount;
+}
+
+void LogClusterSummary(const ClusterCompositor *compositor)
+{
+    const ClusterStats *stats = &compositor->stats;
+    if (stats->frames == 0)
+    {
+        return;
+    }
+    TraceLog(LOG_INFO, "CLUSTER: %lld node frames, %.1f%% of the tiles sent, %.1f KB per frame, %.2f ms per node step",
+             stats->frames, 100.0 * (double)stats->tiles / (double)stats->totalTiles,
+             (double)stats->bytes / 1024.0 / (double)stats->frames, stats->nodeStepMs / (double)stats->frames);
+}
+
+void StopClusterCompositor(ClusterCompositor *compositor)
+{
+    CloseCompositorSockets(compositor);
+    for (int n = 0; n < compositor->nodeCount; n++)
+    {
+        FreeOccupancyBitmap(&compositor->mirrors[n]);
+    }
+    free(compositor->payload);
+    free(compositor->bandChanged);
+    compositor->payload = NULL;
+    compositor->bandChanged = NULL;
+    compositor->nodeCount = 0;
+}
@@ -0,0 +1,208 @@
+#include "cluster_net.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+typedef SOCKET NativeSocket;
+typedef int TransferSize;
+#define NATIVE_INVALID_SOCKET INVALID_SOCKET
+#define CloseNativeSocket closesocket
+#define SEND_FLAGS 0
+#else
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+typedef int NativeSocket;
+typedef size_t TransferSize;
+#define NATIVE_INVALID_SOCKET (-1)
+#define CloseNativeSocket close
+#if defined(MSG_NOSIGNAL)
+#define SEND_FLAGS MSG_NOSIGNAL // A node that went away fails the send instead of raising SIGPIPE
+#else
+#define SEND_FLAGS 0
+#endif
+#endif
+
+#define CLUSTER_TRANSFER_CHUNK (1 << 20) // Largest single send or receive call
+
+/* ========================================================================= */
+/*                            Private functions                              */
+/* ========================================================================= */
+static ClusterSocket WrapSocket(NativeSocket native)
+{
+    return native == NATIVE_INVALID_SOCKET ? CLUSTER_INVALID_SOCKET : (ClusterSocket)native;
+}
+
+// Frames are one request and one reply per step; batching small writes would only add latency
+static void DisableNagle(NativeSocket native)
+{
+    int on = 1;
+    setsockopt(native, IPPROTO_TCP, TCP_NODELAY, (const char *)&on, sizeof(on));
+}
+
+// A signal delivered before any byte moved fails the call without closing the connection
+static bool WasInterrupted(void)
+{
+#if defined(_WIN32)
+    return WSAGetLastError() == WSAEINTR;
+#else
+    return errno == EINTR;
+#endif
+}
+
+/* ========================================================================= */
+/*                            Public functions                               */
+/* ========================================================================= */
+bool ClusterNetStartup(void)
+{
+#if defined(_WIN32)
+    WSADATA data;
+    return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+#else
+#if !defined(MSG_NOSIGNAL)
+    signal(SIGPIPE, SIG_IGN);
+#endif
+    return true;
+#endif
+}
+
+void ClusterNetCleanup(void)
+{
+#if defined(_WIN32)
+    WSACleanup();
+#endif
+}
+
+ClusterSocket ClusterListen(int port)
+{
+    NativeSocket native = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (native == NATIVE_INVALID_SOCKET)
+    {
+        return CLUSTER_INVALID_SOCKET;
+    }
+
+    // A restarted compositor can take the port back while the old connections time out
+    int on = 1;
+    setsockopt(native, SOL_SOCKET, SO_REUSEADDR, (const char *)&on, sizeof(on));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons((unsigned short)port);
+    if (bind(native, (const struct sockaddr *)&address, sizeof(address)) != 0 || listen(native, 16) != 0)
+    {
+        CloseNativeSocket(native);
+        return CLUSTER_INVALID_SOCKET;
+    }
+    return WrapSocket(native);
+}
+
+ClusterSocket ClusterAccept(ClusterSocket listener)
+{
+    NativeSocket native = accept((NativeSocket)listener, NULL, NULL);
+    if (native != NATIVE_INVALID_SOCKET)
+    {
+        DisableNagle(native);
+    }
+    return WrapSocket(native);
+}
+
+ClusterSocket ClusterConnect(const char *host, int port)
+{
+    char service[16];
+    snprintf(service, sizeof(service), "%d", port);
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    struct addrinfo *addresses = NULL;
+    if (getaddrinfo(host, service, &hints, &addresses) != 0)
+    {
+        return CLUSTER_INVALID_SOCKET;
+    }
+
+    NativeSocket native = NATIVE_INVALID_SOCKET;
+    for (struct addrinfo *address = addresses; address; address = address->ai_next)
+    {
+        native = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (native == NATIVE_INVALID_SOCKET)
+        {
+            continue;
+        }
+        if (connect(native, address->ai_addr, (int)address->ai_addrlen) == 0)
+        {
+            break;
+        }
+        CloseNativeSocket(native);
+        native = NATIVE_INVALID_SOCKET;
+    }
+    freeaddrinfo(addresses);
+
+    if (native != NATIVE_INVALID_SOCKET)
+    {
+        DisableNagle(native);
+    }
+    return WrapSocket(native);
+}
+
+bool ClusterSend(ClusterSocket socket, const void *data, size_t size)
+{
+    const char *bytes = (const char *)data;
+    while (size > 0)
+    {
+        size_t chunk = size < CLUSTER_TRANSFER_CHUNK ? size : CLUSTER_TRANSFER_CHUNK;
+        long sent = (long)send((NativeSocket)socket, bytes, (TransferSize)chunk, SEND_FLAGS);
+        if (sent < 0 && WasInterrupted())
+        {
+            continue;
+        }
+        if (sent <= 0)
+        {
+            return false;
+        }
+        bytes += sent;
+        size -= (size_t)sent;
+    }
+    return true;
+}
+
+bool ClusterReceive(ClusterSocket socket, void *data, size_t size)
+{
+    char *bytes = (char *)data;
+    while (size > 0)
+    {
+        size_t chunk = size < CLUSTER_TRANSFER_CHUNK ? size : CLUSTER_TRANSFER_CHUNK;
+        long received = (long)recv((NativeSocket)socket, bytes, (TransferSize)chunk, 0);
+        if (received < 0 && WasInterrupted())
+        {
+            continue;
+        }
+        if (received <= 0)
+        {
+            return false;
+        }
+        bytes += received;
+        size -= (size_t)received;
+    }
+    return true;
+}
+
+void ClusterCloseSocket(ClusterSocket socket)
+{
+    if (socket != CLUSTER_INVALID_SOCKET)
+    {
+        CloseNativeSocket((NativeSocket)socket);
+    }
+}
@@ -0,0 +1,611 @@
+#include "config.h"
+#include "particle_sort.h"
+#include "raylib.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ========================================================================= */
+/*                            Option table                                   */
+/* ========================================================================= */
+typedef enum OptionType
+{
+    OPTION_INT,
+    OPTION_FLOAT,
+    OPTION_CHOICE,   // Stored as an int, the index of the value in choices
+    OPTION_ATTRACTOR, // "x,y,strength[,falloff[,orbitRadius,orbitPeriod]]" appended to an AttractorList
+    OPTION_EMITTER,   // "x,y,rate,lifetime[,speed[,angle,spread]]" appended to an EmitterList
+    OPTION_PATH       // Copied into a char[CONFIG_PATH_LENGTH]
+} OptionType;
+
+typedef struct ConfigOption
+{
+    const char *name;  // Flag name without dashes, also the config file key
+    OptionType type;   // How the value is parsed
+    size_t offset;     // Offset of the field in SimulationConfig
+    const char *help;  // One-line description for --help
+    const char *const *choices; // NULL-terminated accepted values of an OPTION_CHOICE
+} ConfigOption;
+
+static const char *const BackendChoices[] = {"cpu", "gpu", "cluster", NULL};
+static const char *const RenderChoices[] = {"occupancy", "density", NULL};
+static const char *const StorageChoices[] = {"full", "compact", NULL};
+static const char *const UploadChoices[] = {"copy", "pbo", NULL};
+static const char *const SimdChoices[] = {"auto", "scalar", "sse4.1", "avx2", "avx512", NULL};
+static const char *const PinningChoices[] = {"none", "cpus", "cores", NULL};
+
+static const ConfigOption Options[] = {
+    {"particles", OPTION_INT, offsetof(SimulationConfig, particleCount), "number of particles"},
+    {"threads", OPTION_INT, offsetof(SimulationConfig, threadCount), "number of worker threads"},
+    {"width", OPTION_INT, offsetof(SimulationConfig, screenWidth), "simulation width in pixels (0 = display width / simscale)"},
+    {"height", OPTION_INT, offsetof(SimulationConfig, screenHeight), "simulation height in pixels (0 = display height / simscale)"},
+    {"simscale", OPTION_INT, offsetof(SimulationConfig, simScale), "run the simulation at 1/N of the display resolution, upscaled by the GPU"},
+    {"attraction", OPTION_FLOAT, offsetof(SimulationConfig, attractionStrength), "attraction strength"},
+    {"friction", OPTION_FLOAT, offsetof(SimulationConfig, friction), "velocity multiplier per frame"},
+    {"backend", OPTION_CHOICE, offsetof(SimulationConfig, backend), "particle backend", BackendChoices},
+    {"render", OPTION_CHOICE, offsetof(SimulationConfig, renderMode), "pixel shading, 'density' tone-maps per-pixel particle counts", RenderChoices},
+    {"storage", OPTION_CHOICE, offsetof(SimulationConfig, storage), "particle state precision, 'compact' halves the bytes per particle", StorageChoices},
+    {"upload", OPTION_CHOICE, offsetof(SimulationConfig, pixelUpload), "pixel path, 'pbo' combines straight into mapped GPU buffers", UploadChoices},
+    {"benchmark", OPTION_INT, offsetof(SimulationConfig, benchmarkFrames), "time N frames in a hidden window and print CSV (0 = off)"},
+    {"simd", OPTION_CHOICE, offsetof(SimulationConfig, simdLevel), "CPU kernel instruction set", SimdChoices},
+    {"fastmath", OPTION_INT, offsetof(SimulationConfig, fastMath), "integrate with refined rsqrt estimates on a softened distance"},
+    {"verify", OPTION_INT, offsetof(SimulationConfig, verifyKernels), "check every supported kernel against the scalar one, print CSV and exit"},
+    {"pin", OPTION_CHOICE, offsetof(SimulationConfig, pinning), "bind workers to logical processors, 'cores' skips SMT siblings", PinningChoices},
+    {"fused", OPTION_INT, offsetof(SimulationConfig, fusedUpdate), "integrate and splat in one pass (0 = separate rasterization phase)"},
+    {"pipelined", OPTION_INT, offsetof(SimulationConfig, pipelined), "integrate the next frame while presenting this one (one frame of latency)"},
+    {"attractor", OPTION_ATTRACTOR, offsetof(SimulationConfig, attractors), "add an attractor, x,y,strength[,falloff[,orbit,period]] (repeatable, negative strength repels)"},
+    {"repulsion", OPTION_FLOAT, offsetof(SimulationConfig, repulsion), "particle-particle repulsion strength (0 = off)"},
+    {"repelradius", OPTION_FLOAT, offsetof(SimulationConfig, repulsionRadius), "particle-particle interaction radius in pixels"},
+    {"profiler", OPTION_INT, offsetof(SimulationConfig, showProfiler), "show the frame profiler overlay at startup (toggle with F3)"},
+    {"snapshot", OPTION_PATH, offsetof(SimulationConfig, snapshotPath), "file the particle state is saved to with F5"},
+    {"restore", OPTION_PATH, offsetof(SimulationConfig, restorePath), "start from a saved snapshot, with its particle count and forces"},
+    {"emitter", OPTION_EMITTER, offsetof(SimulationConfig, emitters), "add an emitter, x,y,rate,lifetime[,speed[,angle,spread]] (repeatable, rate per frame)"},
+    {"emitterpool", OPTION_INT, offsetof(SimulationConfig, emitterCapacity), "emitted particles alive at once at most"},
+    {"sortinterval", OPTION_INT, offsetof(SimulationConfig, sortInterval), "frames between re-sorts of the particles along a Morton curve (0 = off)"},
+    {"governor", OPTION_INT, offsetof(SimulationConfig, governor), "drop particles while the p99 frame time is over budget, restore them after"},
+    {"governorfloor", OPTION_FLOAT, offsetof(SimulationConfig, governorFloor), "share of the particles the governor always keeps"},
+    {"steprate", OPTION_INT, offsetof(SimulationConfig, stepRate), "fixed simulation steps per second, independent of the frame rate (0 = one per frame)"},
+    {"maxsteps", OPTION_INT, offsetof(SimulationConfig, maxSteps), "steps a slow frame catches up at most before the simulation slows down"},
+    {"record", OPTION_PATH, offsetof(SimulationConfig, recordPath), "write the attractor input of every step to a file"},
+    {"replay", OPTION_PATH, offsetof(SimulationConfig, replayPath), "take the attractor input from a recording instead of the pointer"},
+    {"audiodrive", OPTION_FLOAT, offsetof(SimulationConfig, audioDrive), "extra pointer attraction at full bass, as a multiple of 'attraction' (0 = off)"},
+    {"clusternodes", OPTION_INT, offsetof(SimulationConfig, clusterNodes), "nodes the cluster backend waits for and shards the particles over"},
+    {"clusterport", OPTION_INT, offsetof(SimulationConfig, clusterPort), "TCP port of the cluster compositor"},
+    {"clusterhost", OPTION_PATH, offsetof(SimulationConfig, clusterHost), "run headless as a node of the cluster compositor on this host"},
+    {"export", OPTION_PATH, offsetof(SimulationConfig, exportPath), "render headless to frames like out/%05d.png or .rgba, or '|command' fed raw RGBA"},
+    {"exportframes", OPTION_INT, offsetof(SimulationConfig, exportFrames), "number of frames to export"},
+};
+
+#define OPTION_COUNT (int)(sizeof(Options) / sizeof(Options[0]))
+
+/* ========================================================================= */
+/*                            Private functions                              */
+/* ========================================================================= */
+static const ConfigOption *FindOption(const char *name, size_t length)
+{
+    for (int i = 0; i < OPTION_COUNT; i++)
+    {
+        if (strlen(Options[i].name) == length && strncmp(Options[i].name, name, length) == 0)
+        {
+            return &Options[i];
+        }
+    }
+    return NULL;
+}
+
+// Parses up to maxFields comma-separated floats, all of the text consumed. Returns the number
+// of fields, or 0 if the text is malformed.
+static int ParseFloatList(const char *value, float *fields, int maxFields)
+{
+    int fieldCount = 0;
+    const char *cursor = value;
+    char *end = NULL;
+
+    for (;;)
+    {
+        if (fieldCount == maxFields)
+        {
+            return 0;
+        }
+        fields[fieldCount++] = strtof(cursor, &end);
+        if (end == cursor)
+        {
+            return 0;
+        }
+        if (*end == '\0')
+        {
+            break;
+        }
+        if (*end != ',')
+        {
+            return 0;
+        }
+        cursor = end + 1;
+    }
+    return errno ? 0 : fieldCount;
+}
+
+static bool ParseAttractor(AttractorList *list, const char *value)
+{
+    float fields[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+    int fieldCount = ParseFloatList(value, fields, 6);
+
+    if (fieldCount < 3 || fieldCount == 5)
+    {
+        return false;
+    }
+    if (list->count == MAX_ATTRACTORS - 1)
+    {
+        TraceLog(LOG_ERROR, "CONFIG: At most %d attractors can be added", MAX_ATTRACTORS - 1);
+        return false;
+    }
+
+    list->items[list->count++] = (AttractorConfig){
+        .x = fields[0],
+        .y = fields[1],
+        .strength = fields[2],
+        .falloff = fields[3],
+        .orbitRadius = fields[4],
+        .orbitPeriod = fields[5]
+    };
+    return true;
+}
+
+static bool ParseEmitter(EmitterList *list, const char *value)
+{
+    float fields[7] = {0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 360.0f}; // Speed 1, every direction
+    int fieldCount = ParseFloatList(value, fields, 7);
+
+    if (fieldCount < 4 || fieldCount == 6)
+    {
+        return false;
+    }
+    if (list->count == MAX_EMITTERS)
+    {
+        TraceLog(LOG_ERROR, "CONFIG: At most %d emitters can be added", MAX_EMITTERS);
+        return false;
+    }
+
+    list->items[list->count++] = (EmitterConfig){
+        .x = fields[0],
+        .y = fields[1],
+        .rate = fields[2],
+        .lifetime = fields[3],
+        .speed = fields[4],
+        .angle = fields[5],
+        .spread = fields[6]
+    };
+    return true;
+}
+
+static bool SetOption(SimulationConfig *config, const ConfigOption *option, const char *value)
+{
+    char *end = NULL;
+    void *field = (char *)config + option->offset;
+
+    errno = 0;
+    switch (option->type)
+    {
+    case OPTION_INT:
+    {
+        long parsed = strtol(value, &end, 10);
+        if (errno || end == value || *end != '\0')
+        {
+            break;
+        }
+        *(int *)field = (int)parsed;
+        return true;
+    }
+    case OPTION_FLOAT:
+    {
+        float parsed = strtof(value, &end);
+        if (errno || end == value || *end != '\0')
+        {
+            break;
+        }
+        *(float *)field = parsed;
+        return true;
+    }
+    case OPTION_CHOICE:
+    {
+        for (int i = 0; option->choices[i]; i++)
+        {
+            if (strcmp(option->choices[i], value) == 0)
+            {
+                *(int *)field = i;
+                return true;
+            }
+        }
+        break;
+    }
+    case OPTION_ATTRACTOR:
+    {
+        if (ParseAttractor((AttractorList *)field, value))
+        {
+            return true;
+        }
+        break;
+    }
+    case OPTION_EMITTER:
+    {
+        if (ParseEmitter((EmitterList *)field, value))
+        {
+            return true;
+        }
+        break;
+    }
+    case OPTION_PATH:
+    {
+        if (strlen(value) >= CONFIG_PATH_LENGTH)
+        {
+            break;
+        }
+        strcpy((char *)field, value);
+        return true;
+    }
+    }
+
+    TraceLog(LOG_ERROR, "CONFIG: Invalid value '%s' for '%s'", value, option->name);
+    return false;
+}
+
+static char *TrimWhitespace(char *text)
+{
+    while (isspace((unsigned char)*text))
+    {
+        text++;
+    }
+
+    char *end = text + strlen(text);
+    while (end > text && isspace((unsigned char)end[-1]))
+    {
+        *--end = '\0';
+    }
+
+    return text;
+}
+
+static void PrintUsage(const char *program)
+{
+    printf("Usage: %s [--config <file>] [--<option> <value>]...\n\nOptions:\n", program);
+    for (int i = 0; i < OPTION_COUNT; i++)
+    {
+        printf("  --%-14s %s", Options[i].name, Options[i].help);
+        if (Options[i].type == OPTION_CHOICE)
+        {
+            for (int c = 0; Options[i].choices[c]; c++)
+            {
+                printf("%s%s", c == 0 ? " (" : "|", Options[i].choices[c]);
+            }
+            printf(")");
+        }
+        printf("\n");
+    }
+}
+
+/* ========================================================================= */
+/*                            Public functions                               */
+/* ========================================================================= */
+void DefaultSimulationConfig(SimulationConfig *config)
+{
+    config->particleCount = DEFAULT_PARTICLE_COUNT;
+    config->threadCount = DEFAULT_THREAD_COUNT;
+    config->screenWidth = 0;
+    config->screenHeight = 0;
+    config->simScale = DEFAULT_SIM_SCALE;
+    config->attractionStrength = DEFAULT_ATTRACTION_STRENGTH;
+    config->friction = DEFAULT_FRICTION;
+    config->backend = BACKEND_CPU;
+    config->renderMode = RENDER_OCCUPANCY;
+    config->storage = STORAGE_FULL;
+    config->pixelUpload = UPLOAD_COPY;
+    config->benchmarkFrames = DEFAULT_BENCHMARK_FRAMES;
+    config->showProfiler = DEFAULT_SHOW_PROFILER;
+    config->fusedUpdate = DEFAULT_FUSED_UPDATE;
+    config->pipelined = DEFAULT_PIPELINED;
+    config->simdLevel = SIMD_AUTO;
+    config->fastMath = DEFAULT_FAST_MATH;
+    config->verifyKernels = 0;
+    config->pinning = SIMPLE_THREADPOOL_PIN_NONE;
+    config->attractors.count = 0;
+    config->repulsion = DEFAULT_REPULSION;
+    config->repulsionRadius = DEFAULT_REPULSION_RADIUS;
+    strcpy(config->snapshotPath, DEFAULT_SNAPSHOT_PATH);
+    config->restorePath[0] = '\0';
+    config->exportPath[0] = '\0';
+    config->exportFrames = DEFAULT_EXPORT_FRAMES;
+    config->emitters.count = 0;
+    config->emitterCapacity = DEFAULT_EMITTER_CAPACITY;
+    config->sortInterval = 0;
+    config->governor = DEFAULT_GOVERNOR;
+    config->governorFloor = DEFAULT_GOVERNOR_FLOOR;
+    config->stepRate = DEFAULT_STEP_RATE;
+    config->maxSteps = DEFAULT_MAX_STEPS;
+    config->recordPath[0] = '\0';
+    config->replayPath[0] = '\0';
+    config->audioDrive = DEFAULT_AUDIO_DRIVE;
+    config->clusterNodes = DEFAULT_CLUSTER_NODES;
+    config->clusterPort = DEFAULT_CLUSTER_PORT;
+    config->clusterHost[0] = '\0';
+}
+
+bool LoadSimulationConfigFile(SimulationConfig *config, const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        TraceLog(LOG_ERROR, "CONFIG: Failed to open '%s'", path);
+        return false;
+    }
+
+    char line[512];
+    int lineNumber = 0;
+    bool ok = true;
+
+    while (ok && fgets(line, sizeof(line), file))
+    {
+        lineNumber++;
+        char *text = TrimWhitespace(line);
+        if (*text == '\0' || *text == '#')
+        {
+            continue;
+        }
+
+        char *separator = strchr(text, '=');
+        if (!separator)
+        {
+            TraceLog(LOG_ERROR, "CONFIG: %s:%d: expected 'key = value'", path, lineNumber);
+            ok = false;
+            break;
+        }
+
+        *separator = '\0';
+        char *key = TrimWhitespace(text);
+        char *value = TrimWhitespace(separator + 1);
+
+        const ConfigOption *option = FindOption(key, strlen(key));
+        if (!option)
+        {
+            TraceLog(LOG_ERROR, "CONFIG: %s:%d: unknown key '%s'", path, lineNumber, key);
+            ok = false;
+            break;
+        }
+
+        ok = SetOption(config, option, value);
+    }
+
+    fclose(file);
+    return ok;
+}
+
+bool ParseSimulationArgs(SimulationConfig *config, int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0)
+        {
+            PrintUsage(argv[0]);
+            return false;
+        }
+
+        if (strncmp(arg, "--", 2) != 0)
+        {
+            TraceLog(LOG_ERROR, "CONFIG: Unexpected argument '%s'", arg);
+            return false;
+        }
+
+        // Accept both "--key value" and "--key=value"
+        const char *name = arg + 2;
+        const char *value = strchr(name, '=');
+        size_t nameLength = value ? (size_t)(value - name) : strlen(name);
+        if (value)
+        {
+            value++;
+        }
+        else if (i + 1 < argc)
+        {
+            value = argv[++i];
+        }
+        else
+        {
+            TraceLog(LOG_ERROR, "CONFIG: Missing value for '%s'", arg);
+            return false;
+        }
+
+        if (nameLength == strlen("config") && strncmp(name, "config", nameLength) == 0)
+        {
+            if (!LoadSimulationConfigFile(config, value))
+            {
+                return false;
+            }
+            continue;
+        }
+
+        const ConfigOption *option = FindOption(name, nameLength);
+        if (!option)
+        {
+            TraceLog(LOG_ERROR, "CONFIG: Unknown option '%s'", arg);
+            return false;
+        }
+
+        if (!SetOption(config, option, value))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool ValidateSimulationConfig(const SimulationConfig *config)
+{
+    if (config->particleCount <= 0)
+    {
+        TraceLog(LOG_ERROR, "CONFIG: Particle count must be positive (got %d)", config->particleCount);
+        return false;
+    }
+    if (config->threadCount < 1 || config->threadCount > MAX_THREADS)
+    {
+        TraceLog(LOG_ERROR, "CONFIG: Thread count must be between 1 and %d (got %d)", MAX_THREADS, config->threadCount);
+        return false;
+    }
+    if (config->screenWidth < 0 || config->screenHeight < 0)
+    {
+        TraceLog(LOG_ERROR, "CONFIG: Invalid resolution %dx%d", config->screenWidth, config->screenHeight);
+        return false;
+    }
+    if (config->simScale < 1 || config->simScale > MAX_SIM_SCALE)
+    {
+        TraceLog(LOG_ERROR, "CONFIG: Simulation scale must be between 1 and %d (got %d)", MAX_SIM_SCALE, config->simScale);
+        return false;
+    }
+    if (config->benchmarkFrames < 0)
+    {
+        TraceLog(LOG_ERROR, "CONFIG: Benchmark frame count cannot be negative (got %d)", config->benchmarkFrames);
+        return false;
+    }
+    if (config->repulsion < 0.0f || config->repulsionRadius < 1.0f)
+    {
+        TraceLog(LOG_ERROR, "CONFIG: Repulsion must be non-negative and its radius at least 1 pixel (got %g, %g)",
+                 config->repulsion, config->repulsionRadius);
+        return false;
+    }
+    if (config->exportPath[0] != '\0' && config->exportFrames <= 0)
+    {
+        TraceLog(LOG_ERROR, "CONFIG: Export frame count must be positive (got %d)", config->exportFrames);
+        return false;
+    }
+    if (config->storage == STORAGE_COMPACT &&
+        (!config->fusedUpdate || config->renderMode == RENDER_DENSITY || config->repulsion > 0.0f ||
+         config->emitters.count > 0 || config->sortInterval > 0))
+    {
+        TraceLog(LOG_ERROR, "CONFIG: Compact storage only runs the fused update, without density rendering, repulsion, "
+                            "emitters or sorting");
+        return false;
+    }
+    if (config->stepRate < 0 || config->maxSteps < 1)
+    {
+        TraceLog(LOG_ERROR, "CONFIG: Step rate cannot be negative and a frame must run at least 1 step (got %d, %d)",
+                 config->stepRate, config->maxSteps);
+        return false;
+    }
+    if (config->stepRate > 0 && config->pipelined)
+    {
+        TraceLog(LOG_ERROR, "CONFIG: Pipelining starts the one step of the next frame early, it needs 'steprate' 0");
+        return false;
+    }
+    if (config->recordPath[0] != '\0' && strcmp(config->recordPath, config->replayPath) == 0)
+    {
+        TraceLog(LOG_ERROR, "CONFIG: Cannot record over the recording being replayed");
+        return false;
+    }
+    if (config->clusterNodes < 1 || config->clusterNodes > MAX_THREADS)
+    {
+        TraceLog(LOG_ERROR, "CONFIG: Cluster node count must be between 1 and %d (got %d)", MAX_THREADS,
+                 config->clusterNodes);
+        return false;
+    }
+    if (config->clusterPort < 1 || config->clusterPort > 65535)
+    {
+        TraceLog(LOG_ERROR, "CONFIG: Cluster port must be between 1 and 65535 (got %d)", config->clusterPort);
+        return false;
+    }
+    if (config->clusterHost[0] != '\0' &&
+        (config->backend == BACKEND_CLUSTER || config->benchmarkFrames > 0 || config->restorePath[0] != '\0' ||
+         config->replayPath[0] != '\0' || config->recordPath[0] != '\0' || config->exportPath[0] != '\0'))
+    {
+        TraceLog(LOG_ERROR, "CONFIG: A cluster node takes its scene and input from the compositor; it cannot be the "
+                            "compositor, benchmark, restore, replay, record or export");
+        return false;
+    }
+    if (config->backend == BACKEND_CLUSTER &&
+        (config->renderMode == RENDER_DENSITY || config->storage == STORAGE_COMPACT || config->repulsion > 0.0f ||
+         config->emitters.count > 0 || config->sortInterval > 0 || config->governor || config->stepRate > 0 ||
+         config->pipelined || config->restorePath[0] != '\0' || config->exportPath[0] != '\0'))
+    {
+        TraceLog(LOG_ERROR, "CONFIG: The cluster backend steps full-precision occupancy shards once per frame; density, "
+                            "compact storage, repulsion, emitters, sorting, the governor, fixed stepping, pipelining, "
+                            "restore and export are not supported");
+        return false;
+    }
+    if (config->audioDrive < 0.0f)
+    {
+        TraceLog(LOG_ERROR, "CONFIG: Audio drive must be non-negative (got %g)", config->audioDrive);
+        return false;
+    }
+    if (config->audioDrive > 0.0f && (config->recordPath[0] != '\0' || config->replayPath[0] != '\0'))
+    {
+        TraceLog(LOG_ERROR, "CONFIG: Recordings hold the pointer only, the music-driven attraction would not replay");
+        return false;
+    }
+    if (config->governorFloor <= 0.0f || config->governorFloor > 1.0f)
+    {
+        TraceLog(LOG_ERROR, "CONFIG: Governor floor must be in (0, 1] (got %g)", config->governorFloor);
+        return false;
+    }
+    if (config->governor && (config->emitters.count > 0 || config->sortInterval > 0))
+    {
+        TraceLog(LOG_ERROR, "CONFIG: The governor drops the end of the particle arrays, which emitters and sorting reorder");
+        return false;
+    }
+    if (config->governor && (config->recordPath[0] != '\0' || config->replayPath[0] != '\0'))
+    {
+        TraceLog(LOG_ERROR, "CONFIG: The governor sets the particle count from frame times, a recording would not replay");
+        return false;
+    }
+    if (config->pixelUpload == UPLOAD_PBO && config->exportPath[0] != '\0')
+    {
+        TraceLog(LOG_ERROR, "CONFIG: Pixel buffers only receive the changed bands of a frame, export needs the copy upload");
+        return false;
+    }
+    if (config->sortInterval != 0 && config->sortInterval < SORT_STAGES)
+    {
+        TraceLog(LOG_ERROR, "CONFIG: Sort interval must be 0 or at least %d frames, one re-sort spans that many (got %d)",
+                 SORT_STAGES, config->sortInterval);
+        return false;
+    }
+    for (int i = 0; i < config->emitters.count; i++)
+    {
+        const EmitterConfig *emitter = &config->emitters.items[i];
+        if (emitter->rate < 0.0f || emitter->lifetime < 1.0f || emitter->spread < 0.0f)
+        {
+            TraceLog(LOG_ERROR, "CONFIG: Emitter %d needs a non-negative rate and spread and a lifetime of at least 1 frame",
+                     i + 1);
+            return false;
+        }
+    }
+    if (config->emitters.count > 0 &&
+        (config->emitterCapacity <= 0 || (long long)config->particleCount + config->emitterCapacity > INT_MAX))
+    {
+        TraceLog(LOG_ERROR, "CONFIG: The emitter pool must be positive and fit next to the particles (got %d)",
+                 config->emitterCapacity);
+        return false;
+    }
+    if (config->emitters.count > 0 && config->restorePath[0] != '\0')
+    {
+        TraceLog(LOG_ERROR, "CONFIG: Snapshots hold no particle lifetimes, emitters cannot be combined with 'restore'");
+        return false;
+    }
+    for (int i = 0; i < config->attractors.count; i++)
+    {
+        const AttractorConfig *attractor = &config->attractors.items[i];
+        if (attractor->falloff < 0.0f || (attractor->orbitRadius != 0.0f && attractor->orbitPeriod <= 0.0f))
+        {
+            TraceLog(LOG_ERROR, "CONFIG: Attractor %d needs a non-negative falloff and a positive orbit period", i + 1);
+            return false;
+        }
+    }
+    return true;
+}
+
+const char *GetBackendName(SimulationBackend backend)
+{
+    return BackendChoices[backend];
+}
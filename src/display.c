@@ -0,0 +1,52 @@
+#include "display.h"
+
+/* ========================================================================= */
+/*                            Private functions                              */
+/* ========================================================================= */
+static int ResolveGridSide(int requested, int display, int scale)
+{
+    if (requested > 0)
+    {
+        return requested;
+    }
+    int side = display / scale;
+    return side > 0 ? side : 1;
+}
+
+/* ========================================================================= */
+/*                            Public functions                               */
+/* ========================================================================= */
+DisplayLayout ResolveDisplayLayout(const SimulationConfig *config, int displayWidth, int displayHeight)
+{
+    const int scale = config->simScale;
+    if (displayWidth <= 0 || displayHeight <= 0)
+    {
+        displayWidth = config->screenWidth > 0 ? config->screenWidth * scale : DEFAULT_SCREEN_WIDTH;
+        displayHeight = config->screenHeight > 0 ? config->screenHeight * scale : DEFAULT_SCREEN_HEIGHT;
+    }
+
+    DisplayLayout layout = {
+        .simWidth = ResolveGridSide(config->screenWidth, displayWidth, scale),
+        .simHeight = ResolveGridSide(config->screenHeight, displayHeight, scale),
+        .displayWidth = displayWidth,
+        .displayHeight = displayHeight
+    };
+
+    // The largest uniform scale that fits, so pixels stay square and nothing is clipped
+    float zoomX = (float)displayWidth / (float)layout.simWidth;
+    float zoomY = (float)displayHeight / (float)layout.simHeight;
+    float zoom = zoomX < zoomY ? zoomX : zoomY;
+    layout.camera = (Camera2D){
+        .offset = {0.5f * ((float)displayWidth - zoom * (float)layout.simWidth),
+                   0.5f * ((float)displayHeight - zoom * (float)layout.simHeight)},
+        .target = {0.0f, 0.0f},
+        .rotation = 0.0f,
+        .zoom = zoom
+    };
+    return layout;
+}
+
+Vector2 DisplayToSimulation(const DisplayLayout *layout, Vector2 position)
+{
+    return GetScreenToWorld2D(position, layout->camera);
+}
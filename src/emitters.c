@@ -0,0 +1,111 @@
+#include "emitters.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#define EMITTER_DEG_TO_RAD 0.017453292f
+
+/* ========================================================================= */
+/*                            Private functions                              */
+/* ========================================================================= */
+
+// Uniform in [0, 1), the same sequence every run so that recorded runs are reproducible
+static float NextUnit(ParticleEmitters *emitters)
+{
+    emitters->seed = emitters->seed * 1664525u + 1013904223u;
+    return (float)(emitters->seed >> 8) / (float)(1u << 24);
+}
+
+// Fills the slots of expired emitted particles with live ones taken from the end of the range.
+// Moving from the end keeps the work proportional to the dead particles and the range dense.
+static void CompactLiveParticles(ParticleEmitters *emitters, Particles *particles, int frame)
+{
+    int *expiry = emitters->expiry;
+    int live = particles->count;
+    int i = emitters->immortalCount;
+
+    while (i < live)
+    {
+        if (expiry[i] > frame)
+        {
+            i++;
+            continue;
+        }
+        live--;
+        particles->posX[i] = particles->posX[live];
+        particles->posY[i] = particles->posY[live];
+        particles->velX[i] = particles->velX[live];
+        particles->velY[i] = particles->velY[live];
+        expiry[i] = expiry[live]; // Checked again, the moved particle may be dead as well
+    }
+    particles->count = live;
+}
+
+/* ========================================================================= */
+/*                            Public functions                               */
+/* ========================================================================= */
+bool InitParticleEmitters(ParticleEmitters *emitters, const SimulationConfig *config, int capacity)
+{
+    emitters->count = config->emitters.count;
+    for (int e = 0; e < emitters->count; e++)
+    {
+        emitters->configs[e] = config->emitters.items[e];
+        emitters->pending[e] = 0.0f;
+    }
+    emitters->immortalCount = config->particleCount;
+    emitters->capacity = capacity;
+    emitters->seed = 12345u;
+
+    emitters->expiry = (int *)malloc((size_t)capacity * sizeof(int));
+    if (!emitters->expiry)
+    {
+        return false;
+    }
+    for (int i = 0; i < emitters->immortalCount; i++)
+    {
+        emitters->expiry[i] = EMITTER_IMMORTAL;
+    }
+    return true;
+}
+
+void UpdateParticleEmitters(ParticleEmitters *emitters, Particles *particles, int frame)
+{
+    if (frame % EMITTER_COMPACT_INTERVAL == 0)
+    {
+        CompactLiveParticles(emitters, particles, frame);
+    }
+
+    int live = particles->count;
+    for (int e = 0; e < emitters->count; e++)
+    {
+        const EmitterConfig *emitter = &emitters->configs[e];
+        emitters->pending[e] += emitter->rate;
+        int spawn = (int)emitters->pending[e];
+        emitters->pending[e] -= (float)spawn;
+
+        // A full pool drops the particles instead of owing them, so no burst follows
+        if (spawn > emitters->capacity - live)
+        {
+            spawn = emitters->capacity - live;
+        }
+
+        const int lifetime = (int)emitter->lifetime;
+        for (int n = 0; n < spawn; n++, live++)
+        {
+            // Spread over the emitter's pixel so that a burst does not start stacked
+            float direction = (emitter->angle + (NextUnit(emitters) - 0.5f) * emitter->spread) * EMITTER_DEG_TO_RAD;
+            particles->posX[live] = emitter->x + NextUnit(emitters);
+            particles->posY[live] = emitter->y + NextUnit(emitters);
+            particles->velX[live] = emitter->speed * cosf(direction);
+            particles->velY[live] = emitter->speed * sinf(direction);
+            emitters->expiry[live] = frame + lifetime;
+        }
+    }
+    particles->count = live;
+}
+
+void FreeParticleEmitters(ParticleEmitters *emitters)
+{
+    free(emitters->expiry);
+    emitters->expiry = NULL;
+}
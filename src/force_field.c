@@ -0,0 +1,70 @@
+#include "force_field.h"
+
+#include <math.h>
+
+/* ========================================================================= */
+/*                            Public functions                               */
+/* ========================================================================= */
+void InitForceField(ForceField *field, const SimulationConfig *config)
+{
+    field->attractors[0] = (Attractor){
+        .position = (Vector2){0.0f, 0.0f},
+        .strength = config->attractionStrength,
+        .falloffRadiusSq = 0.0f
+    };
+    field->count = 1;
+    field->pointerStrength = config->attractionStrength;
+
+    for (int i = 0; i < config->attractors.count && field->count < MAX_ATTRACTORS; i++)
+    {
+        const AttractorConfig *settings = &config->attractors.items[i];
+        field->paths[field->count] = *settings;
+        field->attractors[field->count] = (Attractor){
+            .position = (Vector2){settings->x, settings->y},
+            .strength = settings->strength,
+            .falloffRadiusSq = settings->falloff * settings->falloff
+        };
+        field->count++;
+    }
+}
+
+void UpdateForceField(ForceField *field, Vector2 pointer, int frame)
+{
+    field->attractors[0].position = pointer;
+
+    for (int i = 1; i < field->count; i++)
+    {
+        const AttractorConfig *path = &field->paths[i];
+        if (path->orbitRadius == 0.0f)
+        {
+            continue;
+        }
+
+        float angle = 2.0f * PI * (float)frame / path->orbitPeriod;
+        field->attractors[i].position = (Vector2){
+            path->x + path->orbitRadius * cosf(angle),
+            path->y + path->orbitRadius * sinf(angle)
+        };
+    }
+}
+
+void ScalePointerAttractor(ForceField *field, float scale)
+{
+    field->attractors[0].strength = field->pointerStrength * scale;
+}
+
+void DrawForceField(const ForceField *field)
+{
+    DrawCircleV(field->attractors[0].position, 5.0f, RED);
+
+    for (int i = 1; i < field->count; i++)
+    {
+        const Attractor *attractor = &field->attractors[i];
+        Color color = attractor->strength >= 0.0f ? ORANGE : SKYBLUE;
+        DrawCircleV(attractor->position, 4.0f, color);
+        if (attractor->falloffRadiusSq > 0.0f)
+        {
+            DrawCircleLines((int)attractor->position.x, (int)attractor->position.y, sqrtf(attractor->falloffRadiusSq), color);
+        }
+    }
+}
@@ -0,0 +1,313 @@
+#include "frame_export.h"
+#include "config.h"
+#include "platform.h"
+#include "platform_threads.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#define OpenPipe(command) _popen(command, "wb")
+#define ClosePipe(pipe) _pclose(pipe)
+#else
+#include <signal.h>
+#define OpenPipe(command) popen(command, "w")
+#define ClosePipe(pipe) pclose(pipe)
+#endif
+
+/* ========================================================================= */
+/*                            Exporter                                       */
+/* ========================================================================= */
+struct FrameExporter
+{
+    FrameExportFormat format;
+    char target[CONFIG_PATH_LENGTH]; // File name pattern, or the command of a pipe
+    FILE *pipe;                      // Standard input of the command, owned by the encoder thread
+    int width;
+    int height;
+    size_t frameBytes;
+
+    // Slot n % EXPORT_RING_FRAMES holds frame n from its submission until the encoder has
+    // written it. Only the counters are shared, under the mutex; a slot's pixels belong to the
+    // producer before its frame is submitted and to the encoder after.
+    unsigned char *slots[EXPORT_RING_FRAMES];
+    int submitted;  // Frames appended to the ring
+    int written;    // Frames the encoder is done with
+    int succeeded;  // Frames among those that were written successfully
+    int stalls;     // Submissions that found the ring full
+    bool closing;   // No more frames will be submitted
+    bool failed;    // A frame could not be written
+    PlatformMutex mutex;
+    PlatformCondition changed; // Signalled whenever any of the above changes
+    PlatformThread thread;
+
+    const unsigned char *copySource; // Frame read by the copy phase
+    unsigned char *copyTarget;       // Slot written by the copy phase
+    SimpleThreadPoolRangePhase copyPhase;
+};
+
+/* ========================================================================= */
+/*                            Private functions                              */
+/* ========================================================================= */
+static bool HasExtension(const char *path, const char *extension)
+{
+    size_t length = strlen(path);
+    size_t extensionLength = strlen(extension);
+    return length > extensionLength && strcmp(path + length - extensionLength, extension) == 0;
+}
+
+// A pattern is handed to snprintf(), so it may hold exactly one "%d", optionally with a
+// zero-padded width, and no other conversion
+static bool IsFramePattern(const char *pattern)
+{
+    int conversions = 0;
+    for (const char *c = pattern; *c; c++)
+    {
+        if (*c != '%')
+        {
+            continue;
+        }
+        c++;
+        while (*c >= '0' && *c <= '9')
+        {
+            c++;
+        }
+        if (*c != 'd')
+        {
+            return false;
+        }
+        conversions++;
+    }
+    return conversions == 1;
+}
+
+static void CopyRowsWorkCallback(void *Context, int Start, int End, int WorkerIndex)
+{
+    (void)WorkerIndex;
+    FrameExporter *exporter = (FrameExporter *)Context;
+    size_t rowBytes = (size_t)exporter->width * 4;
+
+    memcpy(exporter->copyTarget + Start * rowBytes, exporter->copySource + Start * rowBytes,
+           (size_t)(End - Start) * rowBytes);
+}
+
+static bool WriteFrame(FrameExporter *exporter, const unsigned char *pixels, int frame)
+{
+    if (exporter->format == FRAME_EXPORT_PIPE)
+    {
+        return fwrite(pixels, 1, exporter->frameBytes, exporter->pipe) == exporter->frameBytes;
+    }
+
+    char path[CONFIG_PATH_LENGTH + 16];
+    snprintf(path, sizeof(path), exporter->target, frame);
+    if (exporter->format == FRAME_EXPORT_PNG)
+    {
+        return WriteFramePng(path, pixels, exporter->width, exporter->height);
+    }
+
+    FILE *file = fopen(path, "wb");
+    if (!file)
+    {
+        return false;
+    }
+    bool ok = fwrite(pixels, 1, exporter->frameBytes, file) == exporter->frameBytes;
+    return fclose(file) == 0 && ok;
+}
+
+static PlatformThreadResult PLATFORM_THREAD_CALL FrameEncoderMain(void *param)
+{
+    FrameExporter *exporter = (FrameExporter *)param;
+
+    PlatformMutexLock(&exporter->mutex);
+    for (;;)
+    {
+        while (exporter->written == exporter->submitted && !exporter->closing)
+        {
+            PlatformConditionWait(&exporter->changed, &exporter->mutex);
+        }
+        if (exporter->written == exporter->submitted)
+        {
+            break; // Closing and drained
+        }
+
+        int frame = exporter->written;
+        bool skip = exporter->failed;
+        PlatformMutexUnlock(&exporter->mutex);
+
+        // Disk and compression time is spent here, off the simulation thread. After a failure
+        // the remaining frames are only drained, so the producer never waits on a dead encoder.
+        bool ok = skip || WriteFrame(exporter, exporter->slots[frame % EXPORT_RING_FRAMES], frame);
+
+        PlatformMutexLock(&exporter->mutex);
+        exporter->failed = exporter->failed || !ok;
+        exporter->succeeded += !skip && ok;
+        exporter->written++;
+        PlatformConditionWakeAll(&exporter->changed);
+    }
+    PlatformMutexUnlock(&exporter->mutex);
+    return 0;
+}
+
+static void FreeFrameExporter(FrameExporter *exporter)
+{
+    for (int s = 0; s < EXPORT_RING_FRAMES; s++)
+    {
+        FreeAligned(exporter->slots[s]);
+    }
+    PlatformConditionDestroy(&exporter->changed);
+    PlatformMutexDestroy(&exporter->mutex);
+    free(exporter);
+}
+
+/* ========================================================================= */
+/*                            Public functions                               */
+/* ========================================================================= */
+FrameExporter *CreateFrameExporter(const char *target, int width, int height, const char **error)
+{
+    FrameExportFormat format;
+    if (target[0] == '|')
+    {
+        format = FRAME_EXPORT_PIPE;
+        target++;
+    }
+    else if (!IsFramePattern(target))
+    {
+        *error = "the file name needs one frame number conversion such as %05d";
+        return NULL;
+    }
+    else if (HasExtension(target, ".png"))
+    {
+        format = FRAME_EXPORT_PNG;
+    }
+    else if (HasExtension(target, ".rgba") || HasExtension(target, ".raw"))
+    {
+        format = FRAME_EXPORT_RAW;
+    }
+    else
+    {
+        *error = "unknown format, use .png, .rgba, .raw or a '|command'";
+        return NULL;
+    }
+
+    FrameExporter *exporter = (FrameExporter *)calloc(1, sizeof(FrameExporter));
+    if (!exporter)
+    {
+        *error = "out of memory";
+        return NULL;
+    }
+    exporter->format = format;
+    exporter->width = width;
+    exporter->height = height;
+    exporter->frameBytes = (size_t)width * height * 4;
+    snprintf(exporter->target, sizeof(exporter->target), "%s", target);
+    PlatformMutexInit(&exporter->mutex);
+    PlatformConditionInit(&exporter->changed);
+
+    for (int s = 0; s < EXPORT_RING_FRAMES; s++)
+    {
+        exporter->slots[s] = (unsigned char *)AllocateAligned(exporter->frameBytes, 64);
+        if (!exporter->slots[s])
+        {
+            *error = "out of memory for the frame ring";
+            FreeFrameExporter(exporter);
+            return NULL;
+        }
+    }
+
+    if (format == FRAME_EXPORT_PIPE)
+    {
+#if !defined(_WIN32)
+        signal(SIGPIPE, SIG_IGN); // A command that exits early fails the write instead of killing us
+#endif
+        exporter->pipe = OpenPipe(exporter->target);
+        if (!exporter->pipe)
+        {
+            *error = "the command could not be started";
+            FreeFrameExporter(exporter);
+            return NULL;
+        }
+    }
+
+    exporter->copyPhase = (SimpleThreadPoolRangePhase){
+        .job = CopyRowsWorkCallback,
+        .context = exporter,
+        .itemCount = height,
+        .chunkSize = EXPORT_COPY_CHUNK_ROWS
+    };
+
+    if (!PlatformThreadStart(&exporter->thread, FrameEncoderMain, exporter))
+    {
+        *error = "the encoder thread could not be started";
+        if (exporter->pipe)
+        {
+            ClosePipe(exporter->pipe);
+        }
+        FreeFrameExporter(exporter);
+        return NULL;
+    }
+    return exporter;
+}
+
+bool SubmitExportFrame(FrameExporter *exporter, SimpleThreadPool *pool, const void *pixels)
+{
+    PlatformMutexLock(&exporter->mutex);
+    if (exporter->submitted - exporter->written == EXPORT_RING_FRAMES)
+    {
+        exporter->stalls++;
+        while (exporter->submitted - exporter->written == EXPORT_RING_FRAMES)
+        {
+            PlatformConditionWait(&exporter->changed, &exporter->mutex);
+        }
+    }
+    int frame = exporter->submitted;
+    bool failed = exporter->failed;
+    PlatformMutexUnlock(&exporter->mutex);
+    if (failed)
+    {
+        return false;
+    }
+
+    // The slot is free and the encoder cannot see it until submitted advances
+    exporter->copySource = (const unsigned char *)pixels;
+    exporter->copyTarget = exporter->slots[frame % EXPORT_RING_FRAMES];
+    SimpleThreadPool_RunRange(pool, &exporter->copyPhase);
+
+    PlatformMutexLock(&exporter->mutex);
+    exporter->submitted++;
+    PlatformConditionWakeAll(&exporter->changed);
+    PlatformMutexUnlock(&exporter->mutex);
+    return true;
+}
+
+bool FinishFrameExport(FrameExporter *exporter, FrameExportStats *stats)
+{
+    if (!exporter)
+    {
+        return true;
+    }
+
+    PlatformMutexLock(&exporter->mutex);
+    exporter->closing = true;
+    PlatformConditionWakeAll(&exporter->changed);
+    PlatformMutexUnlock(&exporter->mutex);
+    PlatformThreadJoin(exporter->thread);
+
+    // Closing the pipe waits for the command to finish encoding
+    bool ok = !exporter->failed;
+    if (exporter->pipe)
+    {
+        ok = ClosePipe(exporter->pipe) == 0 && ok;
+    }
+
+    if (stats)
+    {
+        *stats = (FrameExportStats){
+            .framesSubmitted = exporter->submitted,
+            .framesWritten = exporter->succeeded,
+            .stalls = exporter->stalls
+        };
+    }
+    FreeFrameExporter(exporter);
+    return ok;
+}
@@ -0,0 +1,34 @@
+#include "frame_export.h"
+#include "raylib.h"
+
+#include <stdio.h>
+
+/* ========================================================================= */
+/*                            Public functions                               */
+/* ========================================================================= */
+bool WriteFramePng(const char *path, const void *pixels, int width, int height)
+{
+    // Encoded in memory and written here: ExportImage() would log every file it saves
+    Image image = {
+        .data = (void *)pixels,
+        .width = width,
+        .height = height,
+        .mipmaps = 1,
+        .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
+    };
+    int size = 0;
+    unsigned char *encoded = ExportImageToMemory(image, ".png", &size);
+    if (!encoded)
+    {
+        return false;
+    }
+
+    FILE *file = fopen(path, "wb");
+    bool ok = file && fwrite(encoded, 1, (size_t)size, file) == (size_t)size;
+    if (file)
+    {
+        ok = fclose(file) == 0 && ok;
+    }
+    MemFree(encoded);
+    return ok;
+}
@@ -0,0 +1,164 @@
+#include "frame_timing.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+const char *const FramePhaseNames[FRAME_PHASE_COUNT] = {
+    "integrate",
+    "rasterize",
+    "combine",
+    "upload",
+    "present",
+};
+
+/* ========================================================================= */
+/*                            Private functions                              */
+/* ========================================================================= */
+static int CompareDoubles(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of an ascending array
+static double Percentile(const double *sorted, int count, double fraction)
+{
+    int rank = (int)ceil(fraction * count);
+    if (rank < 1)
+    {
+        rank = 1;
+    }
+    return sorted[rank - 1];
+}
+
+static void WriteCsvRow(FILE *file, const SimulationConfig *config, int frames, const char *name, double *column)
+{
+    qsort(column, frames, sizeof(double), CompareDoubles);
+    fprintf(file, "%s,%d,%d,%d,%d,%d,%s,%.4f,%.4f,%.4f\n",
+            GetBackendName(config->backend), config->particleCount, config->threadCount,
+            config->screenWidth, config->screenHeight, frames, name,
+            column[0] * 1000.0, Percentile(column, frames, 0.5) * 1000.0, Percentile(column, frames, 0.99) * 1000.0);
+}
+
+/* ========================================================================= */
+/*                            Public functions                               */
+/* ========================================================================= */
+void InitStepClock(StepClock *clock, int stepRate, int maxSteps)
+{
+    *clock = (StepClock){
+        .stepSeconds = 1.0 / stepRate,
+        .accumulator = 0.0,
+        .lastTime = -1.0,
+        .maxSteps = maxSteps
+    };
+}
+
+int AdvanceStepClock(StepClock *clock, double now)
+{
+    if (clock->lastTime < 0.0)
+    {
+        clock->lastTime = now;
+        clock->steps++;
+        return 1;
+    }
+
+    clock->accumulator += now - clock->lastTime;
+    clock->lastTime = now;
+    long long owed = (long long)(clock->accumulator / clock->stepSeconds);
+    clock->accumulator -= (double)owed * clock->stepSeconds;
+
+    // Whatever does not fit is forgotten, the remainder below one step carries over
+    int steps = owed > clock->maxSteps ? clock->maxSteps : (int)owed;
+    clock->droppedSteps += owed - steps;
+    clock->steps += steps;
+    return steps;
+}
+
+bool InitBenchmarkRecorder(BenchmarkRecorder *recorder, int frames)
+{
+    recorder->samples = (double *)malloc((size_t)frames * FRAME_PHASE_COUNT * sizeof(double));
+    recorder->frameCapacity = frames;
+    recorder->frameCount = 0;
+    recorder->warmupLeft = BENCHMARK_WARMUP_FRAMES;
+    return recorder->samples != NULL;
+}
+
+void RecordBenchmarkFrame(BenchmarkRecorder *recorder, const FrameTimer *timer)
+{
+    if (recorder->warmupLeft > 0)
+    {
+        recorder->warmupLeft--;
+        return;
+    }
+    if (recorder->frameCount >= recorder->frameCapacity)
+    {
+        return;
+    }
+
+    double *row = recorder->samples + (size_t)recorder->frameCount * FRAME_PHASE_COUNT;
+    for (int i = 0; i < FRAME_PHASE_COUNT; i++)
+    {
+        row[i] = timer->seconds[i];
+    }
+    recorder->frameCount++;
+}
+
+bool BenchmarkFinished(const BenchmarkRecorder *recorder)
+{
+    return recorder->frameCount >= recorder->frameCapacity;
+}
+
+void WriteBenchmarkCsv(const BenchmarkRecorder *recorder, const SimulationConfig *config, FILE *file)
+{
+    int frames = recorder->frameCount;
+    if (frames == 0)
+    {
+        return;
+    }
+
+    double *column = (double *)malloc((size_t)frames * sizeof(double));
+    if (!column)
+    {
+        return;
+    }
+
+    fprintf(file, "backend,particles,threads,width,height,frames,phase,min_ms,median_ms,p99_ms\n");
+    for (int phase = 0; phase < FRAME_PHASE_COUNT; phase++)
+    {
+        for (int f = 0; f < frames; f++)
+        {
+            column[f] = recorder->samples[(size_t)f * FRAME_PHASE_COUNT + phase];
+        }
+        WriteCsvRow(file, config, frames, FramePhaseNames[phase], column);
+    }
+
+    // Percentiles of the whole frame are taken per frame, not summed from the phase rows
+    for (int f = 0; f < frames; f++)
+    {
+        const double *row = recorder->samples + (size_t)f * FRAME_PHASE_COUNT;
+        column[f] = 0.0;
+        for (int phase = 0; phase < FRAME_PHASE_COUNT; phase++)
+        {
+            column[f] += row[phase];
+        }
+    }
+    WriteCsvRow(file, config, frames, "frame", column);
+
+    free(column);
+}
+
+void FreeBenchmarkRecorder(BenchmarkRecorder *recorder)
+{
+    free(recorder->samples);
+    recorder->samples = NULL;
+}
+
+Vector2 GetBenchmarkAttractor(int frame, int width, int height)
+{
+    float t = (float)frame;
+    return (Vector2){
+        width * (0.5f + 0.4f * sinf(t * 0.021f)),
+        height * (0.5f + 0.4f * sinf(t * 0.034f + 1.0f)),
+    };
+}
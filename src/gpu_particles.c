@@ -0,0 +1,227 @@
+#include "gpu_particles.h"
+#include "rlgl.h"
+
+#if defined(GRAPHICS_API_OPENGL_43)
+#include "external/glad.h" // Version queries, glMemoryBarrier and GL_POINTS draws are not wrapped by rlgl
+#include "raymath.h"
+#endif
+
+#include <stddef.h>
+
+#define GPU_WORKGROUP_SIZE 256
+#define STRINGIFY_VALUE(x) #x
+#define STRINGIFY(x) STRINGIFY_VALUE(x)
+
+/* ========================================================================= */
+/*                            Shaders                                        */
+/* ========================================================================= */
+// Same math as UpdateParticlesWorkCallback, one invocation per particle
+static const char *IntegrateShaderCode =
+    "#version 430\n"
+    "layout(local_size_x = 256) in;\n"
+    "layout(std430, binding = 0) buffer PosX { float posX[]; };\n"
+    "layout(std430, binding = 1) buffer PosY { float posY[]; };\n"
+    "layout(std430, binding = 2) buffer VelX { float velX[]; };\n"
+    "layout(std430, binding = 3) buffer VelY { float velY[]; };\n"
+    "uniform vec4 attractors[" STRINGIFY(MAX_ATTRACTORS) "];\n" // xy position, z strength, w falloff radius squared
+    "uniform int attractorCount;\n"
+    "uniform float friction;\n"
+    "uniform int count;\n"
+    "void main()\n"
+    "{\n"
+    "    int i = int(gl_GlobalInvocationID.x);\n"
+    "    if (i >= count) return;\n"
+    "    vec2 pos = vec2(posX[i], posY[i]);\n"
+    "    vec2 vel = vec2(velX[i], velY[i]);\n"
+    "    vec2 force = vec2(0.0);\n"
+    "    for (int k = 0; k < attractorCount; k++)\n"
+    "    {\n"
+    "        vec2 diff = attractors[k].xy - pos;\n"
+    "        float distSq = dot(diff, diff);\n"
+    "        if (distSq == 0.0) continue;\n" // On the attractor, like the CPU kernels
+    "        float scale = attractors[k].z;\n"
+    "        if (attractors[k].w > 0.0) scale *= attractors[k].w / (distSq + attractors[k].w);\n"
+    "        force += diff / sqrt(distSq) * scale;\n"
+    "    }\n"
+    "    vel += force;\n"
+    "    vel *= friction;\n"
+    "    pos += vel;\n"
+    "    posX[i] = pos.x; posY[i] = pos.y;\n"
+    "    velX[i] = vel.x; velY[i] = vel.y;\n"
+    "}\n";
+
+// Places one point per particle at the center of the pixel the CPU path would light up, through
+// the same 2D camera as the texture the CPU path draws, and as large as that pixel on screen
+static const char *DrawVertexShaderCode =
+    "#version 430\n"
+    "layout(std430, binding = 0) readonly buffer PosX { float posX[]; };\n"
+    "layout(std430, binding = 1) readonly buffer PosY { float posY[]; };\n"
+    "uniform mat4 mvp;\n"
+    "uniform float pointSize;\n"
+    "void main()\n"
+    "{\n"
+    "    vec2 pixel = floor(vec2(posX[gl_VertexID], posY[gl_VertexID])) + 0.5;\n"
+    "    gl_Position = mvp * vec4(pixel, 0.0, 1.0);\n"
+    "    gl_PointSize = pointSize;\n"
+    "}\n";
+
+static const char *DrawFragmentShaderCode =
+    "#version 430\n"
+    "uniform vec4 color;\n"
+    "out vec4 fragColor;\n"
+    "void main()\n"
+    "{\n"
+    "    fragColor = color;\n"
+    "}\n";
+
+/* ========================================================================= */
+/*                            Public functions                               */
+/* ========================================================================= */
+bool InitGpuParticles(GpuParticles *gpu, const Particles *particles)
+{
+    *gpu = (GpuParticles){0};
+
+#if defined(GRAPHICS_API_OPENGL_43)
+    // rlGetVersion() only reports what raylib was built for, ask the context what it provides
+    GLint major = 0;
+    GLint minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (major < 4 || (major == 4 && minor < 3))
+    {
+        TraceLog(LOG_WARNING, "GPU: Compute shaders need an OpenGL 4.3 context, the driver provides %d.%d", major,
+                 minor);
+        return false;
+    }
+
+    unsigned int computeShader = rlCompileShader(IntegrateShaderCode, RL_COMPUTE_SHADER);
+    if (computeShader == 0)
+    {
+        return false;
+    }
+    gpu->computeProgram = rlLoadComputeShaderProgram(computeShader);
+    gpu->drawProgram = rlLoadShaderCode(DrawVertexShaderCode, DrawFragmentShaderCode);
+    if (gpu->computeProgram == 0 || gpu->drawProgram == 0)
+    {
+        UnloadGpuParticles(gpu);
+        return false;
+    }
+
+    gpu->attractorsLoc = rlGetLocationUniform(gpu->computeProgram, "attractors");
+    gpu->attractorCountLoc = rlGetLocationUniform(gpu->computeProgram, "attractorCount");
+    gpu->frictionLoc = rlGetLocationUniform(gpu->computeProgram, "friction");
+    gpu->countLoc = rlGetLocationUniform(gpu->computeProgram, "count");
+    gpu->mvpLoc = rlGetLocationUniform(gpu->drawProgram, "mvp");
+    gpu->pointSizeLoc = rlGetLocationUniform(gpu->drawProgram, "pointSize");
+    gpu->colorLoc = rlGetLocationUniform(gpu->drawProgram, "color");
+
+    // The state is uploaded once and only ever touched by shaders afterwards
+    unsigned int size = (unsigned int)(particles->count * sizeof(float));
+    gpu->posXBuffer = rlLoadShaderBuffer(size, particles->posX, RL_DYNAMIC_COPY);
+    gpu->posYBuffer = rlLoadShaderBuffer(size, particles->posY, RL_DYNAMIC_COPY);
+    gpu->velXBuffer = rlLoadShaderBuffer(size, particles->velX, RL_DYNAMIC_COPY);
+    gpu->velYBuffer = rlLoadShaderBuffer(size, particles->velY, RL_DYNAMIC_COPY);
+    gpu->vertexArray = rlLoadVertexArray();
+    gpu->count = particles->count;
+
+    if (!gpu->posXBuffer || !gpu->posYBuffer || !gpu->velXBuffer || !gpu->velYBuffer || !gpu->vertexArray)
+    {
+        TraceLog(LOG_WARNING, "GPU: Failed to allocate particle storage buffers");
+        UnloadGpuParticles(gpu);
+        return false;
+    }
+
+    TraceLog(LOG_INFO, "GPU: Compute backend ready for %d particles", gpu->count);
+    return true;
+#else
+    (void)particles;
+    TraceLog(LOG_WARNING, "GPU: Built without GRAPHICS_API_OPENGL_43, compute backend unavailable");
+    return false;
+#endif
+}
+
+void UpdateGpuParticles(GpuParticles *gpu, const ForceField *field, float friction)
+{
+#if defined(GRAPHICS_API_OPENGL_43)
+    float attractorValues[MAX_ATTRACTORS][4];
+    for (int k = 0; k < field->count; k++)
+    {
+        const Attractor *attractor = &field->attractors[k];
+        attractorValues[k][0] = attractor->position.x;
+        attractorValues[k][1] = attractor->position.y;
+        attractorValues[k][2] = attractor->strength;
+        attractorValues[k][3] = attractor->falloffRadiusSq;
+    }
+
+    rlEnableShader(gpu->computeProgram);
+    rlSetUniform(gpu->attractorsLoc, attractorValues, RL_SHADER_UNIFORM_VEC4, field->count);
+    rlSetUniform(gpu->attractorCountLoc, &field->count, RL_SHADER_UNIFORM_INT, 1);
+    rlSetUniform(gpu->frictionLoc, &friction, RL_SHADER_UNIFORM_FLOAT, 1);
+    rlSetUniform(gpu->countLoc, &gpu->count, RL_SHADER_UNIFORM_INT, 1);
+    rlBindShaderBuffer(gpu->posXBuffer, 0);
+    rlBindShaderBuffer(gpu->posYBuffer, 1);
+    rlBindShaderBuffer(gpu->velXBuffer, 2);
+    rlBindShaderBuffer(gpu->velYBuffer, 3);
+    rlComputeShaderDispatch((gpu->count + GPU_WORKGROUP_SIZE - 1) / GPU_WORKGROUP_SIZE, 1, 1);
+    rlDisableShader();
+
+    // Make the new positions visible to the vertex shader of the draw call
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+#else
+    (void)gpu;
+    (void)field;
+    (void)friction;
+#endif
+}
+
+void DrawGpuParticles(const GpuParticles *gpu, Color color, float pointSize)
+{
+#if defined(GRAPHICS_API_OPENGL_43)
+    float colorValue[4] = {color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f};
+
+    // Flush what raylib has batched so far so the points land on top of it
+    rlDrawRenderBatchActive();
+
+    // Inside BeginMode2D() the modelview holds the camera, exactly what raylib's own shaders get
+    Matrix mvp = MatrixMultiply(rlGetMatrixModelview(), rlGetMatrixProjection());
+
+    rlEnableShader(gpu->drawProgram);
+    rlSetUniformMatrix(gpu->mvpLoc, mvp);
+    rlSetUniform(gpu->pointSizeLoc, &pointSize, RL_SHADER_UNIFORM_FLOAT, 1);
+    rlSetUniform(gpu->colorLoc, colorValue, RL_SHADER_UNIFORM_VEC4, 1);
+    rlBindShaderBuffer(gpu->posXBuffer, 0);
+    rlBindShaderBuffer(gpu->posYBuffer, 1);
+    rlEnableVertexArray(gpu->vertexArray);
+    glEnable(GL_PROGRAM_POINT_SIZE);
+    glDrawArrays(GL_POINTS, 0, gpu->count);
+    glDisable(GL_PROGRAM_POINT_SIZE);
+    rlDisableVertexArray();
+    rlDisableShader();
+#else
+    (void)gpu;
+    (void)color;
+    (void)pointSize;
+#endif
+}
+
+void UnloadGpuParticles(GpuParticles *gpu)
+{
+    // Deleting buffer id 0 is a no-op in GL, so a partially initialized state can be released too
+    rlUnloadShaderBuffer(gpu->posXBuffer);
+    rlUnloadShaderBuffer(gpu->posYBuffer);
+    rlUnloadShaderBuffer(gpu->velXBuffer);
+    rlUnloadShaderBuffer(gpu->velYBuffer);
+    if (gpu->vertexArray)
+    {
+        rlUnloadVertexArray(gpu->vertexArray);
+    }
+    if (gpu->computeProgram)
+    {
+        rlUnloadShaderProgram(gpu->computeProgram);
+    }
+    if (gpu->drawProgram)
+    {
+        rlUnloadShaderProgram(gpu->drawProgram);
+    }
+    *gpu = (GpuParticles){0};
+}
@@ -0,0 +1,144 @@
+#include "input_replay.h"
+
+#include <stdlib.h>
+
+/* ========================================================================= */
+/*                            Public functions                               */
+/* ========================================================================= */
+bool OpenInputRecorder(InputRecorder *recorder, const char *path, int firstStep, int gridWidth, int gridHeight,
+                       int stepRate)
+{
+    *recorder = (InputRecorder){0};
+    FILE *file = fopen(path, "wb");
+    if (!file)
+    {
+        TraceLog(LOG_WARNING, "INPUT: Failed to create '%s'", path);
+        return false;
+    }
+
+    InputRecordingHeader header = {
+        .magic = INPUT_RECORDING_MAGIC,
+        .version = INPUT_RECORDING_VERSION,
+        .headerSize = sizeof(InputRecordingHeader),
+        .firstStep = firstStep,
+        .gridWidth = gridWidth,
+        .gridHeight = gridHeight,
+        .stepRate = stepRate,
+        .reserved = 0
+    };
+    if (fwrite(&header, sizeof(header), 1, file) != 1)
+    {
+        TraceLog(LOG_WARNING, "INPUT: Failed to write '%s'", path);
+        fclose(file);
+        return false;
+    }
+
+    recorder->file = file;
+    return true;
+}
+
+void RecordInputStep(InputRecorder *recorder, Vector2 position)
+{
+    if (!recorder->file || recorder->failed)
+    {
+        return;
+    }
+    // Buffered by stdio, one step costs a copy of 8 bytes
+    float entry[2] = {position.x, position.y};
+    if (fwrite(entry, sizeof(entry), 1, recorder->file) != 1)
+    {
+        recorder->failed = true;
+        return;
+    }
+    recorder->stepCount++;
+}
+
+bool CloseInputRecorder(InputRecorder *recorder)
+{
+    if (!recorder->file)
+    {
+        return true;
+    }
+    bool written = fclose(recorder->file) == 0 && !recorder->failed;
+    recorder->file = NULL;
+    TraceLog(written ? LOG_INFO : LOG_WARNING, "INPUT: Recorded %d steps%s", recorder->stepCount,
+             written ? "" : ", the recording is incomplete");
+    return written;
+}
+
+bool LoadInputReplay(InputReplay *replay, const char *path)
+{
+    *replay = (InputReplay){0};
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        TraceLog(LOG_ERROR, "INPUT: Failed to open '%s'", path);
+        return false;
+    }
+
+    InputRecordingHeader header;
+    long size = -1;
+    if (fread(&header, sizeof(header), 1, file) == 1 && fseek(file, 0, SEEK_END) == 0)
+    {
+        size = ftell(file);
+    }
+    if (size < 0 || header.magic != INPUT_RECORDING_MAGIC || header.headerSize < sizeof(header) ||
+        (unsigned long)size < header.headerSize)
+    {
+        TraceLog(LOG_ERROR, "INPUT: '%s' is not an input recording", path);
+        fclose(file);
+        return false;
+    }
+    if (header.version != INPUT_RECORDING_VERSION)
+    {
+        TraceLog(LOG_ERROR, "INPUT: '%s' has version %u, expected %u", path, header.version, INPUT_RECORDING_VERSION);
+        fclose(file);
+        return false;
+    }
+
+    // A partial last entry, from a run that did not close its recording, is ignored
+    int stepCount = (int)(((unsigned long)size - header.headerSize) / (2 * sizeof(float)));
+    Vector2 *positions = (Vector2 *)malloc((size_t)(stepCount > 0 ? stepCount : 1) * sizeof(Vector2));
+    bool read = positions && fseek(file, (long)header.headerSize, SEEK_SET) == 0;
+    for (int i = 0; read && i < stepCount; i++)
+    {
+        float entry[2];
+        read = fread(entry, sizeof(entry), 1, file) == 1;
+        positions[i] = (Vector2){entry[0], entry[1]};
+    }
+    fclose(file);
+    if (!read || stepCount == 0)
+    {
+        TraceLog(LOG_ERROR, "INPUT: Failed to read the steps of '%s'", path);
+        free(positions);
+        return false;
+    }
+
+    replay->header = header;
+    replay->positions = positions;
+    replay->stepCount = stepCount;
+    TraceLog(LOG_INFO, "INPUT: Replaying %d steps from step %d, recorded on a %dx%d grid", stepCount, header.firstStep,
+             header.gridWidth, header.gridHeight);
+    return true;
+}
+
+Vector2 GetReplayInput(const InputReplay *replay, int step)
+{
+    int index = step - replay->header.firstStep;
+    if (index < 0)
+    {
+        index = 0;
+    }
+    if (index >= replay->stepCount)
+    {
+        index = replay->stepCount - 1;
+    }
+    return replay->positions[index];
+}
+
+void FreeInputReplay(InputReplay *replay)
+{
+    free(replay->positions);
+    replay->positions = NULL;
+    replay->stepCount = 0;
+}
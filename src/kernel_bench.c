@@ -0,0 +1,735 @@
+// Microbenchmarks of the CPU hot loops, without a window or the rest of the frame around them.
+// Every kernel runs on the thread pool the simulation uses, chunked the same way, and is timed
+// as the median of several repetitions. The results are printed as CSV, see PrintUsage().
+/* ========================================================================= */
+/*                             Header Includes                               */
+/* ========================================================================= */
+#include "raylib.h"
+#include "threadpool.h" // Keeps the platform thread headers out of this file, they clash with raylib
+#include "config.h"
+#include "particles.h"
+#include "occupancy.h"
+#include "kernels.h"
+#include "platform.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ========================================================================= */
+/*                            Defines                                        */
+/* ========================================================================= */
+#define BENCH_MAX_LIST 16                    // Entries of each swept list
+#define BENCH_MAX_REPS 101                   // Timed repetitions of one measurement
+#define BENCH_DEFAULT_REPS 7
+#define BENCH_PARTICLE_CHUNK_SIZE 2048       // Same work-stealing chunks as the simulation's integration phase
+#define BENCH_ROW_CHUNK (1 << DIRTY_BAND_SHIFT) // Rows per chunk of the pixel kernels, one dirty band
+#define BENCH_PEAK_BYTES (128 * 1024 * 1024) // Size of each buffer of the copy peak, far past any last-level cache
+#define BENCH_PEAK_CHUNK (256 * 1024)        // Bytes per chunk of the copy peak
+#define BENCH_SEED 0x2545F491u
+
+/**
+ * @brief The lists swept by one run.
+ */
+typedef struct BenchOptions
+{
+    int particleCounts[BENCH_MAX_LIST];
+    int particleListCount;
+    int threadCounts[BENCH_MAX_LIST]; // Ascending, the first one is the baseline of the scaling efficiency
+    int threadListCount;
+    int widths[BENCH_MAX_LIST];
+    int heights[BENCH_MAX_LIST];
+    int resolutionCount;
+    SimdLevel simdLevel; // SIMD_AUTO for every level the CPU supports
+    SimpleThreadPoolPinning pinning;
+    int reps;
+} BenchOptions;
+
+/**
+ * @brief Everything one measurement reads and writes, shared by every chunk of its phase.
+ */
+typedef struct BenchScene
+{
+    const ParticleKernels *kernels;
+    IntegrateKernel integrate;      // Integration kernel of the current case
+    Particles source;               // Random positions, never written, so every repetition does the same work
+    Particles target;
+    IntegrateParams params;
+    Attractor attractor;
+    OccupancyBitmap *bitmaps;       // MAX_THREADS bit bitmaps, one per worker
+    OccupancyBitmap *densityBitmaps; // DENSITY_MAX_BITMAPS density bitmaps
+    OccupancyBitmap *bitmapList[MAX_THREADS]; // The bitmaps of the current case, as the combine kernels take them
+    OccupancyBitmap *splat;         // Bitmaps the current case splats into, or NULL
+    int bitmapCount;                // Bitmaps the current case combines: one per thread like the simulation, at
+                                    // most DENSITY_MAX_BITMAPS in density mode
+    bool density;                   // The current case works on the density bitmaps
+    bool stream;                    // The current case uses the non-temporal pixel kernels
+    Color *pixels;
+    int width;
+    int height;
+    uint32_t palette[DENSITY_LEVELS];
+    unsigned char *copySource;      // Buffers of the copy peak
+    unsigned char *copyTarget;
+} BenchScene;
+
+/**
+ * @brief One kernel measured by the sweep.
+ */
+typedef enum BenchCase
+{
+    BENCH_INTEGRATE,
+    BENCH_INTEGRATE_FAST,
+    BENCH_INTEGRATE_FUSED,
+    BENCH_SPLAT,
+    BENCH_COMBINE,
+    BENCH_COMBINE_STREAM,
+    BENCH_COMBINE_DENSITY,
+    BENCH_FILL,
+    BENCH_FILL_STREAM,
+    BENCH_CASE_COUNT
+} BenchCase;
+
+static const char *const BenchCaseNames[BENCH_CASE_COUNT] = {
+    "integrate", "integrate_fast", "integrate_fused", "splat", "combine", "combine_stream", "combine_density",
+    "fill", "fill_stream"
+};
+
+static const char *const SimdNames[] = {"all", "scalar", "sse4.1", "avx2", "avx512", NULL};
+static const char *const PinningNames[] = {"none", "cpus", "cores", NULL};
+
+/* ========================================================================= */
+/*                           Function Prototypes                             */
+/* ========================================================================= */
+
+/**
+ * @brief Reads the command line into the sweep lists, keeping the defaults of every list not given.
+ *
+ * @param options A pointer to the options to fill in.
+ * @param argc The argument count of main().
+ * @param argv The arguments of main().
+ *
+ * @return true on success, false (after logging the reason) on a malformed argument.
+ */
+bool ParseBenchOptions(BenchOptions *options, int argc, char **argv);
+
+/**
+ * @brief Times one phase on a pool.
+ *
+ * Runs one untimed warm-up repetition, then reps timed ones, calling prepare (if not NULL)
+ * before every repetition outside of the timed region.
+ *
+ * @param pool The pool to run the phase on.
+ * @param phase The phase to time.
+ * @param scene The scene the phase works on, passed to prepare.
+ * @param prepare Restores the input of the phase, may be NULL.
+ * @param reps The number of timed repetitions, at most BENCH_MAX_REPS.
+ *
+ * @return The median time of one repetition in seconds.
+ */
+double MeasurePhase(SimpleThreadPool *pool, const SimpleThreadPoolRangePhase *phase, BenchScene *scene,
+                    void (*prepare)(SimpleThreadPool *pool, BenchScene *scene), int reps);
+
+/**
+ * @brief Measures the copy bandwidth of a pool, the peak the kernels are compared with.
+ *
+ * @param pool The pool to measure.
+ * @param scene The scene holding the copy buffers.
+ * @param reps The number of timed repetitions.
+ *
+ * @return The bytes read and written per second, in GB/s.
+ */
+double MeasureCopyPeak(SimpleThreadPool *pool, BenchScene *scene, int reps);
+
+/* ========================================================================= */
+/*                            Private functions                              */
+/* ========================================================================= */
+static void PrintUsage(void)
+{
+    printf("Usage: kernel_bench [options]\n"
+           "  --particles N[,N...]      particle counts (default 1000000,4000000)\n"
+           "  --threads N[,N...]        thread counts, the first is the scaling baseline (default 1,2,4,8,12)\n"
+           "  --resolutions WxH[,WxH...] grid sizes (default 1920x1080,3440x1440)\n"
+           "  --simd all|scalar|sse4.1|avx2|avx512 kernels to run, 'all' for every supported set (default all)\n"
+           "  --pin none|cpus|cores     bind workers to logical processors (default none)\n"
+           "  --reps N                  timed repetitions, the median is reported (default %d)\n"
+           "\n"
+           "Prints one CSV row per kernel, instruction set, particle count, thread count and grid:\n"
+           "ns_per_item is per particle or per pixel, gbps counts the streamed bytes (particle arrays,\n"
+           "pixels and bitmaps, not the scattered bitmap writes of a splat), peak_gbps is a multi-threaded\n"
+           "copy at the same thread count, which working sets that fit in cache can exceed, and\n"
+           "efficiency is the throughput per thread relative to the first thread count.\n",
+           BENCH_DEFAULT_REPS);
+}
+
+static int FindChoice(const char *const *choices, const char *value)
+{
+    for (int i = 0; choices[i]; i++)
+    {
+        if (strcmp(choices[i], value) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Parses "a,b,c" into positive integers; with heights, every entry is "WxH"
+static bool ParseList(const char *option, const char *value, int *values, int *heights, int *count)
+{
+    *count = 0;
+    const char *cursor = value;
+    while (*cursor)
+    {
+        char *end = NULL;
+        long parsed = strtol(cursor, &end, 10);
+        long height = 1;
+        if (heights && end != cursor && *end == 'x')
+        {
+            const char *rest = end + 1;
+            height = strtol(rest, &end, 10);
+            if (end == rest)
+            {
+                height = 0;
+            }
+        }
+        else if (heights)
+        {
+            height = 0;
+        }
+        if (end == cursor || parsed <= 0 || parsed > 1 << 30 || height <= 0 || height > 1 << 16 ||
+            (*end != ',' && *end != '\0') || *count == BENCH_MAX_LIST)
+        {
+            TraceLog(LOG_ERROR, "BENCH: Invalid --%s list '%s'", option, value);
+            return false;
+        }
+        values[*count] = (int)parsed;
+        if (heights)
+        {
+            heights[*count] = (int)height;
+        }
+        (*count)++;
+        cursor = *end == ',' ? end + 1 : end;
+    }
+    if (*count == 0)
+    {
+        TraceLog(LOG_ERROR, "BENCH: Empty --%s list", option);
+        return false;
+    }
+    return true;
+}
+
+static int CompareInts(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+static int CompareDoubles(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Uniform positions over the grid and small random velocities, from a fixed seed
+static void RandomizeParticles(Particles *particles, int width, int height)
+{
+    uint32_t state = BENCH_SEED;
+    for (int i = 0; i < particles->count; i++)
+    {
+        float r[4];
+        for (int k = 0; k < 4; k++)
+        {
+            state = state * 1664525u + 1013904223u;
+            r[k] = (float)(state >> 8) * (1.0f / 16777216.0f);
+        }
+        particles->posX[i] = r[0] * (float)width;
+        particles->posY[i] = r[1] * (float)height;
+        particles->velX[i] = r[2] - 0.5f;
+        particles->velY[i] = r[3] - 0.5f;
+    }
+}
+
+static void ClearBitmaps(OccupancyBitmap *bitmaps, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (bitmaps[i].counts)
+        {
+            memset(bitmaps[i].counts, 0, (size_t)bitmaps[i].countStride * bitmaps[i].height);
+        }
+        else
+        {
+            memset(bitmaps[i].words, 0, (size_t)bitmaps[i].wordCount * sizeof(uint32_t));
+        }
+        memset(bitmaps[i].bandTouched, 0, (size_t)bitmaps[i].bandCount);
+    }
+}
+
+static void IntegrateJob(void *context, int start, int end, int workerIndex)
+{
+    BenchScene *scene = (BenchScene *)context;
+    OccupancyBitmap *splat = scene->splat ? &scene->splat[workerIndex] : NULL;
+    scene->integrate(&scene->source, &scene->target, start, end, &scene->params, splat);
+}
+
+static void SplatJob(void *context, int start, int end, int workerIndex)
+{
+    BenchScene *scene = (BenchScene *)context;
+    UpdateBufferWithParticles(&scene->splat[workerIndex], &scene->target, start, end);
+}
+
+// Splats one contiguous slice of the particles per bitmap, like the rasterization jobs of the simulation
+static void SplatSliceJob(void *context, int start, int end, int workerIndex)
+{
+    (void)workerIndex;
+    BenchScene *scene = (BenchScene *)context;
+    const int count = scene->target.count;
+    for (int b = start; b < end; b++)
+    {
+        int first = (int)((long long)count * b / scene->bitmapCount);
+        int last = (int)((long long)count * (b + 1) / scene->bitmapCount);
+        UpdateBufferWithParticles(&scene->splat[b], &scene->target, first, last);
+    }
+}
+
+static void CombineJob(void *context, int start, int end, int workerIndex)
+{
+    (void)workerIndex;
+    BenchScene *scene = (BenchScene *)context;
+    const ParticleKernels *kernels = scene->kernels;
+    if (scene->density)
+    {
+        DensityCombineKernel combine = scene->stream ? kernels->combineDensityStream : kernels->combineDensity;
+        combine(scene->bitmapList, scene->bitmapCount, scene->pixels, start, end, scene->palette);
+        return;
+    }
+    CombineKernel combine = scene->stream ? kernels->combineStream : kernels->combine;
+    combine(scene->bitmapList, scene->bitmapCount, scene->pixels, start, end);
+}
+
+static void FillJob(void *context, int start, int end, int workerIndex)
+{
+    (void)workerIndex;
+    BenchScene *scene = (BenchScene *)context;
+    FillKernel fill = scene->stream ? scene->kernels->fillStream : scene->kernels->fill;
+    fill(scene->pixels + start, end - start, OCCUPIED_COLOR);
+}
+
+static void CopyJob(void *context, int start, int end, int workerIndex)
+{
+    (void)workerIndex;
+    BenchScene *scene = (BenchScene *)context;
+    memcpy(scene->copyTarget + (size_t)start * BENCH_PEAK_CHUNK, scene->copySource + (size_t)start * BENCH_PEAK_CHUNK,
+           (size_t)(end - start) * BENCH_PEAK_CHUNK);
+}
+
+static void PrepareSplat(SimpleThreadPool *pool, BenchScene *scene)
+{
+    (void)pool;
+    ClearBitmaps(scene->splat, scene->bitmapCount);
+}
+
+// The combine kernels clear what they read, so the bitmaps are filled again before every repetition
+static void PrepareCombine(SimpleThreadPool *pool, BenchScene *scene)
+{
+    SimpleThreadPoolRangePhase splat = {
+        .job = SplatSliceJob,
+        .context = scene,
+        .itemCount = scene->bitmapCount,
+        .chunkSize = 1
+    };
+    ClearBitmaps(scene->splat, scene->bitmapCount);
+    SimpleThreadPool_RunRange(pool, &splat);
+}
+
+// Points the scene at the kernel of one case and returns the phase running it, with the items
+// and the streamed bytes of one repetition
+static SimpleThreadPoolRangePhase SetupCase(BenchScene *scene, BenchCase benchCase, int threadCount, double *items,
+                                            double *bytes)
+{
+    const double particles = (double)scene->source.count;
+    const double pixels = (double)scene->width * scene->height;
+    SimpleThreadPoolRangePhase phase = {.context = scene};
+
+    scene->integrate = benchCase == BENCH_INTEGRATE_FAST ? scene->kernels->integrateFast : scene->kernels->integrate;
+    scene->density = benchCase == BENCH_COMBINE_DENSITY;
+    scene->stream = benchCase == BENCH_COMBINE_STREAM || benchCase == BENCH_FILL_STREAM;
+    scene->splat = scene->density ? scene->densityBitmaps : scene->bitmaps;
+    scene->bitmapCount = scene->density && threadCount > DENSITY_MAX_BITMAPS ? DENSITY_MAX_BITMAPS : threadCount;
+    for (int i = 0; i < scene->bitmapCount; i++)
+    {
+        scene->bitmapList[i] = &scene->splat[i];
+    }
+
+    switch (benchCase)
+    {
+    case BENCH_INTEGRATE:
+    case BENCH_INTEGRATE_FAST:
+    case BENCH_INTEGRATE_FUSED:
+        if (benchCase != BENCH_INTEGRATE_FUSED)
+        {
+            scene->splat = NULL;
+        }
+        phase.job = IntegrateJob;
+        phase.itemCount = scene->source.count;
+        phase.chunkSize = BENCH_PARTICLE_CHUNK_SIZE;
+        *items = particles;
+        *bytes = particles * 8 * sizeof(float); // Four arrays read, four written
+        break;
+    case BENCH_SPLAT:
+        phase.job = SplatJob;
+        phase.itemCount = scene->source.count;
+        phase.chunkSize = BENCH_PARTICLE_CHUNK_SIZE;
+        *items = particles;
+        *bytes = particles * 2 * sizeof(float);
+        break;
+    case BENCH_COMBINE:
+    case BENCH_COMBINE_STREAM:
+    case BENCH_COMBINE_DENSITY:
+    {
+        const OccupancyBitmap *bitmap = scene->bitmapList[0];
+        double bitmapBytes = scene->density ? (double)bitmap->countStride * bitmap->height
+                                            : (double)bitmap->stride * bitmap->height * sizeof(uint32_t);
+        phase.job = CombineJob;
+        phase.itemCount = scene->height;
+        phase.chunkSize = BENCH_ROW_CHUNK;
+        *items = pixels;
+        *bytes = pixels * sizeof(Color) + bitmapBytes * scene->bitmapCount * 2; // Every bitmap read and cleared
+        break;
+    }
+    case BENCH_FILL:
+    case BENCH_FILL_STREAM:
+    default:
+        phase.job = FillJob;
+        phase.itemCount = scene->width * scene->height;
+        phase.chunkSize = scene->width * BENCH_ROW_CHUNK;
+        *items = pixels;
+        *bytes = pixels * sizeof(Color);
+        break;
+    }
+    return phase;
+}
+
+static void (*CasePreparation(BenchCase benchCase))(SimpleThreadPool *, BenchScene *)
+{
+    switch (benchCase)
+    {
+    case BENCH_INTEGRATE_FUSED:
+    case BENCH_SPLAT:
+        return PrepareSplat;
+    case BENCH_COMBINE:
+    case BENCH_COMBINE_STREAM:
+    case BENCH_COMBINE_DENSITY:
+        return PrepareCombine;
+    default:
+        return NULL;
+    }
+}
+
+/* ========================================================================= */
+/*                            Main                                           */
+/* ========================================================================= */
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+    if (!ParseBenchOptions(&options, argc, argv))
+    {
+        return 1;
+    }
+
+    // Every kernel table the CPU can run, or only the requested one
+    const ParticleKernels *const Tables[] = {&ScalarKernels, &Sse41Kernels, &Avx2Kernels, &Avx512Kernels};
+    const SimdLevel supported = DetectSimdLevel();
+    const ParticleKernels *tables[4];
+    int tableCount = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        if (Tables[i]->level <= supported && (options.simdLevel == SIMD_AUTO || Tables[i]->level == options.simdLevel))
+        {
+            tables[tableCount++] = Tables[i];
+        }
+    }
+    if (tableCount == 0)
+    {
+        TraceLog(LOG_ERROR, "BENCH: The CPU does not support the requested instruction set");
+        return 1;
+    }
+
+    // One pool per thread count, all started up front so none of them is timed while starting
+    SimpleThreadPool *pools[BENCH_MAX_LIST];
+    for (int t = 0; t < options.threadListCount; t++)
+    {
+        pools[t] = SimpleThreadPool_Init(options.threadCounts[t], options.pinning);
+        if (!pools[t] || SimpleThreadPool_ThreadCount(pools[t]) != options.threadCounts[t])
+        {
+            TraceLog(LOG_ERROR, "BENCH: Failed to start %d threads", options.threadCounts[t]);
+            return 1;
+        }
+    }
+
+    BenchScene scene = {
+        .attractor = {.strength = DEFAULT_ATTRACTION_STRENGTH, .falloffRadiusSq = 0.0f},
+        .copySource = (unsigned char *)AllocateAligned(BENCH_PEAK_BYTES, 64),
+        .copyTarget = (unsigned char *)AllocateAligned(BENCH_PEAK_BYTES, 64)
+    };
+    scene.params = (IntegrateParams){.attractors = &scene.attractor, .attractorCount = 1, .friction = DEFAULT_FRICTION};
+    BuildDensityPalette(scene.palette);
+    if (!scene.copySource || !scene.copyTarget)
+    {
+        TraceLog(LOG_ERROR, "BENCH: Failed to allocate the copy buffers");
+        return 1;
+    }
+    memset(scene.copySource, 1, BENCH_PEAK_BYTES);
+    memset(scene.copyTarget, 0, BENCH_PEAK_BYTES);
+
+    double peaks[BENCH_MAX_LIST];
+    for (int t = 0; t < options.threadListCount; t++)
+    {
+        peaks[t] = MeasureCopyPeak(pools[t], &scene, options.reps);
+    }
+
+    // A failed allocation ends the sweep after the current resolution is freed again
+    int status = 0;
+    printf("kernel,isa,particles,threads,width,height,items,ns_per_item,gbps,peak_gbps,peak_pct,efficiency\n");
+    for (int r = 0; status == 0 && r < options.resolutionCount; r++)
+    {
+        scene.width = options.widths[r];
+        scene.height = options.heights[r];
+        scene.attractor.position = (Vector2){0.5f * (float)scene.width, 0.5f * (float)scene.height};
+        scene.pixels = (Color *)AllocateAligned((size_t)scene.width * scene.height * sizeof(Color), 64);
+        scene.bitmaps = (OccupancyBitmap *)calloc(MAX_THREADS, sizeof(OccupancyBitmap));
+        scene.densityBitmaps = (OccupancyBitmap *)calloc(DENSITY_MAX_BITMAPS, sizeof(OccupancyBitmap));
+        const bool arrays = scene.bitmaps && scene.densityBitmaps;
+        bool allocated = scene.pixels && arrays;
+        const int largest = options.threadCounts[options.threadListCount - 1];
+        const int densityCount = largest > DENSITY_MAX_BITMAPS ? DENSITY_MAX_BITMAPS : largest;
+        for (int i = 0; arrays && i < largest; i++)
+        {
+            scene.bitmaps[i] = AllocateOccupancyBitmap(scene.width, scene.height, false);
+            allocated = allocated && scene.bitmaps[i].words && scene.bitmaps[i].bandTouched;
+        }
+        for (int i = 0; arrays && i < densityCount; i++)
+        {
+            scene.densityBitmaps[i] = AllocateOccupancyBitmap(scene.width, scene.height, true);
+            allocated = allocated && scene.densityBitmaps[i].counts && scene.densityBitmaps[i].bandTouched;
+        }
+        if (!allocated)
+        {
+            TraceLog(LOG_ERROR, "BENCH: Failed to allocate a %dx%d grid", scene.width, scene.height);
+            status = 1;
+        }
+
+        for (int p = 0; status == 0 && p < options.particleListCount; p++)
+        {
+            scene.source = AllocateParticles(options.particleCounts[p]);
+            scene.target = AllocateParticles(options.particleCounts[p]);
+            if (!scene.source.posX || !scene.target.posX)
+            {
+                TraceLog(LOG_ERROR, "BENCH: Failed to allocate %d particles", options.particleCounts[p]);
+                FreeParticles(&scene.source);
+                FreeParticles(&scene.target);
+                status = 1;
+                break;
+            }
+            RandomizeParticles(&scene.source, scene.width, scene.height);
+            memcpy(scene.target.posX, scene.source.posX, (size_t)scene.source.count * sizeof(float));
+            memcpy(scene.target.posY, scene.source.posY, (size_t)scene.source.count * sizeof(float));
+
+            for (int c = 0; c < BENCH_CASE_COUNT; c++)
+            {
+                // The splat is plain C whatever the instruction set, and the fills ignore the particles
+                const bool perTable = c != BENCH_SPLAT;
+                if ((c == BENCH_FILL || c == BENCH_FILL_STREAM) && p > 0)
+                {
+                    continue;
+                }
+                for (int k = 0; k < (perTable ? tableCount : 1); k++)
+                {
+                    scene.kernels = tables[k];
+                    double baseline = 0.0;
+                    for (int t = 0; t < options.threadListCount; t++)
+                    {
+                        const int threads = options.threadCounts[t];
+                        double items;
+                        double bytes;
+                        SimpleThreadPoolRangePhase phase = SetupCase(&scene, (BenchCase)c, threads, &items, &bytes);
+                        double seconds = MeasurePhase(pools[t], &phase, &scene, CasePreparation((BenchCase)c),
+                                                      options.reps);
+
+                        // Throughput per thread, relative to the first thread count
+                        double perThread = items / (seconds * threads);
+                        if (t == 0)
+                        {
+                            baseline = perThread;
+                        }
+                        const bool pixelOnly = c == BENCH_FILL || c == BENCH_FILL_STREAM;
+                        double gbps = bytes / seconds * 1e-9;
+                        printf("%s,%s,%d,%d,%d,%d,%.0f,%.3f,%.2f,%.2f,%.1f,%.3f\n", BenchCaseNames[c],
+                               perTable ? tables[k]->name : "-", pixelOnly ? 0 : scene.source.count, threads,
+                               scene.width, scene.height, items, seconds * 1e9 / items, gbps, peaks[t],
+                               100.0 * gbps / peaks[t], perThread / baseline);
+                        fflush(stdout);
+                    }
+                }
+            }
+
+            FreeParticles(&scene.source);
+            FreeParticles(&scene.target);
+        }
+
+        for (int i = 0; arrays && i < largest; i++)
+        {
+            FreeOccupancyBitmap(&scene.bitmaps[i]);
+        }
+        for (int i = 0; arrays && i < densityCount; i++)
+        {
+            FreeOccupancyBitmap(&scene.densityBitmaps[i]);
+        }
+        free(scene.bitmaps);
+        free(scene.densityBitmaps);
+        FreeAligned(scene.pixels);
+    }
+
+    for (int t = 0; t < options.threadListCount; t++)
+    {
+        SimpleThreadPool_Destroy(pools[t]);
+    }
+    FreeAligned(scene.copySource);
+    FreeAligned(scene.copyTarget);
+    return status;
+}
+
+/* ========================================================================= */
+/*                            Public functions                               */
+/* ========================================================================= */
+bool ParseBenchOptions(BenchOptions *options, int argc, char **argv)
+{
+    *options = (BenchOptions){
+        .particleCounts = {1000000, 4000000},
+        .particleListCount = 2,
+        .threadCounts = {1, 2, 4, 8, DEFAULT_THREAD_COUNT},
+        .threadListCount = 5,
+        .widths = {1920, DEFAULT_SCREEN_WIDTH},
+        .heights = {1080, DEFAULT_SCREEN_HEIGHT},
+        .resolutionCount = 2,
+        .simdLevel = SIMD_AUTO,
+        .pinning = SIMPLE_THREADPOOL_PIN_NONE,
+        .reps = BENCH_DEFAULT_REPS
+    };
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *option = argv[i];
+        if (strcmp(option, "--help") == 0 || strcmp(option, "-h") == 0)
+        {
+            PrintUsage();
+            exit(0);
+        }
+        if (strncmp(option, "--", 2) != 0 || i + 1 == argc)
+        {
+            TraceLog(LOG_ERROR, "BENCH: Expected an option and its value, got '%s'", option);
+            return false;
+        }
+        const char *name = option + 2;
+        const char *value = argv[++i];
+
+        bool parsed = true;
+        if (strcmp(name, "particles") == 0)
+        {
+            parsed = ParseList(name, value, options->particleCounts, NULL, &options->particleListCount);
+        }
+        else if (strcmp(name, "threads") == 0)
+        {
+            parsed = ParseList(name, value, options->threadCounts, NULL, &options->threadListCount);
+        }
+        else if (strcmp(name, "resolutions") == 0)
+        {
+            parsed = ParseList(name, value, options->widths, options->heights, &options->resolutionCount);
+        }
+        else if (strcmp(name, "simd") == 0 || strcmp(name, "pin") == 0)
+        {
+            const bool simd = name[0] == 's';
+            int choice = FindChoice(simd ? SimdNames : PinningNames, value);
+            if (choice < 0)
+            {
+                TraceLog(LOG_ERROR, "BENCH: Unknown --%s value '%s'", name, value);
+                return false;
+            }
+            if (simd)
+            {
+                options->simdLevel = (SimdLevel)choice; // "all" lines up with SIMD_AUTO
+            }
+            else
+            {
+                options->pinning = (SimpleThreadPoolPinning)choice;
+            }
+        }
+        else if (strcmp(name, "reps") == 0)
+        {
+            char *end = NULL;
+            long reps = strtol(value, &end, 10);
+            parsed = end != value && *end == '\0' && reps >= 1 && reps <= BENCH_MAX_REPS;
+            options->reps = (int)reps;
+            if (!parsed)
+            {
+                TraceLog(LOG_ERROR, "BENCH: --reps takes one count from 1 to %d", BENCH_MAX_REPS);
+            }
+        }
+        else
+        {
+            TraceLog(LOG_ERROR, "BENCH: Unknown option '%s', see --help", option);
+            return false;
+        }
+        if (!parsed)
+        {
+            return false;
+        }
+    }
+
+    for (int t = 0; t < options->threadListCount; t++)
+    {
+        if (options->threadCounts[t] > MAX_THREADS)
+        {
+            TraceLog(LOG_ERROR, "BENCH: At most %d threads are supported", MAX_THREADS);
+            return false;
+        }
+    }
+    qsort(options->threadCounts, (size_t)options->threadListCount, sizeof(int), CompareInts);
+    return true;
+}
+
+double MeasurePhase(SimpleThreadPool *pool, const SimpleThreadPoolRangePhase *phase, BenchScene *scene,
+                    void (*prepare)(SimpleThreadPool *pool, BenchScene *scene), int reps)
+{
+    double samples[BENCH_MAX_REPS];
+    for (int rep = -1; rep < reps; rep++)
+    {
+        if (prepare)
+        {
+            prepare(pool, scene);
+        }
+        double start = SimpleThreadPool_GetTime();
+        SimpleThreadPool_RunRange(pool, phase);
+        double elapsed = SimpleThreadPool_GetTime() - start;
+        if (rep >= 0)
+        {
+            samples[rep] = elapsed;
+        }
+    }
+    qsort(samples, (size_t)reps, sizeof(double), CompareDoubles);
+    return samples[reps / 2];
+}
+
+double MeasureCopyPeak(SimpleThreadPool *pool, BenchScene *scene, int reps)
+{
+    SimpleThreadPoolRangePhase copy = {
+        .job = CopyJob,
+        .context = scene,
+        .itemCount = BENCH_PEAK_BYTES / BENCH_PEAK_CHUNK,
+        .chunkSize = 1
+    };
+    double seconds = MeasurePhase(pool, &copy, scene, NULL, reps);
+    return 2.0 * BENCH_PEAK_BYTES / seconds * 1e-9;
+}
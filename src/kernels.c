@@ -0,0 +1,457 @@
+#include "kernels.h"
+
+#include <cpuid.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ========================================================================= */
+/*                            Defines                                        */
+/* ========================================================================= */
+#define VERIFY_PARTICLE_COUNT 4099 // Not a multiple of any vector width, so every tail path runs
+#define VERIFY_EXACT_TOLERANCE 1e-6f // Exact kernels only differ by the rounding of reordered operations
+#define VERIFY_NEAR_DISTANCE 1.0f  // Closer to an attractor than this, only finiteness is checked
+#define VERIFY_AREA_SIZE 1000      // Side in pixels of the square the particles start in, also the compact format's screen
+#define VERIFY_PIXEL_WIDTH 1013    // 21 pixels past a multiple of 32, so both halves of the last word are partial
+#define VERIFY_PIXEL_HEIGHT 5
+#define VERIFY_PIXEL_ROW_START 1   // The combine kernels run on the rows below it, the first must stay untouched
+#define VERIFY_FILL_COUNT (VERIFY_PIXEL_WIDTH * VERIFY_PIXEL_HEIGHT - 2) // Odd, written from the second pixel on
+#define VERIFY_PIXEL_COUNT (VERIFY_PIXEL_WIDTH * VERIFY_PIXEL_HEIGHT + 32) // Image and guard pixels catching overruns
+#define VERIFY_PIXEL_BITMAPS DENSITY_MAX_BITMAPS
+#define VERIFY_SENTINEL_COLOR (Color){1, 2, 3, 4}   // Pixels no kernel should write keep this color
+#define VERIFY_FILL_COLOR (Color){10, 20, 30, 40}
+
+static const ParticleKernels *const Tables[] = {
+    [SIMD_SCALAR] = &ScalarKernels,
+    [SIMD_SSE41] = &Sse41Kernels,
+    [SIMD_AVX2] = &Avx2Kernels,
+    [SIMD_AVX512] = &Avx512Kernels,
+};
+
+typedef enum PixelVariant
+{
+    PIXEL_COMBINE,
+    PIXEL_COMBINE_STREAM,
+    PIXEL_DENSITY,
+    PIXEL_DENSITY_STREAM,
+    PIXEL_FILL,
+    PIXEL_FILL_STREAM,
+    PIXEL_VARIANT_COUNT
+} PixelVariant;
+
+static const char *const PixelVariantNames[] = {
+    [PIXEL_COMBINE] = "combine",
+    [PIXEL_COMBINE_STREAM] = "combine-stream",
+    [PIXEL_DENSITY] = "density",
+    [PIXEL_DENSITY_STREAM] = "density-stream",
+    [PIXEL_FILL] = "fill",
+    [PIXEL_FILL_STREAM] = "fill-stream",
+};
+
+/* ========================================================================= */
+/*                            Private functions                              */
+/* ========================================================================= */
+// Register state the OS saves on context switches (XCR0), only valid when OSXSAVE is set
+static uint64_t ReadXcr0(void)
+{
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64_t)edx << 32) | eax;
+}
+
+// Tests the exponent bits, since isfinite() may be folded away when built with -Ofast
+static bool IsFiniteFloat(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits & 0x7F800000u) != 0x7F800000u;
+}
+
+// Largest velocity difference relative to the reference, -1 if a result is not finite
+static float CompareVelocities(const Particles *reference, const Particles *result, const bool *near, float scale)
+{
+    float maxError = 0.0f;
+    for (int i = 0; i < reference->count; i++)
+    {
+        if (!IsFiniteFloat(result->velX[i]) || !IsFiniteFloat(result->velY[i]))
+        {
+            return -1.0f;
+        }
+        if (near[i])
+        {
+            continue;
+        }
+        float error = fabsf(result->velX[i] - reference->velX[i]) + fabsf(result->velY[i] - reference->velY[i]);
+        maxError = fmaxf(maxError, error / scale);
+    }
+    return maxError;
+}
+
+// The same bits and counters every run. A quarter of the pixels are occupied; a third of the
+// counters are empty, a third small and a third from 200 up, so most sums of them saturate.
+static void FillVerifyBitmaps(OccupancyBitmap *const *buffers, int bufferCount)
+{
+    unsigned int seed = 54321u;
+    for (int b = 0; b < bufferCount; b++)
+    {
+        OccupancyBitmap *bitmap = buffers[b];
+        for (int y = 0; y < bitmap->height; y++)
+        {
+            for (int x = 0; x < bitmap->width; x++)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                unsigned int value = seed >> 24;
+                if (bitmap->counts)
+                {
+                    bitmap->counts[y * bitmap->countStride + x] =
+                        (uint8_t)(value < 85 ? 0 : (value < 170 ? value % 8 + 1 : 200 + value % 56));
+                }
+                else if (value < 64)
+                {
+                    bitmap->words[y * bitmap->stride + (x >> 5)] |= 1u << (x & 31);
+                }
+            }
+        }
+    }
+}
+
+// Whether the combine left every bitmap clear over the rows it merged
+static bool AreBitmapsClear(OccupancyBitmap *const *buffers, int bufferCount, int rowStart, int rowEnd)
+{
+    for (int b = 0; b < bufferCount; b++)
+    {
+        const OccupancyBitmap *bitmap = buffers[b];
+        for (int y = rowStart; y < rowEnd; y++)
+        {
+            int rowSize = bitmap->counts ? bitmap->countStride : bitmap->stride;
+            for (int i = 0; i < rowSize; i++)
+            {
+                if (bitmap->counts ? bitmap->counts[y * rowSize + i] : bitmap->words[y * rowSize + i])
+                {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Runs one pixel kernel on the fixed input over a sentinel image, false if it left a bitmap dirty
+static bool RunPixelKernel(const ParticleKernels *kernels, PixelVariant variant, OccupancyBitmap *const *bits,
+                           OccupancyBitmap *const *counts, Color *pixels, const uint32_t *palette)
+{
+    for (int i = 0; i < VERIFY_PIXEL_COUNT; i++)
+    {
+        pixels[i] = VERIFY_SENTINEL_COLOR;
+    }
+
+    // Both bitmap sets also start clear for the fills, whose check then passes trivially
+    OccupancyBitmap *const *buffers = variant == PIXEL_DENSITY || variant == PIXEL_DENSITY_STREAM ? counts : bits;
+    if (variant < PIXEL_FILL)
+    {
+        FillVerifyBitmaps(buffers, VERIFY_PIXEL_BITMAPS);
+    }
+
+    switch (variant)
+    {
+    case PIXEL_COMBINE:
+        kernels->combine(buffers, VERIFY_PIXEL_BITMAPS, pixels, VERIFY_PIXEL_ROW_START, VERIFY_PIXEL_HEIGHT);
+        break;
+    case PIXEL_COMBINE_STREAM:
+        kernels->combineStream(buffers, VERIFY_PIXEL_BITMAPS, pixels, VERIFY_PIXEL_ROW_START, VERIFY_PIXEL_HEIGHT);
+        break;
+    case PIXEL_DENSITY:
+        kernels->combineDensity(buffers, VERIFY_PIXEL_BITMAPS, pixels, VERIFY_PIXEL_ROW_START, VERIFY_PIXEL_HEIGHT,
+                                palette);
+        break;
+    case PIXEL_DENSITY_STREAM:
+        kernels->combineDensityStream(buffers, VERIFY_PIXEL_BITMAPS, pixels, VERIFY_PIXEL_ROW_START,
+                                      VERIFY_PIXEL_HEIGHT, palette);
+        break;
+    case PIXEL_FILL:
+        kernels->fill(pixels + 1, VERIFY_FILL_COUNT, VERIFY_FILL_COLOR);
+        break;
+    case PIXEL_FILL_STREAM:
+        kernels->fillStream(pixels + 1, VERIFY_FILL_COUNT, VERIFY_FILL_COLOR);
+        break;
+    default:
+        break;
+    }
+
+    // Rows above the range keep their input, which the next fill of the bitmaps ORs over
+    bool clear = AreBitmapsClear(buffers, VERIFY_PIXEL_BITMAPS, VERIFY_PIXEL_ROW_START, VERIFY_PIXEL_HEIGHT);
+    for (int b = 0; b < VERIFY_PIXEL_BITMAPS; b++)
+    {
+        if (buffers[b]->counts)
+        {
+            memset(buffers[b]->counts, 0, (size_t)buffers[b]->countStride * buffers[b]->height);
+        }
+        else
+        {
+            memset(buffers[b]->words, 0, (size_t)buffers[b]->wordCount * sizeof(uint32_t));
+        }
+    }
+    return clear;
+}
+
+// Checks the combine and fill kernels of every supported table pixel for pixel against the
+// scalar ones, on rows whose width leaves a partial word and vector at the end
+static bool VerifyPixelKernels(FILE *out)
+{
+    OccupancyBitmap bitStorage[VERIFY_PIXEL_BITMAPS];
+    OccupancyBitmap countStorage[VERIFY_PIXEL_BITMAPS];
+    OccupancyBitmap *bits[VERIFY_PIXEL_BITMAPS];
+    OccupancyBitmap *counts[VERIFY_PIXEL_BITMAPS];
+    bool allocated = true;
+    for (int b = 0; b < VERIFY_PIXEL_BITMAPS; b++)
+    {
+        bitStorage[b] = AllocateOccupancyBitmap(VERIFY_PIXEL_WIDTH, VERIFY_PIXEL_HEIGHT, false);
+        countStorage[b] = AllocateOccupancyBitmap(VERIFY_PIXEL_WIDTH, VERIFY_PIXEL_HEIGHT, true);
+        bits[b] = &bitStorage[b];
+        counts[b] = &countStorage[b];
+        allocated = allocated && bitStorage[b].words && bitStorage[b].bandTouched && countStorage[b].counts &&
+                    countStorage[b].bandTouched;
+    }
+    Color *reference = (Color *)malloc(VERIFY_PIXEL_COUNT * sizeof(Color));
+    Color *pixels = (Color *)malloc(VERIFY_PIXEL_COUNT * sizeof(Color));
+    uint32_t palette[DENSITY_LEVELS];
+    BuildDensityPalette(palette);
+
+    allocated = allocated && reference && pixels;
+    if (!allocated)
+    {
+        TraceLog(LOG_ERROR, "SIMD: Failed to allocate the verification bitmaps");
+    }
+
+    bool passed = allocated;
+    for (PixelVariant variant = 0; allocated && variant < PIXEL_VARIANT_COUNT; variant++)
+    {
+        RunPixelKernel(&ScalarKernels, variant, bits, counts, reference, palette);
+        for (SimdLevel level = SIMD_SCALAR; level <= DetectSimdLevel(); level++)
+        {
+            bool clear = RunPixelKernel(Tables[level], variant, bits, counts, pixels, palette);
+            int mismatches = 0;
+            for (int i = 0; i < VERIFY_PIXEL_COUNT; i++)
+            {
+                mismatches += memcmp(&pixels[i], &reference[i], sizeof(Color)) != 0;
+            }
+            bool ok = mismatches == 0 && clear;
+            passed = passed && ok;
+
+            // The error of a pixel kernel is its count of differing pixels
+            fprintf(out, "%s,%s,%d,0,%s\n", Tables[level]->name, PixelVariantNames[variant], mismatches,
+                    !clear ? "not-cleared" : (ok ? "pass" : "fail"));
+        }
+    }
+
+    for (int b = 0; b < VERIFY_PIXEL_BITMAPS; b++)
+    {
+        FreeOccupancyBitmap(&bitStorage[b]);
+        FreeOccupancyBitmap(&countStorage[b]);
+    }
+    free(reference);
+    free(pixels);
+    return passed;
+}
+
+/* ========================================================================= */
+/*                            Public functions                               */
+/* ========================================================================= */
+SimdLevel DetectSimdLevel(void)
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSE4_1))
+    {
+        return SIMD_SCALAR;
+    }
+
+    // AVX needs the OS to save the YMM registers, AVX-512 additionally the opmask and ZMM state
+    const uint64_t ymmState = 0x6;
+    const uint64_t zmmState = 0xE0;
+    uint64_t xcr0 = (ecx & bit_OSXSAVE) ? ReadXcr0() : 0;
+    if (!(ecx & bit_AVX) || (xcr0 & ymmState) != ymmState)
+    {
+        return SIMD_SSE41;
+    }
+
+    // The AVX2 kernels also convert half-precision floats with F16C, present on every AVX2 CPU
+    bool f16c = (ecx & bit_F16C) != 0;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) || !(ebx & bit_AVX2) || !f16c)
+    {
+        return SIMD_SSE41;
+    }
+
+    if ((ebx & bit_AVX512F) && (xcr0 & zmmState) == zmmState)
+    {
+        return SIMD_AVX512;
+    }
+    return SIMD_AVX2;
+}
+
+const ParticleKernels *SelectParticleKernels(SimdLevel requested)
+{
+    SimdLevel supported = DetectSimdLevel();
+    SimdLevel level = requested == SIMD_AUTO ? supported : requested;
+    if (level > supported)
+    {
+        TraceLog(LOG_WARNING, "SIMD: %s kernels requested but not supported, using %s",
+                 Tables[level]->name, Tables[supported]->name);
+        level = supported;
+    }
+
+    TraceLog(LOG_INFO, "SIMD: Using %s kernels", Tables[level]->name);
+    return Tables[level];
+}
+
+bool VerifyParticleKernels(FILE *out)
+{
+    // Fixed forces covering both branches of the falloff and a repulsor
+    const Attractor attractors[] = {
+        {.position = {500.0f, 500.0f}, .strength = 0.2f, .falloffRadiusSq = 0.0f},
+        {.position = {200.0f, 700.0f}, .strength = -0.3f, .falloffRadiusSq = 150.0f * 150.0f},
+        {.position = {800.0f, 300.0f}, .strength = 0.5f, .falloffRadiusSq = 50.0f * 50.0f},
+    };
+    const int attractorCount = (int)(sizeof(attractors) / sizeof(attractors[0]));
+    const IntegrateParams params = {.attractors = attractors, .attractorCount = attractorCount, .friction = 0.999f};
+
+    float strengthSum = 0.0f;
+    for (int k = 0; k < attractorCount; k++)
+    {
+        strengthSum += fabsf(attractors[k].strength);
+    }
+
+    Particles source = AllocateParticles(VERIFY_PARTICLE_COUNT);
+    Particles reference = AllocateParticles(VERIFY_PARTICLE_COUNT);
+    Particles result = AllocateParticles(VERIFY_PARTICLE_COUNT);
+    Particles expanded = AllocateParticles(VERIFY_PARTICLE_COUNT);
+    CompactParticles compactSource = AllocateCompactParticles(VERIFY_PARTICLE_COUNT, VERIFY_AREA_SIZE, VERIFY_AREA_SIZE);
+    CompactParticles compactResult = AllocateCompactParticles(VERIFY_PARTICLE_COUNT, VERIFY_AREA_SIZE, VERIFY_AREA_SIZE);
+    bool *near = (bool *)malloc(VERIFY_PARTICLE_COUNT * sizeof(bool));
+    if (!source.posX || !reference.posX || !result.posX || !expanded.posX || !compactSource.posX || !compactResult.posX ||
+        !near)
+    {
+        TraceLog(LOG_ERROR, "SIMD: Failed to allocate the verification particles");
+        FreeParticles(&source);
+        FreeParticles(&reference);
+        FreeParticles(&result);
+        FreeParticles(&expanded);
+        FreeCompactParticles(&compactSource);
+        FreeCompactParticles(&compactResult);
+        free(near);
+        return false;
+    }
+
+    // The same pseudo-random set every run, with the first particles exactly on and just next
+    // to the attractors, where the exact kernels used to produce NaN
+    unsigned int seed = 12345u;
+    for (int i = 0; i < VERIFY_PARTICLE_COUNT; i++)
+    {
+        float values[4];
+        for (int v = 0; v < 4; v++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            values[v] = (float)(seed >> 8) / (float)(1u << 24);
+        }
+        source.posX[i] = values[0] * (float)VERIFY_AREA_SIZE;
+        source.posY[i] = values[1] * (float)VERIFY_AREA_SIZE;
+        source.velX[i] = values[2] * 4.0f - 2.0f;
+        source.velY[i] = values[3] * 4.0f - 2.0f;
+
+        if (i < 2 * attractorCount)
+        {
+            const Attractor *attractor = &attractors[i % attractorCount];
+            source.posX[i] = attractor->position.x + (i < attractorCount ? 0.0f : 0.01f);
+            source.posY[i] = attractor->position.y;
+        }
+
+        near[i] = false;
+        for (int k = 0; k < attractorCount; k++)
+        {
+            float dx = attractors[k].position.x - source.posX[i];
+            float dy = attractors[k].position.y - source.posY[i];
+            near[i] = near[i] || dx * dx + dy * dy < VERIFY_NEAR_DISTANCE * VERIFY_NEAR_DISTANCE;
+        }
+    }
+
+    ScalarKernels.integrate(&source, &reference, 0, VERIFY_PARTICLE_COUNT, &params, NULL);
+
+    // The reference itself must be finite everywhere, the particles on an attractor included
+    bool passed = CompareVelocities(&reference, &reference, near, strengthSum) == 0.0f;
+
+    fprintf(out, "kernel,variant,max_error,tolerance,result\n");
+    for (SimdLevel level = SIMD_SCALAR; level <= DetectSimdLevel(); level++)
+    {
+        for (int fast = 0; fast < 2; fast++)
+        {
+            IntegrateKernel integrate = fast ? Tables[level]->integrateFast : Tables[level]->integrate;
+            float tolerance = fast ? KERNEL_VERIFY_TOLERANCE : VERIFY_EXACT_TOLERANCE;
+
+            integrate(&source, &result, 0, VERIFY_PARTICLE_COUNT, &params, NULL);
+            float error = CompareVelocities(&reference, &result, near, strengthSum);
+            bool ok = error >= 0.0f && error <= tolerance;
+            passed = passed && ok;
+
+            fprintf(out, "%s,%s,%g,%g,%s\n", Tables[level]->name, fast ? "fast" : "exact", error, tolerance,
+                    error < 0.0f ? "non-finite" : (ok ? "pass" : "fail"));
+        }
+    }
+
+    // The compact kernels start from the set rounded to the compact format. Their reference is
+    // the exact scalar kernel on that rounded state, so only the rounding of the results counts.
+    PackCompactParticles(&source, &compactSource, 0, VERIFY_PARTICLE_COUNT);
+    UnpackCompactParticles(&compactSource, &expanded, 0, VERIFY_PARTICLE_COUNT);
+    ScalarKernels.integrate(&expanded, &reference, 0, VERIFY_PARTICLE_COUNT, &params, NULL);
+
+    for (SimdLevel level = SIMD_SCALAR; level <= DetectSimdLevel(); level++)
+    {
+        for (int fast = 0; fast < 2; fast++)
+        {
+            CompactIntegrateKernel integrate = fast ? Tables[level]->integrateCompactFast : Tables[level]->integrateCompact;
+
+            integrate(&compactSource, &compactResult, 0, VERIFY_PARTICLE_COUNT, &params, NULL);
+            UnpackCompactParticles(&compactResult, &result, 0, VERIFY_PARTICLE_COUNT);
+            float error = CompareVelocities(&reference, &result, near, strengthSum);
+            bool ok = error >= 0.0f && error <= KERNEL_COMPACT_TOLERANCE;
+            passed = passed && ok;
+
+            fprintf(out, "%s,%s,%g,%g,%s\n", Tables[level]->name, fast ? "compact-fast" : "compact", error,
+                    KERNEL_COMPACT_TOLERANCE, error < 0.0f ? "non-finite" : (ok ? "pass" : "fail"));
+        }
+    }
+
+    // Quality of the compact storage over time: the same start run in both precisions, in place
+    const ParticleKernels *widest = Tables[DetectSimdLevel()];
+    widest->integrate(&expanded, &result, 0, VERIFY_PARTICLE_COUNT, &params, NULL);
+    widest->integrateCompact(&compactSource, &compactResult, 0, VERIFY_PARTICLE_COUNT, &params, NULL);
+    for (int step = 1; step < KERNEL_DRIFT_STEPS; step++)
+    {
+        widest->integrate(&result, &result, 0, VERIFY_PARTICLE_COUNT, &params, NULL);
+        widest->integrateCompact(&compactResult, &compactResult, 0, VERIFY_PARTICLE_COUNT, &params, NULL);
+    }
+    UnpackCompactParticles(&compactResult, &reference, 0, VERIFY_PARTICLE_COUNT);
+
+    double distanceSqSum = 0.0;
+    for (int i = 0; i < VERIFY_PARTICLE_COUNT; i++)
+    {
+        float dx = reference.posX[i] - result.posX[i];
+        float dy = reference.posY[i] - result.posY[i];
+        distanceSqSum += (double)(dx * dx + dy * dy);
+    }
+    float drift = (float)sqrt(distanceSqSum / VERIFY_PARTICLE_COUNT);
+    bool driftOk = IsFiniteFloat(drift) && drift <= KERNEL_DRIFT_TOLERANCE;
+    passed = passed && driftOk;
+    fprintf(out, "%s,compact-drift,%g,%g,%s\n", widest->name, drift, KERNEL_DRIFT_TOLERANCE,
+            !IsFiniteFloat(drift) ? "non-finite" : (driftOk ? "pass" : "fail"));
+
+    passed = VerifyPixelKernels(out) && passed;
+
+    FreeParticles(&source);
+    FreeParticles(&reference);
+    FreeParticles(&result);
+    FreeParticles(&expanded);
+    FreeCompactParticles(&compactSource);
+    FreeCompactParticles(&compactResult);
+    free(near);
+    return passed;
+}
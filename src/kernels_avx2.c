@@ -0,0 +1,468 @@
+#include "kernels.h"
+
+#include <immintrin.h>
+#include <string.h>
+
+/* ========================================================================= */
+/*                            Private functions                              */
+/* ========================================================================= */
+// Streaming stores bypass the caches, for mapped GPU memory that is never read back; they need aligned addresses
+static inline void StorePixels8(void *out, __m256i pixels, bool stream)
+{
+    if (stream && ((uintptr_t)out & 31) == 0)
+    {
+        _mm256_stream_si256((__m256i *)out, pixels);
+    }
+    else
+    {
+        _mm256_storeu_si256((__m256i *)out, pixels);
+    }
+}
+
+static inline void clearBufferSIMD(uint32_t *words, int count)
+{
+    // Process 8 words (256 pixels) at a time with AVX2
+    int i = 0;
+    for (; i <= count - 8; i += 8)
+    {
+        _mm256_storeu_si256((__m256i *)&words[i], _mm256_setzero_si256());
+    }
+    for (; i < count; i++)
+    {
+        words[i] = 0;
+    }
+}
+
+// Marks eight particle positions, truncated like the scalar kernel; lanes outside the bitmap are skipped
+static inline void SplatParticles8(OccupancyBitmap *buffer, __m256 posX, __m256 posY)
+{
+    __m256i x = _mm256_cvttps_epi32(posX);
+    __m256i y = _mm256_cvttps_epi32(posY);
+
+    // 0 <= x < width && 0 <= y < height; NaN and out-of-range floats convert to INT_MIN
+    __m256i minusOne = _mm256_set1_epi32(-1);
+    __m256i inside = _mm256_and_si256(
+        _mm256_and_si256(_mm256_cmpgt_epi32(x, minusOne), _mm256_cmpgt_epi32(_mm256_set1_epi32(buffer->width), x)),
+        _mm256_and_si256(_mm256_cmpgt_epi32(y, minusOne), _mm256_cmpgt_epi32(_mm256_set1_epi32(buffer->height), y)));
+    int mask = _mm256_movemask_ps(_mm256_castsi256_ps(inside));
+    if (mask == 0)
+    {
+        return;
+    }
+
+    int xs[8], ys[8];
+    _mm256_storeu_si256((__m256i *)xs, x);
+    _mm256_storeu_si256((__m256i *)ys, y);
+    while (mask)
+    {
+        int lane = __builtin_ctz(mask);
+        mask &= mask - 1;
+        MarkOccupiedPixel(buffer, xs[lane], ys[lane]);
+    }
+}
+
+// Estimate of 1 / sqrt(x), good to 12 bits, refined by one Newton-Raphson step to about 23
+static inline __m256 ReciprocalSqrt8(__m256 x)
+{
+    __m256 y = _mm256_rsqrt_ps(x);
+    __m256 halfXyy = _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), x), _mm256_mul_ps(y, y));
+    return _mm256_mul_ps(y, _mm256_sub_ps(_mm256_set1_ps(1.5f), halfXyy));
+}
+
+// Estimate of 1 / x refined the same way, y * (2 - x * y)
+static inline __m256 Reciprocal8(__m256 x)
+{
+    __m256 y = _mm256_rcp_ps(x);
+    return _mm256_mul_ps(y, _mm256_sub_ps(_mm256_set1_ps(2.0f), _mm256_mul_ps(x, y)));
+}
+
+// Sums the forces of every attractor on eight particles while the batch stays in registers
+static inline void AccumulateForces8(__m256 posX, __m256 posY, const IntegrateParams *params, bool fastMath,
+                                     __m256 *forceXOut, __m256 *forceYOut)
+{
+    const __m256 softening = _mm256_set1_ps(FAST_MATH_SOFTENING_SQ);
+
+    __m256 forceX = _mm256_setzero_ps();
+    __m256 forceY = _mm256_setzero_ps();
+    for (int k = 0; k < params->attractorCount; k++)
+    {
+        const Attractor *attractor = &params->attractors[k];
+
+        // Compute differences using AVX instructions
+        __m256 diffX = _mm256_sub_ps(_mm256_set1_ps(attractor->position.x), posX);
+        __m256 diffY = _mm256_sub_ps(_mm256_set1_ps(attractor->position.y), posY);
+
+        // Compute distance squared using AVX
+        __m256 distSq = _mm256_add_ps(_mm256_mul_ps(diffX, diffX), _mm256_mul_ps(diffY, diffY));
+
+        // Normalize diff vector. Lanes sitting on the attractor divide 0 by 0; the exact
+        // variant masks them out, the fast one never sees a zero distance.
+        __m256 normX, normY;
+        if (fastMath)
+        {
+            __m256 inverseDist = ReciprocalSqrt8(_mm256_add_ps(distSq, softening));
+            normX = _mm256_mul_ps(diffX, inverseDist);
+            normY = _mm256_mul_ps(diffY, inverseDist);
+        }
+        else
+        {
+            __m256 dist = _mm256_sqrt_ps(distSq);
+            __m256 apart = _mm256_cmp_ps(distSq, _mm256_setzero_ps(), _CMP_GT_OQ);
+            normX = _mm256_and_ps(_mm256_div_ps(diffX, dist), apart);
+            normY = _mm256_and_ps(_mm256_div_ps(diffY, dist), apart);
+        }
+
+        // Strength, scaled down with distance when the attractor has a falloff
+        __m256 scale = _mm256_set1_ps(attractor->strength);
+        if (attractor->falloffRadiusSq > 0.0f)
+        {
+            __m256 radiusSq = _mm256_set1_ps(attractor->falloffRadiusSq);
+            __m256 denominator = _mm256_add_ps(distSq, radiusSq);
+            __m256 falloff = fastMath ? _mm256_mul_ps(radiusSq, Reciprocal8(denominator))
+                                      : _mm256_div_ps(radiusSq, denominator);
+            scale = _mm256_mul_ps(scale, falloff);
+        }
+        forceX = _mm256_add_ps(forceX, _mm256_mul_ps(normX, scale));
+        forceY = _mm256_add_ps(forceY, _mm256_mul_ps(normY, scale));
+    }
+    *forceXOut = forceX;
+    *forceYOut = forceY;
+}
+
+static inline void IntegrateAvx2Range(const Particles *source, Particles *target, int start, int end,
+                                      const IntegrateParams *params, OccupancyBitmap *splat, bool fastMath)
+{
+    // Process in chunks of 8 for AVX2. Slices start anywhere, so the loads are unaligned.
+    int i = start;
+    for (; i + 7 < end; i += 8)
+    {
+        __m256 posX = _mm256_loadu_ps(&source->posX[i]);
+        __m256 posY = _mm256_loadu_ps(&source->posY[i]);
+        __m256 velX = _mm256_loadu_ps(&source->velX[i]);
+        __m256 velY = _mm256_loadu_ps(&source->velY[i]);
+
+        __m256 forceX, forceY;
+        AccumulateForces8(posX, posY, params, fastMath, &forceX, &forceY);
+        velX = _mm256_add_ps(velX, forceX);
+        velY = _mm256_add_ps(velY, forceY);
+
+        // Apply friction using AVX
+        __m256 friction = _mm256_set1_ps(params->friction);
+        velX = _mm256_mul_ps(velX, friction);
+        velY = _mm256_mul_ps(velY, friction);
+
+        // Update positions using AVX
+        posX = _mm256_add_ps(posX, velX);
+        posY = _mm256_add_ps(posY, velY);
+
+        // Store updated positions and velocities back
+        _mm256_storeu_ps(&target->posX[i], posX);
+        _mm256_storeu_ps(&target->posY[i], posY);
+        _mm256_storeu_ps(&target->velX[i], velX);
+        _mm256_storeu_ps(&target->velY[i], velY);
+
+        // Splat while the new positions are still in registers
+        if (splat)
+        {
+            SplatParticles8(splat, posX, posY);
+        }
+    }
+
+    // At most 7 particles left
+    IntegrateKernel tail = fastMath ? ScalarKernels.integrateFast : ScalarKernels.integrate;
+    tail(source, target, i, end, params, splat);
+}
+
+static void IntegrateAvx2(const Particles *source, Particles *target, int start, int end, const IntegrateParams *params,
+                          OccupancyBitmap *splat)
+{
+    IntegrateAvx2Range(source, target, start, end, params, splat, false);
+}
+
+static void IntegrateFastAvx2(const Particles *source, Particles *target, int start, int end,
+                              const IntegrateParams *params, OccupancyBitmap *splat)
+{
+    IntegrateAvx2Range(source, target, start, end, params, splat, true);
+}
+
+// Eight fixed-point positions expanded to pixels
+static inline __m256 LoadPositions8(const int16_t *values, float origin, float step)
+{
+    __m256i wide = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)values));
+    return _mm256_add_ps(_mm256_set1_ps(origin), _mm256_mul_ps(_mm256_cvtepi32_ps(wide), _mm256_set1_ps(step)));
+}
+
+// Rounds eight positions to the nearest fixed-point value; the pack saturates at the ends of the range
+static inline void StorePositions8(int16_t *values, __m256 positions, float origin, float inverseStep)
+{
+    __m256 scaled = _mm256_mul_ps(_mm256_sub_ps(positions, _mm256_set1_ps(origin)), _mm256_set1_ps(inverseStep));
+    __m256i rounded = _mm256_cvtps_epi32(scaled);
+    __m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(rounded), _mm256_extracti128_si256(rounded, 1));
+    _mm_storeu_si128((__m128i *)values, packed);
+}
+
+static inline void IntegrateCompactAvx2Range(const CompactParticles *source, CompactParticles *target, int start, int end,
+                                             const IntegrateParams *params, OccupancyBitmap *splat, bool fastMath)
+{
+    // 8 particles are 16 bytes per array; F16C widens the velocities in one instruction
+    int i = start;
+    for (; i + 7 < end; i += 8)
+    {
+        __m256 posX = LoadPositions8(&source->posX[i], source->originX, source->step);
+        __m256 posY = LoadPositions8(&source->posY[i], source->originY, source->step);
+        __m256 velX = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)&source->velX[i]));
+        __m256 velY = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)&source->velY[i]));
+
+        __m256 forceX, forceY;
+        AccumulateForces8(posX, posY, params, fastMath, &forceX, &forceY);
+
+        __m256 friction = _mm256_set1_ps(params->friction);
+        velX = _mm256_mul_ps(_mm256_add_ps(velX, forceX), friction);
+        velY = _mm256_mul_ps(_mm256_add_ps(velY, forceY), friction);
+        posX = _mm256_add_ps(posX, velX);
+        posY = _mm256_add_ps(posY, velY);
+
+        StorePositions8(&target->posX[i], posX, target->originX, target->inverseStep);
+        StorePositions8(&target->posY[i], posY, target->originY, target->inverseStep);
+        _mm_storeu_si128((__m128i *)&target->velX[i], _mm256_cvtps_ph(velX, _MM_FROUND_TO_NEAREST_INT));
+        _mm_storeu_si128((__m128i *)&target->velY[i], _mm256_cvtps_ph(velY, _MM_FROUND_TO_NEAREST_INT));
+
+        if (splat)
+        {
+            SplatParticles8(splat, posX, posY);
+        }
+    }
+
+    // At most 7 particles left
+    CompactIntegrateKernel tail = fastMath ? ScalarKernels.integrateCompactFast : ScalarKernels.integrateCompact;
+    tail(source, target, i, end, params, splat);
+}
+
+static void IntegrateCompactAvx2(const CompactParticles *source, CompactParticles *target, int start, int end,
+                                 const IntegrateParams *params, OccupancyBitmap *splat)
+{
+    IntegrateCompactAvx2Range(source, target, start, end, params, splat, false);
+}
+
+static void IntegrateCompactFastAvx2(const CompactParticles *source, CompactParticles *target, int start, int end,
+                                     const IntegrateParams *params, OccupancyBitmap *splat)
+{
+    IntegrateCompactAvx2Range(source, target, start, end, params, splat, true);
+}
+
+static inline void CombineAvx2Rows(OccupancyBitmap *const *buffers, int bufferCount, Color *pixels, int rowStart, int rowEnd,
+                                   bool stream)
+{
+    // Define colors in packed format for SIMD
+    uint32_t packedTrueColor = PackColor(OCCUPIED_COLOR);
+    uint32_t packedFalseColor = PackColor(EMPTY_COLOR);
+
+    __m256i vTrueColor = _mm256_set1_epi32(packedTrueColor);
+    __m256i vFalseColor = _mm256_set1_epi32(packedFalseColor);
+
+    // Lane i tests bit i of the broadcast byte
+    __m256i vLaneBits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+
+    const int width = buffers[0]->width;
+    const int stride = buffers[0]->stride;
+    const int fullWords = width / 32;
+
+    for (int y = rowStart; y < rowEnd; y++)
+    {
+        uint32_t *row = &buffers[0]->words[y * stride];
+        Color *rowPixels = &pixels[y * width];
+
+        // Combine buffers using OR into the first bitmap, clearing the others as we go
+        for (int b = 1; b < bufferCount; b++)
+        {
+            uint32_t *other = &buffers[b]->words[y * stride];
+            int w = 0;
+            for (; w <= stride - 8; w += 8)
+            {
+                __m256i vA = _mm256_loadu_si256((const __m256i *)&row[w]);
+                __m256i vB = _mm256_loadu_si256((const __m256i *)&other[w]);
+                _mm256_storeu_si256((__m256i *)&row[w], _mm256_or_si256(vA, vB));
+            }
+            for (; w < stride; w++)
+            {
+                row[w] |= other[w];
+            }
+            clearBufferSIMD(other, stride);
+        }
+
+        for (int w = 0; w < fullWords; w++)
+        {
+            uint32_t combined = row[w];
+            Color *out = &rowPixels[w * 32];
+
+            // Expand each byte of the word into 8 pixels
+            for (int k = 0; k < 4; k++)
+            {
+                __m256i vBits = _mm256_set1_epi32((int)(combined >> (8 * k)));
+                __m256i mask = _mm256_cmpeq_epi32(_mm256_and_si256(vBits, vLaneBits), vLaneBits); // 0xFFFFFFFF where occupied
+
+                // Blend pixels based on the mask: set bits select vTrueColor, clear bits vFalseColor
+                __m256i result = _mm256_blendv_epi8(vFalseColor, vTrueColor, mask);
+
+                // Store the result directly into the pixels array
+                StorePixels8(&out[8 * k], result, stream);
+            }
+        }
+
+        // Remaining pixels of a row whose width is not a multiple of 32
+        if (fullWords * 32 < width)
+        {
+            uint32_t combined = row[fullWords];
+            uint32_t *out = (uint32_t *)rowPixels;
+            for (int x = fullWords * 32; x < width; x++)
+            {
+                out[x] = (combined >> (x & 31)) & 1u ? packedTrueColor : packedFalseColor;
+            }
+        }
+
+        // The merged row has been consumed, leave it clear for the next frame
+        clearBufferSIMD(row, stride);
+    }
+    if (stream)
+    {
+        _mm_sfence();
+    }
+}
+
+static void CombineAvx2(OccupancyBitmap *const *buffers, int bufferCount, Color *pixels, int rowStart, int rowEnd)
+{
+    CombineAvx2Rows(buffers, bufferCount, pixels, rowStart, rowEnd, false);
+}
+
+static void CombineStreamAvx2(OccupancyBitmap *const *buffers, int bufferCount, Color *pixels, int rowStart, int rowEnd)
+{
+    CombineAvx2Rows(buffers, bufferCount, pixels, rowStart, rowEnd, true);
+}
+
+static inline void CombineDensityAvx2Rows(OccupancyBitmap *const *buffers, int bufferCount, Color *pixels, int rowStart,
+                                          int rowEnd, const uint32_t *palette, bool stream)
+{
+    const __m256i vEmpty = _mm256_set1_epi32((int)palette[0]);
+    const int width = buffers[0]->width;
+    const int stride = buffers[0]->countStride;
+
+    for (int y = rowStart; y < rowEnd; y++)
+    {
+        uint32_t *out = (uint32_t *)&pixels[y * width];
+
+        // One pass per 32 pixels: the counters of every bitmap are summed with saturation in a
+        // register and cleared, then shaded. Rows are padded to 64 bytes, so loads need no tail.
+        for (int x = 0; x < width; x += 32)
+        {
+            __m256i vSum = _mm256_setzero_si256();
+            for (int b = 0; b < bufferCount; b++)
+            {
+                __m256i *counts = (__m256i *)&buffers[b]->counts[y * stride + x];
+                vSum = _mm256_adds_epu8(vSum, _mm256_loadu_si256(counts));
+                _mm256_storeu_si256(counts, _mm256_setzero_si256());
+            }
+
+            // The last, partial chunk of a row is shaded into scratch space
+            uint32_t scratch[32];
+            const bool partial = width - x < 32;
+            uint32_t *chunkOut = partial ? scratch : &out[x];
+
+            if (_mm256_testz_si256(vSum, vSum))
+            {
+                // Most of a frame is background, written without a lookup
+                for (int k = 0; k < 4; k++)
+                {
+                    StorePixels8(&chunkOut[8 * k], vEmpty, stream);
+                }
+            }
+            else
+            {
+                // Widen 8 counters at a time and gather their palette entries
+                __m128i halves[2] = {_mm256_castsi256_si128(vSum), _mm256_extracti128_si256(vSum, 1)};
+                for (int k = 0; k < 4; k++)
+                {
+                    __m128i bytes = (k & 1) ? _mm_srli_si128(halves[k >> 1], 8) : halves[k >> 1];
+                    __m256i index = _mm256_cvtepu8_epi32(bytes);
+                    StorePixels8(&chunkOut[8 * k], _mm256_i32gather_epi32((const int *)palette, index, 4), stream);
+                }
+            }
+
+            if (partial)
+            {
+                memcpy(&out[x], scratch, (size_t)(width - x) * sizeof(uint32_t));
+            }
+        }
+    }
+    if (stream)
+    {
+        _mm_sfence();
+    }
+}
+
+static void CombineDensityAvx2(OccupancyBitmap *const *buffers, int bufferCount, Color *pixels, int rowStart, int rowEnd,
+                               const uint32_t *palette)
+{
+    CombineDensityAvx2Rows(buffers, bufferCount, pixels, rowStart, rowEnd, palette, false);
+}
+
+static void CombineDensityStreamAvx2(OccupancyBitmap *const *buffers, int bufferCount, Color *pixels, int rowStart,
+                                     int rowEnd, const uint32_t *palette)
+{
+    CombineDensityAvx2Rows(buffers, bufferCount, pixels, rowStart, rowEnd, palette, true);
+}
+
+static inline void FillAvx2Pixels(Color *pixels, int count, Color color, bool stream)
+{
+    // Assuming Color is a struct of 4 bytes (RGBA)
+    uint32_t packedColor = PackColor(color);
+
+    // Create an AVX2 vector with 8 packed color integers (since we're dealing
+    // with 32-bit ints, and AVX2 can handle 256 bits at a time)
+    __m256i packedColors = _mm256_set1_epi32((int)packedColor);
+
+    // Process 8 pixels per iteration
+    int i = 0;
+    for (; i <= count - 8; i += 8)
+    {
+        StorePixels8(&pixels[i], packedColors, stream);
+    }
+
+    // Remaining pixels of a buffer whose size is not a multiple of 8
+    uint32_t *out = (uint32_t *)pixels;
+    for (; i < count; i++)
+    {
+        out[i] = packedColor;
+    }
+    if (stream)
+    {
+        _mm_sfence();
+    }
+}
+
+static void FillAvx2(Color *pixels, int count, Color color)
+{
+    FillAvx2Pixels(pixels, count, color, false);
+}
+
+static void FillStreamAvx2(Color *pixels, int count, Color color)
+{
+    FillAvx2Pixels(pixels, count, color, true);
+}
+
+/* ========================================================================= */
+/*                            Kernel table                                   */
+/* ========================================================================= */
+const ParticleKernels Avx2Kernels = {
+    .name = "AVX2",
+    .level = SIMD_AVX2,
+    .integrate = IntegrateAvx2,
+    .integrateFast = IntegrateFastAvx2,
+    .integrateCompact = IntegrateCompactAvx2,
+    .integrateCompactFast = IntegrateCompactFastAvx2,
+    .combine = CombineAvx2,
+    .combineStream = CombineStreamAvx2,
+    .combineDensity = CombineDensityAvx2,
+    .combineDensityStream = CombineDensityStreamAvx2,
+    .fill = FillAvx2,
+    .fillStream = FillStreamAvx2,
+};
@@ -0,0 +1,435 @@
+#include "kernels.h"
+
+#include <immintrin.h>
+
+/* ========================================================================= */
+/*                            Private functions                              */
+/* ========================================================================= */
+// Mask selecting the first count lanes, count in [0, 16]
+static inline __mmask16 FirstLanes(int count)
+{
+    return (__mmask16)((1u << count) - 1u);
+}
+
+// Streaming stores bypass the caches, for mapped GPU memory that is never read back; they need aligned addresses
+static inline void StorePixels16(void *out, __m512i pixels, bool stream)
+{
+    if (stream && ((uintptr_t)out & 63) == 0)
+    {
+        _mm512_stream_si512(out, pixels);
+    }
+    else
+    {
+        _mm512_storeu_si512(out, pixels);
+    }
+}
+
+static inline void ClearWordsAvx512(uint32_t *words, int count)
+{
+    int i = 0;
+    for (; i <= count - 16; i += 16)
+    {
+        _mm512_storeu_si512(&words[i], _mm512_setzero_si512());
+    }
+    if (i < count)
+    {
+        _mm512_mask_storeu_epi32(&words[i], FirstLanes(count - i), _mm512_setzero_si512());
+    }
+}
+
+// Marks the positions of the lanes in lanes, truncated like the scalar kernel; lanes outside the bitmap are skipped
+static inline void SplatParticles16(OccupancyBitmap *buffer, __m512 posX, __m512 posY, __mmask16 lanes)
+{
+    __m512i x = _mm512_cvttps_epi32(posX);
+    __m512i y = _mm512_cvttps_epi32(posY);
+
+    // 0 <= x < width && 0 <= y < height; NaN and out-of-range floats convert to INT_MIN
+    __m512i minusOne = _mm512_set1_epi32(-1);
+    lanes &= _mm512_cmpgt_epi32_mask(x, minusOne) & _mm512_cmplt_epi32_mask(x, _mm512_set1_epi32(buffer->width));
+    lanes &= _mm512_cmpgt_epi32_mask(y, minusOne) & _mm512_cmplt_epi32_mask(y, _mm512_set1_epi32(buffer->height));
+    if (lanes == 0)
+    {
+        return;
+    }
+
+    int xs[16], ys[16];
+    _mm512_storeu_si512(xs, x);
+    _mm512_storeu_si512(ys, y);
+    unsigned int mask = lanes;
+    while (mask)
+    {
+        int lane = __builtin_ctz(mask);
+        mask &= mask - 1;
+        MarkOccupiedPixel(buffer, xs[lane], ys[lane]);
+    }
+}
+
+// Estimate of 1 / sqrt(x), good to 14 bits, refined by one Newton-Raphson step to full precision
+static inline __m512 ReciprocalSqrt16(__m512 x)
+{
+    __m512 y = _mm512_rsqrt14_ps(x);
+    __m512 halfXyy = _mm512_mul_ps(_mm512_mul_ps(_mm512_set1_ps(0.5f), x), _mm512_mul_ps(y, y));
+    return _mm512_mul_ps(y, _mm512_sub_ps(_mm512_set1_ps(1.5f), halfXyy));
+}
+
+// Estimate of 1 / x refined the same way, y * (2 - x * y)
+static inline __m512 Reciprocal16(__m512 x)
+{
+    __m512 y = _mm512_rcp14_ps(x);
+    return _mm512_mul_ps(y, _mm512_sub_ps(_mm512_set1_ps(2.0f), _mm512_mul_ps(x, y)));
+}
+
+// Sums the forces of every attractor on sixteen particles while the batch stays in registers
+static inline void AccumulateForces16(__m512 posX, __m512 posY, const IntegrateParams *params, bool fastMath,
+                                      __m512 *forceXOut, __m512 *forceYOut)
+{
+    __m512 forceX = _mm512_setzero_ps();
+    __m512 forceY = _mm512_setzero_ps();
+    for (int k = 0; k < params->attractorCount; k++)
+    {
+        const Attractor *attractor = &params->attractors[k];
+        __m512 diffX = _mm512_sub_ps(_mm512_set1_ps(attractor->position.x), posX);
+        __m512 diffY = _mm512_sub_ps(_mm512_set1_ps(attractor->position.y), posY);
+        __m512 distSq = _mm512_add_ps(_mm512_mul_ps(diffX, diffX), _mm512_mul_ps(diffY, diffY));
+
+        // Lanes sitting on the attractor divide 0 by 0; the exact variant zeroes them, the fast
+        // one never sees a zero distance
+        __m512 normX, normY;
+        if (fastMath)
+        {
+            __m512 inverseDist = ReciprocalSqrt16(_mm512_add_ps(distSq, _mm512_set1_ps(FAST_MATH_SOFTENING_SQ)));
+            normX = _mm512_mul_ps(diffX, inverseDist);
+            normY = _mm512_mul_ps(diffY, inverseDist);
+        }
+        else
+        {
+            __m512 dist = _mm512_sqrt_ps(distSq);
+            __mmask16 apart = _mm512_cmp_ps_mask(distSq, _mm512_setzero_ps(), _CMP_GT_OQ);
+            normX = _mm512_maskz_div_ps(apart, diffX, dist);
+            normY = _mm512_maskz_div_ps(apart, diffY, dist);
+        }
+
+        __m512 scale = _mm512_set1_ps(attractor->strength);
+        if (attractor->falloffRadiusSq > 0.0f)
+        {
+            __m512 radiusSq = _mm512_set1_ps(attractor->falloffRadiusSq);
+            __m512 denominator = _mm512_add_ps(distSq, radiusSq);
+            __m512 falloff = fastMath ? _mm512_mul_ps(radiusSq, Reciprocal16(denominator))
+                                      : _mm512_div_ps(radiusSq, denominator);
+            scale = _mm512_mul_ps(scale, falloff);
+        }
+        forceX = _mm512_add_ps(forceX, _mm512_mul_ps(normX, scale));
+        forceY = _mm512_add_ps(forceY, _mm512_mul_ps(normY, scale));
+    }
+    *forceXOut = forceX;
+    *forceYOut = forceY;
+}
+
+// Integrates the particles i..i+15 selected by lanes; masked-off lanes are neither read nor written
+static inline void Integrate16(const Particles *source, Particles *target, int i, __mmask16 lanes, const IntegrateParams *params,
+                               OccupancyBitmap *splat, bool fastMath)
+{
+    __m512 posX = _mm512_maskz_loadu_ps(lanes, &source->posX[i]);
+    __m512 posY = _mm512_maskz_loadu_ps(lanes, &source->posY[i]);
+    __m512 velX = _mm512_maskz_loadu_ps(lanes, &source->velX[i]);
+    __m512 velY = _mm512_maskz_loadu_ps(lanes, &source->velY[i]);
+
+    __m512 forceX, forceY;
+    AccumulateForces16(posX, posY, params, fastMath, &forceX, &forceY);
+
+    __m512 friction = _mm512_set1_ps(params->friction);
+    velX = _mm512_mul_ps(_mm512_add_ps(velX, forceX), friction);
+    velY = _mm512_mul_ps(_mm512_add_ps(velY, forceY), friction);
+    posX = _mm512_add_ps(posX, velX);
+    posY = _mm512_add_ps(posY, velY);
+
+    _mm512_mask_storeu_ps(&target->posX[i], lanes, posX);
+    _mm512_mask_storeu_ps(&target->posY[i], lanes, posY);
+    _mm512_mask_storeu_ps(&target->velX[i], lanes, velX);
+    _mm512_mask_storeu_ps(&target->velY[i], lanes, velY);
+
+    if (splat)
+    {
+        SplatParticles16(splat, posX, posY, lanes);
+    }
+}
+
+static inline void IntegrateAvx512Range(const Particles *source, Particles *target, int start, int end,
+                                        const IntegrateParams *params, OccupancyBitmap *splat, bool fastMath)
+{
+    int i = start;
+    for (; i + 15 < end; i += 16)
+    {
+        Integrate16(source, target, i, (__mmask16)0xFFFF, params, splat, fastMath);
+    }
+
+    // The tail runs through the same code with the missing lanes masked off
+    if (i < end)
+    {
+        Integrate16(source, target, i, FirstLanes(end - i), params, splat, fastMath);
+    }
+}
+
+static void IntegrateAvx512(const Particles *source, Particles *target, int start, int end, const IntegrateParams *params,
+                            OccupancyBitmap *splat)
+{
+    IntegrateAvx512Range(source, target, start, end, params, splat, false);
+}
+
+static void IntegrateFastAvx512(const Particles *source, Particles *target, int start, int end,
+                                const IntegrateParams *params, OccupancyBitmap *splat)
+{
+    IntegrateAvx512Range(source, target, start, end, params, splat, true);
+}
+
+// Sixteen fixed-point positions expanded to pixels
+static inline __m512 LoadPositions16(const int16_t *values, float origin, float step)
+{
+    __m512i wide = _mm512_cvtepi16_epi32(_mm256_loadu_si256((const __m256i *)values));
+    return _mm512_add_ps(_mm512_set1_ps(origin), _mm512_mul_ps(_mm512_cvtepi32_ps(wide), _mm512_set1_ps(step)));
+}
+
+// Rounds sixteen positions to the nearest fixed-point value, saturating at the ends of the range
+static inline void StorePositions16(int16_t *values, __m512 positions, float origin, float inverseStep)
+{
+    __m512 scaled = _mm512_mul_ps(_mm512_sub_ps(positions, _mm512_set1_ps(origin)), _mm512_set1_ps(inverseStep));
+    _mm256_storeu_si256((__m256i *)values, _mm512_cvtsepi32_epi16(_mm512_cvtps_epi32(scaled)));
+}
+
+static inline void IntegrateCompactAvx512Range(const CompactParticles *source, CompactParticles *target, int start,
+                                               int end, const IntegrateParams *params, OccupancyBitmap *splat,
+                                               bool fastMath)
+{
+    // Masked 16-bit loads and stores need AVX-512BW, so only whole batches run here
+    int i = start;
+    for (; i + 15 < end; i += 16)
+    {
+        __m512 posX = LoadPositions16(&source->posX[i], source->originX, source->step);
+        __m512 posY = LoadPositions16(&source->posY[i], source->originY, source->step);
+        __m512 velX = _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i *)&source->velX[i]));
+        __m512 velY = _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i *)&source->velY[i]));
+
+        __m512 forceX, forceY;
+        AccumulateForces16(posX, posY, params, fastMath, &forceX, &forceY);
+
+        __m512 friction = _mm512_set1_ps(params->friction);
+        velX = _mm512_mul_ps(_mm512_add_ps(velX, forceX), friction);
+        velY = _mm512_mul_ps(_mm512_add_ps(velY, forceY), friction);
+        posX = _mm512_add_ps(posX, velX);
+        posY = _mm512_add_ps(posY, velY);
+
+        StorePositions16(&target->posX[i], posX, target->originX, target->inverseStep);
+        StorePositions16(&target->posY[i], posY, target->originY, target->inverseStep);
+        _mm256_storeu_si256((__m256i *)&target->velX[i], _mm512_cvtps_ph(velX, _MM_FROUND_TO_NEAREST_INT));
+        _mm256_storeu_si256((__m256i *)&target->velY[i], _mm512_cvtps_ph(velY, _MM_FROUND_TO_NEAREST_INT));
+
+        if (splat)
+        {
+            SplatParticles16(splat, posX, posY, (__mmask16)0xFFFF);
+        }
+    }
+
+    // At most 15 particles left
+    CompactIntegrateKernel tail = fastMath ? ScalarKernels.integrateCompactFast : ScalarKernels.integrateCompact;
+    tail(source, target, i, end, params, splat);
+}
+
+static void IntegrateCompactAvx512(const CompactParticles *source, CompactParticles *target, int start, int end,
+                                   const IntegrateParams *params, OccupancyBitmap *splat)
+{
+    IntegrateCompactAvx512Range(source, target, start, end, params, splat, false);
+}
+
+static void IntegrateCompactFastAvx512(const CompactParticles *source, CompactParticles *target, int start, int end,
+                                       const IntegrateParams *params, OccupancyBitmap *splat)
+{
+    IntegrateCompactAvx512Range(source, target, start, end, params, splat, true);
+}
+
+static inline void CombineAvx512Rows(OccupancyBitmap *const *buffers, int bufferCount, Color *pixels, int rowStart,
+                                     int rowEnd, bool stream)
+{
+    const __m512i vTrueColor = _mm512_set1_epi32((int)PackColor(OCCUPIED_COLOR));
+    const __m512i vFalseColor = _mm512_set1_epi32((int)PackColor(EMPTY_COLOR));
+
+    const int width = buffers[0]->width;
+    const int stride = buffers[0]->stride;
+    const int fullWords = width / 32;
+
+    for (int y = rowStart; y < rowEnd; y++)
+    {
+        uint32_t *row = &buffers[0]->words[y * stride];
+        uint32_t *rowPixels = (uint32_t *)&pixels[y * width];
+
+        for (int b = 1; b < bufferCount; b++)
+        {
+            uint32_t *other = &buffers[b]->words[y * stride];
+            int w = 0;
+            for (; w <= stride - 16; w += 16)
+            {
+                __m512i vA = _mm512_loadu_si512(&row[w]);
+                __m512i vB = _mm512_loadu_si512(&other[w]);
+                _mm512_storeu_si512(&row[w], _mm512_or_si512(vA, vB));
+            }
+            if (w < stride)
+            {
+                __mmask16 tail = FirstLanes(stride - w);
+                __m512i vA = _mm512_maskz_loadu_epi32(tail, &row[w]);
+                __m512i vB = _mm512_maskz_loadu_epi32(tail, &other[w]);
+                _mm512_mask_storeu_epi32(&row[w], tail, _mm512_or_si512(vA, vB));
+            }
+            ClearWordsAvx512(other, stride);
+        }
+
+        // Each half of an occupancy word is directly a blend mask for 16 pixels
+        for (int w = 0; w < fullWords; w++)
+        {
+            uint32_t combined = row[w];
+            StorePixels16(&rowPixels[w * 32], _mm512_mask_blend_epi32((__mmask16)combined, vFalseColor, vTrueColor), stream);
+            StorePixels16(&rowPixels[w * 32 + 16], _mm512_mask_blend_epi32((__mmask16)(combined >> 16), vFalseColor, vTrueColor),
+                          stream);
+        }
+
+        int remaining = width - fullWords * 32;
+        if (remaining > 0)
+        {
+            uint32_t combined = row[fullWords];
+            uint32_t *out = &rowPixels[fullWords * 32];
+            int low = remaining < 16 ? remaining : 16;
+            _mm512_mask_storeu_epi32(out, FirstLanes(low), _mm512_mask_blend_epi32((__mmask16)combined, vFalseColor, vTrueColor));
+            if (remaining > 16)
+            {
+                _mm512_mask_storeu_epi32(out + 16, FirstLanes(remaining - 16), _mm512_mask_blend_epi32((__mmask16)(combined >> 16), vFalseColor, vTrueColor));
+            }
+        }
+
+        ClearWordsAvx512(row, stride);
+    }
+    if (stream)
+    {
+        _mm_sfence();
+    }
+}
+
+static void CombineAvx512(OccupancyBitmap *const *buffers, int bufferCount, Color *pixels, int rowStart, int rowEnd)
+{
+    CombineAvx512Rows(buffers, bufferCount, pixels, rowStart, rowEnd, false);
+}
+
+static void CombineStreamAvx512(OccupancyBitmap *const *buffers, int bufferCount, Color *pixels, int rowStart, int rowEnd)
+{
+    CombineAvx512Rows(buffers, bufferCount, pixels, rowStart, rowEnd, true);
+}
+
+static inline void CombineDensityAvx512Rows(OccupancyBitmap *const *buffers, int bufferCount, Color *pixels, int rowStart,
+                                            int rowEnd, const uint32_t *palette, bool stream)
+{
+    const __m512i vEmpty = _mm512_set1_epi32((int)palette[0]);
+    const int width = buffers[0]->width;
+    const int stride = buffers[0]->countStride;
+
+    for (int y = rowStart; y < rowEnd; y++)
+    {
+        uint32_t *out = (uint32_t *)&pixels[y * width];
+
+        // One pass per 32 pixels: the counters of every bitmap are summed with saturation in a
+        // register and cleared, then shaded. Byte arithmetic needs AVX-512BW, so the sums use the
+        // AVX2 subset of AVX-512F. Rows are padded to 64 bytes, so loads need no tail.
+        for (int x = 0; x < width; x += 32)
+        {
+            __m256i vSum = _mm256_setzero_si256();
+            for (int b = 0; b < bufferCount; b++)
+            {
+                __m256i *counts = (__m256i *)&buffers[b]->counts[y * stride + x];
+                vSum = _mm256_adds_epu8(vSum, _mm256_loadu_si256(counts));
+                _mm256_storeu_si256(counts, _mm256_setzero_si256());
+            }
+
+            __m128i halves[2] = {_mm256_castsi256_si128(vSum), _mm256_extracti128_si256(vSum, 1)};
+            for (int k = 0; k < 2 && x + 16 * k < width; k++)
+            {
+                int pixelCount = width - x - 16 * k;
+                __mmask16 lanes = pixelCount < 16 ? FirstLanes(pixelCount) : (__mmask16)0xFFFF;
+
+                // Most of a frame is background, written without a gather
+                __m512i colors = vEmpty;
+                if (!_mm_testz_si128(halves[k], halves[k]))
+                {
+                    colors = _mm512_i32gather_epi32(_mm512_cvtepu8_epi32(halves[k]), palette, 4);
+                }
+                if (pixelCount < 16)
+                {
+                    _mm512_mask_storeu_epi32(&out[x + 16 * k], lanes, colors);
+                }
+                else
+                {
+                    StorePixels16(&out[x + 16 * k], colors, stream);
+                }
+            }
+        }
+    }
+    if (stream)
+    {
+        _mm_sfence();
+    }
+}
+
+static void CombineDensityAvx512(OccupancyBitmap *const *buffers, int bufferCount, Color *pixels, int rowStart, int rowEnd,
+                                 const uint32_t *palette)
+{
+    CombineDensityAvx512Rows(buffers, bufferCount, pixels, rowStart, rowEnd, palette, false);
+}
+
+static void CombineDensityStreamAvx512(OccupancyBitmap *const *buffers, int bufferCount, Color *pixels, int rowStart,
+                                       int rowEnd, const uint32_t *palette)
+{
+    CombineDensityAvx512Rows(buffers, bufferCount, pixels, rowStart, rowEnd, palette, true);
+}
+
+static inline void FillAvx512Pixels(Color *pixels, int count, Color color, bool stream)
+{
+    const __m512i packedColors = _mm512_set1_epi32((int)PackColor(color));
+    uint32_t *out = (uint32_t *)pixels;
+
+    int i = 0;
+    for (; i <= count - 16; i += 16)
+    {
+        StorePixels16(&out[i], packedColors, stream);
+    }
+    if (i < count)
+    {
+        _mm512_mask_storeu_epi32(&out[i], FirstLanes(count - i), packedColors);
+    }
+    if (stream)
+    {
+        _mm_sfence();
+    }
+}
+
+static void FillAvx512(Color *pixels, int count, Color color)
+{
+    FillAvx512Pixels(pixels, count, color, false);
+}
+
+static void FillStreamAvx512(Color *pixels, int count, Color color)
+{
+    FillAvx512Pixels(pixels, count, color, true);
+}
+
+/* ========================================================================= */
+/*                            Kernel table                                   */
+/* ========================================================================= */
+const ParticleKernels Avx512Kernels = {
+    .name = "AVX-512",
+    .level = SIMD_AVX512,
+    .integrate = IntegrateAvx512,
+    .integrateFast = IntegrateFastAvx512,
+    .integrateCompact = IntegrateCompactAvx512,
+    .integrateCompactFast = IntegrateCompactFastAvx512,
+    .combine = CombineAvx512,
+    .combineStream = CombineStreamAvx512,
+    .combineDensity = CombineDensityAvx512,
+    .combineDensityStream = CombineDensityStreamAvx512,
+    .fill = FillAvx512,
+    .fillStream = FillStreamAvx512,
+};
@@ -0,0 +1,220 @@
+#include "kernels.h"
+
+#include <math.h>
+#include <string.h>
+
+/* ========================================================================= */
+/*                            Private functions                              */
+/* ========================================================================= */
+// Sum of the forces of every attractor on a particle at (posX, posY)
+static inline void AccumulateForces(float posX, float posY, const IntegrateParams *params, bool fastMath, float *forceX,
+                                    float *forceY)
+{
+    *forceX = 0.0f;
+    *forceY = 0.0f;
+    for (int k = 0; k < params->attractorCount; k++)
+    {
+        const Attractor *attractor = &params->attractors[k];
+        float diffX = attractor->position.x - posX;
+        float diffY = attractor->position.y - posY;
+        float distSq = diffX * diffX + diffY * diffY;
+
+        // Plain C has no estimate instructions, the fast variant only softens the distance
+        float normX, normY;
+        if (fastMath)
+        {
+            float inverseDist = 1.0f / sqrtf(distSq + FAST_MATH_SOFTENING_SQ);
+            normX = diffX * inverseDist;
+            normY = diffY * inverseDist;
+        }
+        else if (distSq > 0.0f)
+        {
+            float dist = sqrtf(distSq);
+            normX = diffX / dist;
+            normY = diffY / dist;
+        }
+        else
+        {
+            continue; // On the attractor, no direction to pull in
+        }
+
+        float scale = attractor->strength;
+        if (attractor->falloffRadiusSq > 0.0f)
+        {
+            scale *= attractor->falloffRadiusSq / (distSq + attractor->falloffRadiusSq);
+        }
+        *forceX += normX * scale;
+        *forceY += normY * scale;
+    }
+}
+
+static inline void SplatParticle(OccupancyBitmap *splat, float posX, float posY)
+{
+    int x = (int)posX;
+    int y = (int)posY;
+    if (x >= 0 && x < splat->width && y >= 0 && y < splat->height)
+    {
+        MarkOccupiedPixel(splat, x, y);
+    }
+}
+
+static inline void IntegrateScalarRange(const Particles *source, Particles *target, int start, int end,
+                                        const IntegrateParams *params, OccupancyBitmap *splat, bool fastMath)
+{
+    for (int i = start; i < end; i++)
+    {
+        float posX = source->posX[i];
+        float posY = source->posY[i];
+
+        float forceX, forceY;
+        AccumulateForces(posX, posY, params, fastMath, &forceX, &forceY);
+
+        float velX = (source->velX[i] + forceX) * params->friction;
+        float velY = (source->velY[i] + forceY) * params->friction;
+        posX += velX;
+        posY += velY;
+
+        target->posX[i] = posX;
+        target->posY[i] = posY;
+        target->velX[i] = velX;
+        target->velY[i] = velY;
+
+        if (splat)
+        {
+            SplatParticle(splat, posX, posY);
+        }
+    }
+}
+
+static inline void IntegrateCompactScalarRange(const CompactParticles *source, CompactParticles *target, int start, int end,
+                                               const IntegrateParams *params, OccupancyBitmap *splat, bool fastMath)
+{
+    for (int i = start; i < end; i++)
+    {
+        float posX = DequantizePosition(source->posX[i], source->originX, source->step);
+        float posY = DequantizePosition(source->posY[i], source->originY, source->step);
+
+        float forceX, forceY;
+        AccumulateForces(posX, posY, params, fastMath, &forceX, &forceY);
+
+        float velX = (HalfToFloat(source->velX[i]) + forceX) * params->friction;
+        float velY = (HalfToFloat(source->velY[i]) + forceY) * params->friction;
+        posX += velX;
+        posY += velY;
+
+        target->posX[i] = QuantizePosition(posX, target->originX, target->inverseStep);
+        target->posY[i] = QuantizePosition(posY, target->originY, target->inverseStep);
+        target->velX[i] = FloatToHalf(velX);
+        target->velY[i] = FloatToHalf(velY);
+
+        if (splat)
+        {
+            SplatParticle(splat, posX, posY);
+        }
+    }
+}
+
+static void IntegrateScalar(const Particles *source, Particles *target, int start, int end, const IntegrateParams *params,
+                            OccupancyBitmap *splat)
+{
+    IntegrateScalarRange(source, target, start, end, params, splat, false);
+}
+
+static void IntegrateFastScalar(const Particles *source, Particles *target, int start, int end,
+                                const IntegrateParams *params, OccupancyBitmap *splat)
+{
+    IntegrateScalarRange(source, target, start, end, params, splat, true);
+}
+
+static void IntegrateCompactScalar(const CompactParticles *source, CompactParticles *target, int start, int end,
+                                   const IntegrateParams *params, OccupancyBitmap *splat)
+{
+    IntegrateCompactScalarRange(source, target, start, end, params, splat, false);
+}
+
+static void IntegrateCompactFastScalar(const CompactParticles *source, CompactParticles *target, int start, int end,
+                                       const IntegrateParams *params, OccupancyBitmap *splat)
+{
+    IntegrateCompactScalarRange(source, target, start, end, params, splat, true);
+}
+
+static void CombineScalar(OccupancyBitmap *const *buffers, int bufferCount, Color *pixels, int rowStart, int rowEnd)
+{
+    const uint32_t occupied = PackColor(OCCUPIED_COLOR);
+    const uint32_t empty = PackColor(EMPTY_COLOR);
+    const int width = buffers[0]->width;
+    const int stride = buffers[0]->stride;
+
+    for (int y = rowStart; y < rowEnd; y++)
+    {
+        uint32_t *row = &buffers[0]->words[y * stride];
+        for (int b = 1; b < bufferCount; b++)
+        {
+            uint32_t *other = &buffers[b]->words[y * stride];
+            for (int w = 0; w < stride; w++)
+            {
+                row[w] |= other[w];
+            }
+            memset(other, 0, stride * sizeof(uint32_t));
+        }
+
+        uint32_t *out = (uint32_t *)&pixels[y * width];
+        for (int x = 0; x < width; x++)
+        {
+            out[x] = (row[x >> 5] >> (x & 31)) & 1u ? occupied : empty;
+        }
+        memset(row, 0, stride * sizeof(uint32_t));
+    }
+}
+
+static void CombineDensityScalar(OccupancyBitmap *const *buffers, int bufferCount, Color *pixels, int rowStart, int rowEnd,
+                                 const uint32_t *palette)
+{
+    const int width = buffers[0]->width;
+    const int stride = buffers[0]->countStride;
+
+    for (int y = rowStart; y < rowEnd; y++)
+    {
+        uint32_t *out = (uint32_t *)&pixels[y * width];
+        for (int x = 0; x < width; x++)
+        {
+            // Sum the counters of every bitmap, clearing them for the next frame
+            int sum = 0;
+            for (int b = 0; b < bufferCount; b++)
+            {
+                uint8_t *count = &buffers[b]->counts[y * stride + x];
+                sum += *count;
+                *count = 0;
+            }
+            out[x] = palette[sum < DENSITY_LEVELS ? sum : DENSITY_LEVELS - 1];
+        }
+    }
+}
+
+static void FillScalar(Color *pixels, int count, Color color)
+{
+    const uint32_t packed = PackColor(color);
+    uint32_t *out = (uint32_t *)pixels;
+    for (int i = 0; i < count; i++)
+    {
+        out[i] = packed;
+    }
+}
+
+/* ========================================================================= */
+/*                            Kernel table                                   */
+/* ========================================================================= */
+const ParticleKernels ScalarKernels = {
+    .name = "scalar",
+    .level = SIMD_SCALAR,
+    .integrate = IntegrateScalar,
+    .integrateFast = IntegrateFastScalar,
+    .integrateCompact = IntegrateCompactScalar,
+    .integrateCompactFast = IntegrateCompactFastScalar,
+    .combine = CombineScalar,
+    .combineStream = CombineScalar, // No streaming stores in portable code
+    .combineDensity = CombineDensityScalar,
+    .combineDensityStream = CombineDensityScalar,
+    .fill = FillScalar,
+    .fillStream = FillScalar,
+};
@@ -0,0 +1,357 @@
+#include "kernels.h"
+
+#include <smmintrin.h>
+
+/* ========================================================================= */
+/*                            Private functions                              */
+/* ========================================================================= */
+// Streaming stores bypass the caches, for mapped GPU memory that is never read back; they need aligned addresses
+static inline void StorePixels4(void *out, __m128i pixels, bool stream)
+{
+    if (stream && ((uintptr_t)out & 15) == 0)
+    {
+        _mm_stream_si128((__m128i *)out, pixels);
+    }
+    else
+    {
+        _mm_storeu_si128((__m128i *)out, pixels);
+    }
+}
+
+static inline void ClearWordsSse41(uint32_t *words, int count)
+{
+    int i = 0;
+    for (; i <= count - 4; i += 4)
+    {
+        _mm_storeu_si128((__m128i *)&words[i], _mm_setzero_si128());
+    }
+    for (; i < count; i++)
+    {
+        words[i] = 0;
+    }
+}
+
+static inline void SplatParticles4(OccupancyBitmap *buffer, __m128 posX, __m128 posY)
+{
+    __m128i x = _mm_cvttps_epi32(posX);
+    __m128i y = _mm_cvttps_epi32(posY);
+
+    // 0 <= x < width && 0 <= y < height; NaN and out-of-range floats convert to INT_MIN
+    __m128i minusOne = _mm_set1_epi32(-1);
+    __m128i inside = _mm_and_si128(
+        _mm_and_si128(_mm_cmpgt_epi32(x, minusOne), _mm_cmplt_epi32(x, _mm_set1_epi32(buffer->width))),
+        _mm_and_si128(_mm_cmpgt_epi32(y, minusOne), _mm_cmplt_epi32(y, _mm_set1_epi32(buffer->height))));
+    int mask = _mm_movemask_ps(_mm_castsi128_ps(inside));
+
+    int xs[4], ys[4];
+    _mm_storeu_si128((__m128i *)xs, x);
+    _mm_storeu_si128((__m128i *)ys, y);
+    while (mask)
+    {
+        int lane = __builtin_ctz(mask);
+        mask &= mask - 1;
+        MarkOccupiedPixel(buffer, xs[lane], ys[lane]);
+    }
+}
+
+// Estimate of 1 / sqrt(x), good to 12 bits, refined by one Newton-Raphson step to about 23
+static inline __m128 ReciprocalSqrt4(__m128 x)
+{
+    __m128 y = _mm_rsqrt_ps(x);
+    __m128 halfXyy = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), x), _mm_mul_ps(y, y));
+    return _mm_mul_ps(y, _mm_sub_ps(_mm_set1_ps(1.5f), halfXyy));
+}
+
+// Estimate of 1 / x refined the same way, y * (2 - x * y)
+static inline __m128 Reciprocal4(__m128 x)
+{
+    __m128 y = _mm_rcp_ps(x);
+    return _mm_mul_ps(y, _mm_sub_ps(_mm_set1_ps(2.0f), _mm_mul_ps(x, y)));
+}
+
+static inline void IntegrateSse41Range(const Particles *source, Particles *target, int start, int end,
+                                       const IntegrateParams *params, OccupancyBitmap *splat, bool fastMath)
+{
+    const __m128 friction = _mm_set1_ps(params->friction);
+    const __m128 softening = _mm_set1_ps(FAST_MATH_SOFTENING_SQ);
+
+    int i = start;
+    for (; i + 3 < end; i += 4)
+    {
+        __m128 posX = _mm_loadu_ps(&source->posX[i]);
+        __m128 posY = _mm_loadu_ps(&source->posY[i]);
+        __m128 velX = _mm_loadu_ps(&source->velX[i]);
+        __m128 velY = _mm_loadu_ps(&source->velY[i]);
+
+        __m128 forceX = _mm_setzero_ps();
+        __m128 forceY = _mm_setzero_ps();
+        for (int k = 0; k < params->attractorCount; k++)
+        {
+            const Attractor *attractor = &params->attractors[k];
+            __m128 diffX = _mm_sub_ps(_mm_set1_ps(attractor->position.x), posX);
+            __m128 diffY = _mm_sub_ps(_mm_set1_ps(attractor->position.y), posY);
+            __m128 distSq = _mm_add_ps(_mm_mul_ps(diffX, diffX), _mm_mul_ps(diffY, diffY));
+
+            // Lanes sitting on the attractor divide 0 by 0; the exact variant masks them out,
+            // the fast one never sees a zero distance
+            __m128 normX, normY;
+            if (fastMath)
+            {
+                __m128 inverseDist = ReciprocalSqrt4(_mm_add_ps(distSq, softening));
+                normX = _mm_mul_ps(diffX, inverseDist);
+                normY = _mm_mul_ps(diffY, inverseDist);
+            }
+            else
+            {
+                __m128 dist = _mm_sqrt_ps(distSq);
+                __m128 apart = _mm_cmpgt_ps(distSq, _mm_setzero_ps());
+                normX = _mm_and_ps(_mm_div_ps(diffX, dist), apart);
+                normY = _mm_and_ps(_mm_div_ps(diffY, dist), apart);
+            }
+
+            __m128 scale = _mm_set1_ps(attractor->strength);
+            if (attractor->falloffRadiusSq > 0.0f)
+            {
+                __m128 radiusSq = _mm_set1_ps(attractor->falloffRadiusSq);
+                __m128 denominator = _mm_add_ps(distSq, radiusSq);
+                __m128 falloff = fastMath ? _mm_mul_ps(radiusSq, Reciprocal4(denominator))
+                                          : _mm_div_ps(radiusSq, denominator);
+                scale = _mm_mul_ps(scale, falloff);
+            }
+            forceX = _mm_add_ps(forceX, _mm_mul_ps(normX, scale));
+            forceY = _mm_add_ps(forceY, _mm_mul_ps(normY, scale));
+        }
+
+        velX = _mm_mul_ps(_mm_add_ps(velX, forceX), friction);
+        velY = _mm_mul_ps(_mm_add_ps(velY, forceY), friction);
+        posX = _mm_add_ps(posX, velX);
+        posY = _mm_add_ps(posY, velY);
+
+        _mm_storeu_ps(&target->posX[i], posX);
+        _mm_storeu_ps(&target->posY[i], posY);
+        _mm_storeu_ps(&target->velX[i], velX);
+        _mm_storeu_ps(&target->velY[i], velY);
+
+        if (splat)
+        {
+            SplatParticles4(splat, posX, posY);
+        }
+    }
+
+    // At most 3 particles left
+    IntegrateKernel tail = fastMath ? ScalarKernels.integrateFast : ScalarKernels.integrate;
+    tail(source, target, i, end, params, splat);
+}
+
+static void IntegrateSse41(const Particles *source, Particles *target, int start, int end, const IntegrateParams *params,
+                           OccupancyBitmap *splat)
+{
+    IntegrateSse41Range(source, target, start, end, params, splat, false);
+}
+
+static void IntegrateFastSse41(const Particles *source, Particles *target, int start, int end,
+                               const IntegrateParams *params, OccupancyBitmap *splat)
+{
+    IntegrateSse41Range(source, target, start, end, params, splat, true);
+}
+
+// F16C needs AVX, so the compact kernels of this level convert in plain C
+static void IntegrateCompactSse41(const CompactParticles *source, CompactParticles *target, int start, int end,
+                                  const IntegrateParams *params, OccupancyBitmap *splat)
+{
+    ScalarKernels.integrateCompact(source, target, start, end, params, splat);
+}
+
+static void IntegrateCompactFastSse41(const CompactParticles *source, CompactParticles *target, int start, int end,
+                                      const IntegrateParams *params, OccupancyBitmap *splat)
+{
+    ScalarKernels.integrateCompactFast(source, target, start, end, params, splat);
+}
+
+static inline void CombineSse41Rows(OccupancyBitmap *const *buffers, int bufferCount, Color *pixels, int rowStart, int rowEnd,
+                                    bool stream)
+{
+    const uint32_t packedTrueColor = PackColor(OCCUPIED_COLOR);
+    const uint32_t packedFalseColor = PackColor(EMPTY_COLOR);
+    const __m128i vTrueColor = _mm_set1_epi32((int)packedTrueColor);
+    const __m128i vFalseColor = _mm_set1_epi32((int)packedFalseColor);
+
+    // Lane i tests bit i of the broadcast nibble
+    const __m128i vLaneBits = _mm_setr_epi32(1, 2, 4, 8);
+
+    const int width = buffers[0]->width;
+    const int stride = buffers[0]->stride;
+    const int fullWords = width / 32;
+
+    for (int y = rowStart; y < rowEnd; y++)
+    {
+        uint32_t *row = &buffers[0]->words[y * stride];
+        Color *rowPixels = &pixels[y * width];
+
+        for (int b = 1; b < bufferCount; b++)
+        {
+            uint32_t *other = &buffers[b]->words[y * stride];
+            int w = 0;
+            for (; w <= stride - 4; w += 4)
+            {
+                __m128i vA = _mm_loadu_si128((const __m128i *)&row[w]);
+                __m128i vB = _mm_loadu_si128((const __m128i *)&other[w]);
+                _mm_storeu_si128((__m128i *)&row[w], _mm_or_si128(vA, vB));
+            }
+            for (; w < stride; w++)
+            {
+                row[w] |= other[w];
+            }
+            ClearWordsSse41(other, stride);
+        }
+
+        for (int w = 0; w < fullWords; w++)
+        {
+            uint32_t combined = row[w];
+            Color *out = &rowPixels[w * 32];
+
+            // Expand each nibble of the word into 4 pixels
+            for (int k = 0; k < 8; k++)
+            {
+                __m128i vBits = _mm_set1_epi32((int)(combined >> (4 * k)));
+                __m128i mask = _mm_cmpeq_epi32(_mm_and_si128(vBits, vLaneBits), vLaneBits);
+                StorePixels4(&out[4 * k], _mm_blendv_epi8(vFalseColor, vTrueColor, mask), stream);
+            }
+        }
+
+        if (fullWords * 32 < width)
+        {
+            uint32_t combined = row[fullWords];
+            uint32_t *out = (uint32_t *)rowPixels;
+            for (int x = fullWords * 32; x < width; x++)
+            {
+                out[x] = (combined >> (x & 31)) & 1u ? packedTrueColor : packedFalseColor;
+            }
+        }
+
+        ClearWordsSse41(row, stride);
+    }
+    if (stream)
+    {
+        _mm_sfence();
+    }
+}
+
+static void CombineSse41(OccupancyBitmap *const *buffers, int bufferCount, Color *pixels, int rowStart, int rowEnd)
+{
+    CombineSse41Rows(buffers, bufferCount, pixels, rowStart, rowEnd, false);
+}
+
+static void CombineStreamSse41(OccupancyBitmap *const *buffers, int bufferCount, Color *pixels, int rowStart, int rowEnd)
+{
+    CombineSse41Rows(buffers, bufferCount, pixels, rowStart, rowEnd, true);
+}
+
+static inline void CombineDensitySse41Rows(OccupancyBitmap *const *buffers, int bufferCount, Color *pixels, int rowStart,
+                                           int rowEnd, const uint32_t *palette, bool stream)
+{
+    const __m128i vEmpty = _mm_set1_epi32((int)palette[0]);
+    const int width = buffers[0]->width;
+    const int stride = buffers[0]->countStride;
+
+    for (int y = rowStart; y < rowEnd; y++)
+    {
+        uint32_t *out = (uint32_t *)&pixels[y * width];
+
+        // One pass per 16 pixels: the counters of every bitmap are summed with saturation in a
+        // register and cleared, then shaded. Rows are padded to 64 bytes, so loads need no tail.
+        for (int x = 0; x < width; x += 16)
+        {
+            __m128i vSum = _mm_setzero_si128();
+            for (int b = 0; b < bufferCount; b++)
+            {
+                __m128i *counts = (__m128i *)&buffers[b]->counts[y * stride + x];
+                vSum = _mm_adds_epu8(vSum, _mm_loadu_si128(counts));
+                _mm_storeu_si128(counts, _mm_setzero_si128());
+            }
+
+            int pixelCount = width - x < 16 ? width - x : 16;
+            if (pixelCount == 16 && _mm_testz_si128(vSum, vSum))
+            {
+                // Most of a frame is background, written without a lookup
+                for (int k = 0; k < 4; k++)
+                {
+                    StorePixels4(&out[x + 4 * k], vEmpty, stream);
+                }
+                continue;
+            }
+
+            uint8_t sums[16];
+            _mm_storeu_si128((__m128i *)sums, vSum);
+            for (int k = 0; k < pixelCount; k++)
+            {
+                out[x + k] = palette[sums[k]];
+            }
+        }
+    }
+    if (stream)
+    {
+        _mm_sfence();
+    }
+}
+
+static void CombineDensitySse41(OccupancyBitmap *const *buffers, int bufferCount, Color *pixels, int rowStart, int rowEnd,
+                                const uint32_t *palette)
+{
+    CombineDensitySse41Rows(buffers, bufferCount, pixels, rowStart, rowEnd, palette, false);
+}
+
+static void CombineDensityStreamSse41(OccupancyBitmap *const *buffers, int bufferCount, Color *pixels, int rowStart,
+                                      int rowEnd, const uint32_t *palette)
+{
+    CombineDensitySse41Rows(buffers, bufferCount, pixels, rowStart, rowEnd, palette, true);
+}
+
+static inline void FillSse41Pixels(Color *pixels, int count, Color color, bool stream)
+{
+    const uint32_t packed = PackColor(color);
+    const __m128i packedColors = _mm_set1_epi32((int)packed);
+    uint32_t *out = (uint32_t *)pixels;
+
+    int i = 0;
+    for (; i <= count - 4; i += 4)
+    {
+        StorePixels4(&out[i], packedColors, stream);
+    }
+    for (; i < count; i++)
+    {
+        out[i] = packed;
+    }
+    if (stream)
+    {
+        _mm_sfence();
+    }
+}
+
+static void FillSse41(Color *pixels, int count, Color color)
+{
+    FillSse41Pixels(pixels, count, color, false);
+}
+
+static void FillStreamSse41(Color *pixels, int count, Color color)
+{
+    FillSse41Pixels(pixels, count, color, true);
+}
+
+/* ========================================================================= */
+/*                            Kernel table                                   */
+/* ========================================================================= */
+const ParticleKernels Sse41Kernels = {
+    .name = "SSE4.1",
+    .level = SIMD_SSE41,
+    .integrate = IntegrateSse41,
+    .integrateFast = IntegrateFastSse41,
+    .integrateCompact = IntegrateCompactSse41,
+    .integrateCompactFast = IntegrateCompactFastSse41,
+    .combine = CombineSse41,
+    .combineStream = CombineStreamSse41,
+    .combineDensity = CombineDensitySse41,
+    .combineDensityStream = CombineDensityStreamSse41,
+    .fill = FillSse41,
+    .fillStream = FillStreamSse41,
+};
@@ -6,595 +6,1900 @@
 /*                             Header Includes                               */
 /* ========================================================================= */
 #include "raylib.h"
-#define Rectangle _Rectangle
-#define CloseWindow _CloseWindow
-#define ShowCursor _ShowCursor
-#define DrawText _DrawText
-#include <windows.h>
-#undef Rectangle
-#undef CloseWindow
-#undef ShowCursor
-#undef DrawText
-// workaround for naming conflicts
-
-#include <immintrin.h>
+#include "threadpool.h" // Keeps the platform thread headers out of this file, they clash with raylib
+#include "config.h"
+#include "particles.h"
+#include "gpu_particles.h"
+#include "frame_timing.h"
+#include "profiler.h"
+#include "occupancy.h"
+#include "kernels.h"
+#include "force_field.h"
+#include "spatial_grid.h"
+#include "snapshot.h"
+#include "frame_export.h"
+#include "emitters.h"
+#include "particle_sort.h"
+#include "pixel_buffers.h"
+#include "display.h"
+#include "quality_governor.h"
+#include "input_replay.h"
+#include "audio_player.h"
+#include "cluster.h"
+
 #include <assert.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 /* ========================================================================= */
 /*                            Defines                                        */
 /* ========================================================================= */
-#define PARTICLE_COUNT 8000 // 360000 // 720000 // 1440000 // 2880000 // 5760000 // 4953600
-#define MAX_THREADS 12
 #define TARGET_FPS 160
-#define ATTRACTION_STRENGHT 0.2000f // 0.2000f
-#define FRICTION 0.999f // 0.999f
-#define SCREEN_WIDTH 3440
-#define SCREEN_HEIGHT 1440
+#define SNAPSHOT_SAVE_KEY KEY_F5
+#define PARTICLE_CHUNK_SIZE 2048 // Particles per work-stealing chunk: 4 arrays x 8 KB, about one L1d
 
 /* ========================================================================= */
 /*                            Global Variables                               */
 /* ========================================================================= */
-//
-static TP_CALLBACK_ENVIRON CallBackEnviron;
-
-typedef struct Particles
+typedef struct DirtyBands
 {
-    float *posX;
-    float *posY;
-    float *velX;
-    float *velY;
-    int count;
-} Particles;
+    uint8_t *painted; // Non-zero if the band holds occupied pixels on the texture
+    int *list;        // Bands to clear, recolour and upload this frame
+    int listCount;    // Number of entries in list
+    int bandCount;    // Number of bands covering the screen
+} DirtyBands;
 
 typedef struct UpdateContext
 {
-    BOOL *buffer;         // Pointer to the boolean buffer
-    Particles *particles; // Pointer to the particle data
-    int start;            // Start index of particles for this update
-    int end;              // End index of particles for this update
-    int bufferWidth;      // Width of the buffer (to calculate positions)
-    int bufferHeight;     // Height of the buffer
+    OccupancyBitmap *buffer; // Pointer to the occupancy bitmap
+    Particles *particles;    // Pointer to the particle data
+    int start;               // Start index of particles for this update
+    int end;                 // End index of particles for this update
 } UpdateContext;
 
+typedef struct CombineContext
+{
+    OccupancyBitmap *buffers; // Per-thread bitmaps, merged and cleared by this context
+    int bufferCount;          // Number of per-thread bitmaps
+    Color *pixels;            // Destination pixel buffer (width * height)
+    bool stream;              // Write pixels with the streaming kernels, pixels is mapped GPU memory
+    const DirtyBands *dirty;  // Bands to process this frame
+    int listStart;            // First entry of dirty->list owned by this context
+    int listEnd;              // One past the last entry owned by this context
+    const ParticleKernels *kernels; // Conversion and fill kernels
+    const uint32_t *palette;  // Tone-mapping palette of the density mode, NULL for occupancy
+} CombineContext;
+
 typedef struct
 {
-    int start;
-    int end;
-    Particles *particles;
-    Vector2 mousePos;
+    const Particles *source;        // State the step starts from
+    Particles *target;              // State the step writes, the same as source when updating in place
+    IntegrateParams params;         // Attractors, updated every frame, and force constants
+    IntegrateKernel integrate;      // Exact or fast integration kernel of the selected instruction set
+    OccupancyBitmap *buffers;       // Per-worker bitmaps to splat into, NULL when rasterizing separately
+    const CompactParticles *compactSource; // Compact storage replaces source, target and integrate
+    CompactParticles *compactTarget;
+    CompactIntegrateKernel integrateCompact; // NULL unless the storage is compact
 } ThreadArgs;
 
+typedef struct ParticleInitContext
+{
+    Particles *particles; // Particles to initialize
+    CompactParticles *compact; // Initialized instead of particles when not NULL
+    int start;            // First particle of the slice
+    int end;              // One past the last particle of the slice
+    int shardStart;       // Index of particle 0 in the whole scene, non-zero on a cluster node
+    int screenWidth;      // Dimensions the initial placement is based on
+    int screenHeight;
+} ParticleInitContext;
+
+typedef struct ParticleUpdatePhase
+{
+    ThreadArgs args;                 // Shared by every chunk of the particle range
+    OccupancyBitmap *splatBuffers;   // Bitmaps a shown step splats into when fused, NULL otherwise
+    SimpleThreadPoolRangePhase phase; // Descriptor submitted to the pool every frame
+} ParticleUpdatePhase;
+
+typedef struct AttractorInput
+{
+    bool scripted;               // Benchmark and export runs follow the scripted path
+    const DisplayLayout *layout; // Maps the pointer to grid pixels
+    const InputReplay *replay;   // Recording replayed instead of the pointer or the script, or NULL
+    InputRecorder *recorder;     // Recording the position of every step is appended to, or NULL
+    Vector2 pointerFrom;         // Pointer on the grid at the previous frame
+    Vector2 pointerTo;           // Pointer on the grid at the current frame
+} AttractorInput;
+
+typedef struct RasterizePhase
+{
+    UpdateContext contexts[MAX_THREADS]; // One particle slice and one private bitmap per job
+    SimpleThreadPoolPhase phase;
+} RasterizePhase;
+
+typedef struct CombinePhase
+{
+    CombineContext contexts[MAX_THREADS]; // One share of this frame's dirty bands per job
+    int maxJobs;                          // Upper bound for the number of jobs per frame
+    SimpleThreadPoolPhase phase;
+} CombinePhase;
+
 /* ========================================================================= */
 /*                           Function Prototypes                             */
 /* ========================================================================= */
 
 /**
- * @brief Creates a new set of particles with the specified count and screen dimensions.
+ * @brief Prepares the reusable particle update phase.
+ *
+ * Cuts the whole particle range into PARTICLE_CHUNK_SIZE chunks balanced by work stealing, and
+ * fills in the phase descriptor once so that nothing has to be allocated or created per frame.
+ *
+ * @param update A pointer to the ParticleUpdatePhase to initialize.
+ * @param particles A pointer to the Particles structure the jobs will update.
+ * @param compact The compact particles the jobs update instead, with the compact kernels, or NULL.
+ * @param config The simulation config providing the force constants and the kernel variant.
+ * @param buffers One occupancy bitmap per pool worker to splat the new positions into, or NULL
+ *                to leave rasterization to the separate rasterization phase.
+ * @param kernels The kernel table selected at startup.
+ */
+void InitParticleUpdatePhase(ParticleUpdatePhase *update, Particles *particles, CompactParticles *compact,
+                             const SimulationConfig *config, OccupancyBitmap *buffers, const ParticleKernels *kernels);
+
+/**
+ * @brief Writes the initial particle state from the workers that will update it.
+ *
+ * Runs one pinned job per worker over its home run of the update phase, so every page of the
+ * run is first touched, and therefore placed on the NUMA node of, the worker that integrates
+ * it every frame unless another worker steals the chunk.
  *
- * @param count The number of particles to create.
+ * @param pool The thread pool running the jobs.
+ * @param particles The particles allocated with AllocateParticles().
+ * @param compact The compact particles allocated with AllocateCompactParticles() to initialize instead, or NULL.
+ * @param update The particle update phase prepared by InitParticleUpdatePhase().
+ * @param shardStart The index of the first particle in the whole scene, 0 unless the particles
+ *                   are one shard of a cluster. Only full storage supports shards.
  * @param screenWidth The width of the screen to place the particles on.
  * @param screenHeight The height of the screen to place the particles on.
+ */
+void FirstTouchParticles(SimpleThreadPool *pool, Particles *particles, CompactParticles *compact,
+                         const ParticleUpdatePhase *update, int shardStart, int screenWidth, int screenHeight);
+
+/**
+ * @brief Callback function for initializing one slice of the particles.
  *
- * @return A Particles structure containing the particle positions and velocities.
+ * @param Context A pointer to a ParticleInitContext describing the slice.
+ * @param WorkerIndex Unused. Index of the pool worker running the job.
  */
-Particles CreateParticles(int count, int screenWidth, int screenHeight);
+void InitializeParticlesWorkCallback(void *Context, int WorkerIndex);
 
 /**
  * @brief Updates the positions and velocities of the particles in a multithreaded environment.
  *
- * This function updates the positions and velocities of the particles in a multithreaded environment
- * using the Windows Thread Pool API. It creates a thread pool with a maximum number of threads
- * and divides the work of updating the particles among the threads. Each thread updates a subset
- * of the particles based on their current positions, velocities, and the influence of an external force
- * (e.g., attraction to a point, simulated by mouse position). The calculations include computing the
- * distance to the attraction point, applying an attraction force, and adjusting for friction.
+ * This function updates the positions and velocities of the particles on the persistent worker
+ * threads of the pool. Each job of the phase updates a subset of the particles based on their
+ * current positions, velocities, and the influence of external forces (e.g., attraction to a
+ * point, simulated by mouse position, plus any configured attractors and repulsors). The
+ * calculations include computing the distance to every attraction point, applying the
+ * attraction forces, and adjusting for friction. The function returns once every job of the
+ * phase has finished.
+ *
+ * @param pool The thread pool running the jobs.
+ * @param update The particle update phase prepared by InitParticleUpdatePhase().
+ * @param field The attractors of this step; must not change until the function returns.
+ * @param splat false for a step whose positions are not drawn, when a frame catches up several
+ *              steps, so that only the last one of the frame lands in the fused bitmaps.
+ */
+void UpdateParticlesMultithreaded(SimpleThreadPool *pool, ParticleUpdatePhase *update, const ForceField *field, bool splat);
+
+/**
+ * @brief Starts integrating one step from source into target and returns immediately.
  *
- * @param particles A pointer to the Particles structure containing the particle positions.
- * @param mousePos The current position of the mouse, used to simulate an external force.
+ * The step runs on the pool while the caller does other work; SimpleThreadPool_Wait() ends it.
+ * Neither particle set may be touched until then, and no other phase can be submitted.
+ *
+ * @param pool The thread pool running the jobs.
+ * @param update The particle update phase prepared by InitParticleUpdatePhase().
+ * @param source The state to integrate from.
+ * @param target The state to write, allocated and first-touched like source.
+ * @param field The attractors of the step; must not change until the step is waited for.
  */
-void UpdateParticlesMultithreaded(Particles *particles, Vector2 mousePos);
+void SubmitParticleUpdate(SimpleThreadPool *pool, ParticleUpdatePhase *update, const Particles *source, Particles *target,
+                          const ForceField *field);
 
 /**
- * @brief Frees the memory allocated for the particles.
+ * @brief Starts integrating one step of compact particles, like SubmitParticleUpdate().
  *
- * @param particles A pointer to the Particles structure to free.
+ * @param pool The thread pool running the jobs.
+ * @param update The particle update phase prepared by InitParticleUpdatePhase() for compact particles.
+ * @param source The state to integrate from.
+ * @param target The state to write, allocated with the same format as source.
+ * @param field The attractors of the step; must not change until the step is waited for.
  */
-void FreeParticles(Particles *particles);
+void SubmitCompactParticleUpdate(SimpleThreadPool *pool, ParticleUpdatePhase *update, const CompactParticles *source,
+                                 CompactParticles *target, const ForceField *field);
 
 /**
  * @brief Callback function for updating particle positions and velocities in a multithreaded environment.
  *
- * This function is called by a thread pool work item to update a subset of particles
+ * This function is called by the thread pool for one chunk of the particle range to update a subset of particles
  * based on their current positions, velocities, and the influence of an external force
- * (e.g., attraction to a point, simulated by mouse position). It utilizes AVX2 instructions
- * for SIMD (Single Instruction, Multiple Data) processing to efficiently compute the new
- * state of each particle in the subset. The calculations include computing the distance
- * to the attraction point, applying an attraction force, and adjusting for friction.
+ * (e.g., attraction to a point, simulated by mouse position). It runs the integration kernel
+ * selected at startup, the widest of scalar, SSE4.1, AVX2 and AVX-512 the CPU supports, to
+ * compute the new state of each particle in the subset. The calculations include computing the
+ * distance to the attraction point, applying an attraction force, and adjusting for friction.
+ * When the phase is fused, the new positions are splatted into the worker's bitmap while they
+ * are still in registers, so the positions are not read back by a second pass.
  *
- * @param Instance Unused. A pointer to a TP_CALLBACK_INSTANCE structure that defines the callback instance.
  * @param Context A pointer to user-defined data passed to the function. This should be a pointer
- *                to a ThreadArgs structure containing information about the particles to update,
- *                the range of particles this callback is responsible for, and the current mouse position.
- * @param Work Unused. A pointer to a TP_WORK structure that represents the work item that generated the callback.
+ *                to a ThreadArgs structure containing information about the particles to update
+ *                and the current mouse position.
+ * @param Start The first particle of the chunk.
+ * @param End One past the last particle of the chunk.
+ * @param WorkerIndex Index of the pool worker running the chunk, selects its bitmap when fused.
  *
- * @note This function is designed to be used with the Windows Thread Pool API and expects
+ * @note This function is designed to be used as a SimpleThreadPoolRangeJob and expects
  * the Context parameter to be of type (ThreadArgs*).
- *
- * @warning Ensure AVX2 support is available on the executing hardware to avoid runtime issues.
  */
-void CALLBACK UpdateParticlesWorkCallback(PTP_CALLBACK_INSTANCE Instance, PVOID Context, PTP_WORK Work);
+void UpdateParticlesWorkCallback(void *Context, int Start, int End, int WorkerIndex);
 
 /**
- * @brief Sets the color of a buffer using SIMD instructions.
+ * @brief Prepares the reusable rasterization phase.
  *
- * This function sets the color of a buffer using SIMD instructions to efficiently process
- * multiple pixels at once. It utilizes AVX2 instructions for SIMD (Single Instruction, Multiple Data)
- * processing to efficiently set the color of a buffer to a specified value. The function processes
- * the buffer in chunks of 8 pixels at a time, which is the optimal size for AVX2 processing.
+ * Splits the particle range into jobCount slices. Each job splats its slice into its own
+ * bitmap, so the jobs never write to shared memory.
  *
- * @param pixels A pointer to the buffer to set the color of.
- * @param count The number of pixels in the buffer.
- * @param color The color to set the buffer to.
+ * @param raster A pointer to the RasterizePhase to initialize.
+ * @param buffers An array of jobCount occupancy bitmaps, one per job.
+ * @param jobCount The number of jobs, at most MAX_THREADS.
+ * @param particles A pointer to the Particles structure to rasterize.
  */
-void InitializeThreadPoolWithMaxThreads(PTP_POOL *pool, PTP_CALLBACK_ENVIRON callBackEnviron, DWORD maxThreads);
+void InitRasterizePhase(RasterizePhase *raster, OccupancyBitmap *buffers, int jobCount, Particles *particles);
 
 /**
- * @brief Updates a boolean buffer with the positions of particles.
- *
- * This function updates a boolean buffer with the positions of particles. It sets the buffer
- * to true at the positions of the particles and false at all other positions. The function
- * processes the particles in a specified range and updates the buffer based on their positions.
- *
- * @param buffer A pointer to the boolean buffer to update.
- * @param particles A pointer to the Particles structure containing the particle positions.
- * @param start The starting index of the particles to update.
- * @param end The ending index of the particles to update.
- * @param bufferWidth The width of the buffer.
- * @param bufferHeight The height of the buffer.
+ * @brief Points the rasterization phase at a particle set and splits its current count into the job slices.
+ *
+ * @param raster A pointer to the RasterizePhase to update.
+ * @param particles A pointer to the Particles structure to rasterize from now on.
  */
-void UpdateBufferWithParticles(BOOL *buffer, Particles *particles, int start, int end, int bufferWidth, int bufferHeight);
+void SetRasterizeParticles(RasterizePhase *raster, Particles *particles);
 
 /**
- * @brief Callback function for updating a boolean buffer with particle positions in a multithreaded environment.
+ * @brief Prepares the reusable combine phase.
  *
- * This function is called by a thread pool work item to update a boolean buffer with the positions of particles.
- * It sets the buffer to true at the positions of the particles and false at all other positions. The function
- * processes the particles in a specified range and updates the buffer based on their positions. It is designed
- * to be used with the Windows Thread Pool API and expects the Context parameter to be of type (UpdateContext*).
+ * Each job takes a share of the frame's dirty bands, merges those bands of every per-thread
+ * bitmap, converts them to pixels and clears them for the next frame, so the merge runs in
+ * parallel and no separate clear pass is needed.
  *
- * @param Instance Unused. A pointer to a TP_CALLBACK_INSTANCE structure that defines the callback instance.
- * @param Context A pointer to user-defined data passed to the function. This should be a pointer to an UpdateContext
- *                structure containing information about the boolean buffer to update, the range of particles this
- *                callback is responsible for, and the dimensions of the buffer.
- * @param Work Unused. A pointer to a TP_WORK structure that represents the work item that generated the callback.
+ * @param combine A pointer to the CombinePhase to initialize.
+ * @param buffers The per-job bitmaps written by the rasterization phase.
+ * @param bufferCount The number of bitmaps in buffers.
+ * @param maxJobs The maximum number of jobs, at most MAX_THREADS.
+ * @param pixels The destination pixel buffer.
+ * @param dirty The dirty band list filled in by CollectDirtyBands() every frame.
+ * @param kernels The kernel table selected at startup.
+ * @param palette DENSITY_LEVELS packed colors to tone-map density bitmaps with, or NULL for
+ *                occupancy bitmaps.
  */
-void CALLBACK UpdateBufferWorkCallback(PTP_CALLBACK_INSTANCE Instance, PVOID Context, PTP_WORK Work);
+void InitCombinePhase(CombinePhase *combine, OccupancyBitmap *buffers, int bufferCount, int maxJobs, Color *pixels,
+                      const DirtyBands *dirty, const ParticleKernels *kernels, const uint32_t *palette);
 
 /**
- * @brief Sets the color of a buffer using SIMD instructions.
+ * @brief Splits the current dirty band list between the jobs of the combine phase.
  *
- * This function sets the color of a buffer using SIMD instructions to efficiently process
- * multiple pixels at once. It utilizes AVX2 instructions for SIMD (Single Instruction, Multiple Data)
- * processing to efficiently set the color of a buffer to a specified value. The function processes
- * the buffer in chunks of 8 pixels at a time, which is the optimal size for AVX2 processing.
- *
- * @param pixels A pointer to the buffer to set the color of.
- * @param count The number of pixels in the buffer.
- * @param color The color to set the buffer to.
+ * @param combine A pointer to the CombinePhase to update.
  */
-static inline uint32_t PackColor(Color color);
+void PrepareCombinePhase(CombinePhase *combine);
 
 /**
- * Allocates memory for a 2D boolean buffer with alignment suitable for SIMD operations.
+ * @brief Points the combine phase at the pixel buffer of the current frame.
  *
- * @param width The width of the buffer.
- * @param height The height of the buffer.
- * @return A pointer to the allocated buffer or NULL if allocation fails.
+ * @param combine A pointer to the CombinePhase to update.
+ * @param pixels The destination pixel buffer, of the screen's size.
+ * @param stream true if pixels is mapped GPU memory, written with the streaming kernels.
  */
-BOOL *AllocateAlignedBoolBuffer(int width, int height)
-{
-    // Calculate the total size needed for the buffer.
-    size_t totalSize = width * height * sizeof(BOOL);
-
-    // Allocate the memory with specified alignment.
-    BOOL *buffer = (BOOL *)_aligned_malloc(totalSize, 32);
-
-    // Optionally, you can initialize the buffer to false (0) here.
-    if (buffer)
-    {
-        memset(buffer, 0, totalSize);
-    }
-
-    return buffer;
-}
+void SetCombinePixels(CombinePhase *combine, Color *pixels, bool stream);
 
 /**
- * @brief Sets the color of a buffer using SIMD instructions.
+ * @brief Allocates the dirty band tracking state for a screen of the given height.
  *
- * This function sets the color of a buffer using SIMD instructions to efficiently process
- * multiple pixels at once. It utilizes AVX2 instructions for SIMD (Single Instruction, Multiple Data)
- * processing to efficiently set the color of a buffer to a specified value. The function processes
- * the buffer in chunks of 8 pixels at a time, which is the optimal size for AVX2 processing.
+ * Every band starts out as painted so that the first frame repaints the whole texture.
  *
- * @param pixels A pointer to the buffer to set the color of.
- * @param count The number of pixels in the buffer.
- * @param color The color to set the buffer to.
+ * @param height The height of the screen in pixels.
+ * @return The allocated state; its pointers are NULL if allocation fails.
  */
-void CombineBuffersAndConvertToPixelsSIMD(const BOOL *bufferA, const BOOL *bufferB, Color *pixels, int bufferSize);
-
-/* ========================================================================= */
-/*                            Main                                           */
-/* ========================================================================= */
-int main(void)
-{
-    assert(PARTICLE_COUNT % 8 == 0 && "Particle count must be a multiple of 8 for AVX2 processing!");
+DirtyBands AllocateDirtyBands(int height);
 
-    // Initialize the thread pool environment and set the maximum number of threads.
-    PTP_POOL pool;
-    InitializeThreadPoolWithMaxThreads(&pool, &CallBackEnviron, 12);
+/**
+ * @brief Frees the memory allocated by AllocateDirtyBands().
+ *
+ * @param dirty A pointer to the state to free.
+ */
+void FreeDirtyBands(DirtyBands *dirty);
 
-    // Initialize the screen width and height to the monitor's size
-    int screenWidth = GetMonitorWidth(0);
-    int screenHeight = GetMonitorHeight(0);
-    InitWindow(screenWidth, screenHeight, "Particle System");
-    SetWindowState(FLAG_FULLSCREEN_MODE);
-    SetTargetFPS(TARGET_FPS);
+/**
+ * @brief Builds the list of bands that have to be repainted this frame.
+ *
+ * A band is repainted if any per-thread bitmap touched it this frame, or if it held occupied
+ * pixels last frame (so they get erased). Bands that were empty in both frames are skipped by
+ * the combine phase and the texture upload.
+ *
+ * @param dirty A pointer to the dirty band state to update.
+ * @param buffers The per-thread bitmaps written by the rasterization phase.
+ * @param bufferCount The number of bitmaps in buffers.
+ */
+void CollectDirtyBands(DirtyBands *dirty, const OccupancyBitmap *buffers, int bufferCount);
 
-    // Initialize audio device
-    InitAudioDevice(); 
-    Music music = LoadMusicStream("midnight-forest-184304.mp3");
-    PlayMusicStream(music);
+/**
+ * @brief Uploads the dirty bands of the pixel buffer to the texture.
+ *
+ * Consecutive dirty bands are merged into a single partial texture update. Bands span the full
+ * width of the texture, so every update reads a contiguous slice of the pixel buffer.
+ *
+ * @param texture The texture to update, with the same dimensions as the pixel buffer.
+ * @param pixels The pixel buffer written by the combine phase.
+ * @param dirty The dirty band list of this frame.
+ * @param ring The pixel buffer ring whose acquired buffer the combine phase wrote instead of
+ *             pixels, or NULL. The GPU then copies the bands itself.
+ */
+void UploadDirtyBands(Texture2D texture, const Color *pixels, const DirtyBands *dirty, PixelBufferRing *ring);
 
-    HideCursor(); // Hide the system cursor
-    // Set the initial position of the mouse to the center of the screen
-    int centerX = SCREEN_WIDTH / 2;
-    int centerY = SCREEN_HEIGHT / 2;
-    SetMousePosition(centerX, centerY);
+/**
+ * @brief Runs the main loop on the GPU compute backend.
+ *
+ * The particles are created on the CPU, uploaded once, then integrated by a compute shader and
+ * drawn as points straight from the GPU buffers. No pixel buffer or texture upload is involved.
+ *
+ * @param config The simulation config.
+ * @param layout The display layout; the points are drawn through its camera, like the CPU path's texture.
+ * @param input The attractor input, which advances one step per frame on this backend.
+ * @param audio The music player whose bass drives the pointer attractor, or NULL.
+ * @param recorder The benchmark recorder, or NULL for an interactive run.
+ * @param snapshot The restored snapshot to start from, or NULL for the scanline placement.
+ *
+ * @return false if the backend is unavailable and nothing was run, true once the loop ended.
+ */
+bool RunGpuBackend(const SimulationConfig *config, const DisplayLayout *layout, AttractorInput *input, const AudioPlayer *audio,
+                   BenchmarkRecorder *recorder, const ParticleSnapshot *snapshot);
 
-    // Load the main render texture and allocate memory for the pixel buffer
-    RenderTexture2D mainBuffer = LoadRenderTexture(SCREEN_WIDTH, SCREEN_HEIGHT);
-    Color *pixels = (Color *)malloc(SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(Color));
-
-    // Allocate aligned memory for the buffers
-    BOOL *bufferA = AllocateAlignedBoolBuffer(SCREEN_WIDTH, SCREEN_HEIGHT);
-    BOOL *bufferB = AllocateAlignedBoolBuffer(SCREEN_WIDTH, SCREEN_HEIGHT);
-
-    Particles particles = CreateParticles(PARTICLE_COUNT, SCREEN_WIDTH, SCREEN_HEIGHT);
-
-    // Define and initialize update contexts for each buffer
-    UpdateContext updateContextA = {
-        .buffer = bufferA,            // Target buffer for the first half of particles
-        .particles = &particles,      // Pointer to the particle data
-        .start = 0,                   // Starting index of particles for the first update context
-        .end = PARTICLE_COUNT / 2,    // End index (process the first half of particles)
-        .bufferWidth = SCREEN_WIDTH,  // Width of the buffer
-        .bufferHeight = SCREEN_HEIGHT // Height of the buffer
-    };
+/**
+ * @brief Runs the main loop as the compositor of the cluster backend.
+ *
+ * Waits for config->clusterNodes nodes and hands each a shard of the particles. Every frame,
+ * the attractors are broadcast to the nodes, which integrate their shards in parallel and
+ * answer with the tiles of their bitmaps that changed. The bands those tiles cover are merged
+ * over all nodes by the combine phase and uploaded; everything else stays on the texture.
+ *
+ * @param config The simulation config.
+ * @param layout The display layout; the texture is stretched from the grid over the window.
+ * @param input The attractor input, which advances one step per frame on this backend.
+ * @param audio The music player whose bass drives the pointer attractor, or NULL.
+ * @param recorder The benchmark recorder, or NULL for an interactive run.
+ * @param pool The thread pool running the combine phase.
+ *
+ * @return false if the buffers could not be allocated or the compositor could not be started, so
+ *         nothing was run, true once the loop ended.
+ */
+bool RunClusterBackend(const SimulationConfig *config, const DisplayLayout *layout, AttractorInput *input,
+                       const AudioPlayer *audio, BenchmarkRecorder *recorder, SimpleThreadPool *pool);
 
-    UpdateContext updateContextB = {
-        .buffer = bufferB,            // Target buffer for the second half of particles
-        .particles = &particles,      // Pointer to the same particle data
-        .start = PARTICLE_COUNT / 2,  // Starting index for the second half
-        .end = PARTICLE_COUNT,        // Process to the end of the particle array
-        .bufferWidth = SCREEN_WIDTH,  // Width of the buffer
-        .bufferHeight = SCREEN_HEIGHT // Height of the buffer
-    };
+/**
+ * @brief Serves as a headless node of the cluster compositor at config->clusterHost.
+ *
+ * The scene, its shard and the attractors of every step come from the compositor; only the
+ * threads, their pinning and the kernels are this machine's own. Returns once the compositor
+ * hangs up.
+ *
+ * @param config The simulation config of the node.
+ * @param pool The thread pool integrating the shard.
+ *
+ * @return The exit status of the program.
+ */
+int RunClusterNode(const SimulationConfig *config, SimpleThreadPool *pool);
 
-// #define PROFILING
-#ifdef PROFILING
-    while (!WindowShouldClose())
-    {
-        double startTime = GetTime();
-
-        // Particles update
-        double particlesStartTime = GetTime();
-        Vector2 mousePos = GetMousePosition();
-        UpdateParticlesMultithreaded(&particles, mousePos);
-        TraceLog(LOG_INFO, "Particles update took %f seconds", GetTime() - particlesStartTime);
-
-        // Threadpool work
-        double threadPoolStartTime = GetTime();
-        PTP_WORK workItemA = CreateThreadpoolWork(UpdateBufferWorkCallback, &updateContextA, &CallBackEnviron);
-        PTP_WORK workItemB = CreateThreadpoolWork(UpdateBufferWorkCallback, &updateContextB, &CallBackEnviron);
-        SubmitThreadpoolWork(workItemA);
-        SubmitThreadpoolWork(workItemB);
-        WaitForThreadpoolWorkCallbacks(workItemA, FALSE);
-        WaitForThreadpoolWorkCallbacks(workItemB, FALSE);
-        CloseThreadpoolWork(workItemA);
-        CloseThreadpoolWork(workItemB);
-        TraceLog(LOG_INFO, "Threadpool work took %f seconds", GetTime() - threadPoolStartTime);
-
-        // Buffers combination and conversion
-        double bufferStartTime = GetTime();
-        TraceLog(LOG_INFO, "Buffers combination and conversion took %f seconds", GetTime() - bufferStartTime);
-
-        // Texture update and drawing
-        double drawingStartTime = GetTime();
-        UpdateTexture(mainBuffer.texture, pixels);
-        BeginDrawing();
-        DrawTexture(mainBuffer.texture, 0, 0, WHITE);
-        DrawCircleV(mousePos, redDotRadius, redDotColor);
-        EndDrawing();
-        TraceLog(LOG_INFO, "Texture update and drawing took %f seconds", GetTime() - drawingStartTime);
+/**
+ * @brief Applies the particle count and force constants of a restored snapshot to the config.
+ *
+ * A simulation grid left to be derived from the display takes the snapshot's instead, so the
+ * particles land on the grid they were captured on.
+ *
+ * @param config A pointer to the config to update.
+ * @param snapshot The mapped snapshot.
+ *
+ * @return true if the resulting config is valid.
+ */
+bool ApplySnapshotConfig(SimulationConfig *config, const ParticleSnapshot *snapshot);
 
-        TraceLog(LOG_INFO, "Total loop iteration took %f seconds", GetTime() - startTime);
-    }
-#else
-    while (!WindowShouldClose())
-    {
-        UpdateMusicStream(music);
-        Vector2 mousePos = GetMousePosition();
-        UpdateParticlesMultithreaded(&particles, mousePos);
+/**
+ * @brief Starts saving the particle state to config->snapshotPath and logs the outcome.
+ *
+ * The writer is created on the first save, so runs that never save do not pay for its staging
+ * copy. Must be called while no phase is in flight on the pool.
+ *
+ * @param writer A pointer to the writer, NULL until the first save.
+ * @param pool The thread pool running the staging copy.
+ * @param particles The state to save.
+ * @param config The simulation config stored with the state.
+ * @param frame The index of the next frame to simulate.
+ */
+void SaveParticleSnapshot(SnapshotWriter **writer, SimpleThreadPool *pool, const Particles *particles,
+                          const SimulationConfig *config, int frame);
 
-        // tranform particles to buffer
-        PTP_WORK workItemA = CreateThreadpoolWork(UpdateBufferWorkCallback, &updateContextA, &CallBackEnviron);
-        PTP_WORK workItemB = CreateThreadpoolWork(UpdateBufferWorkCallback, &updateContextB, &CallBackEnviron);
-        SubmitThreadpoolWork(workItemA);
-        SubmitThreadpoolWork(workItemB);
-        WaitForThreadpoolWorkCallbacks(workItemA, FALSE);
-        WaitForThreadpoolWorkCallbacks(workItemB, FALSE);
-        CloseThreadpoolWork(workItemA);
-        CloseThreadpoolWork(workItemB);
+/**
+ * @brief Hands the finished pixels of a frame to the exporter and logs a failure.
+ *
+ * Must be called while no phase is in flight on the pool.
+ *
+ * @param exporter The exporter.
+ * @param pool The thread pool running the copy into the ring.
+ * @param pixels The pixel buffer written by the combine phase.
+ *
+ * @return true if the frame was queued, false once the encoder has failed.
+ */
+bool ExportFrame(FrameExporter *exporter, SimpleThreadPool *pool, const Color *pixels);
 
-        CombineBuffersAndConvertToPixelsSIMD(bufferA, bufferB, pixels, SCREEN_WIDTH * SCREEN_HEIGHT);
+/**
+ * @brief Decides whether the main loop runs another frame.
+ *
+ * @param recorder The benchmark recorder, or NULL for an interactive run.
+ *
+ * @return In benchmark mode, true until every frame is recorded; otherwise true until the window is closed.
+ */
+bool ShouldRunFrame(const BenchmarkRecorder *recorder);
 
-        // update texture and draw
-        UpdateTexture(mainBuffer.texture, pixels);
-        BeginDrawing();
-        DrawTexture(mainBuffer.texture, 0, 0, WHITE);
-        DrawCircleV(mousePos, 5.0f, RED);
-        DrawFPS(10, 10);
-        EndDrawing();
-    }
-#endif
-    FreeParticles(&particles);
+/**
+ * @brief Samples the pointer for a new frame. The steps of the frame move from the previous sample to this one.
+ *
+ * @param input A pointer to the attractor input of the run.
+ */
+void SampleAttractorPointer(AttractorInput *input);
 
-    // Close the window and clean up resources
-    CloseWindow();
+/**
+ * @brief Returns the attraction point of a simulation step and appends it to the recording, if any.
+ *
+ * @param input A pointer to the attractor input of the run.
+ * @param step The index of the step.
+ * @param progress Where the step lies between the last two pointer samples, in (0, 1].
+ *
+ * @return The replayed position if replaying, the scripted benchmark path if scripted, the
+ *         interpolated pointer otherwise, in grid pixels.
+ */
+Vector2 GetStepAttractor(AttractorInput *input, int step, float progress);
 
-    DestroyThreadpoolEnvironment(&CallBackEnviron);
-    if (pool)
-    {
-        CloseThreadpool(pool);
-    }
+/**
+ * @brief Callback function for updating a boolean buffer with particle positions in a multithreaded environment.
+ *
+ * This function is called by a thread pool job to update a boolean buffer with the positions of particles.
+ * It sets the buffer to true at the positions of the particles and false at all other positions. The function
+ * processes the particles in a specified range and updates the buffer based on their positions. It is designed
+ * to be used as a SimpleThreadPoolJob and expects the Context parameter to be of type (UpdateContext*).
+ *
+ * @param Context A pointer to user-defined data passed to the function. This should be a pointer to an UpdateContext
+ *                structure containing information about the boolean buffer to update, the range of particles this
+ *                callback is responsible for, and the dimensions of the buffer.
+ * @param WorkerIndex Unused. Index of the pool worker running the job.
+ */
+void UpdateBufferWorkCallback(void *Context, int WorkerIndex);
 
-    return 0;
-}
+/**
+ * @brief Callback function for merging a band of the per-thread bitmaps into pixels.
+ *
+ * @param Context A pointer to a CombineContext describing the band to process.
+ * @param WorkerIndex Unused. Index of the pool worker running the job.
+ */
+void CombineBuffersWorkCallback(void *Context, int WorkerIndex);
 
 /* ========================================================================= */
-/*                            Private functions                              */
+/*                            Main                                           */
 /* ========================================================================= */
-void setBufferColorSIMD(Color *pixels, int count, Color color)
+int main(int argc, char **argv)
 {
-    // Assuming Color is a struct of 4 bytes (RGBA)
-    int packedColor = color.r | (color.g << 8) | (color.b << 16) | (color.a << 24);
-
-    // Create an AVX2 vector with 8 packed color integers (since we're dealing
-    // with 32-bit ints, and AVX2 can handle 256 bits at a time)
-    __m256i packedColors = _mm256_set1_epi32(packedColor);
-
-    // Process 8 pixels per iteration
-    for (int i = 0; i < count; i += 8)
+    // Read the simulation parameters: defaults, then config file and command-line overrides
+    SimulationConfig config;
+    DefaultSimulationConfig(&config);
+    if (!ParseSimulationArgs(&config, argc, argv) || !ValidateSimulationConfig(&config))
     {
-        _mm256_storeu_si256((__m256i *)(pixels + i), packedColors);
+        return 1;
     }
-}
-
-Particles CreateParticles(int count, int screenWidth, int screenHeight)
-{
-    Particles p;
-    p.count = count;
-    p.posX = (float *)_aligned_malloc(count * sizeof(float), 32);
-    p.posY = (float *)_aligned_malloc(count * sizeof(float), 32);
-    p.velX = (float *)_aligned_malloc(count * sizeof(float), 32);
-    p.velY = (float *)_aligned_malloc(count * sizeof(float), 32);
-
-    // Place particles in a scanline manner, starting from the top-left pixel.
-    // Continue "below" the screen if there are more particles than fit on the screen.
-    for (int i = 0; i < count; ++i)
+    if (config.verifyKernels)
     {
-        int x = i % screenWidth;
-        int y = i / screenWidth;
-
-        p.posX[i] = (float)x;
-        p.posY[i] = (float)y;
-
-        // Initialize velocity to zero or a small random value for initial movement
-        p.velX[i] = 0.0f;
-        p.velY[i] = 0.0f;
+        return VerifyParticleKernels(stdout) ? 0 : 1;
     }
 
-    return p;
-}
-
-void FreeParticles(Particles *particles)
-{
-    _aligned_free(particles->posX);
-    _aligned_free(particles->posY);
-    _aligned_free(particles->velX);
-    _aligned_free(particles->velY);
-}
+    // Everything from here on is released by the cleanup block at the end of main, which every
+    // exit goes through with whatever was set up by then
+    int status = 1;
+    ParticleSnapshot snapshot = {0};
+    InputReplay replay = {0};
+    SimpleThreadPool *pool = NULL;
+    BenchmarkRecorder benchmark;
+    BenchmarkRecorder *recorder = NULL;
+    AudioPlayer *audio = NULL;
+    InputRecorder inputRecorder = {0};
+    FrameExporter *exporter = NULL;
+
+    // A restored scene brings its own particle count and forces and resumes at its frame
+    const bool restored = config.restorePath[0] != '\0';
+    if (restored)
+    {
+        SnapshotStatus snapshotStatus = MapParticleSnapshot(&snapshot, config.restorePath);
+        if (snapshotStatus != SNAPSHOT_OK)
+        {
+            TraceLog(LOG_ERROR, "SNAPSHOT: Failed to restore '%s': %s", config.restorePath,
+                     GetSnapshotStatusText(snapshotStatus));
+            goto cleanup;
+        }
+        if (!ApplySnapshotConfig(&config, &snapshot))
+        {
+            goto cleanup;
+        }
+    }
+    const int startFrame = restored ? snapshot.header.frame : 0;
 
-void CALLBACK UpdateParticlesWorkCallback(PTP_CALLBACK_INSTANCE Instance, PVOID Context, PTP_WORK Work)
-{
-    // Explicitly mark unused parameters to avoid compiler warnings
-    (void)Instance;
-    (void)Work;
-    ThreadArgs *args = (ThreadArgs *)Context;
+    // A replay stands in for the pointer from the first step on
+    const bool replaying = config.replayPath[0] != '\0';
+    if (replaying && !LoadInputReplay(&replay, config.replayPath))
+    {
+        goto cleanup;
+    }
 
-    Particles *particles = args->particles;
-    Vector2 mousePos = args->mousePos;
+    const int threadCount = config.threadCount;
 
-    // Process in chunks of 8 for AVX2
-    int i = args->start;
-    for (; i + 7 < args->end; i += 8)
+    // Start the persistent worker threads once; every frame phase reuses them.
+    pool = SimpleThreadPool_Init(threadCount, config.pinning);
+    if (!pool)
     {
-        { // Adjusted for AVX2 processing 8 floats at a time
-            __m256 posX = _mm256_load_ps(&particles->posX[i]);
-            __m256 posY = _mm256_load_ps(&particles->posY[i]);
-            __m256 velX = _mm256_load_ps(&particles->velX[i]);
-            __m256 velY = _mm256_load_ps(&particles->velY[i]);
-
-            // Compute differences using AVX instructions
-            __m256 mouseX = _mm256_set1_ps(mousePos.x);
-            __m256 mouseY = _mm256_set1_ps(mousePos.y);
-            __m256 diffX = _mm256_sub_ps(mouseX, posX);
-            __m256 diffY = _mm256_sub_ps(mouseY, posY);
+        TraceLog(LOG_FATAL, "Failed to create the thread pool");
+        goto cleanup;
+    }
+    if (config.pinning != SIMPLE_THREADPOOL_PIN_NONE &&
+        SimpleThreadPool_PinnedCount(pool) < SimpleThreadPool_ThreadCount(pool))
+    {
+        TraceLog(LOG_WARNING, "POOL: Pinned only %d of %d workers", SimpleThreadPool_PinnedCount(pool),
+                 SimpleThreadPool_ThreadCount(pool));
+    }
 
-            // Compute distance squared and distance using AVX
-            __m256 distSq = _mm256_add_ps(_mm256_mul_ps(diffX, diffX), _mm256_mul_ps(diffY, diffY));
-            __m256 dist = _mm256_sqrt_ps(distSq);
+    // A cluster node opens no window, it simulates the shard it is given until the compositor hangs up
+    if (config.clusterHost[0] != '\0')
+    {
+        status = RunClusterNode(&config, pool);
+        goto cleanup;
+    }
 
-            // Normalize diff vector (ensure you handle division by zero appropriately)
-            __m256 normX = _mm256_div_ps(diffX, dist);
-            __m256 normY = _mm256_div_ps(diffY, dist);
+    if (config.benchmarkFrames > 0)
+    {
+        if (!InitBenchmarkRecorder(&benchmark, config.benchmarkFrames))
+        {
+            TraceLog(LOG_FATAL, "Failed to allocate the benchmark samples");
+            goto cleanup;
+        }
+        recorder = &benchmark;
+        SetTraceLogLevel(LOG_WARNING); // Keep stdout for the CSV
+    }
 
-            // Compute attraction force using AVX
-            __m256 attraction = _mm256_set1_ps(ATTRACTION_STRENGHT);
-            velX = _mm256_add_ps(velX, _mm256_mul_ps(normX, attraction));
-            velY = _mm256_add_ps(velY, _mm256_mul_ps(normY, attraction));
+    // Benchmark and export runs follow the scripted attractor path in a hidden window, sized to
+    // the simulation and never throttled: no SetTargetFPS() and no FLAG_VSYNC_HINT.
+    const bool exporting = config.exportPath[0] != '\0';
+    const bool scripted = recorder || exporting;
+    DisplayLayout layout;
+    if (scripted)
+    {
+        layout = ResolveDisplayLayout(&config, 0, 0);
+        SetConfigFlags(FLAG_WINDOW_HIDDEN);
+        InitWindow(layout.displayWidth, layout.displayHeight,
+                   exporting ? "Particle System Export" : "Particle System Benchmark");
+    }
+    else
+    {
+        // A 0 x 0 window opens at the size of the monitor
+        InitWindow(0, 0, "Particle System");
+        SetWindowState(FLAG_FULLSCREEN_MODE);
+        SetTargetFPS(TARGET_FPS);
+        layout = ResolveDisplayLayout(&config, GetScreenWidth(), GetScreenHeight());
+
+        // The music decodes on its own thread, the frame loop never touches it
+        InitAudioDevice();
+        audio = StartAudioPlayer("midnight-forest-184304.mp3");
+        if (!audio)
+        {
+            TraceLog(LOG_WARNING, "AUDIO: Playing without music");
+        }
 
-            // Apply friction using AVX
-            __m256 friction = _mm256_set1_ps(FRICTION);
-            velX = _mm256_mul_ps(velX, friction);
-            velY = _mm256_mul_ps(velY, friction);
+        HideCursor(); // Hide the system cursor
+        // Set the initial position of the mouse to the center of the screen
+        int centerX = layout.displayWidth / 2;
+        int centerY = layout.displayHeight / 2;
+        SetMousePosition(centerX, centerY);
+    }
 
-            // Update positions using AVX
-            posX = _mm256_add_ps(posX, velX);
-            posY = _mm256_add_ps(posY, velY);
+    // From here on every buffer is sized from the simulation grid, whatever the display
+    config.screenWidth = layout.simWidth;
+    config.screenHeight = layout.simHeight;
+    const int simWidth = layout.simWidth;
+    const int simHeight = layout.simHeight;
+    TraceLog(LOG_INFO, "DISPLAY: Simulating %dx%d, shown at %dx%d scaled by %.2f", simWidth, simHeight,
+             layout.displayWidth, layout.displayHeight, layout.camera.zoom);
+
+    // Every step's attractor is taken from here, so what a recording holds is exactly what was simulated
+    if (config.recordPath[0] != '\0' &&
+        !OpenInputRecorder(&inputRecorder, config.recordPath, startFrame, simWidth, simHeight, config.stepRate))
+    {
+        TraceLog(LOG_WARNING, "INPUT: Running without recording the input");
+    }
+    if (replaying && (replay.header.gridWidth != simWidth || replay.header.gridHeight != simHeight))
+    {
+        TraceLog(LOG_WARNING, "INPUT: Recorded on a %dx%d grid, running on %dx%d", replay.header.gridWidth,
+                 replay.header.gridHeight, simWidth, simHeight);
+    }
+    AttractorInput input = {
+        .scripted = scripted,
+        .layout = &layout,
+        .replay = replaying ? &replay : NULL,
+        .recorder = inputRecorder.file ? &inputRecorder : NULL
+    };
+    SampleAttractorPointer(&input);
+    input.pointerFrom = input.pointerTo; // The first step has nowhere to move from
 
-            // Store updated positions and velocities back
-            _mm256_store_ps(&particles->posX[i], posX);
-            _mm256_store_ps(&particles->posY[i], posY);
-            _mm256_store_ps(&particles->velX[i], velX);
-            _mm256_store_ps(&particles->velY[i], velY);
+    // An export run writes the pixel buffer of every frame through the encoder thread
+    if (exporting)
+    {
+        const char *error = NULL;
+        exporter = CreateFrameExporter(config.exportPath, simWidth, simHeight, &error);
+        if (!exporter)
+        {
+            TraceLog(LOG_ERROR, "EXPORT: Cannot export to '%s': %s", config.exportPath, error);
+            goto cleanup;
         }
     }
-}
-
-void UpdateParticlesMultithreaded(Particles *particles, Vector2 mousePos)
-{
-    const int threadCount = MAX_THREADS;
-    PTP_WORK workItems[threadCount];
-    ThreadArgs args[threadCount];
-    int particlesPerThread = PARTICLE_COUNT / threadCount;
+    int exportFramesLeft = config.exportFrames;
 
-    for (int i = 0; i < threadCount; i++)
+    bool ranBackend = false;
+    if (config.backend == BACKEND_GPU && exporting)
     {
-        args[i].start = i * particlesPerThread;
-        args[i].end = (i + 1) * particlesPerThread;
-        args[i].particles = particles;
-        args[i].mousePos = mousePos;
-
-        workItems[i] = CreateThreadpoolWork(UpdateParticlesWorkCallback, &args[i], &CallBackEnviron);
-        SubmitThreadpoolWork(workItems[i]);
+        TraceLog(LOG_WARNING, "EXPORT: The GPU backend has no pixel buffer, exporting from the CPU path");
     }
-    // Wait for all work items to complete
-    for (int i = 0; i < threadCount; i++)
+    else if (config.backend == BACKEND_GPU)
     {
-        WaitForThreadpoolWorkCallbacks(workItems[i], FALSE);
-        CloseThreadpoolWork(workItems[i]);
+        ranBackend = RunGpuBackend(&config, &layout, &input, audio, recorder, restored ? &snapshot : NULL);
+        if (!ranBackend)
+        {
+            TraceLog(LOG_WARNING, "GPU backend unavailable, falling back to the CPU path");
+        }
     }
-}
-
-void InitializeThreadPoolWithMaxThreads(PTP_POOL *pool, PTP_CALLBACK_ENVIRON callBackEnviron, DWORD maxThreads)
-{
-    // Create a new thread pool.
-    *pool = CreateThreadpool(NULL);
-    if (!*pool)
+    else if (config.backend == BACKEND_CLUSTER)
     {
-        // Handle error.
-        return;
+        ranBackend = RunClusterBackend(&config, &layout, &input, audio, recorder, pool);
+        if (!ranBackend)
+        {
+            TraceLog(LOG_WARNING, "CLUSTER: No cluster to composite, falling back to the CPU path");
+        }
     }
-
-    // Set the thread pool's minimum and maximum thread counts.
-    // Note: Setting the minimum is required before setting the maximum.
-    SetThreadpoolThreadMinimum(*pool, 1); // Ensure at least one thread.
-    SetThreadpoolThreadMaximum(*pool, maxThreads);
-
-    // Initialize the callback environment.
-    InitializeThreadpoolEnvironment(callBackEnviron);
-
-    // Associate the thread pool with the callback environment.
-    SetThreadpoolCallbackPool(callBackEnviron, *pool);
-}
-
-void inline clearBufferSIMD(BOOL *buffer, int count)
-{
-    // Process 8 bools at a time with AVX2
-    for (int i = 0; i <= count - 8; i += 8)
+    if (ranBackend)
     {
-        _mm256_store_si256((__m256i *)&buffer[i], _mm256_setzero_si256());
+        if (recorder)
+        {
+            WriteBenchmarkCsv(recorder, &config, stdout);
+        }
+        status = 0;
+        goto cleanup;
     }
-}
 
-void UpdateBufferWithParticles(BOOL *buffer, Particles *particles, int start, int end, int bufferWidth, int bufferHeight)
-{
-    clearBufferSIMD(buffer, bufferWidth * bufferHeight);
+    // Pick the widest kernels this CPU runs, once for the whole session
+    const ParticleKernels *kernels = SelectParticleKernels(config.simdLevel);
 
-    // Update buffer with particles
-    for (int i = start; i < end; i++)
+    // Load the main render texture and allocate memory for the pixel buffer
+    RenderTexture2D mainBuffer = LoadRenderTexture(simWidth, simHeight);
+    Color *pixels = (Color *)malloc((size_t)simWidth * simHeight * sizeof(Color));
+    DirtyBands dirty = AllocateDirtyBands(simHeight);
+
+    // Allocate aligned memory for the buffers, one private bitmap per rasterization job. The
+    // density mode counts particles per pixel instead and shades the counts through a palette.
+    // Its counters cost a byte per pixel each, so it keeps only DENSITY_MAX_BITMAPS of them and
+    // splats with as many rasterization jobs instead of fusing the splat into every worker.
+    const bool density = config.renderMode == RENDER_DENSITY;
+    const int bufferCount = density && threadCount > DENSITY_MAX_BITMAPS ? DENSITY_MAX_BITMAPS : threadCount;
+    const bool fused = config.fusedUpdate && !density;
+    if (config.fusedUpdate && density)
+    {
+        TraceLog(LOG_INFO, "DENSITY: Splatting into %d count arrays in a separate rasterization phase", bufferCount);
+    }
+    OccupancyBitmap buffers[MAX_THREADS];
+    bool allocated = pixels && dirty.painted && dirty.list;
+    for (int i = 0; i < bufferCount; i++)
+    {
+        buffers[i] = AllocateOccupancyBitmap(simWidth, simHeight, density);
+        bool bits = density ? buffers[i].counts != NULL : buffers[i].words != NULL;
+        allocated = allocated && bits && buffers[i].bandTouched;
+    }
+    if (!allocated)
     {
-        int x = (int)particles->posX[i];
-        int y = (int)particles->posY[i];
+        TraceLog(LOG_FATAL, "Failed to allocate the pixel buffer and bitmaps of a %dx%d grid", simWidth, simHeight);
+        for (int i = 0; i < bufferCount; i++)
+        {
+            FreeOccupancyBitmap(&buffers[i]);
+        }
+        FreeDirtyBands(&dirty);
+        free(pixels);
+        UnloadRenderTexture(mainBuffer);
+        FinishFrameExport(exporter, NULL);
+        goto cleanup;
+    }
 
-        // Ensure the particle is within the bounds of the buffer
-        if (x >= 0 && x < bufferWidth && y >= 0 && y < bufferHeight)
+    // Start from an all-background texture; afterwards only dirty bands are repainted
+    kernels->fill(pixels, simWidth * simHeight, EMPTY_COLOR);
+    UpdateTexture(mainBuffer.texture, pixels);
+    uint32_t densityPalette[DENSITY_LEVELS];
+    BuildDensityPalette(densityPalette);
+
+    // When pipelined, the workers integrate frame N+1 from particles[front] into the other copy
+    // while this thread uploads and presents frame N. Otherwise particles[0] is updated in place.
+    // A restored particles[0] lives in the snapshot mapping. With emitters, the arrays are sized
+    // for the emitted particles up front and count is the live prefix of them. Compact storage
+    // replaces the arrays with compactParticles, only a restored particles[0] is still mapped
+    // to be packed.
+    bool emitting = config.emitters.count > 0;
+    const int capacity = config.particleCount + (emitting ? config.emitterCapacity : 0);
+    const bool pipelined = config.pipelined != 0;
+    const bool compact = config.storage == STORAGE_COMPACT;
+    Particles particles[2] = {0};
+    if (restored)
+    {
+        particles[0] = snapshot.particles;
+    }
+    else if (!compact)
+    {
+        particles[0] = AllocateParticles(capacity);
+    }
+    if (pipelined && !compact)
+    {
+        particles[1] = AllocateParticles(capacity);
+    }
+    CompactParticles compactParticles[2] = {0};
+    if (compact)
+    {
+        compactParticles[0] = AllocateCompactParticles(capacity, simWidth, simHeight);
+        if (pipelined)
         {
-            int index = y * bufferWidth + x;
-            buffer[index] = true; // Particle present at this position
+            compactParticles[1] = AllocateCompactParticles(capacity, simWidth, simHeight);
         }
     }
-}
+    int front = 0;
+
+    // Prepare the particle update phase once, it is resubmitted every frame. When fused, pool
+    // worker w splats into buffers[w] and the rasterization phase is skipped.
+    ParticleUpdatePhase particleUpdate;
+    InitParticleUpdatePhase(&particleUpdate, &particles[0], compact ? &compactParticles[0] : NULL, &config,
+                            fused ? buffers : NULL, kernels);
+    if (!restored || compact)
+    {
+        FirstTouchParticles(pool, &particles[0], compact ? &compactParticles[0] : NULL, &particleUpdate, 0, simWidth,
+                            simHeight);
+    }
+    if (pipelined)
+    {
+        FirstTouchParticles(pool, &particles[1], compact ? &compactParticles[1] : NULL, &particleUpdate, 0, simWidth,
+                            simHeight); // Same pages, same workers
+    }
+    if (restored && compact)
+    {
+        PackCompactParticles(&snapshot.particles, &compactParticles[0], 0, config.particleCount);
+    }
+    particles[0].count = config.particleCount;
+    particles[1].count = config.particleCount;
+    compactParticles[0].count = config.particleCount;
+    compactParticles[1].count = config.particleCount;
 
-void CALLBACK UpdateBufferWorkCallback(PTP_CALLBACK_INSTANCE Instance, PVOID Context, PTP_WORK Work)
-{
-    // Explicitly mark unused parameters to avoid compiler warnings
-    (void)Instance;
-    (void)Work;
+    ParticleEmitters emitters = {0};
+    if (emitting && !InitParticleEmitters(&emitters, &config, capacity))
+    {
+        TraceLog(LOG_WARNING, "EMITTER: Failed to allocate the particle lifetimes, running without emitters");
+        FreeParticleEmitters(&emitters);
+        emitting = false;
+    }
 
-    // Convert context to our structure that holds necessary information
-    UpdateContext *updateContext = (UpdateContext *)Context;
+    // Splat particles into the per-thread bitmaps, then merge them band by band into pixels
+    RasterizePhase rasterize;
+    InitRasterizePhase(&rasterize, buffers, bufferCount, &particles[0]);
 
-    // Call the updated function that works with a boolean buffer
-    UpdateBufferWithParticles(updateContext->buffer, updateContext->particles,
-                              updateContext->start, updateContext->end,
-                              updateContext->bufferWidth, updateContext->bufferHeight);
-}
+    CombinePhase combine;
+    InitCombinePhase(&combine, buffers, bufferCount, threadCount, pixels, &dirty, kernels,
+                     density ? densityPalette : NULL);
 
-static inline uint32_t PackColor(Color color)
-{
-    return color.r | (color.g << 8) | (color.b << 16) | (color.a << 24);
-}
+    // Frames whose pixel buffer is still being read by the GPU take the copy path instead
+    PixelBufferRing pixelRing;
+    bool pbo = config.pixelUpload == UPLOAD_PBO;
+    if (pbo && !InitPixelBufferRing(&pixelRing, simWidth, simHeight))
+    {
+        TraceLog(LOG_WARNING, "UPLOAD: Copying the pixels to the texture instead");
+        pbo = false;
+    }
 
-void CombineBuffersAndConvertToPixelsSIMD(const BOOL *bufferA, const BOOL *bufferB, Color *pixels, int bufferSize) {
-    // Define colors in packed format for SIMD
-    uint32_t packedTrueColor = PackColor((Color){0, 0, 0, 255}); // Black
-    uint32_t packedFalseColor = PackColor((Color){130, 130, 130, 255}); // Gray
+    FrameProfiler profiler;
+    if (!InitFrameProfiler(&profiler, SimpleThreadPool_ThreadCount(pool), config.showProfiler != 0))
+    {
+        TraceLog(LOG_WARNING, "Failed to allocate the frame profiler history");
+    }
+    double workerBusy[MAX_THREADS];
 
-    __m256i vTrueColor = _mm256_set1_epi32(packedTrueColor);
-    __m256i vFalseColor = _mm256_set1_epi32(packedFalseColor);
+    // Drops the end of the particle arrays while over budget: those particles are neither
+    // integrated nor drawn, and resume where they stopped once the count grows back
+    QualityGovernor governor;
+    const bool governing = config.governor != 0;
+    if (governing)
+    {
+        InitQualityGovernor(&governor, config.particleCount, config.governorFloor, 1000.0f / TARGET_FPS);
+    }
 
-    for (int i = 0; i <= bufferSize - 8; i += 8) {
-        __m256i vA = _mm256_load_si256((const __m256i *)&bufferA[i]); // Load 8 elements from bufferA
-        __m256i vB = _mm256_load_si256((const __m256i *)&bufferB[i]); // Load 8 elements from bufferB
+    // The pointer attractor plus the configured ones, moved before every step
+    ForceField field;
+    InitForceField(&field, &config);
 
-        // Combine buffers using OR (or any other logical operation you prefer)
-        __m256i combined = _mm256_or_si256(vA, vB);
-        //__m256i combined = _mm256_xor_si256(vA, vB); 
+    // Neighbour repulsion adds to the velocities of the state a step starts from, before it is integrated
+    SpatialGrid grid;
+    bool repel = config.repulsion > 0.0f;
+    if (repel && !InitSpatialGrid(&grid, capacity, simWidth, simHeight, config.repulsionRadius,
+                                  config.repulsion, SimpleThreadPool_ThreadCount(pool)))
+    {
+        TraceLog(LOG_WARNING, "GRID: Running without particle repulsion");
+        repel = false;
+    }
 
-        // Generate a mask based on the combined result to select between trueColor and falseColor
-        // Assuming non-zero values in combined mean true, and zero means false
-        __m256i mask = _mm256_cmpeq_epi32(combined, _mm256_setzero_si256()); // Elements are 0xFFFFFFFF if false, 0x0 if true
-        
-        // Blend pixels based on the mask: true values select from vTrueColor, false values from vFalseColor
-        __m256i result = _mm256_blendv_epi8(vTrueColor, vFalseColor, mask);
+    // Keeps particles that are close on screen close in memory for the splat. Emitted particles
+    // come and go behind the initial ones and are left alone.
+    ParticleSorter sorter;
+    bool sorting = config.sortInterval > 0;
+    if (sorting && !InitParticleSorter(&sorter, config.particleCount, simWidth, simHeight, config.sortInterval,
+                                       SimpleThreadPool_ThreadCount(pool)))
+    {
+        TraceLog(LOG_WARNING, "SORT: Running without particle re-sorting");
+        sorting = false;
+    }
 
-        // Store the result directly into the pixels array
-        _mm256_storeu_si256((__m256i *)&pixels[i], result);
+    // With a fixed step rate, a frame runs as many steps as the real time since the previous one
+    // calls for. Scripted and pipelined runs keep one step per frame, so that frame N shows step N
+    // on every machine and benchmarks always measure the same work.
+    const bool fixedRate = config.stepRate > 0 && !scripted;
+    StepClock stepClock;
+    if (fixedRate)
+    {
+        InitStepClock(&stepClock, config.stepRate, config.maxSteps);
     }
-}
\ No newline at end of file
+    int step = startFrame; // Index of the next step to simulate
+
+    // The first pipelined step is started up front, every later one at the end of the previous frame
+    if (pipelined)
+    {
+        if (emitting)
+        {
+            UpdateParticleEmitters(&emitters, &particles[0], step);
+        }
+        UpdateForceField(&field, GetStepAttractor(&input, step, 1.0f), step);
+        if (repel)
+        {
+            ApplyParticleRepulsion(&grid, pool, &particles[0]);
+        }
+        if (compact)
+        {
+            SubmitCompactParticleUpdate(pool, &particleUpdate, &compactParticles[0], &compactParticles[1], &field);
+        }
+        else
+        {
+            SubmitParticleUpdate(pool, &particleUpdate, &particles[0], &particles[1], &field);
+        }
+        step++;
+    }
+
+    SnapshotWriter *snapshotWriter = NULL;
+    SnapshotStatus snapshotStatus;
+
+    FrameTimer timer;
+    for (int frame = startFrame; ShouldRunFrame(recorder) && (!exporting || exportFramesLeft > 0); frame++)
+    {
+        if (IsKeyPressed(PROFILER_TOGGLE_KEY))
+        {
+            profiler.visible = !profiler.visible;
+        }
+        bool saveSnapshot = IsKeyPressed(SNAPSHOT_SAVE_KEY) && config.snapshotPath[0] != '\0';
+        if (saveSnapshot && emitting)
+        {
+            TraceLog(LOG_WARNING, "SNAPSHOT: Snapshots hold no particle lifetimes, not saving while emitters run");
+            saveSnapshot = false;
+        }
+        if (saveSnapshot && compact)
+        {
+            TraceLog(LOG_WARNING, "SNAPSHOT: Snapshots hold full precision particles, not saving compact storage");
+            saveSnapshot = false;
+        }
+        if (snapshotWriter && PollSnapshotWriter(snapshotWriter, &snapshotStatus))
+        {
+            TraceLog(snapshotStatus == SNAPSHOT_OK ? LOG_INFO : LOG_WARNING, "SNAPSHOT: Saving '%s': %s",
+                     config.snapshotPath, GetSnapshotStatusText(snapshotStatus));
+        }
+
+        BeginFrameTimer(&timer);
+        SampleAttractorPointer(&input);
+        if (config.audioDrive > 0.0f)
+        {
+            ScalePointerAttractor(&field, 1.0f + config.audioDrive * GetAudioBassLevel(audio));
+        }
+        int steps = 1;
+        if (pipelined)
+        {
+            // Only the part of the step that did not fit behind the last present is paid here
+            SimpleThreadPool_Wait(pool);
+            front = !front;
+        }
+        else
+        {
+            steps = fixedRate ? AdvanceStepClock(&stepClock, GetTime()) : 1;
+            for (int s = 0; s < steps; s++, step++)
+            {
+                if (governing)
+                {
+                    particles[front].count = governor.activeCount;
+                    compactParticles[front].count = governor.activeCount;
+                }
+                if (emitting)
+                {
+                    UpdateParticleEmitters(&emitters, &particles[front], step);
+                }
+                UpdateForceField(&field, GetStepAttractor(&input, step, (float)(s + 1) / (float)steps), step);
+                if (repel)
+                {
+                    ApplyParticleRepulsion(&grid, pool, &particles[front]);
+                }
+                UpdateParticlesMultithreaded(pool, &particleUpdate, &field, s == steps - 1);
+            }
+        }
+        EndFramePhase(&timer, FRAME_PHASE_INTEGRATE);
+
+        // A frame without a step leaves the bitmaps empty and the texture as it was
+        const bool stepped = steps > 0;
+
+        // tranform particles to buffer, unless the update phase already did
+        if (!fused && stepped)
+        {
+            SetRasterizeParticles(&rasterize, &particles[front]);
+            SimpleThreadPool_Run(pool, &rasterize.phase);
+        }
+        EndFramePhase(&timer, FRAME_PHASE_RASTERIZE);
+
+        // merge the dirty bands of the per-thread buffers into pixels, in parallel, or straight
+        // into a pixel buffer of the GPU when one is free
+        Color *mappedPixels = NULL;
+        if (stepped)
+        {
+            mappedPixels = pbo ? AcquirePixelBuffer(&pixelRing) : NULL;
+            SetCombinePixels(&combine, mappedPixels ? mappedPixels : pixels, mappedPixels != NULL);
+            CollectDirtyBands(&dirty, buffers, bufferCount);
+            PrepareCombinePhase(&combine);
+            SimpleThreadPool_Run(pool, &combine.phase);
+        }
+        EndFramePhase(&timer, FRAME_PHASE_COMBINE);
+
+        // The pool is idle and particles[front] holds the state this frame shows
+        if (saveSnapshot)
+        {
+            Particles saved = particles[front];
+            saved.count = config.particleCount; // Including the particles the governor holds back
+            SaveParticleSnapshot(&snapshotWriter, pool, &saved, &config, step);
+        }
+        if (exporting)
+        {
+            if (!ExportFrame(exporter, pool, pixels))
+            {
+                break;
+            }
+            exportFramesLeft--;
+        }
+
+        // Reordering the state the next step starts from changes nothing but the splat order
+        if (sorting)
+        {
+            StepParticleSorter(&sorter, pool, &particles[front], frame);
+        }
+
+        // The bitmaps are clear again and pixels is final, so the next step can start. It never
+        // writes particles[front], the state this frame was drawn from.
+        if (pipelined)
+        {
+            if (governing)
+            {
+                particles[front].count = governor.activeCount;
+                compactParticles[front].count = governor.activeCount;
+            }
+            if (emitting)
+            {
+                UpdateParticleEmitters(&emitters, &particles[front], step);
+            }
+            UpdateForceField(&field, GetStepAttractor(&input, step, 1.0f), step);
+            if (repel)
+            {
+                ApplyParticleRepulsion(&grid, pool, &particles[front]); // Only touches velocities, not what was drawn
+            }
+            if (compact)
+            {
+                SubmitCompactParticleUpdate(pool, &particleUpdate, &compactParticles[front],
+                                            &compactParticles[!front], &field);
+            }
+            else
+            {
+                SubmitParticleUpdate(pool, &particleUpdate, &particles[front], &particles[!front], &field);
+            }
+            step++;
+        }
+
+        // update the dirty part of the texture and draw
+        if (stepped)
+        {
+            UploadDirtyBands(mainBuffer.texture, pixels, &dirty, mappedPixels ? &pixelRing : NULL);
+        }
+        EndFramePhase(&timer, FRAME_PHASE_UPLOAD);
+
+        // The grid is scaled up to the display by the GPU, overlays in grid pixels with it
+        BeginDrawing();
+        ClearBackground(EMPTY_COLOR);
+        BeginMode2D(layout.camera);
+        DrawTexture(mainBuffer.texture, 0, 0, WHITE);
+        DrawForceField(&field);
+        EndMode2D();
+        DrawFPS(10, 10);
+        DrawFrameProfiler(&profiler, 10, 40, 1000.0f / TARGET_FPS); // Shows the history up to the previous frame
+        EndDrawing();
+        EndFramePhase(&timer, FRAME_PHASE_PRESENT);
+
+        if (recorder)
+        {
+            RecordBenchmarkFrame(recorder, &timer);
+        }
+        if (governing)
+        {
+            UpdateQualityGovernor(&governor, &timer, frame);
+        }
+        if (profiler.workerBusyMs)
+        {
+            for (int w = 0; w < SimpleThreadPool_ThreadCount(pool); w++)
+            {
+                workerBusy[w] = SimpleThreadPool_ConsumeBusyTime(pool, w);
+            }
+            RecordProfilerFrame(&profiler, &timer, workerBusy);
+        }
+    }
+
+    if (pipelined)
+    {
+        SimpleThreadPool_Wait(pool); // The step started by the last frame
+    }
+
+    if (recorder)
+    {
+        WriteBenchmarkCsv(recorder, &config, stdout);
+    }
+    FreeFrameProfiler(&profiler);
+    if (fixedRate)
+    {
+        TraceLog(LOG_INFO, "STEP: %lld steps at %d per second, %lld dropped by frames that fell behind",
+                 stepClock.steps, config.stepRate, stepClock.droppedSteps);
+    }
+    if (governing)
+    {
+        LogQualityGovernorSummary(&governor);
+    }
+    DestroySnapshotWriter(snapshotWriter); // Completes a save still being written
+
+    // Waits for the encoder to write the frames still in the ring
+    FrameExportStats exportStats;
+    bool exported = FinishFrameExport(exporter, &exportStats);
+    if (exporting)
+    {
+        TraceLog(exported ? LOG_INFO : LOG_ERROR, "EXPORT: Wrote %d of %d frames to '%s', %d waited for the encoder",
+                 exportStats.framesWritten, exportStats.framesSubmitted, config.exportPath, exportStats.stalls);
+    }
+
+    if (pbo)
+    {
+        TraceLog(LOG_INFO, "UPLOAD: %d of %d frames found every pixel buffer in use and were copied",
+                 pixelRing.busyFrames, pixelRing.frames);
+        UnloadPixelBufferRing(&pixelRing);
+    }
+    if (repel)
+    {
+        FreeSpatialGrid(&grid);
+    }
+    if (emitting)
+    {
+        FreeParticleEmitters(&emitters);
+    }
+    if (sorting)
+    {
+        FreeParticleSorter(&sorter);
+    }
+    if (!restored)
+    {
+        FreeParticles(&particles[0]); // A restored particles[0] is the snapshot mapping
+    }
+    if (pipelined)
+    {
+        FreeParticles(&particles[1]);
+    }
+    if (compact)
+    {
+        FreeCompactParticles(&compactParticles[0]);
+        FreeCompactParticles(&compactParticles[1]);
+    }
+    for (int i = 0; i < bufferCount; i++)
+    {
+        FreeOccupancyBitmap(&buffers[i]);
+    }
+    FreeDirtyBands(&dirty);
+    free(pixels);
+    UnloadRenderTexture(mainBuffer);
+    status = exported ? 0 : 1;
+
+cleanup:
+    // Close the window and clean up resources
+    if (recorder)
+    {
+        FreeBenchmarkRecorder(recorder);
+    }
+    CloseInputRecorder(&inputRecorder);
+    FreeInputReplay(&replay);
+    UnmapParticleSnapshot(&snapshot);
+    StopAudioPlayer(audio);
+    if (IsAudioDeviceReady())
+    {
+        CloseAudioDevice();
+    }
+    if (IsWindowReady())
+    {
+        CloseWindow();
+    }
+    SimpleThreadPool_Destroy(pool);
+
+    return status;
+}
+
+/* ========================================================================= */
+/*                            Private functions                              */
+/* ========================================================================= */
+bool RunGpuBackend(const SimulationConfig *config, const DisplayLayout *layout, AttractorInput *input, const AudioPlayer *audio,
+                   BenchmarkRecorder *recorder, const ParticleSnapshot *snapshot)
+{
+    GpuParticles gpuParticles;
+    bool ready;
+    if (snapshot)
+    {
+        ready = InitGpuParticles(&gpuParticles, &snapshot->particles);
+    }
+    else
+    {
+        Particles initial = CreateParticles(config->particleCount, config->screenWidth, config->screenHeight);
+        ready = InitGpuParticles(&gpuParticles, &initial);
+        FreeParticles(&initial); // The state now lives in GPU buffers only
+    }
+
+    if (!ready)
+    {
+        return false;
+    }
+    if (config->repulsion > 0.0f)
+    {
+        TraceLog(LOG_WARNING, "GPU: Particle repulsion is only implemented on the CPU backend, ignoring it");
+    }
+    if (config->renderMode == RENDER_DENSITY)
+    {
+        TraceLog(LOG_WARNING, "GPU: Density rendering is only implemented on the CPU backend, ignoring it");
+    }
+    if (config->emitters.count > 0)
+    {
+        TraceLog(LOG_WARNING, "GPU: Emitters are only implemented on the CPU backend, ignoring them");
+    }
+    if (config->sortInterval > 0)
+    {
+        TraceLog(LOG_WARNING, "GPU: Particle re-sorting is only implemented on the CPU backend, ignoring it");
+    }
+    if (config->pixelUpload == UPLOAD_PBO)
+    {
+        TraceLog(LOG_INFO, "GPU: The compute backend has no pixels to upload, ignoring the pixel buffers");
+    }
+    if (config->storage == STORAGE_COMPACT)
+    {
+        TraceLog(LOG_WARNING, "GPU: Compact particle storage is only implemented on the CPU backend, ignoring it");
+    }
+    if (config->governor)
+    {
+        TraceLog(LOG_WARNING, "GPU: The quality governor is only implemented on the CPU backend, ignoring it");
+    }
+    if (config->stepRate > 0)
+    {
+        TraceLog(LOG_WARNING, "GPU: Fixed-rate stepping is only implemented on the CPU backend, stepping once per frame");
+    }
+
+    // Only the integrate and present phases exist here. Their CPU timestamps mostly measure
+    // command submission; the GPU work itself is paid for in the swap at the end of present.
+    ForceField field;
+    InitForceField(&field, config);
+
+    FrameTimer timer;
+    for (int frame = snapshot ? snapshot->header.frame : 0; ShouldRunFrame(recorder); frame++)
+    {
+        BeginFrameTimer(&timer);
+        SampleAttractorPointer(input);
+        if (config->audioDrive > 0.0f)
+        {
+            ScalePointerAttractor(&field, 1.0f + config->audioDrive * GetAudioBassLevel(audio));
+        }
+        UpdateForceField(&field, GetStepAttractor(input, frame, 1.0f), frame);
+        UpdateGpuParticles(&gpuParticles, &field, config->friction);
+        EndFramePhase(&timer, FRAME_PHASE_INTEGRATE);
+
+        BeginDrawing();
+        ClearBackground(EMPTY_COLOR);
+        BeginMode2D(layout->camera);
+        DrawGpuParticles(&gpuParticles, OCCUPIED_COLOR, layout->camera.zoom);
+        DrawForceField(&field);
+        EndMode2D();
+        DrawFPS(10, 10);
+        EndDrawing();
+        EndFramePhase(&timer, FRAME_PHASE_PRESENT);
+
+        if (recorder)
+        {
+            RecordBenchmarkFrame(recorder, &timer);
+        }
+    }
+
+    UnloadGpuParticles(&gpuParticles);
+    return true;
+}
+
+bool RunClusterBackend(const SimulationConfig *config, const DisplayLayout *layout, AttractorInput *input,
+                       const AudioPlayer *audio, BenchmarkRecorder *recorder, SimpleThreadPool *pool)
+{
+    const int width = config->screenWidth;
+    const int height = config->screenHeight;
+    const int nodeCount = config->clusterNodes;
+    const ParticleKernels *kernels = SelectParticleKernels(config->simdLevel);
+
+    // The mirrors are the lasting state; the bands to repaint are staged into one bitmap per
+    // node, which the combine phase merges and clears again as on the CPU path. All of it is
+    // allocated before any node is waited for.
+    Color *pixels = (Color *)malloc((size_t)width * height * sizeof(Color));
+    DirtyBands dirty = AllocateDirtyBands(height); // Only the list is used, the nodes track what they painted
+    OccupancyBitmap staged[MAX_THREADS];
+    bool allocated = pixels && dirty.painted && dirty.list;
+    for (int n = 0; n < nodeCount; n++)
+    {
+        staged[n] = AllocateOccupancyBitmap(width, height, false);
+        allocated = allocated && staged[n].words && staged[n].bandTouched;
+    }
+
+    ClusterCompositor compositor;
+    bool started = false;
+    if (!allocated)
+    {
+        TraceLog(LOG_ERROR, "CLUSTER: Failed to allocate the buffers of a %dx%d scene", width, height);
+    }
+    else if (!ClusterNetStartup())
+    {
+        TraceLog(LOG_ERROR, "CLUSTER: Failed to initialize the sockets");
+    }
+    else if (!StartClusterCompositor(&compositor, config))
+    {
+        ClusterNetCleanup();
+    }
+    else
+    {
+        started = true;
+    }
+    if (!started)
+    {
+        for (int n = 0; n < nodeCount; n++)
+        {
+            FreeOccupancyBitmap(&staged[n]);
+        }
+        FreeDirtyBands(&dirty);
+        free(pixels);
+        return false;
+    }
+
+    RenderTexture2D mainBuffer = LoadRenderTexture(width, height);
+    kernels->fill(pixels, width * height, EMPTY_COLOR);
+    UpdateTexture(mainBuffer.texture, pixels);
+
+    CombinePhase combine;
+    InitCombinePhase(&combine, staged, nodeCount, SimpleThreadPool_ThreadCount(pool), pixels, &dirty, kernels,
+                     NULL);
+
+    ForceField field;
+    InitForceField(&field, config);
+
+    // The nodes step in lockstep with the frames: each frame waits for the slowest node
+    FrameTimer timer;
+    bool connected = true;
+    for (int frame = 0; connected && ShouldRunFrame(recorder); frame++)
+    {
+        BeginFrameTimer(&timer);
+        SampleAttractorPointer(input);
+        if (config->audioDrive > 0.0f)
+        {
+            ScalePointerAttractor(&field, 1.0f + config->audioDrive * GetAudioBassLevel(audio));
+        }
+        UpdateForceField(&field, GetStepAttractor(input, frame, 1.0f), frame);
+        connected = BroadcastClusterTick(&compositor, &field, frame) && GatherClusterFrames(&compositor, frame);
+        EndFramePhase(&timer, FRAME_PHASE_INTEGRATE);
+
+        dirty.listCount = StageClusterBands(&compositor, staged, dirty.list);
+        PrepareCombinePhase(&combine);
+        SimpleThreadPool_Run(pool, &combine.phase);
+        EndFramePhase(&timer, FRAME_PHASE_COMBINE);
+
+        UploadDirtyBands(mainBuffer.texture, pixels, &dirty, NULL);
+        EndFramePhase(&timer, FRAME_PHASE_UPLOAD);
+
+        BeginDrawing();
+        ClearBackground(EMPTY_COLOR);
+        BeginMode2D(layout->camera);
+        DrawTexture(mainBuffer.texture, 0, 0, WHITE);
+        DrawForceField(&field);
+        EndMode2D();
+        DrawFPS(10, 10);
+        EndDrawing();
+        EndFramePhase(&timer, FRAME_PHASE_PRESENT);
+
+        if (recorder)
+        {
+            RecordBenchmarkFrame(recorder, &timer);
+        }
+    }
+
+    LogClusterSummary(&compositor);
+    StopClusterCompositor(&compositor);
+    ClusterNetCleanup();
+    UnloadRenderTexture(mainBuffer);
+    for (int n = 0; n < nodeCount; n++)
+    {
+        FreeOccupancyBitmap(&staged[n]);
+    }
+    FreeDirtyBands(&dirty);
+    free(pixels);
+    return true;
+}
+
+int RunClusterNode(const SimulationConfig *config, SimpleThreadPool *pool)
+{
+    if (!ClusterNetStartup())
+    {
+        TraceLog(LOG_ERROR, "CLUSTER: Failed to initialize the sockets");
+        return 1;
+    }
+    ClusterNodeLink link;
+    if (!ConnectClusterNode(&link, config->clusterHost, config->clusterPort))
+    {
+        ClusterNetCleanup();
+        return 1;
+    }
+
+    // The compositor's scene, restricted to this node's shard
+    const ClusterSetup *setup = &link.setup;
+    SimulationConfig scene = *config;
+    scene.screenWidth = setup->gridWidth;
+    scene.screenHeight = setup->gridHeight;
+    scene.particleCount = setup->shardEnd - setup->shardStart;
+    scene.friction = setup->friction;
+    scene.fastMath = setup->fastMath;
+
+    // Every step is splatted by the fused update, each worker into its own bitmap
+    const ParticleKernels *kernels = SelectParticleKernels(config->simdLevel);
+    const int threadCount = SimpleThreadPool_ThreadCount(pool);
+    OccupancyBitmap buffers[MAX_THREADS];
+    bool allocated = true;
+    for (int i = 0; i < threadCount; i++)
+    {
+        buffers[i] = AllocateOccupancyBitmap(scene.screenWidth, scene.screenHeight, false);
+        allocated = allocated && buffers[i].words && buffers[i].bandTouched;
+    }
+    Particles particles = AllocateParticles(scene.particleCount);
+    if (!allocated || !particles.posX)
+    {
+        TraceLog(LOG_ERROR, "CLUSTER: Failed to allocate a shard of %d particles on a %dx%d grid", scene.particleCount,
+                 scene.screenWidth, scene.screenHeight);
+        FreeParticles(&particles);
+        for (int i = 0; i < threadCount; i++)
+        {
+            FreeOccupancyBitmap(&buffers[i]);
+        }
+        CloseClusterNode(&link);
+        ClusterNetCleanup();
+        return 1;
+    }
+    ParticleUpdatePhase update;
+    InitParticleUpdatePhase(&update, &particles, NULL, &scene, buffers, kernels);
+    FirstTouchParticles(pool, &particles, NULL, &update, setup->shardStart, scene.screenWidth, scene.screenHeight);
+
+    ForceField field = {0}; // Every tick brings the attractors of its step
+    int step = 0;
+    int steps = 0;
+    while (ReceiveClusterTick(&link, &field, &step))
+    {
+        double start = SimpleThreadPool_GetTime();
+        UpdateParticlesMultithreaded(pool, &update, &field, true);
+        float stepMs = (float)((SimpleThreadPool_GetTime() - start) * 1000.0);
+        if (!SendClusterFrame(&link, buffers, threadCount, step, stepMs))
+        {
+            break;
+        }
+        steps++;
+    }
+    TraceLog(LOG_INFO, "CLUSTER: The compositor hung up after %d steps", steps);
+
+    CloseClusterNode(&link);
+    ClusterNetCleanup();
+    FreeParticles(&particles);
+    for (int i = 0; i < threadCount; i++)
+    {
+        FreeOccupancyBitmap(&buffers[i]);
+    }
+    return 0;
+}
+
+bool ApplySnapshotConfig(SimulationConfig *config, const ParticleSnapshot *snapshot)
+{
+    const SnapshotHeader *header = &snapshot->header;
+    if (config->screenWidth == 0 && config->screenHeight == 0)
+    {
+        config->screenWidth = header->screenWidth;
+        config->screenHeight = header->screenHeight;
+    }
+    else if (header->screenWidth != config->screenWidth || header->screenHeight != config->screenHeight)
+    {
+        TraceLog(LOG_WARNING, "SNAPSHOT: Captured at %dx%d, running at %dx%d", header->screenWidth, header->screenHeight,
+                 config->screenWidth, config->screenHeight);
+    }
+
+    config->particleCount = header->particleCount;
+    config->attractionStrength = header->attractionStrength;
+    config->friction = header->friction;
+    config->repulsion = header->repulsion;
+    config->repulsionRadius = header->repulsionRadius;
+    return ValidateSimulationConfig(config);
+}
+
+void SaveParticleSnapshot(SnapshotWriter **writer, SimpleThreadPool *pool, const Particles *particles,
+                          const SimulationConfig *config, int frame)
+{
+    if (!*writer)
+    {
+        *writer = CreateSnapshotWriter(particles->count);
+        if (!*writer)
+        {
+            TraceLog(LOG_WARNING, "SNAPSHOT: Failed to allocate the staging copy");
+            return;
+        }
+    }
+
+    SnapshotStatus status = BeginSnapshotSave(*writer, pool, particles, config, frame, config->snapshotPath);
+    if (status != SNAPSHOT_OK)
+    {
+        TraceLog(LOG_WARNING, "SNAPSHOT: Cannot save '%s': %s", config->snapshotPath, GetSnapshotStatusText(status));
+    }
+}
+
+bool ExportFrame(FrameExporter *exporter, SimpleThreadPool *pool, const Color *pixels)
+{
+    if (!SubmitExportFrame(exporter, pool, pixels))
+    {
+        TraceLog(LOG_ERROR, "EXPORT: The encoder failed to write a frame, stopping the export");
+        return false;
+    }
+    return true;
+}
+
+bool ShouldRunFrame(const BenchmarkRecorder *recorder)
+{
+    return recorder ? !BenchmarkFinished(recorder) : !WindowShouldClose();
+}
+
+void SampleAttractorPointer(AttractorInput *input)
+{
+    if (input->scripted || input->replay)
+    {
+        return;
+    }
+    input->pointerTo = DisplayToSimulation(input->layout, GetMousePosition());
+}
+
+Vector2 GetStepAttractor(AttractorInput *input, int step, float progress)
+{
+    Vector2 position;
+    if (input->replay)
+    {
+        position = GetReplayInput(input->replay, step);
+    }
+    else if (input->scripted)
+    {
+        position = GetBenchmarkAttractor(step, input->layout->simWidth, input->layout->simHeight);
+    }
+    else
+    {
+        // Catch-up steps sweep the pointer's path over the frame instead of jumping to its end
+        position = (Vector2){
+            input->pointerFrom.x + (input->pointerTo.x - input->pointerFrom.x) * progress,
+            input->pointerFrom.y + (input->pointerTo.y - input->pointerFrom.y) * progress
+        };
+        if (progress >= 1.0f)
+        {
+            input->pointerFrom = input->pointerTo;
+        }
+    }
+
+    if (input->recorder)
+    {
+        RecordInputStep(input->recorder, position);
+    }
+    return position;
+}
+
+void UpdateParticlesWorkCallback(void *Context, int Start, int End, int WorkerIndex)
+{
+    ThreadArgs *args = (ThreadArgs *)Context;
+
+    // Splat into the private bitmap of the worker running this chunk, if fused. A stolen chunk
+    // goes to the thief's bitmap; the combine phase merges all of them anyway.
+    OccupancyBitmap *splat = args->buffers ? &args->buffers[WorkerIndex] : NULL;
+    if (args->integrateCompact)
+    {
+        args->integrateCompact(args->compactSource, args->compactTarget, Start, End, &args->params, splat);
+        return;
+    }
+    args->integrate(args->source, args->target, Start, End, &args->params, splat);
+}
+
+void InitRasterizePhase(RasterizePhase *raster, OccupancyBitmap *buffers, int jobCount, Particles *particles)
+{
+    for (int i = 0; i < jobCount; i++)
+    {
+        raster->contexts[i] = (UpdateContext){
+            .buffer = &buffers[i],                                         // Private bitmap of this job
+            .particles = particles,                                        // Pointer to the particle data
+            .start = (int)((long long)particles->count * i / jobCount),    // First particle of the slice
+            .end = (int)((long long)particles->count * (i + 1) / jobCount) // One past the last particle
+        };
+    }
+
+    raster->phase = (SimpleThreadPoolPhase){
+        .job = UpdateBufferWorkCallback,
+        .contexts = raster->contexts,
+        .contextSize = sizeof(UpdateContext),
+        .jobCount = jobCount,
+        .pinnedJobs = true // Reads roughly the particle slice the same worker just integrated
+    };
+}
+
+void SetRasterizeParticles(RasterizePhase *raster, Particles *particles)
+{
+    const int jobCount = raster->phase.jobCount;
+    for (int i = 0; i < jobCount; i++)
+    {
+        raster->contexts[i].particles = particles;
+        raster->contexts[i].start = (int)((long long)particles->count * i / jobCount);
+        raster->contexts[i].end = (int)((long long)particles->count * (i + 1) / jobCount);
+    }
+}
+
+void InitCombinePhase(CombinePhase *combine, OccupancyBitmap *buffers, int bufferCount, int maxJobs, Color *pixels,
+                      const DirtyBands *dirty, const ParticleKernels *kernels, const uint32_t *palette)
+{
+    for (int i = 0; i < maxJobs; i++)
+    {
+        combine->contexts[i] = (CombineContext){
+            .buffers = buffers,
+            .bufferCount = bufferCount,
+            .pixels = pixels,
+            .stream = false,
+            .dirty = dirty,
+            .listStart = 0,
+            .listEnd = 0,
+            .kernels = kernels,
+            .palette = palette
+        };
+    }
+
+    combine->maxJobs = maxJobs;
+    combine->phase = (SimpleThreadPoolPhase){
+        .job = CombineBuffersWorkCallback,
+        .contexts = combine->contexts,
+        .contextSize = sizeof(CombineContext),
+        .jobCount = 0 // Set every frame by PrepareCombinePhase()
+    };
+}
+
+void PrepareCombinePhase(CombinePhase *combine)
+{
+    const int listCount = combine->contexts[0].dirty->listCount;
+    const int jobCount = listCount < combine->maxJobs ? listCount : combine->maxJobs;
+
+    for (int i = 0; i < jobCount; i++)
+    {
+        combine->contexts[i].listStart = listCount * i / jobCount;
+        combine->contexts[i].listEnd = listCount * (i + 1) / jobCount;
+    }
+    combine->phase.jobCount = jobCount;
+}
+
+void SetCombinePixels(CombinePhase *combine, Color *pixels, bool stream)
+{
+    for (int i = 0; i < combine->maxJobs; i++)
+    {
+        combine->contexts[i].pixels = pixels;
+        combine->contexts[i].stream = stream;
+    }
+}
+
+DirtyBands AllocateDirtyBands(int height)
+{
+    DirtyBands dirty;
+    dirty.bandCount = (height + (1 << DIRTY_BAND_SHIFT) - 1) >> DIRTY_BAND_SHIFT;
+    dirty.painted = (uint8_t *)malloc(dirty.bandCount * sizeof(uint8_t));
+    dirty.list = (int *)malloc(dirty.bandCount * sizeof(int));
+    dirty.listCount = 0;
+
+    if (dirty.painted)
+    {
+        memset(dirty.painted, 1, dirty.bandCount * sizeof(uint8_t));
+    }
+
+    return dirty;
+}
+
+void FreeDirtyBands(DirtyBands *dirty)
+{
+    free(dirty->painted);
+    free(dirty->list);
+    dirty->painted = NULL;
+    dirty->list = NULL;
+}
+
+void CollectDirtyBands(DirtyBands *dirty, const OccupancyBitmap *buffers, int bufferCount)
+{
+    dirty->listCount = 0;
+    for (int band = 0; band < dirty->bandCount; band++)
+    {
+        uint8_t touched = 0;
+        for (int b = 0; b < bufferCount; b++)
+        {
+            touched |= buffers[b].bandTouched[band];
+        }
+
+        // Repaint what is drawn now as well as what was drawn last frame, to erase it
+        if (touched || dirty->painted[band])
+        {
+            dirty->list[dirty->listCount++] = band;
+        }
+        dirty->painted[band] = touched;
+    }
+}
+
+void UploadDirtyBands(Texture2D texture, const Color *pixels, const DirtyBands *dirty, PixelBufferRing *ring)
+{
+    const int width = texture.width;
+    const int height = texture.height;
+
+    if (ring)
+    {
+        BeginPixelBufferUpload(ring);
+    }
+
+    for (int i = 0; i < dirty->listCount;)
+    {
+        // Extend the run while the following bands are dirty too
+        int firstBand = dirty->list[i];
+        int lastBand = firstBand;
+        for (i++; i < dirty->listCount && dirty->list[i] == lastBand + 1; i++)
+        {
+            lastBand++;
+        }
+
+        int rowStart = firstBand << DIRTY_BAND_SHIFT;
+        int rowEnd = (lastBand + 1) << DIRTY_BAND_SHIFT;
+        if (rowEnd > height)
+        {
+            rowEnd = height;
+        }
+
+        if (ring)
+        {
+            UploadPixelBufferRows(ring, texture, rowStart, rowEnd);
+            continue;
+        }
+        Rectangle rec = {0.0f, (float)rowStart, (float)width, (float)(rowEnd - rowStart)};
+        UpdateTextureRec(texture, rec, &pixels[rowStart * width]);
+    }
+
+    if (ring)
+    {
+        EndPixelBufferUpload(ring);
+    }
+}
+
+void InitParticleUpdatePhase(ParticleUpdatePhase *update, Particles *particles, CompactParticles *compact,
+                             const SimulationConfig *config, OccupancyBitmap *buffers, const ParticleKernels *kernels)
+{
+    update->args.source = particles;
+    update->args.target = particles;
+    update->args.params = (IntegrateParams){
+        .attractors = NULL, // Set by every submit
+        .attractorCount = 0,
+        .friction = config->friction
+    };
+    update->args.integrate = config->fastMath ? kernels->integrateFast : kernels->integrate;
+    update->args.buffers = buffers;
+    update->splatBuffers = buffers;
+    update->args.compactSource = compact;
+    update->args.compactTarget = compact;
+    update->args.integrateCompact = NULL;
+    if (compact)
+    {
+        update->args.integrateCompact = config->fastMath ? kernels->integrateCompactFast : kernels->integrateCompact;
+    }
+
+    // Every worker keeps the same home run of chunks from frame to frame and only steals when
+    // it runs out, so the particle range is covered exactly once whatever the thread count.
+    update->phase = (SimpleThreadPoolRangePhase){
+        .job = UpdateParticlesWorkCallback,
+        .context = &update->args,
+        .itemCount = compact ? compact->count : particles->count,
+        .chunkSize = PARTICLE_CHUNK_SIZE
+    };
+}
+
+void FirstTouchParticles(SimpleThreadPool *pool, Particles *particles, CompactParticles *compact,
+                         const ParticleUpdatePhase *update, int shardStart, int screenWidth, int screenHeight)
+{
+    ParticleInitContext contexts[MAX_THREADS];
+    const int jobCount = SimpleThreadPool_ThreadCount(pool);
+
+    for (int i = 0; i < jobCount; i++)
+    {
+        contexts[i] = (ParticleInitContext){
+            .particles = particles,
+            .compact = compact,
+            .shardStart = shardStart,
+            .screenWidth = screenWidth,
+            .screenHeight = screenHeight
+        };
+        SimpleThreadPool_GetHomeRange(pool, &update->phase, i, &contexts[i].start, &contexts[i].end);
+    }
+
+    // One pinned job per worker, so job i runs on the worker that owns home run i
+    SimpleThreadPoolPhase phase = {
+        .job = InitializeParticlesWorkCallback,
+        .contexts = contexts,
+        .contextSize = sizeof(ParticleInitContext),
+        .jobCount = jobCount,
+        .pinnedJobs = true
+    };
+    SimpleThreadPool_Run(pool, &phase);
+}
+
+void InitializeParticlesWorkCallback(void *Context, int WorkerIndex)
+{
+    (void)WorkerIndex;
+
+    ParticleInitContext *init = (ParticleInitContext *)Context;
+    if (init->compact)
+    {
+        InitializeCompactParticleRange(init->compact, init->start, init->end, init->screenWidth, init->screenHeight);
+        return;
+    }
+    InitializeParticleShard(init->particles, init->start, init->end, init->shardStart, init->screenWidth,
+                            init->screenHeight);
+}
+
+void UpdateParticlesMultithreaded(SimpleThreadPool *pool, ParticleUpdatePhase *update, const ForceField *field, bool splat)
+{
+    update->args.buffers = splat ? update->splatBuffers : NULL;
+
+    // Single barrier for the whole phase
+    if (update->args.integrateCompact)
+    {
+        SubmitCompactParticleUpdate(pool, update, update->args.compactTarget, update->args.compactTarget, field);
+    }
+    else
+    {
+        SubmitParticleUpdate(pool, update, update->args.target, update->args.target, field);
+    }
+    SimpleThreadPool_Wait(pool);
+}
+
+void SubmitParticleUpdate(SimpleThreadPool *pool, ParticleUpdatePhase *update, const Particles *source, Particles *target,
+                          const ForceField *field)
+{
+    update->args.source = source;
+    update->args.target = target;
+    update->args.params.attractors = field->attractors;
+    update->args.params.attractorCount = field->count;
+    update->phase.itemCount = source->count; // Emitters change the live count between steps
+    target->count = source->count;
+    SimpleThreadPool_SubmitRange(pool, &update->phase);
+}
+
+void SubmitCompactParticleUpdate(SimpleThreadPool *pool, ParticleUpdatePhase *update, const CompactParticles *source,
+                                 CompactParticles *target, const ForceField *field)
+{
+    update->args.compactSource = source;
+    update->args.compactTarget = target;
+    update->args.params.attractors = field->attractors;
+    update->args.params.attractorCount = field->count;
+    update->phase.itemCount = source->count;
+    SimpleThreadPool_SubmitRange(pool, &update->phase);
+}
+
+void UpdateBufferWorkCallback(void *Context, int WorkerIndex)
+{
+    // Explicitly mark unused parameters to avoid compiler warnings
+    (void)WorkerIndex;
+
+    // Convert context to our structure that holds necessary information
+    UpdateContext *updateContext = (UpdateContext *)Context;
+
+    // Call the updated function that works with a boolean buffer
+    UpdateBufferWithParticles(updateContext->buffer, updateContext->particles,
+                              updateContext->start, updateContext->end);
+}
+
+void CombineBuffersWorkCallback(void *Context, int WorkerIndex)
+{
+    // Explicitly mark unused parameters to avoid compiler warnings
+    (void)WorkerIndex;
+
+    CombineContext *combineContext = (CombineContext *)Context;
+    const DirtyBands *dirty = combineContext->dirty;
+    const ParticleKernels *kernels = combineContext->kernels;
+    const bool stream = combineContext->stream;
+    OccupancyBitmap *touched[MAX_THREADS];
+
+    for (int i = combineContext->listStart; i < combineContext->listEnd; i++)
+    {
+        int band = dirty->list[i];
+
+        // Only merge the bitmaps that actually received particles in this band
+        int touchedCount = 0;
+        for (int b = 0; b < combineContext->bufferCount; b++)
+        {
+            OccupancyBitmap *buffer = &combineContext->buffers[b];
+            if (buffer->bandTouched[band])
+            {
+                buffer->bandTouched[band] = 0;
+                touched[touchedCount++] = buffer;
+            }
+        }
+
+        int rowStart = band << DIRTY_BAND_SHIFT;
+        int rowEnd = (band + 1) << DIRTY_BAND_SHIFT;
+        if (rowEnd > combineContext->buffers[0].height)
+        {
+            rowEnd = combineContext->buffers[0].height;
+        }
+
+        if (touchedCount == 0)
+        {
+            // Nothing was splatted here this frame, only erase what was drawn before
+            const int width = combineContext->buffers[0].width;
+            FillKernel fill = stream ? kernels->fillStream : kernels->fill;
+            fill(&combineContext->pixels[rowStart * width], (rowEnd - rowStart) * width, EMPTY_COLOR);
+        }
+        else if (combineContext->palette)
+        {
+            DensityCombineKernel combineDensity = stream ? kernels->combineDensityStream : kernels->combineDensity;
+            combineDensity(touched, touchedCount, combineContext->pixels, rowStart, rowEnd, combineContext->palette);
+        }
+        else
+        {
+            CombineKernel combine = stream ? kernels->combineStream : kernels->combine;
+            combine(touched, touchedCount, combineContext->pixels, rowStart, rowEnd);
+        }
+    }
+}
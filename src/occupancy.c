@@ -0,0 +1,118 @@
+#include "occupancy.h"
+#include "platform.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct PaletteStop
+{
+    float position; // Position on the logarithmic density scale, 0 for one particle, 1 at saturation
+    Color color;
+} PaletteStop;
+
+// Starts at OCCUPIED_COLOR so a lone particle looks the same in both render modes
+static const PaletteStop DensityStops[] = {
+    {0.00f, {0, 0, 0, 255}},
+    {0.35f, {150, 20, 10, 255}},
+    {0.65f, {240, 120, 0, 255}},
+    {0.85f, {255, 225, 60, 255}},
+    {1.00f, {255, 255, 255, 255}},
+};
+
+OccupancyBitmap AllocateOccupancyBitmap(int width, int height, bool density)
+{
+    OccupancyBitmap bitmap = {0};
+    bitmap.width = width;
+    bitmap.height = height;
+
+    if (density)
+    {
+        // Whole 64-byte rows, so the SIMD merges never need a tail
+        bitmap.countStride = (width + 63) & ~63;
+        size_t countSize = (size_t)bitmap.countStride * height;
+        bitmap.counts = (uint8_t *)AllocateAligned(countSize, 64);
+        if (bitmap.counts)
+        {
+            memset(bitmap.counts, 0, countSize);
+        }
+    }
+    else
+    {
+        bitmap.stride = (width + 31) / 32;
+
+        // Round the size up to whole 512-bit vectors so a whole-bitmap SIMD clear never needs a tail.
+        bitmap.wordCount = (bitmap.stride * height + 15) & ~15;
+        size_t totalSize = (size_t)bitmap.wordCount * sizeof(uint32_t);
+
+        // Allocate the memory with cache line alignment, enough for every vector width.
+        bitmap.words = (uint32_t *)AllocateAligned(totalSize, 64);
+
+        // Start with no pixel occupied.
+        if (bitmap.words)
+        {
+            memset(bitmap.words, 0, totalSize);
+        }
+    }
+
+    bitmap.bandCount = (height + (1 << DIRTY_BAND_SHIFT) - 1) >> DIRTY_BAND_SHIFT;
+    bitmap.bandTouched = (uint8_t *)calloc(bitmap.bandCount, sizeof(uint8_t));
+
+    return bitmap;
+}
+
+void UpdateBufferWithParticles(OccupancyBitmap *buffer, const Particles *particles, int start, int end)
+{
+    const int bufferWidth = buffer->width;
+    const int bufferHeight = buffer->height;
+
+    // Update buffer with particles
+    for (int i = start; i < end; i++)
+    {
+        int x = (int)particles->posX[i];
+        int y = (int)particles->posY[i];
+
+        // Ensure the particle is within the bounds of the buffer
+        if (x >= 0 && x < bufferWidth && y >= 0 && y < bufferHeight)
+        {
+            // Particle present at this position
+            MarkOccupiedPixel(buffer, x, y);
+        }
+    }
+}
+
+void FreeOccupancyBitmap(OccupancyBitmap *bitmap)
+{
+    FreeAligned(bitmap->words);
+    FreeAligned(bitmap->counts);
+    free(bitmap->bandTouched);
+    bitmap->words = NULL;
+    bitmap->counts = NULL;
+    bitmap->bandTouched = NULL;
+}
+
+void BuildDensityPalette(uint32_t *palette)
+{
+    palette[0] = PackColor(EMPTY_COLOR);
+    for (int count = 1; count < DENSITY_LEVELS; count++)
+    {
+        // Logarithmic, so the dense core near an attractor does not wash out the sparse halo
+        float t = logf((float)count) / logf((float)(DENSITY_LEVELS - 1));
+
+        int stop = 1;
+        while (DensityStops[stop].position < t)
+        {
+            stop++;
+        }
+        const PaletteStop *low = &DensityStops[stop - 1];
+        const PaletteStop *high = &DensityStops[stop];
+        float f = (t - low->position) / (high->position - low->position);
+
+        palette[count] = PackColor((Color){
+            (unsigned char)(low->color.r + f * (high->color.r - low->color.r) + 0.5f),
+            (unsigned char)(low->color.g + f * (high->color.g - low->color.g) + 0.5f),
+            (unsigned char)(low->color.b + f * (high->color.b - low->color.b) + 0.5f),
+            255
+        });
+    }
+}
@@ -0,0 +1,247 @@
+#include "particle_sort.h"
+#include "raylib.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* ========================================================================= */
+/*                            Private functions                              */
+/* ========================================================================= */
+
+// Spreads the low 16 bits of a value over the even bits of the result
+static inline uint32_t SpreadBits(uint32_t value)
+{
+    value &= 0x0000FFFFu;
+    value = (value | (value << 8)) & 0x00FF00FFu;
+    value = (value | (value << 4)) & 0x0F0F0F0Fu;
+    value = (value | (value << 2)) & 0x33333333u;
+    value = (value | (value << 1)) & 0x55555555u;
+    return value;
+}
+
+static inline uint32_t QuantizeCoordinate(float position, float scale)
+{
+    // Particles off screen share the border cells; NaN compares false and lands in cell 0
+    float cell = position * scale;
+    if (!(cell > 0.0f))
+    {
+        return 0;
+    }
+    return cell >= (float)((1 << SORT_KEY_BITS) - 1) ? (1u << SORT_KEY_BITS) - 1 : (uint32_t)cell;
+}
+
+static void ComputeKeysWorkCallback(void *Context, int WorkerIndex)
+{
+    (void)WorkerIndex;
+    SortJobContext *job = (SortJobContext *)Context;
+    ParticleSorter *sorter = job->sorter;
+    const Particles *particles = sorter->particles;
+    uint32_t *keys = sorter->keys[0];
+    int *order = sorter->order[0];
+
+    for (int i = job->start; i < job->end; i++)
+    {
+        uint32_t x = QuantizeCoordinate(particles->posX[i], sorter->scale);
+        uint32_t y = QuantizeCoordinate(particles->posY[i], sorter->scale);
+        keys[i] = SpreadBits(x) | (SpreadBits(y) << 1);
+        order[i] = i;
+    }
+}
+
+static int CurrentShift(const ParticleSorter *sorter)
+{
+    return (sorter->stage - 2) * SORT_RADIX_BITS; // Stage 2 runs the first pass
+}
+
+static void CountDigitsWorkCallback(void *Context, int WorkerIndex)
+{
+    (void)WorkerIndex;
+    SortJobContext *job = (SortJobContext *)Context;
+    const uint32_t *keys = job->sorter->keys[job->sorter->current];
+    const int shift = CurrentShift(job->sorter);
+
+    memset(job->histogram, 0, sizeof(job->histogram));
+    for (int i = job->start; i < job->end; i++)
+    {
+        job->histogram[(keys[i] >> shift) & (SORT_RADIX - 1)]++;
+    }
+}
+
+static void ScatterKeysWorkCallback(void *Context, int WorkerIndex)
+{
+    (void)WorkerIndex;
+    SortJobContext *job = (SortJobContext *)Context;
+    ParticleSorter *sorter = job->sorter;
+    const uint32_t *keys = sorter->keys[sorter->current];
+    const int *order = sorter->order[sorter->current];
+    uint32_t *sortedKeys = sorter->keys[!sorter->current];
+    int *sortedOrder = sorter->order[!sorter->current];
+    const int shift = CurrentShift(sorter);
+
+    // Every job owns a disjoint run of slots per digit, filled in its slice's order, so the
+    // pass is stable and the result does not depend on scheduling
+    for (int i = job->start; i < job->end; i++)
+    {
+        uint32_t slot = job->histogram[(keys[i] >> shift) & (SORT_RADIX - 1)]++;
+        sortedKeys[slot] = keys[i];
+        sortedOrder[slot] = order[i];
+    }
+}
+
+static void GatherParticlesWorkCallback(void *Context, int Start, int End, int WorkerIndex)
+{
+    (void)WorkerIndex;
+    ParticleSorter *sorter = (ParticleSorter *)Context;
+    const Particles *particles = sorter->particles;
+    Particles *staging = &sorter->staging;
+    const int *order = sorter->order[sorter->current];
+
+    for (int i = Start; i < End; i++)
+    {
+        int source = order[i];
+        staging->posX[i] = particles->posX[source];
+        staging->posY[i] = particles->posY[source];
+        staging->velX[i] = particles->velX[source];
+        staging->velY[i] = particles->velY[source];
+    }
+}
+
+static void CopyParticlesWorkCallback(void *Context, int Start, int End, int WorkerIndex)
+{
+    (void)WorkerIndex;
+    ParticleSorter *sorter = (ParticleSorter *)Context;
+    Particles *particles = sorter->particles;
+    const Particles *staging = &sorter->staging;
+    size_t bytes = (size_t)(End - Start) * sizeof(float);
+
+    memcpy(particles->posX + Start, staging->posX + Start, bytes);
+    memcpy(particles->posY + Start, staging->posY + Start, bytes);
+    memcpy(particles->velX + Start, staging->velX + Start, bytes);
+    memcpy(particles->velY + Start, staging->velY + Start, bytes);
+}
+
+static void RunRadixPass(ParticleSorter *sorter, SimpleThreadPool *pool)
+{
+    SimpleThreadPool_Run(pool, &sorter->histogramPhase);
+
+    // Exclusive prefix over digits first and jobs second gives every job its first slot per digit
+    uint32_t slot = 0;
+    for (int digit = 0; digit < SORT_RADIX; digit++)
+    {
+        for (int j = 0; j < sorter->histogramPhase.jobCount; j++)
+        {
+            uint32_t count = sorter->jobs[j].histogram[digit];
+            sorter->jobs[j].histogram[digit] = slot;
+            slot += count;
+        }
+    }
+
+    SimpleThreadPool_Run(pool, &sorter->scatterPhase);
+    sorter->current = !sorter->current;
+}
+
+/* ========================================================================= */
+/*                            Public functions                               */
+/* ========================================================================= */
+bool InitParticleSorter(ParticleSorter *sorter, int particleCount, int width, int height, int interval, int jobCount)
+{
+    *sorter = (ParticleSorter){0};
+    sorter->count = particleCount;
+    sorter->interval = interval;
+
+    // Full pixel resolution up to 4096 pixels per side, coarser cells beyond
+    int longest = width > height ? width : height;
+    sorter->scale = longest > (1 << SORT_KEY_BITS) ? (float)(1 << SORT_KEY_BITS) / (float)longest : 1.0f;
+
+    for (int b = 0; b < 2; b++)
+    {
+        sorter->keys[b] = (uint32_t *)malloc((size_t)particleCount * sizeof(uint32_t));
+        sorter->order[b] = (int *)malloc((size_t)particleCount * sizeof(int));
+    }
+    sorter->staging = AllocateParticles(particleCount);
+    if (!sorter->keys[0] || !sorter->keys[1] || !sorter->order[0] || !sorter->order[1] || !sorter->staging.posX ||
+        !sorter->staging.posY || !sorter->staging.velX || !sorter->staging.velY)
+    {
+        TraceLog(LOG_ERROR, "SORT: Failed to allocate the sort buffers for %d particles", particleCount);
+        FreeParticleSorter(sorter);
+        return false;
+    }
+
+    // The key and radix phases split the particles into one contiguous slice per job
+    for (int j = 0; j < jobCount; j++)
+    {
+        sorter->jobs[j] = (SortJobContext){
+            .sorter = sorter,
+            .start = (int)((long long)particleCount * j / jobCount),
+            .end = (int)((long long)particleCount * (j + 1) / jobCount)
+        };
+    }
+
+    sorter->keyPhase = (SimpleThreadPoolPhase){
+        .job = ComputeKeysWorkCallback,
+        .contexts = sorter->jobs,
+        .contextSize = sizeof(SortJobContext),
+        .jobCount = jobCount,
+        .pinnedJobs = true // Both halves of a pass read the same slice, keep it in the same cache
+    };
+    sorter->histogramPhase = sorter->keyPhase;
+    sorter->histogramPhase.job = CountDigitsWorkCallback;
+    sorter->scatterPhase = sorter->keyPhase;
+    sorter->scatterPhase.job = ScatterKeysWorkCallback;
+
+    sorter->gatherPhase = (SimpleThreadPoolRangePhase){
+        .job = GatherParticlesWorkCallback,
+        .context = sorter,
+        .itemCount = particleCount,
+        .chunkSize = SORT_CHUNK_SIZE
+    };
+    sorter->copyPhase = sorter->gatherPhase;
+    sorter->copyPhase.job = CopyParticlesWorkCallback;
+
+    return true;
+}
+
+bool StepParticleSorter(ParticleSorter *sorter, SimpleThreadPool *pool, Particles *particles, int frame)
+{
+    if (sorter->stage == 0)
+    {
+        if (frame % sorter->interval != 0)
+        {
+            return false;
+        }
+        sorter->stage = 1;
+    }
+    sorter->particles = particles;
+
+    if (sorter->stage == 1)
+    {
+        SimpleThreadPool_Run(pool, &sorter->keyPhase);
+        sorter->current = 0;
+        sorter->stage++;
+        return false;
+    }
+    if (sorter->stage < SORT_STAGES)
+    {
+        RunRadixPass(sorter, pool);
+        sorter->stage++;
+        return false;
+    }
+
+    // Same frame, same state: gather into the staging arrays, then copy them back in place so
+    // the caller's arrays, and the memory placement they were first touched with, stay its own
+    SimpleThreadPool_RunRange(pool, &sorter->gatherPhase);
+    SimpleThreadPool_RunRange(pool, &sorter->copyPhase);
+    sorter->stage = 0;
+    return true;
+}
+
+void FreeParticleSorter(ParticleSorter *sorter)
+{
+    for (int b = 0; b < 2; b++)
+    {
+        free(sorter->keys[b]);
+        free(sorter->order[b]);
+    }
+    FreeParticles(&sorter->staging);
+    *sorter = (ParticleSorter){0};
+}
@@ -0,0 +1,122 @@
+#include "particles.h"
+#include "platform.h"
+
+Particles CreateParticles(int count, int screenWidth, int screenHeight)
+{
+    Particles p = AllocateParticles(count);
+    InitializeParticleRange(&p, 0, count, screenWidth, screenHeight);
+    return p;
+}
+
+Particles AllocateParticles(int count)
+{
+    Particles p;
+    p.count = count;
+    p.posX = (float *)AllocateAligned(count * sizeof(float), 64);
+    p.posY = (float *)AllocateAligned(count * sizeof(float), 64);
+    p.velX = (float *)AllocateAligned(count * sizeof(float), 64);
+    p.velY = (float *)AllocateAligned(count * sizeof(float), 64);
+    return p;
+}
+
+void InitializeParticleRange(Particles *particles, int start, int end, int screenWidth, int screenHeight)
+{
+    InitializeParticleShard(particles, start, end, 0, screenWidth, screenHeight);
+}
+
+void InitializeParticleShard(Particles *particles, int start, int end, int shardStart, int screenWidth, int screenHeight)
+{
+    // Place particles in a scanline manner, starting from the top-left pixel.
+    // Continue "below" the screen if there are more particles than fit on the screen.
+    for (int i = start; i < end; ++i)
+    {
+        int x = (shardStart + i) % screenWidth;
+        int y = (shardStart + i) / screenWidth;
+
+        particles->posX[i] = (float)x;
+        particles->posY[i] = (float)y;
+
+        // Initialize velocity to zero or a small random value for initial movement
+        particles->velX[i] = 0.0f;
+        particles->velY[i] = 0.0f;
+    }
+}
+
+CompactParticles AllocateCompactParticles(int count, int screenWidth, int screenHeight)
+{
+    CompactParticles p;
+    p.count = count;
+    p.posX = (int16_t *)AllocateAligned(count * sizeof(int16_t), 64);
+    p.posY = (int16_t *)AllocateAligned(count * sizeof(int16_t), 64);
+    p.velX = (uint16_t *)AllocateAligned(count * sizeof(uint16_t), 64);
+    p.velY = (uint16_t *)AllocateAligned(count * sizeof(uint16_t), 64);
+
+    // Centred on the screen, with the finest step whose range covers the longest side to either
+    // side of the centre, half a screen length of margin past the long edges
+    int longest = screenWidth > screenHeight ? screenWidth : screenHeight;
+    p.step = 1.0f;
+    while (p.step * INT16_MAX < (float)longest)
+    {
+        p.step *= 2.0f;
+    }
+    while (p.step * 0.5f * INT16_MAX >= (float)longest)
+    {
+        p.step *= 0.5f;
+    }
+    p.inverseStep = 1.0f / p.step;
+    p.originX = (float)(screenWidth / 2);
+    p.originY = (float)(screenHeight / 2);
+    return p;
+}
+
+void InitializeCompactParticleRange(CompactParticles *particles, int start, int end, int screenWidth, int screenHeight)
+{
+    (void)screenHeight;
+
+    // Same scanline layout; whole pixels are exact in the fixed-point format
+    for (int i = start; i < end; ++i)
+    {
+        particles->posX[i] = QuantizePosition((float)(i % screenWidth), particles->originX, particles->inverseStep);
+        particles->posY[i] = QuantizePosition((float)(i / screenWidth), particles->originY, particles->inverseStep);
+        particles->velX[i] = 0;
+        particles->velY[i] = 0;
+    }
+}
+
+void PackCompactParticles(const Particles *source, CompactParticles *target, int start, int end)
+{
+    for (int i = start; i < end; i++)
+    {
+        target->posX[i] = QuantizePosition(source->posX[i], target->originX, target->inverseStep);
+        target->posY[i] = QuantizePosition(source->posY[i], target->originY, target->inverseStep);
+        target->velX[i] = FloatToHalf(source->velX[i]);
+        target->velY[i] = FloatToHalf(source->velY[i]);
+    }
+}
+
+void UnpackCompactParticles(const CompactParticles *source, Particles *target, int start, int end)
+{
+    for (int i = start; i < end; i++)
+    {
+        target->posX[i] = DequantizePosition(source->posX[i], source->originX, source->step);
+        target->posY[i] = DequantizePosition(source->posY[i], source->originY, source->step);
+        target->velX[i] = HalfToFloat(source->velX[i]);
+        target->velY[i] = HalfToFloat(source->velY[i]);
+    }
+}
+
+void FreeCompactParticles(CompactParticles *particles)
+{
+    FreeAligned(particles->posX);
+    FreeAligned(particles->posY);
+    FreeAligned(particles->velX);
+    FreeAligned(particles->velY);
+}
+
+void FreeParticles(Particles *particles)
+{
+    FreeAligned(particles->posX);
+    FreeAligned(particles->posY);
+    FreeAligned(particles->velX);
+    FreeAligned(particles->velY);
+}
@@ -0,0 +1,163 @@
+#include "pixel_buffers.h"
+#include "rlgl.h"
+
+#if defined(GRAPHICS_API_OPENGL_33) || defined(GRAPHICS_API_OPENGL_43)
+#define PIXEL_BUFFERS_AVAILABLE
+#include "external/glad.h" // Pixel buffers, buffer mapping and sync objects are not wrapped by rlgl
+#endif
+
+#include <stddef.h>
+
+/* ========================================================================= */
+/*                            Public functions                               */
+/* ========================================================================= */
+bool InitPixelBufferRing(PixelBufferRing *ring, int width, int height)
+{
+    *ring = (PixelBufferRing){.width = width, .height = height, .acquired = -1};
+
+#if defined(PIXEL_BUFFERS_AVAILABLE)
+    if (rlGetVersion() != RL_OPENGL_33 && rlGetVersion() != RL_OPENGL_43)
+    {
+        TraceLog(LOG_WARNING, "UPLOAD: Pixel buffers need an OpenGL 3.3 context");
+        return false;
+    }
+
+    const GLsizeiptr frameBytes = (GLsizeiptr)width * height * (GLsizeiptr)sizeof(Color);
+    bool mapped = true;
+#if defined(GL_MAP_PERSISTENT_BIT)
+    ring->persistent = glBufferStorage != NULL; // Core in 4.4, otherwise ARB_buffer_storage
+#endif
+
+    glGenBuffers(PIXEL_RING_BUFFERS, ring->buffers);
+    for (int b = 0; b < PIXEL_RING_BUFFERS; b++)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring->buffers[b]);
+#if defined(GL_MAP_PERSISTENT_BIT)
+        if (ring->persistent)
+        {
+            // Coherent, so the streamed pixels need no explicit flush before every upload
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_PIXEL_UNPACK_BUFFER, frameBytes, NULL, flags);
+            ring->mapped[b] = (Color *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, frameBytes, flags);
+            mapped = mapped && ring->mapped[b];
+            continue;
+        }
+#endif
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, frameBytes, NULL, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (!mapped || ring->buffers[PIXEL_RING_BUFFERS - 1] == 0)
+    {
+        TraceLog(LOG_WARNING, "UPLOAD: Failed to create the pixel buffers");
+        UnloadPixelBufferRing(ring);
+        return false;
+    }
+
+    TraceLog(LOG_INFO, "UPLOAD: %d pixel buffers of %dx%d, %s", PIXEL_RING_BUFFERS, width, height,
+             ring->persistent ? "persistently mapped" : "mapped every frame");
+    return true;
+#else
+    TraceLog(LOG_WARNING, "UPLOAD: Built without OpenGL 3.3 or 4.3, pixel buffers unavailable");
+    return false;
+#endif
+}
+
+Color *AcquirePixelBuffer(PixelBufferRing *ring)
+{
+    ring->frames++;
+    ring->acquired = -1;
+
+#if defined(PIXEL_BUFFERS_AVAILABLE)
+    // Buffers are used in order, so when the oldest upload is in flight, every later one is too
+    const int b = ring->next;
+    if (ring->fences[b])
+    {
+        if (glClientWaitSync((GLsync)ring->fences[b], 0, 0) == GL_TIMEOUT_EXPIRED)
+        {
+            ring->busyFrames++;
+            return NULL;
+        }
+        glDeleteSync((GLsync)ring->fences[b]);
+        ring->fences[b] = NULL;
+    }
+
+    if (!ring->persistent)
+    {
+        // The fence has passed, so the buffer can be mapped without the driver's implicit sync
+        const GLsizeiptr frameBytes = (GLsizeiptr)ring->width * ring->height * (GLsizeiptr)sizeof(Color);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring->buffers[b]);
+        ring->mapped[b] = (Color *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, frameBytes,
+                                                    GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if (!ring->mapped[b])
+        {
+            ring->busyFrames++;
+            return NULL;
+        }
+    }
+
+    ring->acquired = b;
+    return ring->mapped[b];
+#else
+    return NULL;
+#endif
+}
+
+void BeginPixelBufferUpload(PixelBufferRing *ring)
+{
+#if defined(PIXEL_BUFFERS_AVAILABLE)
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring->buffers[ring->acquired]);
+    if (!ring->persistent)
+    {
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        ring->mapped[ring->acquired] = NULL;
+    }
+#else
+    (void)ring;
+#endif
+}
+
+void UploadPixelBufferRows(PixelBufferRing *ring, Texture2D texture, int rowStart, int rowEnd)
+{
+#if defined(PIXEL_BUFFERS_AVAILABLE)
+    // With an unpack buffer bound, the pixel pointer is an offset into the buffer
+    const size_t offset = (size_t)rowStart * ring->width * sizeof(Color);
+    glBindTexture(GL_TEXTURE_2D, texture.id);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, rowStart, ring->width, rowEnd - rowStart, GL_RGBA, GL_UNSIGNED_BYTE,
+                    (const void *)offset);
+    glBindTexture(GL_TEXTURE_2D, 0);
+#else
+    (void)ring;
+    (void)texture;
+    (void)rowStart;
+    (void)rowEnd;
+#endif
+}
+
+void EndPixelBufferUpload(PixelBufferRing *ring)
+{
+#if defined(PIXEL_BUFFERS_AVAILABLE)
+    // Unbound before anything else uploads, or raylib's pointers would be taken as offsets
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    ring->fences[ring->acquired] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    ring->next = (ring->acquired + 1) % PIXEL_RING_BUFFERS;
+#endif
+    ring->acquired = -1;
+}
+
+void UnloadPixelBufferRing(PixelBufferRing *ring)
+{
+#if defined(PIXEL_BUFFERS_AVAILABLE)
+    for (int b = 0; b < PIXEL_RING_BUFFERS; b++)
+    {
+        if (ring->fences[b])
+        {
+            glDeleteSync((GLsync)ring->fences[b]);
+        }
+    }
+    // Deleting a buffer unmaps it, and deleting id 0 is a no-op
+    glDeleteBuffers(PIXEL_RING_BUFFERS, ring->buffers);
+#endif
+    *ring = (PixelBufferRing){.acquired = -1};
+}
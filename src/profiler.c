@@ -0,0 +1,156 @@
+#include "profiler.h"
+
+#include <stdlib.h>
+
+/* ========================================================================= */
+/*                            Defines                                        */
+/* ========================================================================= */
+#define GRAPH_COLUMN_WIDTH 2      // Pixels per frame in the graph
+#define GRAPH_HEIGHT 160          // Pixels
+#define GRAPH_PIXELS_PER_MS 8.0f  // Vertical scale, the graph clips at GRAPH_HEIGHT / GRAPH_PIXELS_PER_MS
+#define PANEL_PADDING 8
+#define TEXT_SIZE 10
+#define LINE_HEIGHT 14
+#define WORKER_BAR_WIDTH 48
+#define WORKER_COLUMNS 4
+
+static const Color PhaseColors[FRAME_PHASE_COUNT] = {
+    {102, 191, 255, 255}, // integrate: SKYBLUE
+    {255, 161, 0, 255},   // rasterize: ORANGE
+    {0, 228, 48, 255},    // combine: LIME
+    {200, 122, 255, 255}, // upload: PURPLE
+    {253, 249, 0, 255},   // present: YELLOW
+};
+
+/* ========================================================================= */
+/*                            Public functions                               */
+/* ========================================================================= */
+bool InitFrameProfiler(FrameProfiler *profiler, int workerCount, bool visible)
+{
+    *profiler = (FrameProfiler){0};
+    profiler->workerBusyMs = (float *)calloc((size_t)PROFILER_HISTORY * workerCount, sizeof(float));
+    profiler->workerCount = workerCount;
+    profiler->visible = visible;
+    return profiler->workerBusyMs != NULL;
+}
+
+void RecordProfilerFrame(FrameProfiler *profiler, const FrameTimer *timer, const double *workerBusySeconds)
+{
+    int row = profiler->head;
+    for (int phase = 0; phase < FRAME_PHASE_COUNT; phase++)
+    {
+        profiler->phaseMs[row][phase] = (float)(timer->seconds[phase] * 1000.0);
+    }
+
+    float *busy = profiler->workerBusyMs + (size_t)row * profiler->workerCount;
+    for (int w = 0; w < profiler->workerCount; w++)
+    {
+        busy[w] = (float)(workerBusySeconds[w] * 1000.0);
+    }
+
+    profiler->head = (row + 1) % PROFILER_HISTORY;
+    if (profiler->frameCount < PROFILER_HISTORY)
+    {
+        profiler->frameCount++;
+    }
+}
+
+void DrawFrameProfiler(const FrameProfiler *profiler, int x, int y, float budgetMs)
+{
+    if (!profiler->visible || profiler->frameCount == 0)
+    {
+        return;
+    }
+
+    const int frames = profiler->frameCount;
+    const int oldest = (profiler->head - frames + PROFILER_HISTORY) % PROFILER_HISTORY;
+    const int graphWidth = PROFILER_HISTORY * GRAPH_COLUMN_WIDTH;
+    const int workerRows = (profiler->workerCount + WORKER_COLUMNS - 1) / WORKER_COLUMNS;
+    const int panelHeight = GRAPH_HEIGHT + (FRAME_PHASE_COUNT + 1 + workerRows) * LINE_HEIGHT + 3 * PANEL_PADDING;
+
+    DrawRectangle(x, y, graphWidth + 2 * PANEL_PADDING, panelHeight, (Color){0, 0, 0, 170});
+
+    // Stacked graph, oldest frame on the left
+    const int graphLeft = x + PANEL_PADDING;
+    const int graphBottom = y + PANEL_PADDING + GRAPH_HEIGHT;
+    float phaseTotal[FRAME_PHASE_COUNT] = {0};
+    float phaseMax[FRAME_PHASE_COUNT] = {0};
+    float frameTotal = 0.0f;
+
+    for (int i = 0; i < frames; i++)
+    {
+        const float *row = profiler->phaseMs[(oldest + i) % PROFILER_HISTORY];
+        int columnX = graphLeft + (PROFILER_HISTORY - frames + i) * GRAPH_COLUMN_WIDTH;
+        float stackedMs = 0.0f;
+
+        for (int phase = 0; phase < FRAME_PHASE_COUNT; phase++)
+        {
+            int bottom = (int)(stackedMs * GRAPH_PIXELS_PER_MS);
+            stackedMs += row[phase];
+            int top = (int)(stackedMs * GRAPH_PIXELS_PER_MS);
+            if (top > GRAPH_HEIGHT)
+            {
+                top = GRAPH_HEIGHT;
+            }
+            if (top > bottom)
+            {
+                DrawRectangle(columnX, graphBottom - top, GRAPH_COLUMN_WIDTH, top - bottom, PhaseColors[phase]);
+            }
+
+            phaseTotal[phase] += row[phase];
+            if (row[phase] > phaseMax[phase])
+            {
+                phaseMax[phase] = row[phase];
+            }
+        }
+        frameTotal += stackedMs;
+    }
+
+    int budgetY = graphBottom - (int)(budgetMs * GRAPH_PIXELS_PER_MS);
+    if (budgetY > y + PANEL_PADDING)
+    {
+        DrawLine(graphLeft, budgetY, graphLeft + graphWidth, budgetY, RED);
+    }
+
+    // Per-phase averages and worst frame over the history
+    int textY = graphBottom + PANEL_PADDING;
+    for (int phase = 0; phase < FRAME_PHASE_COUNT; phase++)
+    {
+        DrawRectangle(graphLeft, textY + 1, TEXT_SIZE - 2, TEXT_SIZE - 2, PhaseColors[phase]);
+        DrawText(TextFormat("%-10s avg %6.3f ms  max %6.3f ms", FramePhaseNames[phase], phaseTotal[phase] / frames, phaseMax[phase]),
+                 graphLeft + TEXT_SIZE + 4, textY, TEXT_SIZE, RAYWHITE);
+        textY += LINE_HEIGHT;
+    }
+    DrawText(TextFormat("frame      avg %6.3f ms  (%d frames, budget %.2f ms)", frameTotal / frames, frames, budgetMs),
+             graphLeft + TEXT_SIZE + 4, textY, TEXT_SIZE, RAYWHITE);
+    textY += LINE_HEIGHT;
+
+    // Worker load: time spent running jobs as a share of the frame time
+    const int columnWidth = graphWidth / WORKER_COLUMNS;
+    for (int w = 0; w < profiler->workerCount; w++)
+    {
+        float busyTotal = 0.0f;
+        for (int i = 0; i < frames; i++)
+        {
+            busyTotal += profiler->workerBusyMs[(size_t)((oldest + i) % PROFILER_HISTORY) * profiler->workerCount + w];
+        }
+        float load = frameTotal > 0.0f ? busyTotal / frameTotal : 0.0f;
+        if (load > 1.0f)
+        {
+            load = 1.0f;
+        }
+
+        int cellX = graphLeft + (w % WORKER_COLUMNS) * columnWidth;
+        int cellY = textY + (w / WORKER_COLUMNS) * LINE_HEIGHT;
+        DrawText(TextFormat("w%-2d", w), cellX, cellY, TEXT_SIZE, RAYWHITE);
+        DrawRectangle(cellX + 24, cellY + 1, WORKER_BAR_WIDTH, TEXT_SIZE - 2, DARKGRAY);
+        DrawRectangle(cellX + 24, cellY + 1, (int)(WORKER_BAR_WIDTH * load), TEXT_SIZE - 2, LIME);
+        DrawText(TextFormat("%3d%%", (int)(load * 100.0f + 0.5f)), cellX + 28 + WORKER_BAR_WIDTH, cellY, TEXT_SIZE, RAYWHITE);
+    }
+}
+
+void FreeFrameProfiler(FrameProfiler *profiler)
+{
+    free(profiler->workerBusyMs);
+    profiler->workerBusyMs = NULL;
+}
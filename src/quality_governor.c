@@ -0,0 +1,162 @@
+#include "quality_governor.h"
+
+#include <math.h>
+#include <stdio.h>
+
+/* ========================================================================= */
+/*                            Private functions                              */
+/* ========================================================================= */
+
+// Time of the phases the governor holds under budget; present mostly waits for the frame cap
+static float SimulationMs(const float *phaseMs)
+{
+    float total = 0.0f;
+    for (int p = 0; p < FRAME_PHASE_COUNT; p++)
+    {
+        if (p != FRAME_PHASE_PRESENT)
+        {
+            total += phaseMs[p];
+        }
+    }
+    return total;
+}
+
+// Index of the nearest-rank p99 frame of the window
+static int FindP99Frame(const QualityGovernor *governor)
+{
+    int order[GOVERNOR_WINDOW] = {0};
+    float keys[GOVERNOR_WINDOW];
+    const int count = governor->windowFrames;
+
+    // Insertion sort, the window is small and sorted once per decision
+    for (int f = 0; f < count; f++)
+    {
+        float key = SimulationMs(governor->windowMs[f]);
+        int i = f;
+        for (; i > 0 && keys[i - 1] > key; i--)
+        {
+            keys[i] = keys[i - 1];
+            order[i] = order[i - 1];
+        }
+        keys[i] = key;
+        order[i] = f;
+    }
+
+    int rank = (int)ceil(0.99 * count);
+    return order[rank > 0 ? rank - 1 : 0];
+}
+
+static void LogDecision(const QualityGovernor *governor, const float *phaseMs, int frame, int previousCount)
+{
+    char phases[160];
+    int length = 0;
+    for (int p = 0; p < FRAME_PHASE_COUNT && length < (int)sizeof(phases); p++)
+    {
+        if (p != FRAME_PHASE_PRESENT)
+        {
+            length += snprintf(phases + length, sizeof(phases) - length, "%s%s %.2f", length ? ", " : "",
+                               FramePhaseNames[p], phaseMs[p]);
+        }
+    }
+    TraceLog(LOG_INFO, "GOVERNOR: Frame %d, p99 %.2f ms for a %.2f ms target (%s): %d -> %d particles", frame,
+             SimulationMs(phaseMs), governor->targetMs, phases, previousCount, governor->activeCount);
+}
+
+/* ========================================================================= */
+/*                            Public functions                               */
+/* ========================================================================= */
+void InitQualityGovernor(QualityGovernor *governor, int particleCount, float floorShare, float budgetMs)
+{
+    int minCount = (int)ceilf((float)particleCount * floorShare);
+    *governor = (QualityGovernor){
+        .fullCount = particleCount,
+        .minCount = minCount > 0 ? minCount : 1,
+        .activeCount = particleCount,
+        .targetMs = budgetMs * GOVERNOR_HEADROOM,
+        .recoveryMs = budgetMs * GOVERNOR_RECOVERY,
+        .lowestCount = particleCount
+    };
+}
+
+bool UpdateQualityGovernor(QualityGovernor *governor, const FrameTimer *timer, int frame)
+{
+    float *phaseMs = governor->windowMs[governor->windowFrames++];
+    for (int p = 0; p < FRAME_PHASE_COUNT; p++)
+    {
+        phaseMs[p] = (float)(timer->seconds[p] * 1000.0);
+    }
+    governor->activeSum += governor->activeCount;
+    governor->frames++;
+
+    if (governor->windowFrames < GOVERNOR_WINDOW)
+    {
+        return false;
+    }
+    governor->windowFrames = 0;
+
+    // Integration and rasterization take time in proportion to the particle count, the other
+    // phases follow the screen, so the count is sized from the share of the p99 frame they took
+    const float *p99Ms = governor->windowMs[FindP99Frame(governor)];
+    const float p99 = SimulationMs(p99Ms);
+    const float particleMs = p99Ms[FRAME_PHASE_INTEGRATE] + p99Ms[FRAME_PHASE_RASTERIZE];
+    const int previousCount = governor->activeCount;
+
+    if (p99 > governor->targetMs)
+    {
+        // A pipelined step hides behind present and leaves nothing to size the cut from
+        float cut = particleMs > 0.0f ? (p99 - governor->targetMs) / particleMs : GOVERNOR_MAX_CUT;
+        if (cut > GOVERNOR_MAX_CUT)
+        {
+            cut = GOVERNOR_MAX_CUT;
+        }
+        int count = previousCount - (int)ceilf((float)previousCount * cut);
+        governor->activeCount = count > governor->minCount ? count : governor->minCount;
+    }
+    else if (p99 < governor->recoveryMs && previousCount < governor->fullCount)
+    {
+        // Only grow by what the same estimate says still fits under the target
+        int count = previousCount + (int)ceilf((float)governor->fullCount * GOVERNOR_GROWTH);
+        count = count < governor->fullCount ? count : governor->fullCount;
+        float predicted = p99 + particleMs * (float)(count - previousCount) / (float)previousCount;
+        if (predicted < governor->targetMs)
+        {
+            governor->activeCount = count;
+        }
+    }
+
+    if (governor->activeCount == previousCount)
+    {
+        bool saturated = p99 > governor->targetMs;
+        if (saturated && !governor->saturated)
+        {
+            TraceLog(LOG_WARNING, "GOVERNOR: Frame %d, p99 %.2f ms for a %.2f ms target at the floor of %d particles",
+                     frame, p99, governor->targetMs, governor->minCount);
+        }
+        governor->saturated = saturated;
+        return false;
+    }
+
+    governor->saturated = false;
+    if (governor->activeCount < previousCount)
+    {
+        governor->cuts++;
+    }
+    else
+    {
+        governor->raises++;
+    }
+    if (governor->activeCount < governor->lowestCount)
+    {
+        governor->lowestCount = governor->activeCount;
+    }
+    LogDecision(governor, p99Ms, frame, previousCount);
+    return true;
+}
+
+void LogQualityGovernorSummary(const QualityGovernor *governor)
+{
+    const double average = governor->frames ? (double)governor->activeSum / governor->frames : governor->fullCount;
+    TraceLog(LOG_INFO, "GOVERNOR: %d frames at %.1f%% of the %d particles on average, lowest %d, %d cuts and %d raises",
+             governor->frames, 100.0 * average / governor->fullCount, governor->fullCount, governor->lowestCount,
+             governor->cuts, governor->raises);
+}
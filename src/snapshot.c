@@ -0,0 +1,376 @@
+#include "snapshot.h"
+#include "platform.h"
+#include "platform_threads.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h> // Kept out of every file that includes raylib.h, they clash
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* ========================================================================= */
+/*                            Platform layer                                 */
+/* ========================================================================= */
+// A snapshot needs a private file mapping and an atomic file replace; the background thread
+// comes from platform_threads.h.
+#if defined(_WIN32)
+static bool MapFile(const char *path, void **view, size_t *size)
+{
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER length;
+    HANDLE mapping = NULL;
+    if (GetFileSizeEx(file, &length) && length.QuadPart > 0)
+    {
+        mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    }
+    CloseHandle(file);
+    if (!mapping)
+    {
+        return false;
+    }
+
+    // The view keeps the mapping object alive on its own
+    *view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    *size = (size_t)length.QuadPart;
+    CloseHandle(mapping);
+    return *view != NULL;
+}
+
+static void UnmapFile(void *view, size_t size)
+{
+    (void)size;
+    UnmapViewOfFile(view);
+}
+
+static bool ReplaceFileWith(const char *source, const char *destination)
+{
+    return MoveFileExA(source, destination, MOVEFILE_REPLACE_EXISTING) != 0;
+}
+#else
+static bool MapFile(const char *path, void **view, size_t *size)
+{
+    int descriptor = open(path, O_RDONLY);
+    if (descriptor < 0)
+    {
+        return false;
+    }
+
+    struct stat info;
+    void *address = MAP_FAILED;
+    if (fstat(descriptor, &info) == 0 && info.st_size > 0)
+    {
+        // Private and writable: written pages are copied, the file itself is never modified
+        address = mmap(NULL, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, descriptor, 0);
+    }
+    close(descriptor);
+    if (address == MAP_FAILED)
+    {
+        return false;
+    }
+
+    *view = address;
+    *size = (size_t)info.st_size;
+    return true;
+}
+
+static void UnmapFile(void *view, size_t size)
+{
+    munmap(view, size);
+}
+
+static bool ReplaceFileWith(const char *source, const char *destination)
+{
+    return rename(source, destination) == 0;
+}
+#endif
+
+/* ========================================================================= */
+/*                            Writer                                         */
+/* ========================================================================= */
+typedef enum SnapshotWriterState
+{
+    SNAPSHOT_WRITER_IDLE,    // No thread running
+    SNAPSHOT_WRITER_WRITING, // The thread is writing the staging copy
+    SNAPSHOT_WRITER_DONE     // The thread has stored its result and is about to exit
+} SnapshotWriterState;
+
+struct SnapshotWriter
+{
+    Particles staging;         // Copy of the state being written, owned by the thread while writing
+    const Particles *source;   // State read by the staging copy phase
+    SnapshotHeader header;     // Header of the file being written
+    char path[CONFIG_PATH_LENGTH];
+    char temporaryPath[CONFIG_PATH_LENGTH + 4];
+    PlatformThread thread;
+    int state;                 // SnapshotWriterState, shared with the thread through atomics
+    SnapshotStatus result;     // Written by the thread before the state becomes DONE
+    SimpleThreadPoolRangePhase copyPhase;
+};
+
+/* ========================================================================= */
+/*                            Private functions                              */
+/* ========================================================================= */
+static uint64_t AlignUp(uint64_t value)
+{
+    return (value + SNAPSHOT_ALIGNMENT - 1) & ~(uint64_t)(SNAPSHOT_ALIGNMENT - 1);
+}
+
+static void CopyParticlesWorkCallback(void *Context, int Start, int End, int WorkerIndex)
+{
+    (void)WorkerIndex;
+    SnapshotWriter *writer = (SnapshotWriter *)Context;
+    size_t bytes = (size_t)(End - Start) * sizeof(float);
+
+    memcpy(&writer->staging.posX[Start], &writer->source->posX[Start], bytes);
+    memcpy(&writer->staging.posY[Start], &writer->source->posY[Start], bytes);
+    memcpy(&writer->staging.velX[Start], &writer->source->velX[Start], bytes);
+    memcpy(&writer->staging.velY[Start], &writer->source->velY[Start], bytes);
+}
+
+static SnapshotStatus WriteSnapshotFile(const SnapshotWriter *writer)
+{
+    static const char Padding[SNAPSHOT_ALIGNMENT] = {0};
+    const float *arrays[4] = {writer->staging.posX, writer->staging.posY, writer->staging.velX, writer->staging.velY};
+    const size_t count = (size_t)writer->header.particleCount;
+
+    FILE *file = fopen(writer->temporaryPath, "wb");
+    if (!file)
+    {
+        return SNAPSHOT_IO_ERROR;
+    }
+
+    bool ok = fwrite(&writer->header, sizeof(SnapshotHeader), 1, file) == 1;
+    uint64_t position = sizeof(SnapshotHeader);
+    for (int a = 0; a < 4 && ok; a++)
+    {
+        size_t gap = (size_t)(writer->header.arrayOffset[a] - position);
+        ok = fwrite(Padding, 1, gap, file) == gap && fwrite(arrays[a], sizeof(float), count, file) == count;
+        position = writer->header.arrayOffset[a] + count * sizeof(float);
+    }
+    ok = fclose(file) == 0 && ok;
+
+    // Only a complete file ever replaces the previous snapshot
+    if (!ok || !ReplaceFileWith(writer->temporaryPath, writer->path))
+    {
+        remove(writer->temporaryPath);
+        return SNAPSHOT_IO_ERROR;
+    }
+    return SNAPSHOT_OK;
+}
+
+static PlatformThreadResult PLATFORM_THREAD_CALL SnapshotWriterMain(void *param)
+{
+    SnapshotWriter *writer = (SnapshotWriter *)param;
+    writer->result = WriteSnapshotFile(writer);
+    __atomic_store_n(&writer->state, SNAPSHOT_WRITER_DONE, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/* ========================================================================= */
+/*                            Public functions                               */
+/* ========================================================================= */
+SnapshotStatus MapParticleSnapshot(ParticleSnapshot *snapshot, const char *path)
+{
+    *snapshot = (ParticleSnapshot){0};
+
+    void *view = NULL;
+    size_t size = 0;
+    if (!MapFile(path, &view, &size))
+    {
+        return SNAPSHOT_IO_ERROR;
+    }
+
+    SnapshotHeader header = {0};
+    SnapshotStatus status = SNAPSHOT_OK;
+    if (size < sizeof(SnapshotHeader))
+    {
+        status = SNAPSHOT_BAD_FORMAT;
+    }
+    else
+    {
+        memcpy(&header, view, sizeof(header));
+        if (header.magic != SNAPSHOT_MAGIC || header.headerSize < sizeof(SnapshotHeader) || header.particleCount <= 0)
+        {
+            status = SNAPSHOT_BAD_FORMAT;
+        }
+        else if (header.version != SNAPSHOT_VERSION)
+        {
+            status = SNAPSHOT_BAD_VERSION;
+        }
+    }
+
+    // Every array must lie inside the file, aligned for the vector kernels
+    for (int a = 0; a < 4 && status == SNAPSHOT_OK; a++)
+    {
+        uint64_t offset = header.arrayOffset[a];
+        uint64_t bytes = (uint64_t)header.particleCount * sizeof(float);
+        if (offset % 64 != 0 || offset < header.headerSize || offset > size || bytes > size - offset)
+        {
+            status = SNAPSHOT_BAD_FORMAT;
+        }
+    }
+
+    if (status != SNAPSHOT_OK)
+    {
+        UnmapFile(view, size);
+        return status;
+    }
+
+    char *base = (char *)view;
+    snapshot->header = header;
+    snapshot->view = view;
+    snapshot->viewSize = size;
+    snapshot->particles = (Particles){
+        .posX = (float *)(base + header.arrayOffset[0]),
+        .posY = (float *)(base + header.arrayOffset[1]),
+        .velX = (float *)(base + header.arrayOffset[2]),
+        .velY = (float *)(base + header.arrayOffset[3]),
+        .count = header.particleCount
+    };
+    return SNAPSHOT_OK;
+}
+
+void UnmapParticleSnapshot(ParticleSnapshot *snapshot)
+{
+    if (snapshot->view)
+    {
+        UnmapFile(snapshot->view, snapshot->viewSize);
+    }
+    *snapshot = (ParticleSnapshot){0};
+}
+
+SnapshotWriter *CreateSnapshotWriter(int particleCount)
+{
+    SnapshotWriter *writer = (SnapshotWriter *)calloc(1, sizeof(SnapshotWriter));
+    if (!writer)
+    {
+        return NULL;
+    }
+
+    writer->staging = AllocateParticles(particleCount);
+    if (!writer->staging.posX || !writer->staging.posY || !writer->staging.velX || !writer->staging.velY)
+    {
+        FreeParticles(&writer->staging);
+        free(writer);
+        return NULL;
+    }
+
+    writer->state = SNAPSHOT_WRITER_IDLE;
+    writer->copyPhase = (SimpleThreadPoolRangePhase){
+        .job = CopyParticlesWorkCallback,
+        .context = writer,
+        .itemCount = particleCount,
+        .chunkSize = SNAPSHOT_COPY_CHUNK_SIZE
+    };
+    return writer;
+}
+
+SnapshotStatus BeginSnapshotSave(SnapshotWriter *writer, SimpleThreadPool *pool, const Particles *particles,
+                                 const SimulationConfig *config, int frame, const char *path)
+{
+    int state = __atomic_load_n(&writer->state, __ATOMIC_ACQUIRE);
+    if (state == SNAPSHOT_WRITER_WRITING)
+    {
+        return SNAPSHOT_BUSY;
+    }
+    if (state == SNAPSHOT_WRITER_DONE)
+    {
+        PlatformThreadJoin(writer->thread); // Finished but not polled yet, its result is superseded
+        writer->state = SNAPSHOT_WRITER_IDLE;
+    }
+    if (strlen(path) >= sizeof(writer->path) || particles->count != writer->staging.count)
+    {
+        return SNAPSHOT_IO_ERROR;
+    }
+
+    // The thread now owns the staging copy, so the caller's arrays are free to change again
+    writer->source = particles;
+    SimpleThreadPool_RunRange(pool, &writer->copyPhase);
+    writer->source = NULL;
+
+    uint64_t arrayBytes = AlignUp((uint64_t)particles->count * sizeof(float));
+    writer->header = (SnapshotHeader){
+        .magic = SNAPSHOT_MAGIC,
+        .version = SNAPSHOT_VERSION,
+        .headerSize = sizeof(SnapshotHeader),
+        .particleCount = particles->count,
+        .screenWidth = config->screenWidth,
+        .screenHeight = config->screenHeight,
+        .frame = frame,
+        .attractionStrength = config->attractionStrength,
+        .friction = config->friction,
+        .repulsion = config->repulsion,
+        .repulsionRadius = config->repulsionRadius,
+    };
+    for (int a = 0; a < 4; a++)
+    {
+        writer->header.arrayOffset[a] = AlignUp(sizeof(SnapshotHeader)) + (uint64_t)a * arrayBytes;
+    }
+    strcpy(writer->path, path);
+    snprintf(writer->temporaryPath, sizeof(writer->temporaryPath), "%s.tmp", path);
+
+    writer->state = SNAPSHOT_WRITER_WRITING;
+    if (!PlatformThreadStart(&writer->thread, SnapshotWriterMain, writer))
+    {
+        writer->state = SNAPSHOT_WRITER_IDLE;
+        return SNAPSHOT_IO_ERROR;
+    }
+    return SNAPSHOT_OK;
+}
+
+bool PollSnapshotWriter(SnapshotWriter *writer, SnapshotStatus *status)
+{
+    if (__atomic_load_n(&writer->state, __ATOMIC_ACQUIRE) != SNAPSHOT_WRITER_DONE)
+    {
+        return false;
+    }
+
+    PlatformThreadJoin(writer->thread);
+    writer->state = SNAPSHOT_WRITER_IDLE;
+    *status = writer->result;
+    return true;
+}
+
+void DestroySnapshotWriter(SnapshotWriter *writer)
+{
+    if (!writer)
+    {
+        return;
+    }
+    if (writer->state != SNAPSHOT_WRITER_IDLE)
+    {
+        PlatformThreadJoin(writer->thread); // Let a save in progress complete rather than leave a stray temporary file
+    }
+    FreeParticles(&writer->staging);
+    free(writer);
+}
+
+const char *GetSnapshotStatusText(SnapshotStatus status)
+{
+    switch (status)
+    {
+    case SNAPSHOT_OK:
+        return "ok";
+    case SNAPSHOT_IO_ERROR:
+        return "file could not be read or written";
+    case SNAPSHOT_BAD_FORMAT:
+        return "not a snapshot or truncated";
+    case SNAPSHOT_BAD_VERSION:
+        return "unsupported snapshot version";
+    case SNAPSHOT_BUSY:
+        return "a save is already in progress";
+    }
+    return "unknown";
+}
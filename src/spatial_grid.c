@@ -0,0 +1,307 @@
+#include "spatial_grid.h"
+#include "raylib.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Own row first, so the closest candidates are examined before the cap is reached
+static const int NeighbourRows[3] = {0, -1, 1};
+
+/* ========================================================================= */
+/*                            Private functions                              */
+/* ========================================================================= */
+static inline int ClampCell(int value, int count)
+{
+    return value < 0 ? 0 : (value >= count ? count - 1 : value);
+}
+
+static void CountParticlesWorkCallback(void *Context, int WorkerIndex)
+{
+    (void)WorkerIndex;
+    GridSliceContext *slice = (GridSliceContext *)Context;
+    SpatialGrid *grid = slice->grid;
+    const Particles *particles = grid->particles;
+    int *histogram = slice->histogram;
+
+    memset(histogram, 0, (size_t)grid->cellCount * sizeof(int));
+    for (int i = slice->start; i < slice->end; i++)
+    {
+        // NaN positions convert to an out-of-range int on x86 and end up clamped like any other
+        int column = ClampCell((int)floorf(particles->posX[i] * grid->inverseCellSize), grid->columns);
+        int row = ClampCell((int)floorf(particles->posY[i] * grid->inverseCellSize), grid->rows);
+        int cell = row * grid->columns + column;
+
+        grid->particleCell[i] = cell;
+        histogram[cell]++;
+    }
+}
+
+static void SumCellsWorkCallback(void *Context, int WorkerIndex)
+{
+    (void)WorkerIndex;
+    GridScanContext *scan = (GridScanContext *)Context;
+    const SpatialGrid *grid = scan->grid;
+
+    int sum = 0;
+    for (int j = 0; j < grid->jobCount; j++)
+    {
+        const int *histogram = grid->slices[j].histogram;
+        for (int c = scan->begin; c < scan->end; c++)
+        {
+            sum += histogram[c];
+        }
+    }
+    scan->sum = sum;
+}
+
+static void OffsetCellsWorkCallback(void *Context, int WorkerIndex)
+{
+    (void)WorkerIndex;
+    GridScanContext *scan = (GridScanContext *)Context;
+    SpatialGrid *grid = scan->grid;
+
+    // Exclusive prefix over cells first and jobs second, starting from the total of the blocks
+    // before this one, gives every job its first slot in every cell
+    int running = scan->offset;
+    for (int c = scan->begin; c < scan->end; c++)
+    {
+        grid->cellStart[c] = running;
+        for (int j = 0; j < grid->jobCount; j++)
+        {
+            int *histogram = grid->slices[j].histogram;
+            int count = histogram[c];
+            histogram[c] = running;
+            running += count;
+        }
+    }
+}
+
+static void ScatterParticlesWorkCallback(void *Context, int WorkerIndex)
+{
+    (void)WorkerIndex;
+    GridSliceContext *slice = (GridSliceContext *)Context;
+    SpatialGrid *grid = slice->grid;
+    int *histogram = slice->histogram;
+
+    // Private slots filled in slice order keep every cell in ascending particle order
+    for (int i = slice->start; i < slice->end; i++)
+    {
+        grid->sorted[histogram[grid->particleCell[i]]++] = i;
+    }
+}
+
+static void GatherPositionsWorkCallback(void *Context, int Start, int End, int WorkerIndex)
+{
+    (void)WorkerIndex;
+    SpatialGrid *grid = (SpatialGrid *)Context;
+    const Particles *particles = grid->particles;
+
+    // Copy the positions next to the indices, so neighbour searches read them contiguously
+    for (int s = Start; s < End; s++)
+    {
+        int i = grid->sorted[s];
+        grid->sortedX[s] = particles->posX[i];
+        grid->sortedY[s] = particles->posY[i];
+    }
+}
+
+static void RepelParticlesWorkCallback(void *Context, int Start, int End, int WorkerIndex)
+{
+    (void)WorkerIndex;
+    SpatialGrid *grid = (SpatialGrid *)Context;
+    Particles *target = grid->target;
+    const float *sortedX = grid->sortedX;
+    const float *sortedY = grid->sortedY;
+    const float radius = grid->cellSize;
+    const float radiusSq = radius * radius;
+    const float falloff = grid->strength / radius;
+
+    for (int c = Start; c < End; c++)
+    {
+        int column = c % grid->columns;
+        int row = c / grid->columns;
+        int firstColumn = column > 0 ? column - 1 : column;
+        int lastColumn = column < grid->columns - 1 ? column + 1 : column;
+
+        for (int s = grid->cellStart[c]; s < grid->cellStart[c + 1]; s++)
+        {
+            float x = sortedX[s];
+            float y = sortedY[s];
+            float pushX = 0.0f;
+            float pushY = 0.0f;
+            int budget = GRID_MAX_NEIGHBOURS;
+
+            for (int r = 0; r < 3 && budget > 0; r++)
+            {
+                int neighbourRow = row + NeighbourRows[r];
+                if (neighbourRow < 0 || neighbourRow >= grid->rows)
+                {
+                    continue;
+                }
+
+                // The up to three cells of a row are adjacent in the sorted arrays
+                int rowStart = neighbourRow * grid->columns;
+                int begin = grid->cellStart[rowStart + firstColumn];
+                int end = grid->cellStart[rowStart + lastColumn + 1];
+                if (end - begin > budget)
+                {
+                    end = begin + budget;
+                }
+                budget -= end - begin;
+
+                for (int t = begin; t < end; t++)
+                {
+                    float dx = x - sortedX[t];
+                    float dy = y - sortedY[t];
+                    float distSq = dx * dx + dy * dy;
+
+                    // Branch-free so the loop vectorizes. The particle itself, and any coincident
+                    // one, has no direction to push along and is masked out with the far ones.
+                    float scale = falloff * (radius / sqrtf(distSq) - 1.0f); // strength * (1 - dist / radius) / dist
+                    scale = (distSq < radiusSq && distSq > 0.0f) ? scale : 0.0f;
+                    pushX += dx * scale;
+                    pushY += dy * scale;
+                }
+            }
+
+            // Only velocities are written, each by the job owning the particle's cell, and the
+            // sorted positions every job reads stay untouched for the whole phase
+            int i = grid->sorted[s];
+            target->velX[i] += pushX;
+            target->velY[i] += pushY;
+        }
+    }
+}
+
+/* ========================================================================= */
+/*                            Public functions                               */
+/* ========================================================================= */
+bool InitSpatialGrid(SpatialGrid *grid, int particleCount, int width, int height, float radius, float strength,
+                     int jobCount)
+{
+    *grid = (SpatialGrid){0};
+    grid->cellSize = radius;
+    grid->inverseCellSize = 1.0f / radius;
+    grid->strength = strength;
+    grid->columns = (int)ceilf((float)width / radius);
+    grid->rows = (int)ceilf((float)height / radius);
+    grid->cellCount = grid->columns * grid->rows;
+    grid->capacity = particleCount;
+    grid->jobCount = jobCount;
+
+    grid->cellStart = (int *)malloc(((size_t)grid->cellCount + 1) * sizeof(int));
+    grid->histograms = (int *)malloc((size_t)jobCount * grid->cellCount * sizeof(int));
+    grid->particleCell = (int *)malloc((size_t)particleCount * sizeof(int));
+    grid->sorted = (int *)malloc((size_t)particleCount * sizeof(int));
+    grid->sortedX = (float *)malloc((size_t)particleCount * sizeof(float));
+    grid->sortedY = (float *)malloc((size_t)particleCount * sizeof(float));
+    if (!grid->cellStart || !grid->histograms || !grid->particleCell || !grid->sorted || !grid->sortedX ||
+        !grid->sortedY)
+    {
+        TraceLog(LOG_ERROR, "GRID: Failed to allocate a %dx%d grid for %d particles", grid->columns, grid->rows,
+                 particleCount);
+        FreeSpatialGrid(grid);
+        return false;
+    }
+
+    // The scan splits the cells into one contiguous block per job, the count and scatter split
+    // the particles into one slice per job, set at every rebuild
+    for (int j = 0; j < jobCount; j++)
+    {
+        grid->slices[j] = (GridSliceContext){
+            .grid = grid,
+            .histogram = grid->histograms + (size_t)j * grid->cellCount
+        };
+        grid->scan[j] = (GridScanContext){
+            .grid = grid,
+            .begin = (int)((long long)grid->cellCount * j / jobCount),
+            .end = (int)((long long)grid->cellCount * (j + 1) / jobCount)
+        };
+    }
+
+    grid->sumPhase = (SimpleThreadPoolPhase){
+        .job = SumCellsWorkCallback,
+        .contexts = grid->scan,
+        .contextSize = sizeof(GridScanContext),
+        .jobCount = jobCount,
+        .pinnedJobs = true // Both passes of a block run on the same worker
+    };
+    grid->offsetPhase = grid->sumPhase;
+    grid->offsetPhase.job = OffsetCellsWorkCallback;
+
+    grid->countPhase = (SimpleThreadPoolPhase){
+        .job = CountParticlesWorkCallback,
+        .contexts = grid->slices,
+        .contextSize = sizeof(GridSliceContext),
+        .jobCount = jobCount,
+        .pinnedJobs = true // The scatter reads the cells of the slice the count just wrote
+    };
+    grid->scatterPhase = grid->countPhase;
+    grid->scatterPhase.job = ScatterParticlesWorkCallback;
+
+    grid->gatherPhase = (SimpleThreadPoolRangePhase){
+        .job = GatherPositionsWorkCallback,
+        .context = grid,
+        .itemCount = particleCount,
+        .chunkSize = GRID_PARTICLE_CHUNK_SIZE
+    };
+    grid->repelPhase = (SimpleThreadPoolRangePhase){
+        .job = RepelParticlesWorkCallback,
+        .context = grid,
+        .itemCount = grid->cellCount,
+        .chunkSize = GRID_CELL_CHUNK_SIZE
+    };
+
+    return true;
+}
+
+void RebuildSpatialGrid(SpatialGrid *grid, SimpleThreadPool *pool, const Particles *particles)
+{
+    grid->particles = particles;
+    for (int j = 0; j < grid->jobCount; j++)
+    {
+        grid->slices[j].start = (int)((long long)particles->count * j / grid->jobCount);
+        grid->slices[j].end = (int)((long long)particles->count * (j + 1) / grid->jobCount);
+    }
+    grid->gatherPhase.itemCount = particles->count;
+
+    SimpleThreadPool_Run(pool, &grid->countPhase);
+
+    // Two-pass scan: block totals in parallel, their prefix here, then the offsets in parallel
+    SimpleThreadPool_Run(pool, &grid->sumPhase);
+    int offset = 0;
+    for (int j = 0; j < grid->sumPhase.jobCount; j++)
+    {
+        grid->scan[j].offset = offset;
+        offset += grid->scan[j].sum;
+    }
+    grid->cellStart[grid->cellCount] = offset;
+    SimpleThreadPool_Run(pool, &grid->offsetPhase);
+
+    SimpleThreadPool_Run(pool, &grid->scatterPhase);
+    SimpleThreadPool_RunRange(pool, &grid->gatherPhase);
+}
+
+void ApplyParticleRepulsion(SpatialGrid *grid, SimpleThreadPool *pool, Particles *particles)
+{
+    RebuildSpatialGrid(grid, pool, particles);
+    grid->target = particles;
+    SimpleThreadPool_RunRange(pool, &grid->repelPhase);
+}
+
+void FreeSpatialGrid(SpatialGrid *grid)
+{
+    free(grid->cellStart);
+    free(grid->histograms);
+    free(grid->particleCell);
+    free(grid->sorted);
+    free(grid->sortedX);
+    free(grid->sortedY);
+    grid->cellStart = NULL;
+    grid->histograms = NULL;
+    grid->particleCell = NULL;
+    grid->sorted = NULL;
+    grid->sortedX = NULL;
+    grid->sortedY = NULL;
+}
@@ -0,0 +1,652 @@
+#if defined(_WIN32)
+#if !defined(_WIN32_WINNT) || _WIN32_WINNT < 0x0601
+#undef _WIN32_WINNT
+#define _WIN32_WINNT 0x0601 // GetLogicalProcessorInformationEx and SetThreadGroupAffinity
+#endif
+#elif !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // pthread_setaffinity_np, sched_getaffinity and the CPU_* macros
+#endif
+
+#include "platform_threads.h"
+#include "threadpool.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#if !defined(_WIN32)
+#include <sched.h>
+#include <stdio.h>
+#include <time.h>
+#endif
+
+/* ========================================================================= */
+/*                            Platform layer                                 */
+/* ========================================================================= */
+// Threads, the mutex and the condition variables come from platform_threads.h. What the pool
+// needs beyond that, a few atomic counters, a tick counter and thread affinity, maps one to
+// one onto the native primitives below.
+#if defined(_WIN32)
+typedef GROUP_AFFINITY PoolCpu; // One logical processor: its group and a single-bit mask
+
+static inline long AtomicIncrement(volatile long *value)
+{
+    return InterlockedIncrement(value);
+}
+
+static inline long AtomicDecrement(volatile long *value)
+{
+    return InterlockedDecrement(value);
+}
+
+static inline void AtomicStore(volatile long *value, long newValue)
+{
+    InterlockedExchange(value, newValue);
+}
+
+static inline long AtomicLoad(volatile long *value)
+{
+    long result = *value;
+    MemoryBarrier(); // Later reads must not move above the load
+    return result;
+}
+
+static inline long long AtomicLoad64(volatile long long *value)
+{
+    long long result = *value; // Aligned 64-bit reads are atomic on x64
+    MemoryBarrier();
+    return result;
+}
+
+static inline void AtomicStore64(volatile long long *value, long long newValue)
+{
+    InterlockedExchange64(value, newValue);
+}
+
+static inline bool AtomicCompareExchange64(volatile long long *value, long long expected, long long newValue)
+{
+    return InterlockedCompareExchange64(value, newValue, expected) == expected;
+}
+
+static inline long long ReadTicks(void)
+{
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return counter.QuadPart;
+}
+
+static inline double SecondsPerTick(void)
+{
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    return 1.0 / (double)frequency.QuadPart;
+}
+
+// Lists the logical processors, first one per physical core, then (unless skipSiblings) the
+// remaining SMT siblings of every core. Returns the number of entries written.
+static int EnumerateCpus(PoolCpu *cpus, int capacity, bool skipSiblings)
+{
+    DWORD length = 0;
+    GetLogicalProcessorInformationEx(RelationProcessorCore, NULL, &length);
+    SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *info = (SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *)malloc(length);
+    if (!info || !GetLogicalProcessorInformationEx(RelationProcessorCore, info, &length))
+    {
+        free(info);
+        return 0;
+    }
+
+    int count = 0;
+    for (int pass = 0; pass < (skipSiblings ? 1 : 2); pass++)
+    {
+        for (DWORD offset = 0; offset < length;)
+        {
+            const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *entry =
+                (const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *)((const char *)info + offset);
+            const GROUP_AFFINITY *core = &entry->Processor.GroupMask[0]; // A core never spans groups
+            int sibling = 0;
+            for (int bit = 0; bit < (int)(sizeof(KAFFINITY) * 8) && count < capacity; bit++)
+            {
+                KAFFINITY mask = (KAFFINITY)1 << bit;
+                if ((core->Mask & mask) && (sibling++ == 0) == (pass == 0))
+                {
+                    cpus[count] = (GROUP_AFFINITY){.Mask = mask, .Group = core->Group};
+                    count++;
+                }
+            }
+            offset += entry->Size;
+        }
+    }
+
+    free(info);
+    return count;
+}
+
+static inline bool PinThread(PlatformThread thread, const PoolCpu *cpu)
+{
+    return SetThreadGroupAffinity(thread, cpu, NULL) != 0;
+}
+#else
+typedef int PoolCpu; // Logical CPU number
+
+static inline long AtomicIncrement(volatile long *value)
+{
+    return __atomic_add_fetch(value, 1, __ATOMIC_SEQ_CST);
+}
+
+static inline long AtomicDecrement(volatile long *value)
+{
+    return __atomic_sub_fetch(value, 1, __ATOMIC_SEQ_CST);
+}
+
+static inline void AtomicStore(volatile long *value, long newValue)
+{
+    __atomic_store_n(value, newValue, __ATOMIC_RELEASE);
+}
+
+static inline long AtomicLoad(volatile long *value)
+{
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+static inline long long AtomicLoad64(volatile long long *value)
+{
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+static inline void AtomicStore64(volatile long long *value, long long newValue)
+{
+    __atomic_store_n(value, newValue, __ATOMIC_RELEASE);
+}
+
+static inline bool AtomicCompareExchange64(volatile long long *value, long long expected, long long newValue)
+{
+    return __atomic_compare_exchange_n(value, &expected, newValue, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static inline long long ReadTicks(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static inline double SecondsPerTick(void)
+{
+    return 1e-9;
+}
+
+// Returns the lowest SMT sibling of a CPU that this process may run on, or the CPU itself if
+// sysfs has no topology. The sibling list is ascending, in ranges like "0-3" or single CPUs
+// like "0,64", and always contains the CPU itself.
+static int FirstAllowedSibling(int cpu, const cpu_set_t *allowed)
+{
+    char path[96];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+
+    char list[256];
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        return cpu;
+    }
+    bool read = fgets(list, sizeof(list), file) != NULL;
+    fclose(file);
+
+    const char *cursor = list;
+    while (read)
+    {
+        char *end;
+        long low = strtol(cursor, &end, 10);
+        long high = low;
+        if (end == cursor)
+        {
+            break;
+        }
+        if (*end == '-')
+        {
+            cursor = end + 1;
+            high = strtol(cursor, &end, 10);
+            if (end == cursor)
+            {
+                break;
+            }
+        }
+        for (long sibling = low < 0 ? 0 : low; sibling <= high && sibling < CPU_SETSIZE; sibling++)
+        {
+            if (CPU_ISSET((int)sibling, allowed))
+            {
+                return (int)sibling;
+            }
+        }
+        read = *end == ',';
+        cursor = end + 1;
+    }
+    return cpu;
+}
+
+// Lists the CPUs this process may run on, first one per physical core, then (unless
+// skipSiblings) the remaining SMT siblings of every core. Returns the number of entries written.
+static int EnumerateCpus(PoolCpu *cpus, int capacity, bool skipSiblings)
+{
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    {
+        return 0;
+    }
+
+    int count = 0;
+    for (int pass = 0; pass < (skipSiblings ? 1 : 2); pass++)
+    {
+        for (int cpu = 0; cpu < CPU_SETSIZE && count < capacity; cpu++)
+        {
+            if (!CPU_ISSET(cpu, &allowed))
+            {
+                continue;
+            }
+            // The lowest allowed sibling stands for the core, so under taskset or a cgroup every
+            // core with an allowed CPU gets exactly one primary
+            bool primary = FirstAllowedSibling(cpu, &allowed) == cpu;
+            if (primary == (pass == 0))
+            {
+                cpus[count++] = cpu;
+            }
+        }
+    }
+    return count;
+}
+
+static inline bool PinThread(PlatformThread thread, const PoolCpu *cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(*cpu, &set);
+    return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+}
+#endif
+
+/* ========================================================================= */
+/*                            Types                                          */
+/* ========================================================================= */
+#define SIMPLE_THREADPOOL_TIMING_SLOTS 64 // Busy samples buffered per worker, power of two
+
+/**
+ * @brief Single-producer single-consumer ring of busy times.
+ *
+ * The worker pushes the time it spent running jobs each time it leaves a phase; one reader
+ * drains it with SimpleThreadPool_ConsumeBusyTime(). Neither side takes a lock. Samples are
+ * dropped while the ring is full.
+ */
+typedef struct SimpleThreadPoolTimingRing
+{
+    long long busyTicks[SIMPLE_THREADPOOL_TIMING_SLOTS]; // Tick counter deltas, one per phase
+    volatile long head; // Next slot to write, advanced by the worker only
+    volatile long tail; // Next slot to read, advanced by the reader only
+} SimpleThreadPoolTimingRing;
+
+typedef struct SimpleThreadPoolWorker
+{
+    SimpleThreadPool *pool; // Owning pool
+    PlatformThread thread;  // Thread handle, created once at init
+    int index;              // Worker index passed to the jobs
+    SimpleThreadPoolTimingRing timing; // Busy time of every phase this worker joined
+
+    // Chunks of the current range phase nobody has claimed yet, packed as [begin, end) with
+    // begin in the low and end in the high 32 bits. The worker pops from the front, the other
+    // workers steal from the back, both with a compare-exchange of the whole range.
+    volatile long long chunks;
+} SimpleThreadPoolWorker;
+
+struct SimpleThreadPool
+{
+    SimpleThreadPoolWorker *workers;
+    int threadCount;
+    int pinnedCount; // Workers bound to a single logical processor
+
+    PlatformMutex lock;          // Protects phase, generation, activeWorkers and shutdown
+    PlatformCondition workReady; // Signalled when a new phase is submitted
+    PlatformCondition workDone;  // Signalled when the last worker leaves a phase
+
+    const SimpleThreadPoolPhase *phase;           // Phase currently being executed, or NULL
+    const SimpleThreadPoolRangePhase *rangePhase; // Range phase currently being executed, or NULL
+    long generation;                    // Incremented on every submit
+    int activeWorkers;                  // Workers currently pulling jobs from the phase
+    bool shutdown;
+
+    volatile long nextJob;     // Index of the next job to hand out
+    volatile long pendingJobs; // Jobs of the current phase not yet finished
+
+    double secondsPerTick; // Tick counter period, converts busyTicks to seconds
+};
+
+/* ========================================================================= */
+/*                            Private functions                              */
+/* ========================================================================= */
+static void SimpleThreadPool_PushBusyTime(SimpleThreadPoolTimingRing *ring, long long ticks)
+{
+    long head = ring->head;
+    if (head - AtomicLoad(&ring->tail) >= SIMPLE_THREADPOOL_TIMING_SLOTS)
+    {
+        return; // Nobody is reading, drop the sample
+    }
+    ring->busyTicks[head & (SIMPLE_THREADPOOL_TIMING_SLOTS - 1)] = ticks;
+    AtomicStore(&ring->head, head + 1); // Publishes the slot before the new head
+}
+
+static inline long long PackChunks(long begin, long end)
+{
+    return (long long)((unsigned long long)(unsigned long)end << 32 | (unsigned long)begin);
+}
+
+// Claims the first or last unclaimed chunk of a worker. Returns the chunk index, or -1 if the
+// worker has none left.
+static long SimpleThreadPool_PopChunk(SimpleThreadPoolWorker *worker, bool fromBack)
+{
+    for (;;)
+    {
+        long long range = AtomicLoad64(&worker->chunks);
+        long begin = (long)(unsigned long)(range & 0xFFFFFFFF);
+        long end = (long)(unsigned long)((unsigned long long)range >> 32);
+        if (begin >= end)
+        {
+            return -1;
+        }
+
+        long chunk = fromBack ? end - 1 : begin;
+        long long remaining = fromBack ? PackChunks(begin, end - 1) : PackChunks(begin + 1, end);
+        if (AtomicCompareExchange64(&worker->chunks, range, remaining))
+        {
+            return chunk;
+        }
+    }
+}
+
+static void SimpleThreadPool_RunChunk(SimpleThreadPool *tp, const SimpleThreadPoolRangePhase *phase, long chunk, int workerIndex)
+{
+    int start = (int)(chunk * phase->chunkSize);
+    int end = start + phase->chunkSize < phase->itemCount ? start + phase->chunkSize : phase->itemCount;
+    phase->job(phase->context, start, end, workerIndex);
+    AtomicDecrement(&tp->pendingJobs);
+}
+
+// Works through the worker's own chunks front to back, then steals from the back of every
+// other worker. Nothing is ever added to a deque during a phase, so one pass over the victims
+// is enough to leave every deque empty.
+static void SimpleThreadPool_RunChunks(SimpleThreadPool *tp, SimpleThreadPoolWorker *worker, const SimpleThreadPoolRangePhase *phase)
+{
+    long chunk;
+    while ((chunk = SimpleThreadPool_PopChunk(worker, false)) >= 0)
+    {
+        SimpleThreadPool_RunChunk(tp, phase, chunk, worker->index);
+    }
+
+    for (int n = 1; n < tp->threadCount; n++)
+    {
+        SimpleThreadPoolWorker *victim = &tp->workers[(worker->index + n) % tp->threadCount];
+        while ((chunk = SimpleThreadPool_PopChunk(victim, true)) >= 0)
+        {
+            SimpleThreadPool_RunChunk(tp, phase, chunk, worker->index);
+        }
+    }
+}
+
+static PlatformThreadResult PLATFORM_THREAD_CALL SimpleThreadPool_WorkerMain(void *param)
+{
+    SimpleThreadPoolWorker *worker = (SimpleThreadPoolWorker *)param;
+    SimpleThreadPool *tp = worker->pool;
+    long seenGeneration = 0;
+
+    PlatformMutexLock(&tp->lock);
+    for (;;)
+    {
+        // Sleep until a phase we have not joined yet still has unfinished jobs. A worker that
+        // wakes up after the phase is already done must not join it, otherwise it could pull
+        // job indices of the next phase while still holding the old descriptor.
+        while (!tp->shutdown && (tp->generation == seenGeneration || tp->pendingJobs == 0))
+        {
+            PlatformConditionWait(&tp->workReady, &tp->lock);
+        }
+        if (tp->shutdown)
+        {
+            break;
+        }
+
+        seenGeneration = tp->generation;
+        const SimpleThreadPoolPhase *phase = tp->phase;
+        const SimpleThreadPoolRangePhase *rangePhase = tp->rangePhase;
+        tp->activeWorkers++;
+        PlatformMutexUnlock(&tp->lock);
+
+        // Work through the chunks of a range phase, run our share of a pinned phase, or pull
+        // jobs until the phase runs dry
+        long long busyStart = ReadTicks();
+        if (rangePhase)
+        {
+            SimpleThreadPool_RunChunks(tp, worker, rangePhase);
+        }
+        else if (phase->pinnedJobs)
+        {
+            for (long job = worker->index; job < phase->jobCount; job += tp->threadCount)
+            {
+                phase->job((char *)phase->contexts + (size_t)job * phase->contextSize, worker->index);
+                AtomicDecrement(&tp->pendingJobs);
+            }
+        }
+        else
+        {
+            long job;
+            while ((job = AtomicIncrement(&tp->nextJob) - 1) < phase->jobCount)
+            {
+                phase->job((char *)phase->contexts + (size_t)job * phase->contextSize, worker->index);
+                AtomicDecrement(&tp->pendingJobs);
+            }
+        }
+        SimpleThreadPool_PushBusyTime(&worker->timing, ReadTicks() - busyStart);
+
+        PlatformMutexLock(&tp->lock);
+        tp->activeWorkers--;
+        if (tp->activeWorkers == 0 && tp->pendingJobs == 0)
+        {
+            PlatformConditionWakeAll(&tp->workDone);
+        }
+    }
+    PlatformMutexUnlock(&tp->lock);
+
+    return 0;
+}
+
+/* ========================================================================= */
+/*                            Public functions                               */
+/* ========================================================================= */
+SimpleThreadPool *SimpleThreadPool_Init(int threadCount, SimpleThreadPoolPinning pinning)
+{
+    SimpleThreadPool *tp = (SimpleThreadPool *)calloc(1, sizeof(SimpleThreadPool));
+    if (!tp)
+    {
+        return NULL;
+    }
+
+    tp->workers = (SimpleThreadPoolWorker *)calloc(threadCount, sizeof(SimpleThreadPoolWorker));
+    if (!tp->workers)
+    {
+        free(tp);
+        return NULL;
+    }
+
+    PlatformMutexInit(&tp->lock);
+    PlatformConditionInit(&tp->workReady);
+    PlatformConditionInit(&tp->workDone);
+    tp->secondsPerTick = SecondsPerTick();
+
+    // Worker i goes to entry i of the CPU list, wrapping around if there are more workers
+    PoolCpu *cpus = NULL;
+    int cpuCount = 0;
+    if (pinning != SIMPLE_THREADPOOL_PIN_NONE)
+    {
+        cpus = (PoolCpu *)malloc(threadCount * sizeof(PoolCpu));
+        cpuCount = cpus ? EnumerateCpus(cpus, threadCount, pinning == SIMPLE_THREADPOOL_PIN_CORES) : 0;
+    }
+
+    for (int i = 0; i < threadCount; i++)
+    {
+        SimpleThreadPoolWorker *worker = &tp->workers[i];
+        worker->pool = tp;
+        worker->index = i;
+        if (!PlatformThreadStart(&worker->thread, SimpleThreadPool_WorkerMain, worker))
+        {
+            // Keep the threads that did start; they are enough to drain every phase.
+            break;
+        }
+        tp->threadCount++;
+
+        // The new thread sleeps until the first submit, so it is in place before any job runs
+        if (cpuCount > 0 && PinThread(worker->thread, &cpus[i % cpuCount]))
+        {
+            tp->pinnedCount++;
+        }
+    }
+    free(cpus);
+
+    if (tp->threadCount == 0)
+    {
+        PlatformConditionDestroy(&tp->workDone);
+        PlatformConditionDestroy(&tp->workReady);
+        PlatformMutexDestroy(&tp->lock);
+        free(tp->workers);
+        free(tp);
+        return NULL;
+    }
+
+    return tp;
+}
+
+int SimpleThreadPool_ThreadCount(const SimpleThreadPool *tp)
+{
+    return tp->threadCount;
+}
+
+int SimpleThreadPool_PinnedCount(const SimpleThreadPool *tp)
+{
+    return tp->pinnedCount;
+}
+
+void SimpleThreadPool_Submit(SimpleThreadPool *tp, const SimpleThreadPoolPhase *phase)
+{
+    if (phase->jobCount <= 0)
+    {
+        return;
+    }
+
+    PlatformMutexLock(&tp->lock);
+    tp->phase = phase;
+    tp->rangePhase = NULL;
+    tp->nextJob = 0;
+    tp->pendingJobs = phase->jobCount;
+    tp->generation++;
+    PlatformConditionWakeAll(&tp->workReady);
+    PlatformMutexUnlock(&tp->lock);
+}
+
+void SimpleThreadPool_SubmitRange(SimpleThreadPool *tp, const SimpleThreadPoolRangePhase *phase)
+{
+    long chunkCount = (phase->itemCount + phase->chunkSize - 1) / phase->chunkSize;
+    if (chunkCount <= 0)
+    {
+        return;
+    }
+
+    PlatformMutexLock(&tp->lock);
+    for (int i = 0; i < tp->threadCount; i++)
+    {
+        // Same split as SimpleThreadPool_GetHomeRange(), in chunks instead of items
+        long begin = (long)((long long)chunkCount * i / tp->threadCount);
+        long end = (long)((long long)chunkCount * (i + 1) / tp->threadCount);
+        AtomicStore64(&tp->workers[i].chunks, PackChunks(begin, end));
+    }
+    tp->phase = NULL;
+    tp->rangePhase = phase;
+    tp->pendingJobs = chunkCount;
+    tp->generation++;
+    PlatformConditionWakeAll(&tp->workReady);
+    PlatformMutexUnlock(&tp->lock);
+}
+
+void SimpleThreadPool_Wait(SimpleThreadPool *tp)
+{
+    PlatformMutexLock(&tp->lock);
+    while (tp->pendingJobs != 0 || tp->activeWorkers != 0)
+    {
+        PlatformConditionWait(&tp->workDone, &tp->lock);
+    }
+    PlatformMutexUnlock(&tp->lock);
+}
+
+void SimpleThreadPool_Run(SimpleThreadPool *tp, const SimpleThreadPoolPhase *phase)
+{
+    SimpleThreadPool_Submit(tp, phase);
+    SimpleThreadPool_Wait(tp);
+}
+
+void SimpleThreadPool_RunRange(SimpleThreadPool *tp, const SimpleThreadPoolRangePhase *phase)
+{
+    SimpleThreadPool_SubmitRange(tp, phase);
+    SimpleThreadPool_Wait(tp);
+}
+
+void SimpleThreadPool_GetHomeRange(const SimpleThreadPool *tp, const SimpleThreadPoolRangePhase *phase, int workerIndex,
+                                   int *start, int *end)
+{
+    long long chunkCount = (phase->itemCount + phase->chunkSize - 1) / phase->chunkSize;
+    long long first = chunkCount * workerIndex / tp->threadCount;
+    long long last = chunkCount * (workerIndex + 1) / tp->threadCount;
+
+    *start = (int)(first * phase->chunkSize);
+    *end = last * phase->chunkSize < phase->itemCount ? (int)(last * phase->chunkSize) : phase->itemCount;
+    if (*start > *end)
+    {
+        *start = *end;
+    }
+}
+
+double SimpleThreadPool_ConsumeBusyTime(SimpleThreadPool *tp, int workerIndex)
+{
+    SimpleThreadPoolTimingRing *ring = &tp->workers[workerIndex].timing;
+    long head = AtomicLoad(&ring->head); // Read the slots only after the head that published them
+    long tail = ring->tail;
+
+    long long ticks = 0;
+    for (; tail != head; tail++)
+    {
+        ticks += ring->busyTicks[tail & (SIMPLE_THREADPOOL_TIMING_SLOTS - 1)];
+    }
+    AtomicStore(&ring->tail, tail); // Hands the slots back to the worker
+
+    return (double)ticks * tp->secondsPerTick;
+}
+
+double SimpleThreadPool_GetTime(void)
+{
+    return (double)ReadTicks() * SecondsPerTick();
+}
+
+void SimpleThreadPool_Destroy(SimpleThreadPool *tp)
+{
+    if (!tp)
+    {
+        return;
+    }
+
+    PlatformMutexLock(&tp->lock);
+    tp->shutdown = true;
+    PlatformConditionWakeAll(&tp->workReady);
+    PlatformMutexUnlock(&tp->lock);
+
+    for (int i = 0; i < tp->threadCount; i++)
+    {
+        PlatformThreadJoin(tp->workers[i].thread);
+    }
+
+    PlatformConditionDestroy(&tp->workDone);
+    PlatformConditionDestroy(&tp->workReady);
+    PlatformMutexDestroy(&tp->lock);
+    free(tp->workers);
+    free(tp);
+}